@@ -38,22 +38,46 @@
 #if EI_CLASSIFIER_OBJECT_DETECTION != 1
 
 #include <stdint.h>
+#include <string.h>
+
+/**
+ * How ei_classifier_smooth_update() combines readings
+ */
+typedef enum {
+    /** Label that at least min_readings_same of the last n_readings agree on */
+    EI_CLASSIFIER_SMOOTH_MAJORITY = 0,
+    /** Exponential moving average (over ~n_readings) of the scores, top label
+     *  if it's above classifier_confidence */
+    EI_CLASSIFIER_SMOOTH_EMA = 1,
+    /** EMA, but a label is kept until its average drops below
+     *  release_confidence, and only replaced by one above classifier_confidence */
+    EI_CLASSIFIER_SMOOTH_HYSTERESIS = 2,
+} ei_classifier_smooth_mode_t;
 
 typedef struct ei_classifier_smooth {
     int *last_readings;
     size_t last_readings_size;
+    size_t last_readings_head; // oldest reading, overwritten by the next one
     uint8_t min_readings_same;
     float classifier_confidence;
     float anomaly_confidence;
-    uint8_t count[EI_CLASSIFIER_LABEL_COUNT + 2] = { 0 };
+    // readings per label in last_readings, then uncertain and anomaly
+    uint16_t count[EI_CLASSIFIER_LABEL_COUNT + 2] = { 0 };
     size_t count_size = EI_CLASSIFIER_LABEL_COUNT + 2;
+    ei_classifier_smooth_mode_t mode;
+    float ema_alpha;
+    float release_confidence;
+    // averaged scores per label, then the averaged anomaly score
+    float ema[EI_CLASSIFIER_LABEL_COUNT + 1] = { 0 };
+    bool ema_valid;
+    int current; // last reported label (HYSTERESIS), -1 uncertain, -2 anomaly
 } ei_classifier_smooth_t;
 
 /**
  * Initialize a smooth structure. This is useful if you don't want to trust
  * single readings, but rather want consensus
  * (e.g. 7 / 10 readings should be the same before I draw any ML conclusions).
- * This allocates memory on the heap!
+ * This allocates memory on the heap, release it with ei_classifier_smooth_free()!
  * @param smooth Pointer to an uninitialized ei_classifier_smooth_t struct
  * @param n_readings Number of readings you want to store
  * @param min_readings_same Minimum readings that need to be the same before concluding (needs to be lower than n_readings)
@@ -64,14 +88,93 @@ void ei_classifier_smooth_init(ei_classifier_smooth_t *smooth, size_t n_readings
                                uint8_t min_readings_same, float classifier_confidence = 0.8,
                                float anomaly_confidence = 0.3) {
     smooth->last_readings = (int*)ei_malloc(n_readings * sizeof(int));
+    if (!smooth->last_readings) {
+        n_readings = 0;
+    }
     for (size_t ix = 0; ix < n_readings; ix++) {
         smooth->last_readings[ix] = -1; // -1 == uncertain
     }
     smooth->last_readings_size = n_readings;
+    smooth->last_readings_head = 0;
     smooth->min_readings_same = min_readings_same;
     smooth->classifier_confidence = classifier_confidence;
     smooth->anomaly_confidence = anomaly_confidence;
     smooth->count_size = EI_CLASSIFIER_LABEL_COUNT + 2;
+
+    memset(smooth->count, 0, sizeof(smooth->count));
+    smooth->count[EI_CLASSIFIER_LABEL_COUNT] = n_readings;
+
+    smooth->mode = EI_CLASSIFIER_SMOOTH_MAJORITY;
+    smooth->ema_alpha = 2.0f / (n_readings + 1);
+    smooth->release_confidence = classifier_confidence;
+    memset(smooth->ema, 0, sizeof(smooth->ema));
+    smooth->ema_valid = false;
+    smooth->current = -1;
+}
+
+/**
+ * Switch to EMA or hysteresis smoothing (call after ei_classifier_smooth_init)
+ * @param smooth Pointer to an initialized ei_classifier_smooth_t struct
+ * @param mode See ei_classifier_smooth_mode_t
+ * @param release_confidence HYSTERESIS only, the reported label is kept until its
+ *                           average drops below this (lower than classifier_confidence)
+ */
+void ei_classifier_smooth_set_mode(ei_classifier_smooth_t *smooth, ei_classifier_smooth_mode_t mode,
+                                   float release_confidence = 0.6) {
+    smooth->mode = mode;
+    smooth->release_confidence = release_confidence;
+    smooth->ema_valid = false;
+    smooth->current = -1;
+}
+
+/**
+ * @brief Map a reading (label index, -1 uncertain, -2 anomaly) to a label
+ */
+static const char *ei_classifier_smooth_label(ei_impulse_result_t *result, int reading) {
+    if (reading == -2) {
+        return "anomaly";
+    }
+    if (reading < 0) {
+        return "uncertain";
+    }
+    return result->classification[reading].label;
+}
+
+static const char* ei_classifier_smooth_update_ema(ei_classifier_smooth_t *smooth, ei_impulse_result_t *result) {
+    const float alpha = smooth->ema_valid ? smooth->ema_alpha : 1.0f;
+
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        smooth->ema[ix] += alpha * (result->classification[ix].value - smooth->ema[ix]);
+    }
+    smooth->ema[EI_CLASSIFIER_LABEL_COUNT] += alpha * (result->anomaly - smooth->ema[EI_CLASSIFIER_LABEL_COUNT]);
+    smooth->ema_valid = true;
+
+    int top = -1;
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        if (top < 0 || smooth->ema[ix] > smooth->ema[top]) {
+            top = (int)ix;
+        }
+    }
+
+    int reading = -1;
+    if (smooth->ema[EI_CLASSIFIER_LABEL_COUNT] >= smooth->anomaly_confidence) {
+        reading = -2;
+    }
+    else if (top >= 0 && smooth->ema[top] >= smooth->classifier_confidence) {
+        reading = top;
+    }
+
+    if (smooth->mode == EI_CLASSIFIER_SMOOTH_HYSTERESIS) {
+        // hold the current label while it's above the release level, unless
+        // something else made it over the (higher) entry level, or it's an anomaly
+        if (reading == -1 && smooth->current >= 0 &&
+            smooth->ema[smooth->current] >= smooth->release_confidence) {
+            reading = smooth->current;
+        }
+        smooth->current = reading;
+    }
+
+    return ei_classifier_smooth_label(result, reading);
 }
 
 /**
@@ -81,16 +184,16 @@ void ei_classifier_smooth_init(ei_classifier_smooth_t *smooth, size_t n_readings
  * @returns Label, either 'uncertain', 'anomaly', or a label from the result struct
  */
 const char* ei_classifier_smooth_update(ei_classifier_smooth_t *smooth, ei_impulse_result_t *result) {
-    // clear out the count array
-    memset(smooth->count, 0, EI_CLASSIFIER_LABEL_COUNT + 2);
+    if (smooth->mode != EI_CLASSIFIER_SMOOTH_MAJORITY) {
+        return ei_classifier_smooth_update_ema(smooth, result);
+    }
 
-    // roll through the last_readings buffer
-    numpy::roll(smooth->last_readings, smooth->last_readings_size, -1);
+    if (smooth->last_readings_size == 0) {
+        return "uncertain";
+    }
 
     int reading = -1; // uncertain
 
-    // print the predictions
-    // printf("[");
     for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
         if (result->classification[ix].value >= smooth->classifier_confidence) {
             reading = (int)ix;
@@ -100,24 +203,19 @@ const char* ei_classifier_smooth_update(ei_classifier_smooth_t *smooth, ei_impul
         reading = -2; // anomaly
     }
 
-    smooth->last_readings[smooth->last_readings_size - 1] = reading;
+    // replace the oldest reading, and keep the counts up to date
+    int *oldest = &smooth->last_readings[smooth->last_readings_head];
+    smooth->count[*oldest >= 0 ? *oldest : EI_CLASSIFIER_LABEL_COUNT - 1 - *oldest]--;
+    smooth->count[reading >= 0 ? reading : EI_CLASSIFIER_LABEL_COUNT - 1 - reading]++;
+    *oldest = reading;
 
-    // now count last 10 readings and see what we actually see...
-    for (size_t ix = 0; ix < smooth->last_readings_size; ix++) {
-        if (smooth->last_readings[ix] >= 0) {
-            smooth->count[smooth->last_readings[ix]]++;
-        }
-        else if (smooth->last_readings[ix] == -1) { // uncertain
-            smooth->count[EI_CLASSIFIER_LABEL_COUNT]++;
-        }
-        else if (smooth->last_readings[ix] == -2) { // anomaly
-            smooth->count[EI_CLASSIFIER_LABEL_COUNT + 1]++;
-        }
+    if (++smooth->last_readings_head == smooth->last_readings_size) {
+        smooth->last_readings_head = 0;
     }
 
     // then loop over the count and see which is highest
     uint8_t top_result = 0;
-    uint8_t top_count = 0;
+    uint16_t top_count = 0;
     bool met_confidence_threshold = false;
     uint8_t confidence_threshold = smooth->min_readings_same; // XX% of windows should be the same
     for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT + 2; ix++) {
@@ -145,10 +243,15 @@ const char* ei_classifier_smooth_update(ei_classifier_smooth_t *smooth, ei_impul
 }
 
 /**
- * Clear up a smooth structure
+ * Clear up a smooth structure, it needs ei_classifier_smooth_init()
+ * before it can be used again
  */
 void ei_classifier_smooth_free(ei_classifier_smooth_t *smooth) {
     ei_free(smooth->last_readings);
+    smooth->last_readings = nullptr;
+    smooth->last_readings_size = 0;
+    smooth->last_readings_head = 0;
+    memset(smooth->count, 0, sizeof(smooth->count));
 }
 
 #endif // #if EI_CLASSIFIER_OBJECT_DETECTION != 1
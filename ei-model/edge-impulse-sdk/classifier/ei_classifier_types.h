@@ -44,6 +44,11 @@
 #define EI_CLASSIFIER_MAX_OBJECT_DETECTION_COUNT 10
 #endif
 
+// Cheap energy / stability gate that can skip DSP and learning blocks, see ei_impulse_gate.h
+#ifndef EI_CLASSIFIER_GATE_ENABLED
+#define EI_CLASSIFIER_GATE_ENABLED 0
+#endif
+
 // Whether ei_result_t classification field is statically allocated on the result struct or not
 #if defined(EI_DSP_RESULT_OVERRIDE)
 #define EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED    0
@@ -247,6 +252,36 @@ typedef struct {
     float heart_rate;
 } ei_impulse_result_hr_t;
 
+/**
+ * @brief Decision taken by the impulse gate (see ei_impulse_gate.h)
+ */
+typedef enum {
+    EI_GATE_RAN = 0,                /**< Full impulse was run */
+    EI_GATE_SKIPPED_LOW_ENERGY = 1, /**< Signal energy below threshold, idle label reported */
+    EI_GATE_SKIPPED_STABLE = 2,     /**< Previous result was stable, previous result reported */
+} ei_gate_decision_t;
+
+/**
+ * @brief Holds the result of the impulse gate
+ *
+*/
+typedef struct {
+    /**
+     * One of ei_gate_decision_t
+     */
+    uint8_t decision;
+
+    /**
+     * Signal energy (largest per-axis standard deviation) of this window
+     */
+    float energy;
+
+    /**
+     * Energy threshold in use (configured or learned)
+     */
+    float threshold;
+} ei_impulse_result_gate_t;
+
 /**
  * @brief Holds the output of inference, anomaly results, and timing information.
  *
@@ -345,6 +380,12 @@ typedef struct {
 #if EI_CLASSIFIER_HR_ENABLED == 1
     ei_impulse_result_hr_t hr_calcs;
 #endif
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    /**
+     * Impulse gate decision, tells whether the learning blocks ran for this window.
+     */
+    ei_impulse_result_gate_t gate;
+#endif
 } ei_impulse_result_t;
 
 /** @} */
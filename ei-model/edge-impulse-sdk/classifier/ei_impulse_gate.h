@@ -0,0 +1,343 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _EI_CLASSIFIER_IMPULSE_GATE_H_
+#define _EI_CLASSIFIER_IMPULSE_GATE_H_
+
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/classifier/ei_model_types.h"
+#include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include <math.h>
+#include <string.h>
+
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+
+/**
+ * The impulse gate runs before the DSP blocks and decides whether the rest of
+ * the impulse needs to run for a window. A window is skipped when:
+ *  - the signal energy is below a configured or learned threshold; the idle
+ *    label is reported with confidence 1.0, or
+ *  - the top class has been the same for a number of windows and the energy
+ *    hardly moved; the previous result is reported again.
+ *
+ * Energy is the largest per-axis standard deviation of the raw window. That
+ * is the RMS the spectral analysis block computes after removing the mean,
+ * but it's available without running the filter or the FFT.
+ *
+ * The decision is stored in result->gate.
+ *
+ * The learned threshold is learn_margin times the average energy of the windows
+ * classified as idle. Windows skipped as idle pull that average down (never up),
+ * so it adapts in both directions without the skipped windows raising it.
+ *
+ * The gate runs in run_classifier() (full windows) only. run_classifier_continuous()
+ * isn't gated: every slice has to go through the DSP to keep the rolling feature
+ * matrix complete, and the slice DSP is most of the cost.
+ */
+
+#ifndef EI_GATE_MAX_AXES
+#define EI_GATE_MAX_AXES        16
+#endif
+
+#ifndef EI_GATE_CHUNK_SIZE
+#define EI_GATE_CHUNK_SIZE      96
+#endif
+
+// learned energy becomes an exponential moving average after this many windows
+#define EI_GATE_LEARN_WINDOWS   64
+
+/**
+ * @brief      Largest per-axis standard deviation of a raw window
+ *
+ * @param      impulse  Impulse, used for the number of interleaved axes
+ * @param      signal   Raw window
+ * @param      energy   Output energy
+ *
+ * @return     EIDSP_OK if successful
+ */
+static int ei_gate_signal_energy(const ei_impulse_t *impulse, ei::signal_t *signal, float *energy)
+{
+    // more axes than we track: treat the window as one channel
+    size_t axes = impulse->raw_samples_per_frame;
+    if (axes == 0 || axes > EI_GATE_MAX_AXES) {
+        axes = 1;
+    }
+
+    float chunk[EI_GATE_CHUNK_SIZE];
+    float ref[EI_GATE_MAX_AXES];
+    float sum[EI_GATE_MAX_AXES] = { 0 };
+    float sum_sq[EI_GATE_MAX_AXES] = { 0 };
+    const size_t chunk_size = (EI_GATE_CHUNK_SIZE / axes) * axes;
+    size_t count = 0;
+
+    for (size_t offset = 0; offset < signal->total_length; offset += chunk_size) {
+        size_t length = signal->total_length - offset;
+        if (length > chunk_size) {
+            length = chunk_size;
+        }
+
+        int ret = signal->get_data(offset, length, chunk);
+        if (ret != EIDSP_OK) {
+            return ret;
+        }
+
+        if (offset == 0) {
+            // shift by the first frame to keep the float sums well conditioned (gravity on accelerometers)
+            for (size_t ax = 0; ax < axes && ax < length; ax++) {
+                ref[ax] = chunk[ax];
+            }
+        }
+
+        for (size_t ix = 0; ix < length; ix++) {
+            size_t ax = ix % axes;
+            float v = chunk[ix] - ref[ax];
+            sum[ax] += v;
+            sum_sq[ax] += v * v;
+        }
+        count += length;
+    }
+
+    size_t frames = count / axes;
+    float max_var = 0.0f;
+
+    for (size_t ax = 0; ax < axes && frames > 0; ax++) {
+        float mean = sum[ax] / frames;
+        float var = (sum_sq[ax] / frames) - (mean * mean);
+        if (var > max_var) {
+            max_var = var;
+        }
+    }
+
+    *energy = sqrtf(max_var);
+
+    return EIDSP_OK;
+}
+
+/**
+ * @brief      Reset the gate history (stable counters and previous result).
+ *             The learned energy threshold is kept.
+ */
+__attribute__((unused)) static void ei_gate_reset(ei_impulse_handle_t *handle)
+{
+    ei_impulse_gate_state_t *state = &handle->gate_state;
+
+    state->last_energy = 0.0f;
+    state->last_top_ix = -1;
+    state->stable_count = 0;
+    state->skipped_count = 0;
+    state->last_anomaly = 0.0f;
+}
+
+/**
+ * @brief      Run the gate for a new window
+ *
+ * @param      handle  Impulse handle
+ * @param      signal  Raw window
+ * @param      result  Result struct, filled in when the window is skipped
+ *
+ * @return     true if the rest of the impulse should be skipped
+ */
+static bool ei_gate_check(ei_impulse_handle_t *handle, ei::signal_t *signal, ei_impulse_result_t *result)
+{
+    const ei_impulse_gate_config_t *config = handle->gate_config;
+    ei_impulse_gate_state_t *state = &handle->gate_state;
+    const ei_impulse_t *impulse = handle->impulse;
+
+    result->gate.decision = EI_GATE_RAN;
+
+    if (config == nullptr) {
+        return false;
+    }
+
+    float energy;
+    if (ei_gate_signal_energy(impulse, signal, &energy) != EIDSP_OK) {
+        return false;
+    }
+
+    float threshold = config->energy_threshold;
+    if (config->learn_margin > 0.0f && state->learned_count > 0) {
+        float learned = config->learn_margin * state->learned_energy;
+        if (learned > threshold) {
+            threshold = learned;
+        }
+    }
+
+    result->gate.energy = energy;
+    result->gate.threshold = threshold;
+
+    uint8_t decision = EI_GATE_RAN;
+
+    if (config->max_skipped != 0 && state->skipped_count >= config->max_skipped) {
+        decision = EI_GATE_RAN;
+    }
+    else if (threshold > 0.0f && energy < threshold) {
+        decision = EI_GATE_SKIPPED_LOW_ENERGY;
+    }
+    else if (config->stable_windows != 0
+             && state->last_top_ix >= 0
+             && state->stable_count >= config->stable_windows
+             && fabsf(energy - state->last_energy) <= config->stable_energy_delta * state->last_energy) {
+        decision = EI_GATE_SKIPPED_STABLE;
+    }
+
+    result->gate.decision = decision;
+
+    if (decision == EI_GATE_RAN) {
+        state->skipped_count = 0;
+        return false;
+    }
+
+    state->skipped_count++;
+
+    // skipped idle windows can only pull the learned energy down, so the threshold
+    // follows a quieter sensor but doesn't feed on itself
+    if (decision == EI_GATE_SKIPPED_LOW_ENERGY && config->learn_margin > 0.0f
+        && state->learned_count > 0 && energy < state->learned_energy) {
+        state->learned_energy += (energy - state->learned_energy) / state->learned_count;
+    }
+
+    for (uint16_t ix = 0; ix < impulse->label_count; ix++) {
+        result->classification[ix].label = impulse->categories[ix];
+        if (decision == EI_GATE_SKIPPED_LOW_ENERGY) {
+            result->classification[ix].value = (ix == config->idle_label_ix) ? 1.0f : 0.0f;
+        }
+        else {
+            result->classification[ix].value = state->last_values[ix];
+        }
+    }
+    result->anomaly = (decision == EI_GATE_SKIPPED_STABLE) ? state->last_anomaly : 0.0f;
+
+    return true;
+}
+
+/**
+ * @brief      Feed the result of a full run back into the gate (stability and learned threshold)
+ */
+static void ei_gate_update(ei_impulse_handle_t *handle, ei_impulse_result_t *result)
+{
+    const ei_impulse_gate_config_t *config = handle->gate_config;
+    ei_impulse_gate_state_t *state = &handle->gate_state;
+    const ei_impulse_t *impulse = handle->impulse;
+
+    if (config == nullptr || impulse->label_count == 0) {
+        return;
+    }
+
+    int16_t top_ix = 0;
+    for (uint16_t ix = 0; ix < impulse->label_count; ix++) {
+        state->last_values[ix] = result->classification[ix].value;
+        if (result->classification[ix].value > result->classification[top_ix].value) {
+            top_ix = ix;
+        }
+    }
+
+    if (top_ix == state->last_top_ix) {
+        if (state->stable_count < UINT16_MAX) {
+            state->stable_count++;
+        }
+    }
+    else {
+        state->stable_count = 0;
+    }
+
+    state->last_top_ix = top_ix;
+    state->last_energy = result->gate.energy;
+    state->last_anomaly = result->anomaly;
+
+    if (config->learn_margin > 0.0f
+        && top_ix == config->idle_label_ix
+        && result->classification[top_ix].value >= config->learn_min_confidence) {
+        if (state->learned_count < EI_GATE_LEARN_WINDOWS) {
+            state->learned_count++;
+        }
+        state->learned_energy += (result->gate.energy - state->learned_energy) / state->learned_count;
+    }
+}
+
+/**
+ * @brief      Enable or disable the impulse gate
+ *
+ * The config is not copied and has to stay valid while the gate is enabled.
+ * Only classification impulses are supported.
+ *
+ * @param      handle  Impulse handle (e.g. &ei_default_impulse)
+ * @param      config  Gate configuration, nullptr disables the gate
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR ei_set_impulse_gate(ei_impulse_handle_t *handle,
+                                                             const ei_impulse_gate_config_t *config)
+{
+    if (handle == nullptr || handle->impulse == nullptr) {
+        return EI_IMPULSE_INFERENCE_ERROR;
+    }
+
+    ei_impulse_gate_state_t *state = &handle->gate_state;
+
+    if (state->last_values) {
+        ei_free(state->last_values);
+        state->last_values = nullptr;
+    }
+    handle->gate_config = nullptr;
+
+    if (config == nullptr) {
+        return EI_IMPULSE_OK;
+    }
+
+    const ei_impulse_t *impulse = handle->impulse;
+    if (impulse->results_type != EI_CLASSIFIER_TYPE_CLASSIFICATION
+        || config->idle_label_ix >= impulse->label_count) {
+        ei_printf("ERR: Impulse gate is only supported for classification, with a valid idle label\n");
+        return EI_IMPULSE_INFERENCE_ERROR;
+    }
+
+    state->last_values = (float *)ei_calloc(impulse->label_count, sizeof(float));
+    if (state->last_values == nullptr) {
+        return EI_IMPULSE_OUT_OF_MEMORY;
+    }
+
+    state->learned_energy = 0.0f;
+    state->learned_count = 0;
+    ei_gate_reset(handle);
+
+    handle->gate_config = config;
+
+    return EI_IMPULSE_OK;
+}
+
+#endif // EI_CLASSIFIER_GATE_ENABLED == 1
+
+#endif // _EI_CLASSIFIER_IMPULSE_GATE_H_
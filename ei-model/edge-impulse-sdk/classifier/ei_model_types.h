@@ -372,6 +372,34 @@ typedef struct {
     float iou_threshold;
 } ei_object_detection_nms_config_t;
 
+/** Configuration for the impulse gate (ei_impulse_gate.h) */
+typedef struct {
+    /* skip when the largest per-axis std deviation is below this, 0 disables */
+    float energy_threshold;
+    /* >0: raise the threshold to learn_margin * (average energy of confident idle windows) */
+    float learn_margin;
+    float learn_min_confidence;
+    /* label reported when skipped on low energy */
+    uint16_t idle_label_ix;
+    /* skip when the top class didn't change for this many windows, 0 disables */
+    uint16_t stable_windows;
+    /* ... and the energy moved less than this (relative) since the last full run */
+    float stable_energy_delta;
+    /* always run the full impulse after this many consecutive skips, 0 is unlimited */
+    uint16_t max_skipped;
+} ei_impulse_gate_config_t;
+
+typedef struct {
+    float learned_energy;       // running average of energy in confident idle windows
+    uint32_t learned_count;
+    float last_energy;          // energy of the last window that ran fully
+    int16_t last_top_ix;
+    uint16_t stable_count;
+    uint16_t skipped_count;
+    float *last_values;         // last classification values, label_count entries
+    float last_anomaly;
+} ei_impulse_gate_state_t;
+
 typedef struct {
     uint32_t nn_input_frame_size;
     uint32_t raw_sample_count;
@@ -503,6 +531,10 @@ public:
         , freeform_outputs(nullptr)
 #endif //EI_CLASSIFIER_FREEFORM_OUTPUT
         , input_params(nullptr)
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+        , gate_config(nullptr)
+        , gate_state()
+#endif // EI_CLASSIFIER_GATE_ENABLED
         { /* ei_impulse_handle_t ctor */};
 
     ei_impulse_state_t state;
@@ -512,6 +544,10 @@ public:
     ei::matrix_t *freeform_outputs;
 #endif // EI_CLASSIFIER_FREEFORM_OUTPUT
     ei_input_params* input_params;
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    const ei_impulse_gate_config_t *gate_config;
+    ei_impulse_gate_state_t gate_state;
+#endif // EI_CLASSIFIER_GATE_ENABLED
 };
 
 typedef struct {
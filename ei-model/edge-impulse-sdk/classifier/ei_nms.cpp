@@ -0,0 +1,75 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "edge-impulse-sdk/classifier/ei_nms.h"
+#include <cstring>
+
+static ei_nms_scratch_t scratch = { 0 };
+
+ei_nms_scratch_t *ei_nms_get_scratch(size_t count) {
+    if (count <= scratch.capacity) {
+        return &scratch;
+    }
+
+    ei_nms_free_scratch();
+
+    scratch.boxes = (float*)ei_malloc(4 * count * sizeof(float));
+    scratch.scores = (float*)ei_malloc(count * sizeof(float));
+    scratch.classes = (int*)ei_malloc(count * sizeof(int));
+    scratch.selected_indices = (int*)ei_malloc(count * sizeof(int));
+    scratch.selected_scores = (float*)ei_malloc(count * sizeof(float));
+    scratch.order = (int*)ei_malloc(count * sizeof(int));
+    scratch.next = (int*)ei_malloc(count * sizeof(int));
+    scratch.cell_head = (int*)ei_malloc(EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE * sizeof(int));
+
+    if (!scratch.boxes || !scratch.scores || !scratch.classes || !scratch.selected_indices ||
+        !scratch.selected_scores || !scratch.order || !scratch.next || !scratch.cell_head) {
+        return nullptr;
+    }
+
+    scratch.capacity = count;
+    return &scratch;
+}
+
+void ei_nms_free_scratch(void) {
+    ei_free(scratch.boxes);
+    ei_free(scratch.scores);
+    ei_free(scratch.classes);
+    ei_free(scratch.selected_indices);
+    ei_free(scratch.selected_scores);
+    ei_free(scratch.order);
+    ei_free(scratch.next);
+    ei_free(scratch.cell_head);
+    memset(&scratch, 0, sizeof(scratch));
+}
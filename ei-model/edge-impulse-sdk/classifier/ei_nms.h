@@ -40,6 +40,37 @@
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 
+// the grid is allocated in ei_nms.cpp, override it for the whole build
+#ifndef EI_NMS_GRID_SIZE
+#define EI_NMS_GRID_SIZE            32
+#endif
+
+/**
+ * Scratch memory for ei_run_nms, kept between calls and only grown when a
+ * larger box count comes in. Defined once in ei_nms.cpp.
+ */
+typedef struct {
+    size_t capacity;
+    float *boxes;
+    float *scores;
+    int *classes;
+    int *selected_indices;
+    float *selected_scores;
+    int *order;
+    int *next;
+    int *cell_head;     // EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE entries, independent of capacity
+} ei_nms_scratch_t;
+
+/**
+ * Scratch for at least count boxes, nullptr if it can't be allocated
+ */
+ei_nms_scratch_t *ei_nms_get_scratch(size_t count);
+
+/**
+ * Release the NMS scratch, called from run_classifier_deinit()
+ */
+void ei_nms_free_scratch(void);
+
 #if (EI_HAS_YOLOV5 || EI_HAS_YOLOX || EI_HAS_TAO_DECODE_DETECTIONS || EI_HAS_TAO_YOLOV3 || EI_HAS_TAO_YOLOV4 || EI_HAS_YOLOV2 || EI_HAS_YOLO_PRO || EI_HAS_YOLOV11 || EI_HAS_QC_FACE_DET_LITE || EI_HAS_QC_YOLOX)
 
 // The code below comes from tensorflow/lite/kernels/internal/reference/non_max_suppression.h
@@ -47,6 +78,7 @@
 // Licensed under the Apache License, Version 2.0
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <deque>
 #include <queue>
 
@@ -214,8 +246,179 @@ static inline void NonMaxSuppression(const float* boxes, const int num_boxes,
   }
 }
 
+// Cell of a coordinate in the NMS grid, NaN and out of range values are clamped
+static inline int NmsGridCell(float v, float origin, float inv_cell_size) {
+  float c = (v - origin) * inv_cell_size;
+  if (!(c > 0.0f)) return 0;
+  if (c > (float)(EI_NMS_GRID_SIZE - 1)) return EI_NMS_GRID_SIZE - 1;
+  return static_cast<int>(c);
+}
+
+// Hard NMS with the same results as NonMaxSuppression(soft_nms_sigma = 0),
+// for large candidate counts.
+//
+// - Candidates under score_threshold are dropped first, the rest is sorted
+//   (score descending, index ascending) in growing chunks, so a low
+//   max_output_size doesn't pay for a full sort.
+// - Selected boxes are binned by their top-left corner in a coarse grid over
+//   the candidates. A candidate is only tested against the selected boxes in
+//   the cells that can overlap it; boxes larger than two cells go to a list
+//   that is tested against every candidate.
+// - If classes is not null, boxes only suppress boxes of the same class, so
+//   per-class NMS for all classes runs in one pass.
+//
+// order and next must have room for num_boxes entries, cell_head for
+// EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE entries (too large for the stack of
+// small inference threads), no other memory is used. Arguments otherwise as
+// NonMaxSuppression.
+static inline void BinnedNonMaxSuppression(const float* boxes, const int num_boxes,
+                              const float* scores, const int* classes,
+                              const int max_output_size,
+                              const float iou_threshold,
+                              const float score_threshold,
+                              int* order, int* next, int* cell_head,
+                              int* selected_indices,
+                              float* selected_scores,
+                              int* num_selected_indices) {
+  const BoxCornerEncoding *corners = reinterpret_cast<const BoxCornerEncoding*>(boxes);
+
+  *num_selected_indices = 0;
+
+  // score threshold, and the extent / average size of what's left
+  int num_candidates = 0;
+  float x_lo = INFINITY, y_lo = INFINITY, x_hi = -INFINITY, y_hi = -INFINITY;
+  float w_sum = 0, h_sum = 0;
+  for (int i = 0; i < num_boxes; ++i) {
+    if (!(scores[i] > score_threshold)) {
+      continue;
+    }
+    order[num_candidates++] = i;
+
+    const float w = std::fabs(corners[i].x2 - corners[i].x1);
+    const float h = std::fabs(corners[i].y2 - corners[i].y1);
+    if (std::isfinite(w) && std::isfinite(h)) {
+      x_lo = std::min(x_lo, std::min(corners[i].x1, corners[i].x2));
+      x_hi = std::max(x_hi, std::max(corners[i].x1, corners[i].x2));
+      y_lo = std::min(y_lo, std::min(corners[i].y1, corners[i].y2));
+      y_hi = std::max(y_hi, std::max(corners[i].y1, corners[i].y2));
+      w_sum += w;
+      h_sum += h;
+    }
+  }
+
+  const int num_outputs = std::min(num_candidates, max_output_size);
+  if (num_outputs <= 0) return;
+
+  // cells are at least the average box size, so most boxes fit in one
+  float cell_w = std::max((x_hi - x_lo) / EI_NMS_GRID_SIZE, w_sum / num_candidates);
+  float cell_h = std::max((y_hi - y_lo) / EI_NMS_GRID_SIZE, h_sum / num_candidates);
+  if (!(cell_w > 0.0f) || !std::isfinite(cell_w)) cell_w = 1.0f;
+  if (!(cell_h > 0.0f) || !std::isfinite(cell_h)) cell_h = 1.0f;
+  if (!std::isfinite(x_lo)) x_lo = 0.0f;
+  if (!std::isfinite(y_lo)) y_lo = 0.0f;
+  const float inv_cell_w = 1.0f / cell_w;
+  const float inv_cell_h = 1.0f / cell_h;
+
+  // heads of the per cell lists of selected boxes (indices into selected_indices)
+  for (int c = 0; c < EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE; ++c) {
+    cell_head[c] = -1;
+  }
+  int large_head = -1;
+  float max_small_w = 0.0f;
+  float max_small_h = 0.0f;
+
+  auto cmp = [scores](const int i, const int j) {
+    return scores[i] > scores[j] || (scores[i] == scores[j] && i < j);
+  };
+
+  int sorted_end = 0;
+  for (int cursor = 0; cursor < num_candidates && *num_selected_indices < num_outputs; ++cursor) {
+    if (cursor == sorted_end) {
+      const int chunk = std::min(num_candidates - sorted_end, std::max(64, sorted_end));
+      std::partial_sort(order + sorted_end, order + sorted_end + chunk, order + num_candidates, cmp);
+      sorted_end += chunk;
+    }
+
+    const int candidate = order[cursor];
+    const BoxCornerEncoding &box = corners[candidate];
+    const float x_min = std::min(box.x1, box.x2);
+    const float x_max = std::max(box.x1, box.x2);
+    const float y_min = std::min(box.y1, box.y2);
+    const float y_max = std::max(box.y1, box.y2);
+
+    bool suppressed = false;
+
+    if (iou_threshold <= 0.0f) {
+      // everything overlaps 'enough', only the best box per class survives
+      for (int s = 0; s < *num_selected_indices && !suppressed; ++s) {
+        suppressed = !classes || classes[selected_indices[s]] == classes[candidate];
+      }
+    }
+    else {
+      for (int s = large_head; s >= 0 && !suppressed; s = next[s]) {
+        const int j = selected_indices[s];
+        if (classes && classes[j] != classes[candidate]) continue;
+        suppressed = ComputeIntersectionOverUnion(boxes, candidate, j) >= iou_threshold;
+      }
+
+      // a selected (small) box can only overlap if its corner lies at most
+      // its size before ours, start with our own cell where suppressing
+      // boxes usually are
+      const int own_x = NmsGridCell(x_min, x_lo, inv_cell_w);
+      const int own_y = NmsGridCell(y_min, y_lo, inv_cell_h);
+      const int cx0 = NmsGridCell(x_min - max_small_w, x_lo, inv_cell_w);
+      const int cx1 = NmsGridCell(x_max, x_lo, inv_cell_w);
+      const int cy0 = NmsGridCell(y_min - max_small_h, y_lo, inv_cell_h);
+      const int cy1 = NmsGridCell(y_max, y_lo, inv_cell_h);
+
+      for (int cell = -1; !suppressed && cell < (cy1 - cy0 + 1) * (cx1 - cx0 + 1); ++cell) {
+        int c = own_y * EI_NMS_GRID_SIZE + own_x;
+        if (cell >= 0) {
+          c = (cy0 + cell / (cx1 - cx0 + 1)) * EI_NMS_GRID_SIZE + cx0 + cell % (cx1 - cx0 + 1);
+          if (c == own_y * EI_NMS_GRID_SIZE + own_x) continue;
+        }
+        for (int s = cell_head[c]; s >= 0 && !suppressed; s = next[s]) {
+          const int j = selected_indices[s];
+          if (classes && classes[j] != classes[candidate]) continue;
+          // disjoint boxes have IoU 0, skip them before the division
+          const BoxCornerEncoding &other = corners[j];
+          if (std::max(other.x1, other.x2) <= x_min || std::min(other.x1, other.x2) >= x_max ||
+              std::max(other.y1, other.y2) <= y_min || std::min(other.y1, other.y2) >= y_max) continue;
+          suppressed = ComputeIntersectionOverUnion(boxes, candidate, j) >= iou_threshold;
+        }
+      }
+    }
+
+    if (suppressed) {
+      continue;
+    }
+
+    const int s = (*num_selected_indices)++;
+    selected_indices[s] = candidate;
+    if (selected_scores) {
+      selected_scores[s] = scores[candidate];
+    }
+
+    if (x_max - x_min > 2 * cell_w || y_max - y_min > 2 * cell_h ||
+        !std::isfinite(x_max - x_min) || !std::isfinite(y_max - y_min)) {
+      next[s] = large_head;
+      large_head = s;
+    }
+    else {
+      const int c = NmsGridCell(y_min, y_lo, inv_cell_h) * EI_NMS_GRID_SIZE + NmsGridCell(x_min, x_lo, inv_cell_w);
+      next[s] = cell_head[c];
+      cell_head[c] = s;
+      max_small_w = std::max(max_small_w, x_max - x_min);
+      max_small_h = std::max(max_small_h, y_max - y_min);
+    }
+  }
+}
+
 /**
  * Run non-max suppression over the results array (for bounding boxes)
+ *
+ * @param per_class If true, boxes only suppress boxes of the same class
+ *                  (classes[]), so all classes are handled in one pass
  */
 EI_IMPULSE_ERROR ei_run_nms(
     const ei_impulse_t *impulse,
@@ -225,18 +428,16 @@ EI_IMPULSE_ERROR ei_run_nms(
     int *classes,
     size_t bb_count,
     bool clip_boxes,
-    const ei_object_detection_nms_config_t *nms_config) {
+    const ei_object_detection_nms_config_t *nms_config,
+    bool per_class = false) {
 
     if (bb_count < 1) {
         return EI_IMPULSE_OK;
     }
 
-    int *selected_indices = (int*)ei_malloc(1 * bb_count * sizeof(int));
-    float *selected_scores = (float*)ei_malloc(1 * bb_count * sizeof(float));
+    ei_nms_scratch_t *scratch = ei_nms_get_scratch(bb_count);
 
-    if (!scores || !boxes || !selected_indices || !selected_scores || !classes) {
-        ei_free(selected_indices);
-        ei_free(selected_scores);
+    if (!scores || !boxes || !scratch || !classes) {
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
 
@@ -246,30 +447,33 @@ EI_IMPULSE_ERROR ei_run_nms(
     //  max_output_size: the maximum number of selections.
     //  iou_threshold: Intersection-over-Union (IoU) threshold for NMS
     //  score_threshold: All candidate scores below this value are rejected
-    //  soft_nms_sigma: Soft NMS parameter, used for decaying scores
 
     int num_selected_indices;
 
-    NonMaxSuppression(
+    BinnedNonMaxSuppression(
         (const float*)boxes, // boxes
         bb_count, // num_boxes
         (const float*)scores, // scores
+        per_class ? classes : nullptr, // classes
         bb_count, // max_output_size
         nms_config->iou_threshold, // iou_threshold
         nms_config->confidence_threshold, // score_threshold
-        0.0f, // soft_nms_sigma
-        selected_indices,
-        selected_scores,
+        scratch->order,
+        scratch->next,
+        scratch->cell_head,
+        scratch->selected_indices,
+        scratch->selected_scores,
         &num_selected_indices);
 
-    std::vector<ei_impulse_result_bounding_box_t> new_results;
+    // boxes / scores / classes hold a copy, so results can be overwritten
+    results->clear();
 
     for (size_t ix = 0; ix < (size_t)num_selected_indices; ix++) {
 
-        int out_ix = selected_indices[ix];
+        int out_ix = scratch->selected_indices[ix];
         ei_impulse_result_bounding_box_t bb;
         bb.label  = impulse->categories[classes[out_ix]];
-        bb.value  = selected_scores[ix];
+        bb.value  = scratch->selected_scores[ix];
 
         float ymin = boxes[(out_ix * 4) + 0];
         float xmin = boxes[(out_ix * 4) + 1];
@@ -287,20 +491,11 @@ EI_IMPULSE_ERROR ei_run_nms(
         bb.x      = static_cast<uint32_t>(xmin);
         bb.height = static_cast<uint32_t>(ymax) - bb.y;
         bb.width  = static_cast<uint32_t>(xmax) - bb.x;
-        new_results.push_back(bb);
+        results->push_back(bb);
 
         EI_LOGD("Found bb with label %s\n", bb.label);
     }
 
-    results->clear();
-
-    for (size_t ix = 0; ix < new_results.size(); ix++) {
-        results->push_back(new_results[ix]);
-    }
-
-    ei_free(selected_indices);
-    ei_free(selected_scores);
-
     return EI_IMPULSE_OK;
 
 }
@@ -328,17 +523,15 @@ EI_IMPULSE_ERROR ei_run_nms(
         return EI_IMPULSE_OK;
     }
 
-    float *boxes = (float*)ei_malloc(4 * bb_count * sizeof(float));
-    float *scores = (float*)ei_malloc(1 * bb_count * sizeof(float));
-    int *classes = (int*) ei_malloc(bb_count * sizeof(int));
-
-    if (!scores || !boxes || !classes) {
-        ei_free(boxes);
-        ei_free(scores);
-        ei_free(classes);
+    ei_nms_scratch_t *scratch = ei_nms_get_scratch(bb_count);
+    if (!scratch) {
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
 
+    float *boxes = scratch->boxes;
+    float *scores = scratch->scores;
+    int *classes = scratch->classes;
+
     size_t box_ix = 0;
     for (size_t ix = 0; ix < results->size(); ix++) {
         auto bb = results->at(ix);
@@ -368,11 +561,6 @@ EI_IMPULSE_ERROR ei_run_nms(
                                           clip_boxes,
                                           nms_config);
 
-
-    ei_free(boxes);
-    ei_free(scores);
-    ei_free(classes);
-
     return nms_res;
 
 }
@@ -43,7 +43,10 @@
 #include "ei_signal_with_axes.h"
 #include "postprocessing/ei_postprocessing.h"
 #include "edge-impulse-sdk/classifier/ei_data_normalization.h"
+#include "edge-impulse-sdk/classifier/ei_impulse_gate.h"
+#include "edge-impulse-sdk/classifier/ei_nms.h"
 #include "edge-impulse-sdk/classifier/ei_print_results.h"
+#include "edge-impulse-sdk/dsp/image/processing.hpp"
 
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "edge-impulse-sdk/porting/ei_logging.h"
@@ -196,6 +199,90 @@ extern "C" EI_IMPULSE_ERROR run_inference(
     return EI_IMPULSE_OK;
 }
 
+/**
+ * @brief      Second half of process_impulse, once the DSP blocks have run:
+ *             data normalization, learning blocks and postprocessing
+ *
+ * @param      handle        Impulse handle
+ * @param      features      Output of the DSP blocks
+ * @param[in]  block_num     Number of entries in features
+ * @param      result        Output classifier results, timing.dsp_us holds time spent before the DSP blocks
+ * @param[in]  dsp_start_us  Timestamp from before the DSP blocks ran
+ * @param[in]  debug         Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+static EI_IMPULSE_ERROR process_impulse_features(ei_impulse_handle_t *handle,
+                                                 ei_feature_t *features,
+                                                 size_t block_num,
+                                                 ei_impulse_result_t *result,
+                                                 uint64_t dsp_start_us,
+                                                 bool debug)
+{
+    EI_IMPULSE_ERROR res = EI_IMPULSE_OK;
+    (void)res;
+
+#if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
+    EI_IMPULSE_ERROR dn_error = run_data_normalization(handle, features);
+    if (dn_error != EI_IMPULSE_OK) {
+        ei_printf("ERR: Failed to run Data Normalization process (%d)\n", dn_error);
+        return dn_error;
+    }
+#endif
+
+    result->timing.dsp_us += ei_read_timer_us() - dsp_start_us;
+
+    if (debug) {
+        ei_printf("Features (%d ms.): ", result->timing.dsp);
+        for (size_t ix = 0; ix < block_num; ix++) {
+            if (features[ix].matrix == nullptr) {
+                continue;
+            }
+            for (size_t jx = 0; jx < features[ix].matrix->cols; jx++) {
+                ei_printf_float(features[ix].matrix->buffer[jx]);
+                ei_printf(" ");
+            }
+            ei_printf("\n");
+        }
+    }
+
+    if (debug) {
+        ei_printf("Running impulse...\n");
+    }
+
+#if EI_CLASSIFIER_DSP_ONLY
+    ei_result_struct_timing_us_to_ms(result);
+
+    return EI_IMPULSE_OK;
+#else
+#if EI_CLASSIFIER_STATIC_PIPELINE == 1
+    if (handle->impulse == ei_default_impulse.impulse) {
+        res = ei_static_pipeline_t::run_inference(handle->impulse, features, result, debug);
+    }
+    else
+#endif // EI_CLASSIFIER_STATIC_PIPELINE == 1
+    {
+        res = run_inference(handle, features, result, debug);
+    }
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+
+    res = run_postprocessing(handle, result);
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    ei_gate_update(handle, result);
+#endif // EI_CLASSIFIER_GATE_ENABLED == 1
+
+    ei_result_struct_timing_us_to_ms(result);
+
+    return EI_IMPULSE_OK;
+#endif
+}
+
 /**
  * @brief      Process a complete impulse
  *
@@ -256,6 +343,18 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
     EI_IMPULSE_ERROR res = EI_IMPULSE_OK;
     (void)res; // Get around -Werror=unused-variable if neither of the calls below are compiled in (e.g. unit-tests/hr)
 
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    uint64_t gate_start_us = ei_read_timer_us();
+    bool gate_skip = ei_gate_check(handle, signal, result);
+    // counted as DSP time, whether the rest of the impulse runs or not
+    result->timing.dsp_us = ei_read_timer_us() - gate_start_us;
+
+    if (gate_skip) {
+        ei_result_struct_timing_us_to_ms(result);
+        return EI_IMPULSE_OK;
+    }
+#endif // EI_CLASSIFIER_GATE_ENABLED == 1
+
 #if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_VLM_CONNECTOR)
     // Shortcut for vlm models
     res = run_vlm_inference(handle, signal, 0, result, handle->impulse->learning_blocks[0].config, false);
@@ -278,6 +377,21 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
         return res;
     }
 #endif // EI_CLASSIFIER_QUANTIZATION_ENABLED == 1 && (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TENSAIFLOW || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ONNX_TIDL) || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_DRPAI || EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+#if EI_CLASSIFIER_STATIC_PIPELINE == 1
+    if (handle->impulse == ei_default_impulse.impulse) {
+        ei_feature_t static_features[ei_static_pipeline_t::dsp_blocks_size];
+
+        uint64_t dsp_start_us = ei_read_timer_us();
+
+        res = ei_static_pipeline_t::run_dsp(handle->impulse, signal, static_features);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+
+        return process_impulse_features(handle, static_features, ei_static_pipeline_t::dsp_blocks_size, result, dsp_start_us, debug);
+    }
+#endif // EI_CLASSIFIER_STATIC_PIPELINE == 1
+
     uint32_t block_num = handle->impulse->dsp_blocks_size;
 
     // smart pointer to features array
@@ -377,53 +491,7 @@ extern "C" EI_IMPULSE_ERROR process_impulse(ei_impulse_handle_t *handle,
         out_features_index += block.n_output_features;
     }
 
-#if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
-    EI_IMPULSE_ERROR dn_error = run_data_normalization(handle, features);
-    if (dn_error != EI_IMPULSE_OK) {
-        ei_printf("ERR: Failed to run Data Normalization process (%d)\n", dn_error);
-        return dn_error;
-    }
-#endif
-
-    result->timing.dsp_us = ei_read_timer_us() - dsp_start_us;
-
-    if (debug) {
-        ei_printf("Features (%d ms.): ", result->timing.dsp);
-        for (size_t ix = 0; ix < block_num; ix++) {
-            if (features[ix].matrix == nullptr) {
-                continue;
-            }
-            for (size_t jx = 0; jx < features[ix].matrix->cols; jx++) {
-                ei_printf_float(features[ix].matrix->buffer[jx]);
-                ei_printf(" ");
-            }
-            ei_printf("\n");
-        }
-    }
-
-    if (debug) {
-        ei_printf("Running impulse...\n");
-    }
-
-#if EI_CLASSIFIER_DSP_ONLY
-    ei_result_struct_timing_us_to_ms(result);
-
-    return EI_IMPULSE_OK;
-#else
-    res = run_inference(handle, features, result, debug);
-    if (res != EI_IMPULSE_OK) {
-        return res;
-    }
-
-    res = run_postprocessing(handle, result);
-    if (res != EI_IMPULSE_OK) {
-        return res;
-    }
-
-    ei_result_struct_timing_us_to_ms(result);
-
-    return EI_IMPULSE_OK;
-#endif
+    return process_impulse_features(handle, features, block_num, result, dsp_start_us, debug);
 }
 
 /**
@@ -867,6 +935,9 @@ extern "C" void run_classifier_init(void)
     ei_dsp_clear_continuous_audio_state();
     init_impulse(&ei_default_impulse);
     init_postprocessing(&ei_default_impulse);
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    ei_gate_reset(&ei_default_impulse);
+#endif
 #if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
     init_data_normalization(&ei_default_impulse);
 #endif
@@ -892,6 +963,9 @@ __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
     ei_dsp_clear_continuous_audio_state();
     init_impulse(handle);
     init_postprocessing(handle);
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    ei_gate_reset(handle);
+#endif
 #if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
     init_data_normalization(handle);
 #endif
@@ -911,6 +985,10 @@ __attribute__((unused)) void run_classifier_init(ei_impulse_handle_t *handle)
 extern "C" void run_classifier_deinit(void)
 {
     deinit_postprocessing(&ei_default_impulse);
+    // Mel filterbank and frame buffers kept by mfe() / mfcc() between windows
+    ei::speechpy::feature::free_mel_frontend();
+    ei::image::processing::free_resize_scratch();
+    ei_nms_free_scratch();
 }
 
 __attribute__((unused)) void run_classifier_deinit(ei_impulse_handle_t *handle)
@@ -919,6 +997,9 @@ __attribute__((unused)) void run_classifier_deinit(ei_impulse_handle_t *handle)
 #if EI_CLASSIFIER_HAS_DATA_NORMALIZATION
     deinit_data_normalization(handle);
 #endif
+    ei::speechpy::feature::free_mel_frontend();
+    ei::image::processing::free_resize_scratch();
+    ei_nms_free_scratch();
 }
 
 /**
@@ -1100,6 +1181,124 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_classifier(
     return process_impulse(impulse, signal, result, debug);
 }
 
+/**
+ * @brief Called by `run_classifier_batch()` for every classified window.
+ *
+ * `result` shares its classification and bounding box storage with the other windows
+ * of the batch, it's only valid until the callback returns.
+ */
+typedef void (*ei_batch_result_fn_t)(size_t window_ix, ei_impulse_result_t *result, void *user_data);
+
+/**
+ * @brief Run the classifier over a number of windows in one call.
+ *
+ * Same as calling `run_classifier()` for every signal, but the model is only set up once for the
+ * whole batch: on EON compiled models the tensor arena is allocated and the operators are
+ * initialized before the first window and released after the last one. Use this when replaying
+ * buffered data (e.g. recordings from flash) rather than for live inference. The impulse gate
+ * (if enabled on the handle) is bypassed, every window runs the full impulse.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] impulse Pointer to an `ei_impulse_handle_t` struct that contains the model and
+ *  preprocessing information.
+ * @param[in] signals Array of `signals_count` signals, one per window.
+ * @param[in] signals_count Number of windows in the batch.
+ * @param[in] result_fn Called with the result of every window, before the next one is classified.
+ * @param[in] user_data Passed to `result_fn`.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ * @param[out] classified_count If not nullptr, set to the number of windows that were classified.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. On error the batch is stopped, only the
+ *  windows before the failing one (`*classified_count` of them) were passed to `result_fn`.
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR run_classifier_batch(
+    ei_impulse_handle_t *impulse,
+    signal_t *signals,
+    size_t signals_count,
+    ei_batch_result_fn_t result_fn,
+    void *user_data = nullptr,
+    bool debug = false,
+    size_t *classified_count = nullptr)
+{
+    EI_IMPULSE_ERROR res = EI_IMPULSE_OK;
+    ei_impulse_result_t result;
+    size_t ix = 0;
+
+    if (classified_count) {
+        *classified_count = 0;
+    }
+
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    // buffered data isn't gated
+    const ei_impulse_gate_config_t *gate_config = impulse->gate_config;
+    impulse->gate_config = nullptr;
+#endif
+
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1)
+    res = ei_eon_batch_begin(impulse->impulse);
+    if (res != EI_IMPULSE_OK) {
+        ei_eon_batch_end();
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+        impulse->gate_config = gate_config;
+#endif
+        return res;
+    }
+#endif
+
+    for (ix = 0; ix < signals_count; ix++) {
+        res = process_impulse(impulse, &signals[ix], &result, debug);
+        if (res != EI_IMPULSE_OK) {
+            break;
+        }
+        if (result_fn) {
+            result_fn(ix, &result, user_data);
+        }
+    }
+
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1)
+    ei_eon_batch_end();
+#endif
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    impulse->gate_config = gate_config;
+#endif
+
+    if (classified_count) {
+        *classified_count = ix;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Run the classifier over a number of windows in one call.
+ *
+ * Overloaded function [run_classifier_batch()](#run_classifier_batch-1) that defaults to the single impulse.
+ *
+ * **Blocking**: yes
+ *
+ * @param[in] signals Array of `signals_count` signals, one per window.
+ * @param[in] signals_count Number of windows in the batch.
+ * @param[in] result_fn Called with the result of every window, before the next one is classified.
+ * @param[in] user_data Passed to `result_fn`.
+ * @param[in] debug Print internal preprocessing and inference debugging information via `ei_printf()`.
+ * @param[out] classified_count If not nullptr, set to the number of windows that were classified.
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum. Will be `EI_IMPULSE_OK` if inference
+ *  completed successfully for all windows.
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_batch(
+    signal_t *signals,
+    size_t signals_count,
+    ei_batch_result_fn_t result_fn,
+    void *user_data = nullptr,
+    bool debug = false,
+    size_t *classified_count = nullptr)
+{
+    return run_classifier_batch(&ei_default_impulse, signals, signals_count, result_fn, user_data, debug,
+                                classified_count);
+}
+
 #if EI_CLASSIFIER_FREEFORM_OUTPUT
 /**
  * Set the location for freeform outputs. For impulses with freeform output the application needs to allocate
@@ -188,6 +188,60 @@ __attribute__((unused)) int extract_spectral_analysis_features(
     return EIDSP_NOT_SUPPORTED;
 }
 
+#if EI_CLASSIFIER_STATIC_PIPELINE == 1
+/**
+ * Same as extract_spectral_analysis_features, but with the analysis type,
+ * implementation version and filter type fixed at compile time. Referenced
+ * from the static pipeline in model_variables.h, so only the variant the
+ * model uses is instantiated and the string compares on the config go away.
+ */
+template<spectral::analysis_t AnalysisType, uint16_t ImplementationVersion, spectral::filter_t FilterType>
+int extract_spectral_analysis_features_static(
+    signal_t *signal,
+    matrix_t *output_matrix,
+    void *config_ptr,
+    const float frequency)
+{
+    ei_dsp_config_spectral_analysis_t *config = (ei_dsp_config_spectral_analysis_t *)config_ptr;
+
+    // input matrix from the raw signal
+    matrix_t input_matrix(signal->total_length / config->axes, config->axes);
+    if (!input_matrix.buffer) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+
+    signal->get_data(0, signal->total_length, input_matrix.buffer);
+
+    if (AnalysisType == spectral::analysis_wavelet) {
+        return spectral::wavelet::extract_wavelet_features(&input_matrix, output_matrix, config, frequency);
+    }
+
+    if (ImplementationVersion == 1) {
+        return spectral::feature::extract_spectral_analysis_features_v1(
+            &input_matrix,
+            output_matrix,
+            config,
+            frequency);
+    }
+    else if (ImplementationVersion == 4) {
+        return spectral::feature::extract_spectral_analysis_features_v4(
+            &input_matrix,
+            output_matrix,
+            config,
+            frequency,
+            FilterType);
+    }
+    else {
+        return spectral::feature::extract_spectral_analysis_features_v2(
+            &input_matrix,
+            output_matrix,
+            config,
+            frequency,
+            FilterType);
+    }
+}
+#endif // EI_CLASSIFIER_STATIC_PIPELINE == 1
+
 __attribute__((unused)) int extract_raw_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
     ei_dsp_config_raw_t config = *((ei_dsp_config_raw_t*)config_ptr);
 
@@ -1141,6 +1195,56 @@ __attribute__((unused)) int extract_mfe_per_slice_features(signal_t *signal, mat
 #endif
 }
 
+/**
+ * Read a page of pixels from an image signal. When the signal provides RGB888
+ * bytes through get_data_u8 they're read straight into the page buffer (3
+ * bytes per pixel fit in the 4 bytes of a float), so pixels don't have to be
+ * packed into floats by the caller and unpacked here.
+ *
+ * @return true if buffer holds RGB888 bytes, false if it holds 0xRRGGBB floats
+ */
+__attribute__((unused)) static bool ei_image_read_page(signal_t *signal, size_t offset, size_t length, float *buffer)
+{
+    if ((signal->capabilities & EI_SIGNAL_CAP_RGB888) && signal->get_data_u8) {
+        signal->get_data_u8(offset, length, reinterpret_cast<uint8_t*>(buffer));
+        return true;
+    }
+
+    signal->get_data(offset, length, buffer);
+    return false;
+}
+
+/**
+ * Get pixel ix from a page read by ei_image_read_page(), as 0xRRGGBB
+ */
+static inline uint32_t ei_image_get_pixel(const float *buffer, bool is_rgb888, size_t ix)
+{
+    if (is_rgb888) {
+        const uint8_t *rgb = reinterpret_cast<const uint8_t*>(buffer) + ix * 3;
+        return (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+    }
+
+    return static_cast<uint32_t>(buffer[ix]);
+}
+
+/**
+ * Pixel value to 0..1, same values as dividing by 255.0f
+ */
+__attribute__((unused)) static const float *ei_image_unit_table(void)
+{
+    static float table[256];
+    static bool ready = false;
+
+    if (!ready) {
+        for (int ix = 0; ix < 256; ix++) {
+            table[ix] = static_cast<float>(ix) / 255.0f;
+        }
+        ready = true;
+    }
+
+    return table;
+}
+
 __attribute__((unused)) int extract_image_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
     ei_dsp_config_image_t config = *((ei_dsp_config_image_t*)config_ptr);
 
@@ -1148,6 +1252,8 @@ __attribute__((unused)) int extract_image_features(signal_t *signal, matrix_t *o
 
     size_t output_ix = 0;
 
+    const float *unit = ei_image_unit_table();
+
 #if defined(EI_DSP_IMAGE_BUFFER_STATIC_SIZE)
     const size_t page_size = EI_DSP_IMAGE_BUFFER_STATIC_SIZE;
 #else
@@ -1167,15 +1273,15 @@ __attribute__((unused)) int extract_image_features(signal_t *signal, matrix_t *o
         if (!input_matrix.buffer) {
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
-        signal->get_data(ix, elements_to_read, input_matrix.buffer);
+        bool is_rgb888 = ei_image_read_page(signal, ix, elements_to_read, input_matrix.buffer);
 
         for (size_t jx = 0; jx < elements_to_read; jx++) {
-            uint32_t pixel = static_cast<uint32_t>(input_matrix.buffer[jx]);
+            uint32_t pixel = ei_image_get_pixel(input_matrix.buffer, is_rgb888, jx);
 
             // rgb to 0..1
-            float r = static_cast<float>(pixel >> 16 & 0xff) / 255.0f;
-            float g = static_cast<float>(pixel >> 8 & 0xff) / 255.0f;
-            float b = static_cast<float>(pixel & 0xff) / 255.0f;
+            float r = unit[pixel >> 16 & 0xff];
+            float g = unit[pixel >> 8 & 0xff];
+            float b = unit[pixel & 0xff];
 
             if (channel_count == 3) {
                 output_matrix->buffer[output_ix++] = r;
@@ -1227,10 +1333,10 @@ __attribute__((unused)) int extract_drpai_features_quantized(signal_t *signal, m
         if (!input_matrix.buffer) {
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
-        signal->get_data(ix, elements_to_read, input_matrix.buffer);
+        bool is_rgb888 = ei_image_read_page(signal, ix, elements_to_read, input_matrix.buffer);
 
         for (size_t jx = 0; jx < elements_to_read; jx++) {
-            uint32_t pixel = static_cast<uint32_t>(input_matrix.buffer[jx]);
+            uint32_t pixel = ei_image_get_pixel(input_matrix.buffer, is_rgb888, jx);
 
             if (channel_count == 3) {
                 uint8_t r = static_cast<uint8_t>(pixel >> 16 & 0xff);
@@ -1262,6 +1368,189 @@ __attribute__((unused)) int extract_drpai_features_quantized(signal_t *signal, m
 
 #if (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1) && (EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_DRPAI)
 
+/**
+ * Lookup tables from a pixel channel value straight to the int8 input of a
+ * quantized model, with the image scaling and the input tensor's quantization
+ * folded in. Built the first time a model runs, so no float math is left in
+ * the per pixel conversion.
+ */
+typedef struct {
+    float scale;
+    float zero_point;
+    int image_scaling;
+    int16_t channel_count;
+    bool ready;
+    bool offset_128;            // every rgb entry is value - 128
+    int32_t gray_zero_point;
+    int32_t gray_round;
+    int32_t gray_shift;         // fraction bits of the gray table
+    union {
+        int8_t rgb[3][256];     // quantized value per channel
+        int32_t gray[3][256];   // luma contribution per channel in fixed point, without zero point
+    };
+} ei_image_quant_lut_t;
+
+/**
+ * Channel value (0..255) with the model's image scaling applied, as in the
+ * float reference implementation
+ */
+__attribute__((unused)) static float ei_image_scale_channel(int value, int channel, int image_scaling)
+{
+    static const float torch_mean[] = { 0.485, 0.456, 0.406 };
+    static const float torch_std[] = { 0.229, 0.224, 0.225 };
+
+    float v = static_cast<float>(value);
+
+    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+        v /= 255.0f;
+    }
+    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
+        v /= 255.0f;
+        v = (v - torch_mean[channel]) / torch_std[channel];
+    }
+    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
+        v -= 128.0f;
+    }
+
+    return v;
+}
+
+/**
+ * Get the lookup tables for these quantization parameters, only rebuilt when
+ * they change (e.g. when switching between impulses)
+ */
+__attribute__((unused)) static const ei_image_quant_lut_t *ei_image_quant_lut_get(
+    float scale,
+    float zero_point,
+    int image_scaling,
+    int16_t channel_count)
+{
+    static ei_image_quant_lut_t lut;
+
+    if (lut.ready && lut.scale == scale && lut.zero_point == zero_point &&
+        lut.image_scaling == image_scaling && lut.channel_count == channel_count) {
+        return &lut;
+    }
+
+    lut.scale = scale;
+    lut.zero_point = zero_point;
+    lut.image_scaling = image_scaling;
+    lut.channel_count = channel_count;
+
+    if (channel_count == 3) {
+        lut.offset_128 = true;
+        for (int c = 0; c < 3; c++) {
+            for (int ix = 0; ix < 256; ix++) {
+                float q = round(ei_image_scale_channel(ix, c, image_scaling) / scale) + zero_point;
+                int32_t v = q < -128.0f ? -128 : (q > 127.0f ? 127 : static_cast<int32_t>(q));
+                lut.rgb[c][ix] = static_cast<int8_t>(v);
+                lut.offset_128 &= (v == ix - 128);
+            }
+        }
+    }
+    else {
+        // ITU-R 601-2 luma transform
+        // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
+        static const float weights[] = { 0.299f, 0.587f, 0.114f };
+
+        lut.gray_zero_point = static_cast<int32_t>(zero_point);
+
+        if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+            // pixel values are the quantized values, 16.16 and truncated like the previous fixed point code path
+            lut.gray_shift = 16;
+            lut.gray_round = 0;
+            for (int c = 0; c < 3; c++) {
+                const int32_t weight = (int32_t)(weights[c] * 65536.0f);
+                for (int ix = 0; ix < 256; ix++) {
+                    lut.gray[c][ix] = weight * ix;
+                }
+            }
+        }
+        else {
+            // 8 fraction bits leave room for large values (small scales) in the sum
+            lut.gray_shift = 8;
+            lut.gray_round = 1 << 7;
+            for (int c = 0; c < 3; c++) {
+                for (int ix = 0; ix < 256; ix++) {
+                    float v = weights[c] * ei_image_scale_channel(ix, c, image_scaling) / scale * 256.0f;
+                    // keeps the sum of three in range, saturates in the end anyway
+                    if (v > 536870912.0f) v = 536870912.0f;
+                    else if (v < -536870912.0f) v = -536870912.0f;
+                    lut.gray[c][ix] = static_cast<int32_t>(round(v));
+                }
+            }
+        }
+    }
+
+    lut.ready = true;
+
+    return &lut;
+}
+
+/**
+ * value - 128 for a run of bytes, 4 at a time (the default 0..1 scaling
+ * with scale 1/255 and zero point -128)
+ */
+__attribute__((unused)) static void ei_image_u8_to_i8_offset_128(const uint8_t *input, int8_t *output, size_t length)
+{
+    size_t ix = 0;
+
+    for (; ix + 4 <= length; ix += 4) {
+        uint32_t v;
+        memcpy(&v, input + ix, 4);
+        // flipping the top bit of each byte subtracts 128 without carries
+        v ^= 0x80808080;
+        memcpy(output + ix, &v, 4);
+    }
+    for (; ix < length; ix++) {
+        output[ix] = static_cast<int8_t>(input[ix] ^ 0x80);
+    }
+}
+
+/**
+ * Quantize a page read by ei_image_read_page() through the lookup tables
+ *
+ * @return number of int8 values written
+ */
+__attribute__((unused)) static size_t ei_image_quantize_page(
+    const ei_image_quant_lut_t *lut,
+    const float *buffer,
+    bool is_rgb888,
+    size_t pixels,
+    int8_t *output)
+{
+    if (lut->channel_count == 3) {
+        if (is_rgb888 && lut->offset_128) {
+            ei_image_u8_to_i8_offset_128(reinterpret_cast<const uint8_t*>(buffer), output, pixels * 3);
+            return pixels * 3;
+        }
+
+        for (size_t ix = 0; ix < pixels; ix++) {
+            uint32_t pixel = ei_image_get_pixel(buffer, is_rgb888, ix);
+
+            *output++ = lut->rgb[0][pixel >> 16 & 0xff];
+            *output++ = lut->rgb[1][pixel >> 8 & 0xff];
+            *output++ = lut->rgb[2][pixel & 0xff];
+        }
+        return pixels * 3;
+    }
+
+    for (size_t ix = 0; ix < pixels; ix++) {
+        uint32_t pixel = ei_image_get_pixel(buffer, is_rgb888, ix);
+
+        int32_t gray = lut->gray[0][pixel >> 16 & 0xff] +
+                       lut->gray[1][pixel >> 8 & 0xff] +
+                       lut->gray[2][pixel & 0xff] +
+                       lut->gray_round;
+        gray >>= lut->gray_shift;
+        gray += lut->gray_zero_point;
+        if (gray < -128) gray = -128;
+        else if (gray > 127) gray = 127;
+        *output++ = static_cast<int8_t>(gray);
+    }
+    return pixels;
+}
+
 __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, matrix_i8_t *output_matrix, void *config_ptr, float scale, float zero_point, const float frequency,
                                                              int image_scaling) {
     ei_dsp_config_image_t config = *((ei_dsp_config_image_t*)config_ptr);
@@ -1270,12 +1559,7 @@ __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, m
 
     size_t output_ix = 0;
 
-    const int32_t iRedToGray = (int32_t)(0.299f * 65536.0f);
-    const int32_t iGreenToGray = (int32_t)(0.587f * 65536.0f);
-    const int32_t iBlueToGray = (int32_t)(0.114f * 65536.0f);
-
-    static const float torch_mean[] = { 0.485, 0.456, 0.406 };
-    static const float torch_std[] = { 0.229, 0.224, 0.225 };
+    const ei_image_quant_lut_t *lut = ei_image_quant_lut_get(scale, zero_point, image_scaling, channel_count);
 
 #if defined(EI_DSP_IMAGE_BUFFER_STATIC_SIZE)
     const size_t page_size = EI_DSP_IMAGE_BUFFER_STATIC_SIZE;
@@ -1296,102 +1580,10 @@ __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, m
         if (!input_matrix.buffer) {
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
-        signal->get_data(ix, elements_to_read, input_matrix.buffer);
-
-        for (size_t jx = 0; jx < elements_to_read; jx++) {
-            uint32_t pixel = static_cast<uint32_t>(input_matrix.buffer[jx]);
+        bool is_rgb888 = ei_image_read_page(signal, ix, elements_to_read, input_matrix.buffer);
 
-            if (channel_count == 3) {
-                // fast code path
-                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
-                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
-                    int32_t b = static_cast<int32_t>(pixel & 0xff);
-
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(r + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(g + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(b + zero_point);
-                }
-                // slow code path
-                else {
-                    float r = static_cast<float>(pixel >> 16 & 0xff);
-                    float g = static_cast<float>(pixel >> 8 & 0xff);
-                    float b = static_cast<float>(pixel & 0xff);
-
-                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-
-                        r = (r - torch_mean[0]) / torch_std[0];
-                        g = (g - torch_mean[1]) / torch_std[1];
-                        b = (b - torch_mean[2]) / torch_std[2];
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
-                        r -= 128.0f;
-                        g -= 128.0f;
-                        b -= 128.0f;
-                    }
-
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(r / scale) + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(g / scale) + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(b / scale) + zero_point);
-                }
-            }
-            else {
-                // fast code path
-                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
-                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
-                    int32_t b = static_cast<int32_t>(pixel & 0xff);
-
-                    // ITU-R 601-2 luma transform
-                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
-                    int32_t gray = (iRedToGray * r) + (iGreenToGray * g) + (iBlueToGray * b);
-                    gray >>= 16; // scale down to int8_t
-                    gray += zero_point;
-                    if (gray < - 128) gray = -128;
-                    else if (gray > 127) gray = 127;
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(gray);
-                }
-                // slow code path
-                else {
-                    float r = static_cast<float>(pixel >> 16 & 0xff);
-                    float g = static_cast<float>(pixel >> 8 & 0xff);
-                    float b = static_cast<float>(pixel & 0xff);
-
-                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-
-                        r = (r - torch_mean[0]) / torch_std[0];
-                        g = (g - torch_mean[1]) / torch_std[1];
-                        b = (b - torch_mean[2]) / torch_std[2];
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
-                        r -= 128.0f;
-                        g -= 128.0f;
-                        b -= 128.0f;
-                    }
-
-                    // ITU-R 601-2 luma transform
-                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
-                    float v = (0.299f * r) + (0.587f * g) + (0.114f * b);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(v / scale) + zero_point);
-                }
-            }
-        }
+        output_ix += ei_image_quantize_page(lut, input_matrix.buffer, is_rgb888, elements_to_read,
+                                           &output_matrix->buffer[output_ix]);
 
         bytes_left -= elements_to_read;
 
@@ -0,0 +1,233 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _EI_CLASSIFIER_STATIC_PIPELINE_H_
+#define _EI_CLASSIFIER_STATIC_PIPELINE_H_
+
+#include "model-parameters/model_metadata.h"
+
+#ifndef EI_CLASSIFIER_STATIC_PIPELINE
+#define EI_CLASSIFIER_STATIC_PIPELINE 0
+#endif // EI_CLASSIFIER_STATIC_PIPELINE
+
+#if EI_CLASSIFIER_STATIC_PIPELINE == 1
+
+#include "edge-impulse-sdk/dsp/numpy_types.h"
+#include "edge-impulse-sdk/dsp/returntypes.hpp"
+#include "edge-impulse-sdk/classifier/ei_model_types.h"
+#include "edge-impulse-sdk/classifier/ei_signal_with_axes.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+#if EI_CLASSIFIER_LOAD_IMAGE_SCALING
+#error "EI_CLASSIFIER_STATIC_PIPELINE=1 does not support image scaling, build with EI_CLASSIFIER_STATIC_PIPELINE=0"
+#endif
+
+/**
+ * Statically typed impulse.
+ *
+ * With EI_CLASSIFIER_STATIC_PIPELINE=1 model_variables.h describes the
+ * default impulse as a type as well, e.g.:
+ *
+ *   typedef ei_static_pipeline<
+ *       ei_static_dsp_blocks<
+ *           ei_static_dsp_block<0, 33, true, &extract_spectral_analysis_features_static<...>>
+ *       >,
+ *       ei_static_learning_blocks<
+ *           ei_static_learning_block<0, &run_nn_inference>,
+ *           ei_static_learning_block<1, &run_kmeans_anomaly>
+ *       >
+ *   > ei_static_pipeline_t;
+ *
+ * process_impulse() then runs the DSP and learning blocks of the default
+ * impulse through this type instead of looping over the function pointers in
+ * ei_impulse_t. All calls are direct (and can be inlined), the block loops are
+ * unrolled, the output features go into static buffers instead of being
+ * allocated per window, and the axes remapping is skipped at compile time for
+ * blocks that use every axis. Block configs and axes are still read from the
+ * ei_impulse_t, at the same index.
+ *
+ * Stateful DSP blocks (factory != nullptr) and image scaling are not
+ * supported, the generator falls back to the dynamic pipeline for those.
+ * Other impulses (e.g. from a multi-impulse deployment) always run dynamically.
+ */
+
+typedef int (*ei_static_extract_fn_t)(ei::signal_t *signal, ei::matrix_t *output_matrix, void *config, const float frequency);
+typedef EI_IMPULSE_ERROR (*ei_static_infer_fn_t)(const ei_impulse_t *impulse, ei_feature_t *fmatrix, uint32_t learn_block_index, uint32_t* input_block_ids, uint32_t input_block_ids_size, ei_impulse_result_t *result, void *config, bool debug);
+
+/**
+ * DSP block at impulse->dsp_blocks[Index]
+ *
+ * @tparam Index            index of the block in the impulse
+ * @tparam OutputFeatures   n_output_features of the block
+ * @tparam AllAxes          true if the block uses all axes of the signal, in order
+ * @tparam ExtractFn        feature extraction function
+ */
+template<size_t Index, size_t OutputFeatures, bool AllAxes, ei_static_extract_fn_t ExtractFn>
+struct ei_static_dsp_block {
+    static EI_IMPULSE_ERROR run(const ei_impulse_t *impulse, ei::signal_t *signal, ei_feature_t *features)
+    {
+        static float buffer[OutputFeatures];
+        static ei::matrix_t matrix(1, OutputFeatures, buffer);
+
+        const ei_model_dsp_t *block = &impulse->dsp_blocks[Index];
+
+        // extract functions are allowed to reshape the output matrix
+        matrix.rows = 1;
+        matrix.cols = OutputFeatures;
+
+        features[Index].matrix = &matrix;
+        features[Index].blockId = block->blockId;
+
+        int ret;
+        if (AllAxes) {
+            ret = ExtractFn(signal, &matrix, block->config, impulse->frequency);
+        }
+        else {
+#if EIDSP_SIGNAL_C_FN_POINTER
+            static_assert(AllAxes, "EIDSP_SIGNAL_C_FN_POINTER can only be used when all axes are selected for DSP blocks");
+#else
+            SignalWithAxes swa(signal, block->axes, block->axes_size, impulse);
+            ret = ExtractFn(swa.get_signal(), &matrix, block->config, impulse->frequency);
+#endif
+        }
+
+        if (ret != EIDSP_OK) {
+            ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
+            return EI_IMPULSE_DSP_ERROR;
+        }
+
+        return ei_run_impulse_check_canceled();
+    }
+};
+
+/**
+ * Learning block at impulse->learning_blocks[Index]
+ */
+template<size_t Index, ei_static_infer_fn_t InferFn>
+struct ei_static_learning_block {
+    static EI_IMPULSE_ERROR run(const ei_impulse_t *impulse, ei_feature_t *features, ei_impulse_result_t *result, bool debug)
+    {
+        const ei_learning_block_t *block = &impulse->learning_blocks[Index];
+
+        return InferFn(impulse, features, Index, (uint32_t*)block->input_block_ids, block->input_block_ids_size, result, block->config, debug);
+    }
+};
+
+template<typename... Blocks>
+struct ei_static_dsp_blocks;
+
+template<>
+struct ei_static_dsp_blocks<> {
+    static constexpr size_t size = 0;
+
+    static EI_IMPULSE_ERROR run(const ei_impulse_t *, ei::signal_t *, ei_feature_t *)
+    {
+        return EI_IMPULSE_OK;
+    }
+};
+
+template<typename Block, typename... Rest>
+struct ei_static_dsp_blocks<Block, Rest...> {
+    static constexpr size_t size = 1 + sizeof...(Rest);
+
+    static EI_IMPULSE_ERROR run(const ei_impulse_t *impulse, ei::signal_t *signal, ei_feature_t *features)
+    {
+        EI_IMPULSE_ERROR res = Block::run(impulse, signal, features);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+        return ei_static_dsp_blocks<Rest...>::run(impulse, signal, features);
+    }
+};
+
+template<typename... Blocks>
+struct ei_static_learning_blocks;
+
+template<>
+struct ei_static_learning_blocks<> {
+    static EI_IMPULSE_ERROR run(const ei_impulse_t *, ei_feature_t *, ei_impulse_result_t *, bool)
+    {
+        return EI_IMPULSE_OK;
+    }
+};
+
+template<typename Block, typename... Rest>
+struct ei_static_learning_blocks<Block, Rest...> {
+    static EI_IMPULSE_ERROR run(const ei_impulse_t *impulse, ei_feature_t *features, ei_impulse_result_t *result, bool debug)
+    {
+        EI_IMPULSE_ERROR res = Block::run(impulse, features, result, debug);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+        return ei_static_learning_blocks<Rest...>::run(impulse, features, result, debug);
+    }
+};
+
+template<typename DspBlocks, typename LearningBlocks>
+struct ei_static_pipeline {
+    static constexpr size_t dsp_blocks_size = DspBlocks::size;
+
+    /**
+     * @brief      Run all DSP blocks
+     *
+     * @param      impulse   impulse the pipeline was generated for
+     * @param      signal    raw signal
+     * @param      features  dsp_blocks_size entries, filled with (static) feature matrices
+     *
+     * @return     The ei impulse error.
+     */
+    static EI_IMPULSE_ERROR run_dsp(const ei_impulse_t *impulse, ei::signal_t *signal, ei_feature_t *features)
+    {
+        return DspBlocks::run(impulse, signal, features);
+    }
+
+    /**
+     * @brief      Run all learning blocks over the features from run_dsp()
+     *
+     * @return     The ei impulse error.
+     */
+    static EI_IMPULSE_ERROR run_inference(const ei_impulse_t *impulse, ei_feature_t *features, ei_impulse_result_t *result, bool debug)
+    {
+        EI_IMPULSE_ERROR res = LearningBlocks::run(impulse, features, result, debug);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+        return ei_run_impulse_check_canceled();
+    }
+};
+
+#endif // EI_CLASSIFIER_STATIC_PIPELINE == 1
+
+#endif // _EI_CLASSIFIER_STATIC_PIPELINE_H_
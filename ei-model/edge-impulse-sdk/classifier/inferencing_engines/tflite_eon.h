@@ -44,6 +44,34 @@
 #include "edge-impulse-sdk/classifier/inferencing_engines/tflite_helper.h"
 #include "edge-impulse-sdk/classifier/ei_run_dsp.h"
 
+#ifndef EI_CLASSIFIER_EON_MAX_PREPARED_GRAPHS
+#define EI_CLASSIFIER_EON_MAX_PREPARED_GRAPHS   4
+#endif
+
+// Graphs that stay initialized between invokes while a batch is running, see
+// ei_eon_batch_begin(). Outside of a batch every invoke does init + reset.
+static ei_config_tflite_eon_graph_t *eon_prepared_graphs[EI_CLASSIFIER_EON_MAX_PREPARED_GRAPHS];
+static size_t eon_prepared_graphs_count = 0;
+
+static bool eon_graph_is_prepared(ei_config_tflite_eon_graph_t *graph_config) {
+    for (size_t ix = 0; ix < eon_prepared_graphs_count; ix++) {
+        if (eon_prepared_graphs[ix] == graph_config) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Release the graph after an invoke, unless it's kept for the running batch
+ */
+static TfLiteStatus inference_tflite_release(ei_config_tflite_eon_graph_t *graph_config) {
+    if (eon_graph_is_prepared(graph_config)) {
+        return kTfLiteOk;
+    }
+    return graph_config->model_reset(ei_aligned_free);
+}
+
 /**
  * Setup the TFLite runtime
  *
@@ -66,10 +94,12 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
     TfLiteTensor *outputs = *output_arg;
     ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
 
-    TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
-    if (init_status != kTfLiteOk) {
-        ei_printf("Failed to initialize the model (error code %d)\n", init_status);
-        return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+    if (!eon_graph_is_prepared(graph_config)) {
+        TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
+        if (init_status != kTfLiteOk) {
+            ei_printf("Failed to initialize the model (error code %d)\n", init_status);
+            return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+        }
     }
 
     TfLiteStatus status;
@@ -179,7 +209,7 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
         return output_res;
     }
 
-    if (graph_config->model_reset(ei_aligned_free) != kTfLiteOk) {
+    if (inference_tflite_release(graph_config) != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
     ei_free(outputs);
@@ -294,7 +324,7 @@ EI_IMPULSE_ERROR run_nn_inference(
         result->_raw_outputs[learn_block_index + output_ix].blockId = block_config->block_id + output_ix;
     }
 
-    graph_config->model_reset(ei_aligned_free);
+    inference_tflite_release(graph_config);
     ei_free(outputs);
 
     if (run_res != EI_IMPULSE_OK) {
@@ -430,7 +460,7 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
         result->_raw_outputs[learn_block_index + output_ix].blockId = block_config->block_id + output_ix;
     }
 
-    graph_config->model_reset(ei_aligned_free);
+    inference_tflite_release(graph_config);
     ei_free(outputs);
 
     if (run_res != EI_IMPULSE_OK) {
@@ -441,6 +471,53 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
 }
 #endif // EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
 
+/**
+ * @brief      Initialize the EON graphs of all learning blocks of the impulse
+ *             once, they stay prepared (arena allocated, ops initialized) for
+ *             every following invoke until ei_eon_batch_end() is called.
+ *
+ * @param      impulse  The impulse
+ *
+ * @return     The ei impulse error.
+ */
+__attribute__((unused)) static EI_IMPULSE_ERROR ei_eon_batch_begin(const ei_impulse_t *impulse) {
+    for (size_t ix = 0; ix < impulse->learning_blocks_size; ix++) {
+        if (impulse->learning_blocks[ix].infer_fn != run_nn_inference) {
+            continue;
+        }
+
+        ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)impulse->learning_blocks[ix].config;
+        ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+        if (eon_graph_is_prepared(graph_config)
+            || eon_prepared_graphs_count >= EI_CLASSIFIER_EON_MAX_PREPARED_GRAPHS) {
+            continue;
+        }
+
+        TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
+        if (init_status != kTfLiteOk) {
+            ei_printf("Failed to initialize the model (error code %d)\n", init_status);
+            return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+        }
+
+        eon_prepared_graphs[eon_prepared_graphs_count++] = graph_config;
+    }
+
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Release all graphs that were prepared by ei_eon_batch_begin()
+ */
+__attribute__((unused)) static void ei_eon_batch_end(void) {
+    size_t count = eon_prepared_graphs_count;
+
+    eon_prepared_graphs_count = 0;
+    for (size_t ix = 0; ix < count; ix++) {
+        eon_prepared_graphs[ix]->model_reset(ei_aligned_free);
+    }
+}
+
 __attribute__((unused)) int extract_tflite_eon_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
     ei_dsp_config_tflite_eon_t *dsp_config = (ei_dsp_config_tflite_eon_t*)config_ptr;
 
@@ -168,4 +168,136 @@ public:
 
     float threshold;
     bool use_iou;
-};
\ No newline at end of file
+};
+/**
+ * Same matching as JonkerVolgenantAlignment, but on caller owned arrays and
+ * preallocated cost / solver buffers, so align() doesn't touch the heap.
+ *
+ * In IoU mode the cost matrix is gated first: a cheap overlap test finds the
+ * traces and detections that don't overlap anything, those rows / columns
+ * only hold the maximum cost (1) and are dropped before the assignment. This
+ * doesn't change the optimal assignment cost, and such pairs never pass the
+ * threshold anyway.
+ */
+template <uint32_t MaxTraces, uint32_t MaxDetections>
+class FixedCapacityAlignment {
+public:
+    FixedCapacityAlignment(float threshold, bool use_iou = true) : threshold(threshold), use_iou(use_iou) {
+    }
+
+    /**
+     * @param traces Bounding boxes of the open traces (max. MaxTraces)
+     * @param traces_count Number of traces
+     * @param detections Bounding boxes of the new detections (max. MaxDetections)
+     * @param detections_count Number of detections
+     * @param matches Output, (trace idx, detection idx, iou or distance),
+     *        room for min(MaxTraces, MaxDetections) entries
+     * @param total_cost Output, sum of the iou or distance of all matches
+     * @return Number of matches
+     */
+    uint32_t align(const ei_impulse_result_bounding_box_t *traces, uint32_t traces_count,
+                   const ei_impulse_result_bounding_box_t *detections, uint32_t detections_count,
+                   std::tuple<int, int, float> *matches, float *total_cost) {
+
+        *total_cost = 0;
+
+        if (traces_count == 0 || detections_count == 0) {
+            return 0;
+        }
+
+        if (traces_count > MaxTraces || detections_count > MaxDetections) {
+            EI_LOGE("FixedCapacityAlignment: too many traces (%u) or detections (%u)\n",
+                (unsigned)traces_count, (unsigned)detections_count);
+            return 0;
+        }
+
+        // gate on overlap, keep the rows / columns that can produce a match
+        uint32_t nr = 0;
+        uint32_t nc = 0;
+        bool detection_kept[MaxDetections] = { false };
+
+        for (uint32_t trace_idx = 0; trace_idx < traces_count; trace_idx++) {
+            bool kept = !use_iou;
+            for (uint32_t detection_idx = 0; detection_idx < detections_count; detection_idx++) {
+                if (!use_iou || overlaps(traces[trace_idx], detections[detection_idx])) {
+                    kept = true;
+                    detection_kept[detection_idx] = true;
+                }
+            }
+            if (kept) {
+                rows[nr++] = trace_idx;
+            }
+        }
+
+        for (uint32_t detection_idx = 0; detection_idx < detections_count; detection_idx++) {
+            if (detection_kept[detection_idx]) {
+                cols[nc++] = detection_idx;
+            }
+        }
+
+        if (nr == 0 || nc == 0) {
+            return 0;
+        }
+
+        for (uint32_t r = 0; r < nr; r++) {
+            for (uint32_t c = 0; c < nc; c++) {
+                const ei_impulse_result_bounding_box_t &trace = traces[rows[r]];
+                const ei_impulse_result_bounding_box_t &detection = detections[cols[c]];
+                float cost = 0.0;
+                if (use_iou) {
+                    // disjoint boxes have an IoU of 0, skip the division
+                    cost = overlaps(trace, detection) ? 1 - intersection_over_union(trace, detection) : 1;
+                } else {
+                    cost = centroid_euclidean_distance(trace, detection);
+                }
+                cost_mtx[r * nc + c] = cost;
+            }
+        }
+
+        if (solve_in_workspace(nr, nc, cost_mtx, false, alignments_a, alignments_b, workspace.get()) != 0) {
+            return 0;
+        }
+
+        uint32_t matches_count = 0;
+        uint32_t num_iterations = nr > nc ? nc : nr;
+
+        for (uint32_t i = 0; i < num_iterations; i++) {
+            int64_t r = alignments_a[i];
+            int64_t c = alignments_b[i];
+            float cost = cost_mtx[r * nc + c];
+
+            if (use_iou) {
+                float iou = 1 - cost;
+                if (iou > threshold) {
+                    matches[matches_count++] = std::make_tuple((int)rows[r], (int)cols[c], iou);
+                    *total_cost += iou;
+                }
+            } else {
+                if (cost < threshold) {
+                    matches[matches_count++] = std::make_tuple((int)rows[r], (int)cols[c], cost);
+                    *total_cost += cost;
+                }
+            }
+        }
+
+        return matches_count;
+    }
+
+    float threshold;
+    bool use_iou;
+
+private:
+    static constexpr uint32_t max_dim = MaxTraces > MaxDetections ? MaxTraces : MaxDetections;
+
+    static bool overlaps(const ei_impulse_result_bounding_box_t &bbox1, const ei_impulse_result_bounding_box_t &bbox2) {
+        return bbox1.x < bbox2.x + bbox2.width && bbox2.x < bbox1.x + bbox1.width &&
+               bbox1.y < bbox2.y + bbox2.height && bbox2.y < bbox1.y + bbox1.height;
+    }
+
+    double cost_mtx[MaxTraces * MaxDetections];
+    int64_t alignments_a[max_dim];
+    int64_t alignments_b[max_dim];
+    uint32_t rows[MaxTraces];
+    uint32_t cols[MaxDetections];
+    LsapWorkspace<max_dim, MaxTraces * MaxDetections> workspace;
+};
@@ -44,6 +44,7 @@ Author: PM Larsen
 #include <vector>
 #include <numeric>
 #include <algorithm>
+#include <memory>
 
 #define RECTANGULAR_LSAP_INFEASIBLE -1
 #define RECTANGULAR_LSAP_INVALID -2
@@ -57,13 +58,70 @@ template <typename T> std::vector<intptr_t> argsort_iter(const std::vector<T> &v
     return index;
 }
 
+/**
+ * Scratch memory for solve_in_workspace(), for an nr x nc problem every
+ * array needs max(nr, nc) entries and temp needs nr * nc (only used when
+ * the matrix has to be transposed or negated).
+ */
+typedef struct {
+    double *u;
+    double *v;
+    double *shortestPathCosts;
+    double *temp;
+    intptr_t *path;
+    intptr_t *col4row;
+    intptr_t *row4col;
+    intptr_t *remaining;
+    bool *SR;
+    bool *SC;
+} lsap_workspace_t;
+
+/**
+ * Statically sized lsap_workspace_t, for callers that solve many small
+ * problems and don't want to touch the heap
+ */
+template <intptr_t MaxDim, intptr_t MaxCells = MaxDim * MaxDim>
+class LsapWorkspace {
+public:
+    LsapWorkspace() {
+        ws.u = u;
+        ws.v = v;
+        ws.shortestPathCosts = shortestPathCosts;
+        ws.temp = temp;
+        ws.path = path;
+        ws.col4row = col4row;
+        ws.row4col = row4col;
+        ws.remaining = remaining;
+        ws.SR = SR;
+        ws.SC = SC;
+    }
+
+    lsap_workspace_t *get() { return &ws; }
+
+    static constexpr intptr_t max_dim = MaxDim;
+    static constexpr intptr_t max_cells = MaxCells;
+
+private:
+    lsap_workspace_t ws;
+    double u[MaxDim];
+    double v[MaxDim];
+    double shortestPathCosts[MaxDim];
+    double temp[MaxCells];
+    intptr_t path[MaxDim];
+    intptr_t col4row[MaxDim];
+    intptr_t row4col[MaxDim];
+    intptr_t remaining[MaxDim];
+    bool SR[MaxDim];
+    bool SC[MaxDim];
+};
+
 static intptr_t
-augmenting_path(intptr_t nc, double *cost, std::vector<double>& u,
-                std::vector<double>& v, std::vector<intptr_t>& path,
-                std::vector<intptr_t>& row4col,
-                std::vector<double>& shortestPathCosts, intptr_t i,
-                std::vector<bool>& SR, std::vector<bool>& SC,
-                std::vector<intptr_t>& remaining, double* p_minVal)
+augmenting_path(intptr_t nr, intptr_t nc, double *cost, double *u,
+                double *v, intptr_t *path,
+                intptr_t *row4col,
+                double *shortestPathCosts, intptr_t i,
+                bool *SR, bool *SC,
+                intptr_t *remaining, double* p_minVal)
 {
     double minVal = 0;
 
@@ -76,9 +134,9 @@ augmenting_path(intptr_t nc, double *cost, std::vector<double>& u,
         remaining[it] = nc - it - 1;
     }
 
-    std::fill(SR.begin(), SR.end(), false);
-    std::fill(SC.begin(), SC.end(), false);
-    std::fill(shortestPathCosts.begin(), shortestPathCosts.end(), INFINITY);
+    std::fill(SR, SR + nr, false);
+    std::fill(SC, SC + nc, false);
+    std::fill(shortestPathCosts, shortestPathCosts + nc, INFINITY);
 
     // find shortest augmenting path
     intptr_t sink = -1;
@@ -127,8 +185,11 @@ augmenting_path(intptr_t nc, double *cost, std::vector<double>& u,
     return sink;
 }
 
-static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
-                 int64_t* a, int64_t* b) {
+/**
+ * Same as solve(), but all scratch memory comes from ws (see lsap_workspace_t)
+ */
+static int solve_in_workspace(intptr_t nr, intptr_t nc, double* cost, bool maximize,
+                              int64_t* a, int64_t* b, lsap_workspace_t *ws) {
     // handle trivial inputs
     if (nr == 0 || nc == 0) {
         return 0;
@@ -138,9 +199,8 @@ static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
     bool transpose = nc < nr;
 
     // make a copy of the cost matrix if we need to modify it
-    std::vector<double> temp;
     if (transpose || maximize) {
-        temp.resize(nr * nc);
+        double *temp = ws->temp;
 
         if (transpose) {
             for (intptr_t i = 0; i < nr; i++) {
@@ -152,7 +212,7 @@ static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
             std::swap(nr, nc);
         }
         else {
-            std::copy(cost, cost + nr * nc, temp.begin());
+            std::copy(cost, cost + nr * nc, temp);
         }
 
         // negate cost matrix for maximization
@@ -162,7 +222,7 @@ static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
             }
         }
 
-        cost = temp.data();
+        cost = temp;
     }
 
     // test for NaN and -inf entries
@@ -173,21 +233,27 @@ static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
     }
 
     // initialize variables
-    std::vector<double> u(nr, 0);
-    std::vector<double> v(nc, 0);
-    std::vector<double> shortestPathCosts(nc);
-    std::vector<intptr_t> path(nc, -1);
-    std::vector<intptr_t> col4row(nr, -1);
-    std::vector<intptr_t> row4col(nc, -1);
-    std::vector<bool> SR(nr);
-    std::vector<bool> SC(nc);
-    std::vector<intptr_t> remaining(nc);
+    double *u = ws->u;
+    double *v = ws->v;
+    double *shortestPathCosts = ws->shortestPathCosts;
+    intptr_t *path = ws->path;
+    intptr_t *col4row = ws->col4row;
+    intptr_t *row4col = ws->row4col;
+    bool *SR = ws->SR;
+    bool *SC = ws->SC;
+    intptr_t *remaining = ws->remaining;
+
+    std::fill(u, u + nr, 0);
+    std::fill(v, v + nc, 0);
+    std::fill(path, path + nc, -1);
+    std::fill(col4row, col4row + nr, -1);
+    std::fill(row4col, row4col + nc, -1);
 
     // iteratively build the solution
     for (intptr_t curRow = 0; curRow < nr; curRow++) {
 
         double minVal;
-        intptr_t sink = augmenting_path(nc, cost, u, v, path, row4col,
+        intptr_t sink = augmenting_path(nr, nc, cost, u, v, path, row4col,
                                         shortestPathCosts, curRow, SR, SC,
                                         remaining, &minVal);
         if (sink < 0) {
@@ -221,11 +287,19 @@ static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
     }
 
     if (transpose) {
-        intptr_t i = 0;
-        for (auto v: argsort_iter(col4row)) {
-            a[i] = col4row[v];
-            b[i] = v;
-            i++;
+        // argsort of col4row (no allocation, the entries are unique)
+        intptr_t *index = remaining;
+        for (intptr_t i = 0; i < nr; i++) {
+            intptr_t k = i;
+            while (k > 0 && col4row[index[k - 1]] > col4row[i]) {
+                index[k] = index[k - 1];
+                k--;
+            }
+            index[k] = i;
+        }
+        for (intptr_t i = 0; i < nr; i++) {
+            a[i] = col4row[index[i]];
+            b[i] = index[i];
         }
     }
     else {
@@ -238,6 +312,35 @@ static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
     return 0;
 }
 
+static int solve(intptr_t nr, intptr_t nc, double* cost, bool maximize,
+                 int64_t* a, int64_t* b) {
+    // handle trivial inputs
+    if (nr == 0 || nc == 0) {
+        return 0;
+    }
+
+    const intptr_t dim = std::max(nr, nc);
+
+    std::vector<double> temp((nc < nr || maximize) ? nr * nc : 0);
+    std::vector<double> u(dim);
+    std::vector<double> v(dim);
+    std::vector<double> shortestPathCosts(dim);
+    std::vector<intptr_t> path(dim);
+    std::vector<intptr_t> col4row(dim);
+    std::vector<intptr_t> row4col(dim);
+    std::vector<intptr_t> remaining(dim);
+    std::unique_ptr<bool[]> SR(new bool[dim]);
+    std::unique_ptr<bool[]> SC(new bool[dim]);
+
+    lsap_workspace_t ws = {
+        u.data(), v.data(), shortestPathCosts.data(), temp.data(),
+        path.data(), col4row.data(), row4col.data(), remaining.data(),
+        SR.get(), SC.get()
+    };
+
+    return solve_in_workspace(nr, nc, cost, maximize, a, b, &ws);
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -46,6 +46,7 @@
 extern ei_impulse_handle_t & ei_default_impulse;
 
 #include <vector>
+#include <algorithm>
 #include "tinyEKF/tinyekf.hpp"
 #include "alignment/ei_alignment.hpp"
 
@@ -55,6 +56,19 @@ float clip(float num, float min_val = -3.4028235e+38, float max_val = 3.4028235e
 
 #if EI_CLASSIFIER_OBJECT_TRACKING_ENABLED == 1
 
+// Use FixedCapacityTracker (no heap use while tracking) instead of Tracker
+#ifndef EI_CLASSIFIER_OBJECT_TRACKING_FIXED_CAPACITY
+#define EI_CLASSIFIER_OBJECT_TRACKING_FIXED_CAPACITY    0
+#endif
+
+#ifndef EI_CLASSIFIER_OBJECT_TRACKING_MAX_TRACES
+#define EI_CLASSIFIER_OBJECT_TRACKING_MAX_TRACES        16
+#endif
+
+#ifndef EI_CLASSIFIER_OBJECT_TRACKING_MAX_DETECTIONS
+#define EI_CLASSIFIER_OBJECT_TRACKING_MAX_DETECTIONS    16
+#endif
+
 typedef struct {
     float keep_grace;
 } ei_obj_tracking_params_t;
@@ -76,6 +90,11 @@ public:
         return ema_value;
     }
 
+    void reset(int n, float gain = 2) {
+        this->gain = gain / (n + 1);
+        ema_value = -255.0;
+    }
+
 private:
     float gain;
     float ema_value;
@@ -117,6 +136,35 @@ public:
         delete xyxy_emas[3];
     }
 
+    /**
+     * Reuse this trace for a new object, same as constructing a new Trace
+     * but reusing the filters and the observations storage
+     */
+    void reset(int id, int t, const ei_impulse_result_bounding_box_t& initial_bbox, uint32_t max_observations = 5) {
+        this->id = id;
+        this->last_ground_truth_update_t = t;
+        this->last_prediction = initial_bbox;
+        this->max_observations = max_observations;
+
+        trace_label = initial_bbox.label;
+        trace_score = initial_bbox.value;
+        observations.clear();
+        observations.reserve(max_observations + 1);
+        observations.push_back(initial_bbox);
+        float initial_centroid[2] = { initial_bbox.x + static_cast<float>(initial_bbox.width) / 2,
+                                      initial_bbox.y + static_cast<float>(initial_bbox.height) / 2 };
+
+        float initial_width_height[2] = { static_cast<float>(initial_bbox.width),
+                                          static_cast<float>(initial_bbox.height) };
+
+        centroid_filter->reset(initial_centroid);
+        width_height_filter->reset(initial_width_height);
+
+        for (int i = 0; i < 4; i++) {
+            xyxy_emas[i]->reset(this->max_observations);
+        }
+    }
+
     ei_impulse_result_bounding_box_t predict() {
         fx_centroid[0] = centroid_filter->x[0];
         fx_centroid[1] = centroid_filter->x[1];
@@ -408,16 +456,266 @@ private:
     std::vector<std::string> seen_labels;
 };
 
+#if EI_CLASSIFIER_OBJECT_TRACKING_FIXED_CAPACITY == 1
+
+/**
+ * Fixed size bitset of indexes, replaces std::set<uint16_t> in the tracker
+ */
+template <uint32_t N>
+class IndexBitset {
+public:
+    IndexBitset() {
+        clear();
+    }
+
+    void clear() {
+        memset(words, 0, sizeof(words));
+    }
+
+    void set(uint32_t ix) {
+        words[ix >> 5] |= (1UL << (ix & 31));
+    }
+
+    void reset(uint32_t ix) {
+        words[ix >> 5] &= ~(1UL << (ix & 31));
+    }
+
+    bool test(uint32_t ix) const {
+        return (words[ix >> 5] >> (ix & 31)) & 1;
+    }
+
+    /**
+     * @return Lowest index that is set, or -1 if none
+     */
+    int first() const {
+        for (uint32_t w = 0; w < num_words; w++) {
+            if (words[w]) {
+                return (int)((w << 5) + __builtin_ctzl(words[w]));
+            }
+        }
+        return -1;
+    }
+
+private:
+    static constexpr uint32_t num_words = (N + 31) / 32;
+    unsigned long words[num_words];
+};
+
+/**
+ * Same tracking as Tracker, but with everything preallocated at construction:
+ * a pool of MaxTraces traces that are recycled when closed, fixed arrays for
+ * detections and output, and FixedCapacityAlignment for the matching. After
+ * the traces have seen max_observations updates, processing a frame doesn't
+ * allocate.
+ * Detections above MaxDetections are dropped, new traces are not started
+ * while the pool is exhausted.
+ */
+template <uint32_t MaxTraces, uint32_t MaxDetections>
+class FixedCapacityTracker {
+public:
+    FixedCapacityTracker(uint32_t keep_grace = 5, uint16_t max_observations = 5, float threshold = 0.5, bool use_iou = true)
+            : object_tracking_output_count(0),
+              keep_grace(keep_grace),
+              max_observations(max_observations),
+              open_traces_count(0),
+              trace_seq_id(0),
+              t(0),
+              alignment(threshold, use_iou) {
+        const ei_impulse_result_bounding_box_t empty_bbox = { "", 0, 0, 0, 0, 0.0f };
+        for (uint32_t i = 0; i < MaxTraces; i++) {
+            pool[i] = new Trace(0, 0, empty_bbox, max_observations);
+            // reserves the observations up front
+            pool[i]->reset(0, 0, empty_bbox, max_observations);
+            free_traces.set(i);
+        }
+    }
+
+    ~FixedCapacityTracker() {
+        for (uint32_t i = 0; i < MaxTraces; i++) {
+            delete pool[i];
+        }
+    }
+
+    ei_object_tracking_trace_t object_tracking_output[MaxTraces];
+    uint32_t object_tracking_output_count;
+
+    /**
+     * Process new detections.
+     * @param bbs Bounding boxes, copied, not modified
+     * @param bbs_count Number of bounding boxes
+     */
+    void process_new_detections(const ei_impulse_result_bounding_box_t *bbs, uint32_t bbs_count) {
+        if (bbs_count > MaxDetections) {
+            EI_LOGW("FixedCapacityTracker: %u detections, only tracking the first %u\n",
+                (unsigned)bbs_count, (unsigned)MaxDetections);
+            bbs_count = MaxDetections;
+        }
+
+        uint32_t detections_count = bbs_count;
+        if (detections_count > 0) {
+            memcpy(detections, bbs, detections_count * sizeof(ei_impulse_result_bounding_box_t));
+        }
+
+        // sort detections by x, y, width, height, label (same as Tracker)
+        std::sort(detections, detections + detections_count, [](const ei_impulse_result_bounding_box_t& a, const ei_impulse_result_bounding_box_t& b) {
+            if (a.x != b.x) return a.x < b.x;
+            if (a.y != b.y) return a.y < b.y;
+            if (a.width != b.width) return a.width < b.width;
+            if (a.height != b.height) return a.height < b.height;
+            return std::strcmp(a.label, b.label) < 0;
+        });
+
+        // firstly try an alignment with last observations...
+        for (uint32_t i = 0; i < open_traces_count; i++) {
+            trace_bboxes[i] = *pool[open_traces[i]]->last_observation();
+        }
+
+        float last_obs_cost = 0;
+        uint32_t last_obs_matches_count = alignment.align(trace_bboxes, open_traces_count,
+            detections, detections_count, last_obs_matches, &last_obs_cost);
+        EI_LOGD("last_obs_cost %f\n", last_obs_cost);
+
+        // ... then with the kalman filter predictions
+        for (uint32_t i = 0; i < open_traces_count; i++) {
+            trace_bboxes[i] = pool[open_traces[i]]->predict();
+        }
+
+        float predicted_cost = 0;
+        uint32_t predicted_matches_count = alignment.align(trace_bboxes, open_traces_count,
+            detections, detections_count, predicted_matches, &predicted_cost);
+        EI_LOGD("predicted_cost %f\n", predicted_cost);
+
+        // and use whichever matching set is better
+        const std::tuple<int, int, float> *matches = predicted_matches;
+        uint32_t matches_count = predicted_matches_count;
+
+        if (last_obs_cost < predicted_cost) {
+            EI_LOGD("using last_obs_matches matches\n");
+            matches = last_obs_matches;
+            matches_count = last_obs_matches_count;
+        }
+
+        // assume all detections are unassigned and will becomes new tracks
+        // until we see otherwise ( i.e. they match an existing track )
+        unassigned_detections.clear();
+        for (uint32_t i = 0; i < detections_count; i++) {
+            unassigned_detections.set(i);
+        }
+
+        // update existing traces with any matches
+        for (uint32_t i = 0; i < matches_count; i++) {
+            uint32_t trace_idx = std::get<0>(matches[i]);
+            uint32_t detection_idx = std::get<1>(matches[i]);
+            EI_LOGD("t_idx=%u d_idx=%u iou=%.6f\n", trace_idx, detection_idx, std::get<2>(matches[i]));
+
+            pool[open_traces[trace_idx]]->update(t, &detections[detection_idx]);
+            unassigned_detections.reset(detection_idx);
+        }
+
+        for (uint32_t detection_idx = 0; detection_idx < detections_count; detection_idx++) {
+            if (!unassigned_detections.test(detection_idx)) {
+                continue;
+            }
+
+            int slot = free_traces.first();
+            if (slot < 0) {
+                EI_LOGW("FixedCapacityTracker: all %u traces in use, not starting a new one\n", (unsigned)MaxTraces);
+                break;
+            }
+
+            EI_LOGD("unassigned detection %u => starting new trace\n", (unsigned)detection_idx);
+            free_traces.reset(slot);
+            pool[slot]->reset(trace_seq_id, t, detections[detection_idx], max_observations);
+            open_traces[open_traces_count++] = (uint16_t)slot;
+            trace_seq_id += 1;
+        }
+
+        // close stale traces, compacting open_traces in place (keeps the order)
+        uint32_t still_open = 0;
+
+        for (uint32_t i = 0; i < open_traces_count; i++) {
+            Trace *trace = pool[open_traces[i]];
+            uint32_t time_since_last_update = t - trace->last_ground_truth_update_t;
+            if (time_since_last_update > keep_grace) {
+                EI_LOGD("closing trace %d\n", trace->id);
+                free_traces.set(open_traces[i]);
+            }
+            else {
+                if (trace->last_ground_truth_update_t != t) {
+                    // wasn't match this step, so do rollout of filters
+                    trace->update(t, nullptr);
+                }
+                open_traces[still_open++] = open_traces[i];
+            }
+        }
+
+        open_traces_count = still_open;
+
+        for (uint32_t i = 0; i < open_traces_count; i++) {
+            const Trace *trace = pool[open_traces[i]];
+            ei_object_tracking_trace_t trace_result = { 0 };
+            trace_result.id = trace->id;
+            trace_result.last_ground_truth_update_t = trace->last_ground_truth_update_t;
+            trace_result.label = trace->last_prediction.label;
+            trace_result.x = trace->last_prediction.x;
+            trace_result.y = trace->last_prediction.y;
+            trace_result.width = trace->last_prediction.width;
+            trace_result.height = trace->last_prediction.height;
+            trace_result.last_centroid_segment = trace->last_centroid_segment();
+            trace_result.value = trace->last_prediction.value;
+
+            object_tracking_output[i] = trace_result;
+        }
+        object_tracking_output_count = open_traces_count;
+
+        t += 1;
+    }
+
+    void set_threshold(float threshold) {
+        alignment.threshold = threshold;
+    }
+
+    float get_threshold() {
+        return alignment.threshold;
+    }
+
+    uint32_t keep_grace;
+    uint16_t max_observations;
+
+private:
+    static constexpr uint32_t max_matches = MaxTraces < MaxDetections ? MaxTraces : MaxDetections;
+
+    Trace *pool[MaxTraces];
+    uint16_t open_traces[MaxTraces];   // pool slots, oldest trace first
+    uint32_t open_traces_count;
+    IndexBitset<MaxTraces> free_traces;
+    IndexBitset<MaxDetections> unassigned_detections;
+
+    ei_impulse_result_bounding_box_t detections[MaxDetections];
+    ei_impulse_result_bounding_box_t trace_bboxes[MaxTraces];
+    std::tuple<int, int, float> last_obs_matches[max_matches];
+    std::tuple<int, int, float> predicted_matches[max_matches];
+
+    uint32_t trace_seq_id;
+    uint32_t t;
+    FixedCapacityAlignment<MaxTraces, MaxDetections> alignment;
+};
+
+typedef FixedCapacityTracker<EI_CLASSIFIER_OBJECT_TRACKING_MAX_TRACES, EI_CLASSIFIER_OBJECT_TRACKING_MAX_DETECTIONS> ei_object_tracker_t;
+#else
+typedef Tracker ei_object_tracker_t;
+#endif // EI_CLASSIFIER_OBJECT_TRACKING_FIXED_CAPACITY == 1
+
 EI_IMPULSE_ERROR init_object_tracking(ei_impulse_handle_t *handle, void** state, void *config)
 {
     //const ei_impulse_t *impulse = handle->impulse;
     const ei_object_tracking_config_t *ei_object_tracking_config = (ei_object_tracking_config_t*)config;
 
     // Allocate the object counter
-    Tracker *object_tracker = new Tracker(ei_object_tracking_config->keep_grace,
-                                          ei_object_tracking_config->max_observations,
-                                          ei_object_tracking_config->threshold,
-                                          ei_object_tracking_config->use_iou);
+    ei_object_tracker_t *object_tracker = new ei_object_tracker_t(ei_object_tracking_config->keep_grace,
+                                                                  ei_object_tracking_config->max_observations,
+                                                                  ei_object_tracking_config->threshold,
+                                                                  ei_object_tracking_config->use_iou);
     if (!object_tracker) {
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
@@ -430,7 +728,7 @@ EI_IMPULSE_ERROR init_object_tracking(ei_impulse_handle_t *handle, void** state,
 
 EI_IMPULSE_ERROR deinit_object_tracking(void* state, void *config)
 {
-    Tracker *object_tracker = (Tracker *)state;
+    ei_object_tracker_t *object_tracker = (ei_object_tracker_t *)state;
 
     if (object_tracker) {
         delete object_tracker;
@@ -446,22 +744,30 @@ EI_IMPULSE_ERROR process_object_tracking(ei_impulse_handle_t *handle,
                                          void *config_ptr,
                                          void *state)
 {
-    Tracker *object_tracker = (Tracker *)state;
+    ei_object_tracker_t *object_tracker = (ei_object_tracker_t *)state;
     const ei_object_tracking_config_t *ei_object_tracking_config = (ei_object_tracking_config_t*)config_ptr;
 
     if((void *)object_tracker != NULL) {
         ei_impulse_result_bounding_box_t *bbs = result->bounding_boxes;
         uint32_t bbs_num = result->bounding_boxes_count;
-        std::vector<ei_impulse_result_bounding_box_t> detections(bbs, bbs + bbs_num);
 
         object_tracker->keep_grace = ei_object_tracking_config->keep_grace;
         object_tracker->max_observations = ei_object_tracking_config->max_observations;
         object_tracker->set_threshold(ei_object_tracking_config->threshold);
 
+#if EI_CLASSIFIER_OBJECT_TRACKING_FIXED_CAPACITY == 1
+        object_tracker->process_new_detections(bbs, bbs_num);
+
+        result->postprocessed_output.object_tracking_output.open_traces = object_tracker->object_tracking_output;
+        result->postprocessed_output.object_tracking_output.open_traces_count = object_tracker->object_tracking_output_count;
+#else
+        std::vector<ei_impulse_result_bounding_box_t> detections(bbs, bbs + bbs_num);
+
         object_tracker->process_new_detections(detections);
 
         result->postprocessed_output.object_tracking_output.open_traces = object_tracker->object_tracking_output.data();
         result->postprocessed_output.object_tracking_output.open_traces_count = object_tracker->object_tracking_output.size();
+#endif
     }
     else {
         EI_LOGW("process_object_tracking: object_tracker is NULL, did you forget to call run_classifier_init()?\n");
@@ -43,13 +43,35 @@
 #include "edge-impulse-sdk/classifier/ei_nms.h"
 #include "edge-impulse-sdk/dsp/ei_vector.h"
 #include <string>
+#include <limits>
 
 #ifdef EI_HAS_PADDLEOCR_DETECTOR
 #include <utility>
 #include <queue>
-#include <limits>
 #endif // EI_HAS_PADDLEOCR_DETECTOR
 
+// FOMO: cluster the cells with connected-component labeling in fixed buffers (1),
+// or merge heap allocated cubes like before (0). Outputs that don't fit the fixed
+// buffers (see below) always use the cubes.
+#ifndef EI_CLASSIFIER_FOMO_CLUSTERING
+#define EI_CLASSIFIER_FOMO_CLUSTERING               1
+#endif
+
+// widest FOMO output grid (out_height cells per row)
+#ifndef EI_CLASSIFIER_FOMO_MAX_GRID_WIDTH
+#define EI_CLASSIFIER_FOMO_MAX_GRID_WIDTH           64
+#endif
+
+// objects of one class that can be open (touch the current row) at the same time
+#ifndef EI_CLASSIFIER_FOMO_MAX_COMPONENTS
+#define EI_CLASSIFIER_FOMO_MAX_COMPONENTS           64
+#endif
+
+// upper bound for object_detection_count
+#ifndef EI_CLASSIFIER_FOMO_MAX_OBJECTS
+#define EI_CLASSIFIER_FOMO_MAX_OBJECTS              100
+#endif
+
 int16_t get_block_number(ei_impulse_handle_t *handle, void *init_func)
 {
     for (size_t i = 0; i < handle->impulse->postprocessing_blocks_size; i++) {
@@ -187,6 +209,82 @@ __attribute__((unused)) static void process_cubes(ei_impulse_result_t *result, s
     result->bounding_boxes_count = added_boxes_count;
 }
 
+/**
+ * Score threshold in the domain of a quantized output tensor. A raw value passes
+ * if it dequantizes ((v - zero_point) * scale) to at least the threshold. The lowest
+ * raw value that does is found with that same expression, so rejecting candidates
+ * with an integer compare gives exactly the same results as dequantizing first.
+ */
+template<typename T>
+struct ei_raw_threshold {
+    ei_raw_threshold(float threshold, float zero_point, float scale) {
+        const int32_t lowest = std::numeric_limits<T>::lowest();
+        const int32_t highest = std::numeric_limits<T>::max();
+
+        // dequantizing is only monotonic for a positive scale, otherwise let everything through
+        if (!(scale > 0.0f)) {
+            min_value = lowest;
+            return;
+        }
+
+        min_value = highest + 1;
+        for (int32_t v = highest; v >= lowest; v--) {
+            if (!((static_cast<float>(v) - zero_point) * scale >= threshold)) {
+                break;
+            }
+            min_value = v;
+        }
+    }
+
+    bool passes(T v) const {
+        return v >= min_value;
+    }
+
+    int32_t min_value;
+};
+
+/**
+ * Unquantized tensors: everything passes, the caller compares the score itself
+ */
+template<>
+struct ei_raw_threshold<float> {
+    ei_raw_threshold(float threshold, float zero_point, float scale) { }
+
+    bool passes(float v) const {
+        return true;
+    }
+};
+
+/**
+ * Call fn(ix) for every data[ix * stride] (ix < count) that passes the threshold, in order.
+ * Values are compared and compacted a block at a time without branches, so only the
+ * candidates are dequantized and decoded by fn.
+ */
+template<typename T, typename Fn>
+__attribute__((unused)) static void ei_for_each_candidate(const T *data,
+                                                          size_t count,
+                                                          size_t stride,
+                                                          const ei_raw_threshold<T> &threshold,
+                                                          Fn fn) {
+    const size_t block_size = 64;
+    uint8_t hits[block_size];
+
+    for (size_t base = 0; base < count; base += block_size) {
+        const T *block = data + base * stride;
+        const size_t n = count - base < block_size ? count - base : block_size;
+
+        size_t n_hits = 0;
+        for (size_t ix = 0; ix < n; ix++) {
+            hits[n_hits] = (uint8_t)ix;
+            n_hits += threshold.passes(block[ix * stride]) ? 1 : 0;
+        }
+
+        for (size_t hx = 0; hx < n_hits; hx++) {
+            fn(base + hits[hx]);
+        }
+    }
+}
+
 /**
  * Fill the result structure from an unquantized output tensor
  */
@@ -440,26 +538,299 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_anomaly(ei_impulse_handl
     return EI_IMPULSE_OK;
 }
 
-__attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_f32(ei_impulse_handle_t *handle,
-                                                                    uint32_t block_index,
-                                                                    uint32_t input_block_id,
-                                                                    ei_impulse_result_t *result,
-                                                                    void *config_ptr,
-                                                                    void *state) {
-#if EI_HAS_FOMO
-    const ei_impulse_t *impulse = handle->impulse;
-    const ei_fill_result_fomo_f32_config_t *config = (ei_fill_result_fomo_f32_config_t*)config_ptr;
+#if EI_HAS_FOMO && EI_CLASSIFIER_FOMO_CLUSTERING == 1
+typedef struct {
+    uint16_t parent;        // itself for a root
+    uint16_t x0, y0, x1, y1;
+    uint16_t last_row;      // last row with a cell in this component
+    uint32_t first;         // output index of the first cell, keeps the scan order
+    float confidence;       // highest cell confidence
+} ei_fomo_component_t;
+
+typedef struct {
+    // component 0 means "no component"
+    ei_fomo_component_t components[EI_CLASSIFIER_FOMO_MAX_COMPONENTS + 1];
+    uint16_t free_ids[EI_CLASSIFIER_FOMO_MAX_COMPONENTS];
+    size_t free_count;
+    uint16_t live_ids[EI_CLASSIFIER_FOMO_MAX_COMPONENTS];
+    size_t live_count;
+    // component per cell, for the previous and the current row
+    uint16_t rows[2][EI_CLASSIFIER_FOMO_MAX_GRID_WIDTH];
+
+    ei_impulse_result_bounding_box_t results[EI_CLASSIFIER_FOMO_MAX_OBJECTS];
+    uint32_t results_first[EI_CLASSIFIER_FOMO_MAX_OBJECTS];
+    size_t results_count;
+    size_t max_results;
+} ei_fomo_clusters_t;
+
+static inline float ei_fomo_dequantize(float v, float zero_point, float scale) {
+    return v;
+}
 
-    std::vector<ei_classifier_cube_t*> cubes;
+static inline float ei_fomo_dequantize(int8_t v, float zero_point, float scale) {
+    return static_cast<float>(v - zero_point) * scale;
+}
 
-    int out_width_factor = impulse->input_width / config->out_width;
+static uint16_t ei_fomo_find(ei_fomo_clusters_t *c, uint16_t id) {
+    while (c->components[id].parent != id) {
+        // path halving
+        c->components[id].parent = c->components[c->components[id].parent].parent;
+        id = c->components[id].parent;
+    }
+    return id;
+}
 
-    ei::matrix_t* raw_output_mtx = NULL;
-    bool find_mtx_res = find_mtx_by_idx(result->_raw_outputs, &raw_output_mtx, input_block_id, impulse->output_tensors_size);
-    if (!find_mtx_res) {
-        return EI_IMPULSE_OUTPUT_TENSOR_NULL;
+/**
+ * Merge the components of a and b, the one that started first stays the root
+ */
+static uint16_t ei_fomo_union(ei_fomo_clusters_t *c, uint16_t a, uint16_t b) {
+    a = ei_fomo_find(c, a);
+    b = ei_fomo_find(c, b);
+    if (a == b) {
+        return a;
+    }
+    if (c->components[b].first < c->components[a].first) {
+        uint16_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    ei_fomo_component_t *ca = &c->components[a];
+    const ei_fomo_component_t *cb = &c->components[b];
+    if (cb->x0 < ca->x0) ca->x0 = cb->x0;
+    if (cb->y0 < ca->y0) ca->y0 = cb->y0;
+    if (cb->x1 > ca->x1) ca->x1 = cb->x1;
+    if (cb->y1 > ca->y1) ca->y1 = cb->y1;
+    if (cb->last_row > ca->last_row) ca->last_row = cb->last_row;
+    if (cb->confidence > ca->confidence) ca->confidence = cb->confidence;
+
+    c->components[b].parent = a;
+    return a;
+}
+
+/**
+ * Whether result a ranks below result b: less confident, or as confident but found later
+ */
+static inline bool ei_fomo_ranks_below(float a_value, uint32_t a_first, float b_value, uint32_t b_first) {
+    return a_value < b_value || (a_value == b_value && a_first > b_first);
+}
+
+/**
+ * Add a finished object to the results. Once max_results objects are found,
+ * it replaces the lowest ranked one (if it ranks higher).
+ */
+static void ei_fomo_emit(ei_fomo_clusters_t *c, const ei_fomo_component_t *comp, const char *label,
+                         uint32_t out_width_factor) {
+    size_t ix = c->results_count;
+    if (ix == c->max_results) {
+        ix = 0;
+        for (size_t rx = 1; rx < c->results_count; rx++) {
+            if (ei_fomo_ranks_below(c->results[rx].value, c->results_first[rx],
+                                    c->results[ix].value, c->results_first[ix])) {
+                ix = rx;
+            }
+        }
+        if (!ei_fomo_ranks_below(c->results[ix].value, c->results_first[ix], comp->confidence, comp->first)) {
+            return;
+        }
+    }
+    else {
+        c->results_count++;
+    }
+
+    ei_impulse_result_bounding_box_t *bb = &c->results[ix];
+    bb->label = label;
+    bb->x = comp->x0 * out_width_factor;
+    bb->y = comp->y0 * out_width_factor;
+    bb->width = (comp->x1 - comp->x0 + 1) * out_width_factor;
+    bb->height = (comp->y1 - comp->y0 + 1) * out_width_factor;
+    bb->value = comp->confidence;
+    c->results_first[ix] = comp->first;
+}
+
+/**
+ * After row y: components that didn't grow into this row are done, and merged
+ * (non-root) components are no longer referenced, so both are released.
+ * On the last row everything is done.
+ */
+static void ei_fomo_end_row(ei_fomo_clusters_t *c, uint16_t *row, size_t width, uint16_t y, bool last_row,
+                            const char *label, uint32_t out_width_factor) {
+    for (size_t x = 0; x < width; x++) {
+        if (row[x]) {
+            row[x] = ei_fomo_find(c, row[x]);
+        }
+    }
+
+    size_t live_count = 0;
+    for (size_t lx = 0; lx < c->live_count; lx++) {
+        uint16_t id = c->live_ids[lx];
+        const ei_fomo_component_t *comp = &c->components[id];
+        bool is_root = comp->parent == id;
+
+        if (is_root && comp->last_row == y && !last_row) {
+            c->live_ids[live_count++] = id;
+            continue;
+        }
+        if (is_root) {
+            ei_fomo_emit(c, comp, label, out_width_factor);
+        }
+        c->free_ids[c->free_count++] = id;
+    }
+    c->live_count = live_count;
+}
+
+/**
+ * Cluster the FOMO output into objects: 8-connected cells of the same class at or
+ * above the threshold. Each class is labeled in one pass over the grid with union-find,
+ * keeping only the components that touch the current row, so this is linear in the grid
+ * size and works in fixed buffers. Bounding boxes and confidences (of the best cell) are
+ * updated as cells are added. At most object_detection_count objects are reported (the
+ * most confident ones, the first ones on a tie), in the order of their first cell.
+ *
+ * @returns false (and leaves result alone) if the grid is wider than
+ *          EI_CLASSIFIER_FOMO_MAX_GRID_WIDTH or a row has more than
+ *          EI_CLASSIFIER_FOMO_MAX_COMPONENTS open objects, the caller then
+ *          falls back to the cube based clustering
+ */
+template<typename T>
+static bool ei_fomo_cluster(const ei_impulse_t *impulse,
+                                        ei_impulse_result_t *result,
+                                        const T *data,
+                                        uint16_t out_width,
+                                        uint16_t out_height,
+                                        const ei_raw_threshold<T> &raw_threshold,
+                                        float zero_point,
+                                        float scale,
+                                        float threshold,
+                                        uint32_t object_detection_count) {
+    static ei_fomo_clusters_t c;
+
+    const size_t channels = impulse->label_count + 1;
+    const uint32_t out_width_factor = impulse->input_width / out_width;
+
+    if (out_height > EI_CLASSIFIER_FOMO_MAX_GRID_WIDTH) {
+        EI_LOGD("FOMO output is %u cells wide, more than EI_CLASSIFIER_FOMO_MAX_GRID_WIDTH (%u)\n",
+            (unsigned)out_height, (unsigned)EI_CLASSIFIER_FOMO_MAX_GRID_WIDTH);
+        return false;
+    }
+
+    c.results_count = 0;
+    c.max_results = object_detection_count;
+    if (c.max_results == 0 || c.max_results > EI_CLASSIFIER_FOMO_MAX_OBJECTS) {
+        c.max_results = EI_CLASSIFIER_FOMO_MAX_OBJECTS;
+    }
+
+    for (size_t cls = 0; cls < (size_t)impulse->label_count; cls++) {
+        const char *label = impulse->categories[cls];
+
+        c.free_count = EI_CLASSIFIER_FOMO_MAX_COMPONENTS;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_FOMO_MAX_COMPONENTS; ix++) {
+            c.free_ids[ix] = (uint16_t)(EI_CLASSIFIER_FOMO_MAX_COMPONENTS - ix);
+        }
+        c.live_count = 0;
+        memset(c.rows, 0, sizeof(c.rows));
+
+        for (uint16_t y = 0; y < out_width; y++) {
+            uint16_t *prev = c.rows[(y + 1) & 1];
+            uint16_t *cur = c.rows[y & 1];
+
+            for (uint16_t x = 0; x < out_height; x++) {
+                const uint32_t loc = ((y * out_height) + x) * channels + cls + 1;
+                cur[x] = 0;
+
+                if (!raw_threshold.passes(data[loc])) {
+                    continue;
+                }
+                const float vf = ei_fomo_dequantize(data[loc], zero_point, scale);
+                if (vf < threshold) {
+                    continue;
+                }
+
+                // 8-connected neighbours that were already visited
+                const uint16_t neighbours[4] = {
+                    x > 0 ? cur[x - 1] : (uint16_t)0,
+                    x > 0 ? prev[x - 1] : (uint16_t)0,
+                    prev[x],
+                    x + 1 < out_height ? prev[x + 1] : (uint16_t)0,
+                };
+                uint16_t id = 0;
+                for (size_t nx = 0; nx < 4; nx++) {
+                    if (neighbours[nx]) {
+                        id = id ? ei_fomo_union(&c, id, neighbours[nx]) : ei_fomo_find(&c, neighbours[nx]);
+                    }
+                }
+
+                if (id == 0) {
+                    if (c.free_count == 0) {
+                        EI_LOGD("More than EI_CLASSIFIER_FOMO_MAX_COMPONENTS (%u) open FOMO objects\n",
+                            (unsigned)EI_CLASSIFIER_FOMO_MAX_COMPONENTS);
+                        return false;
+                    }
+                    id = c.free_ids[--c.free_count];
+                    c.live_ids[c.live_count++] = id;
+
+                    ei_fomo_component_t *comp = &c.components[id];
+                    comp->parent = id;
+                    comp->x0 = comp->x1 = x;
+                    comp->y0 = comp->y1 = y;
+                    comp->last_row = y;
+                    comp->first = loc;
+                    comp->confidence = vf;
+                }
+                else {
+                    ei_fomo_component_t *comp = &c.components[id];
+                    if (x < comp->x0) comp->x0 = x;
+                    if (x > comp->x1) comp->x1 = x;
+                    comp->y1 = y;
+                    comp->last_row = y;
+                    if (vf > comp->confidence) comp->confidence = vf;
+                }
+                cur[x] = id;
+            }
+
+            ei_fomo_end_row(&c, cur, out_height, y, y + 1 == out_width, label, out_width_factor);
+        }
     }
 
+    // back in scan order
+    for (size_t ix = 1; ix < c.results_count; ix++) {
+        ei_impulse_result_bounding_box_t bb = c.results[ix];
+        uint32_t first = c.results_first[ix];
+        size_t jx = ix;
+        for (; jx > 0 && c.results_first[jx - 1] > first; jx--) {
+            c.results[jx] = c.results[jx - 1];
+            c.results_first[jx] = c.results_first[jx - 1];
+        }
+        c.results[jx] = bb;
+        c.results_first[jx] = first;
+    }
+
+    // if we didn't detect min required objects, fill the rest with fixed value
+    if (c.results_count < c.max_results && c.results_count < object_detection_count) {
+        size_t fill_count = (object_detection_count < c.max_results ? object_detection_count : c.max_results) -
+            c.results_count;
+        memset(&c.results[c.results_count], 0, fill_count * sizeof(c.results[0]));
+    }
+
+    result->bounding_boxes = c.results;
+    result->bounding_boxes_count = c.results_count;
+    return true;
+}
+#endif // EI_HAS_FOMO && EI_CLASSIFIER_FOMO_CLUSTERING == 1
+
+#if EI_HAS_FOMO
+/**
+ * Cube based FOMO clustering, for EI_CLASSIFIER_FOMO_CLUSTERING=0 and for
+ * outputs that don't fit the fixed buffers of ei_fomo_cluster()
+ */
+__attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_cubes_f32(const ei_impulse_t *impulse,
+                                                                      ei_impulse_result_t *result,
+                                                                      const ei::matrix_t *raw_output_mtx,
+                                                                      const ei_fill_result_fomo_f32_config_t *config) {
+    std::vector<ei_classifier_cube_t*> cubes;
+
+    int out_width_factor = impulse->input_width / config->out_width;
+
     for (size_t y = 0; y < config->out_width; y++) {
         for (size_t x = 0; x < config->out_height; x++) {
             size_t loc = ((y * config->out_height) + x) * (impulse->label_count + 1);
@@ -475,6 +846,73 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_f32(ei_impulse_hand
     process_cubes(result, &cubes, out_width_factor, config->object_detection_count);
 
     return EI_IMPULSE_OK;
+}
+
+__attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_cubes_i8(const ei_impulse_t *impulse,
+                                                                     ei_impulse_result_t *result,
+                                                                     const ei::matrix_i8_t *raw_output_mtx,
+                                                                     const ei_fill_result_fomo_i8_config_t *config,
+                                                                     const ei_raw_threshold<int8_t> &threshold) {
+    std::vector<ei_classifier_cube_t*> cubes;
+
+    int out_width_factor = impulse->input_width / config->out_width;
+
+    // only dequantize the cells (and labels) above the threshold, in the same order as
+    // looping over y, x and label (background is channel 0)
+    const size_t channels = impulse->label_count + 1;
+    const size_t count = config->out_width * config->out_height * channels;
+
+    ei_for_each_candidate(raw_output_mtx->buffer, count, 1, threshold, [&](size_t loc) {
+        size_t ix = loc % channels;
+        if (ix == 0) {
+            return;
+        }
+        size_t x = (loc / channels) % config->out_height;
+        size_t y = (loc / channels) / config->out_height;
+
+        int8_t v = raw_output_mtx->buffer[loc];
+        float vf = static_cast<float>(v - config->zero_point) * config->scale;
+
+        ei_handle_cube(&cubes, x, y, vf, impulse->categories[ix - 1], config->threshold);
+    });
+
+    process_cubes(result, &cubes, out_width_factor, config->object_detection_count);
+
+    return EI_IMPULSE_OK;
+}
+#endif // EI_HAS_FOMO
+
+__attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_f32(ei_impulse_handle_t *handle,
+                                                                    uint32_t block_index,
+                                                                    uint32_t input_block_id,
+                                                                    ei_impulse_result_t *result,
+                                                                    void *config_ptr,
+                                                                    void *state) {
+#if EI_HAS_FOMO
+    const ei_impulse_t *impulse = handle->impulse;
+    const ei_fill_result_fomo_f32_config_t *config = (ei_fill_result_fomo_f32_config_t*)config_ptr;
+
+    ei::matrix_t* raw_output_mtx = NULL;
+    bool find_mtx_res = find_mtx_by_idx(result->_raw_outputs, &raw_output_mtx, input_block_id, impulse->output_tensors_size);
+    if (!find_mtx_res) {
+        return EI_IMPULSE_OUTPUT_TENSOR_NULL;
+    }
+
+#if EI_CLASSIFIER_FOMO_CLUSTERING == 1
+    if (ei_fomo_cluster(impulse,
+                        result,
+                        (const float *)raw_output_mtx->buffer,
+                        config->out_width,
+                        config->out_height,
+                        ei_raw_threshold<float>(config->threshold, 0.0f, 1.0f),
+                        0.0f,
+                        1.0f,
+                        config->threshold,
+                        config->object_detection_count)) {
+        return EI_IMPULSE_OK;
+    }
+#endif // EI_CLASSIFIER_FOMO_CLUSTERING == 1
+    return process_fomo_cubes_f32(impulse, result, raw_output_mtx, config);
 #else
     return EI_IMPULSE_LAST_LAYER_NOT_AVAILABLE;
 #endif
@@ -490,32 +928,29 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_fomo_i8(ei_impulse_handl
     const ei_impulse_t *impulse = handle->impulse;
     const ei_fill_result_fomo_i8_config_t *config = (ei_fill_result_fomo_i8_config_t*)config_ptr;
 
-    std::vector<ei_classifier_cube_t*> cubes;
-
-    int out_width_factor = impulse->input_width / config->out_width;
-
     ei::matrix_i8_t* raw_output_mtx = NULL;
     bool find_mtx_res = find_mtx_by_idx(result->_raw_outputs, &raw_output_mtx, input_block_id, impulse->output_tensors_size);
     if (!find_mtx_res) {
         return EI_IMPULSE_OUTPUT_TENSOR_NULL;
     }
 
-    for (size_t y = 0; y < config->out_width; y++) {
-        for (size_t x = 0; x < config->out_height; x++) {
-            size_t loc = ((y * config->out_height) + x) * (impulse->label_count + 1);
-
-            for (size_t ix = 1; ix < (size_t)impulse->label_count + 1; ix++) {
-                int8_t v = raw_output_mtx->buffer[loc+ix];
-                float vf = static_cast<float>(v - config->zero_point) * config->scale;
+    const ei_raw_threshold<int8_t> threshold(config->threshold, config->zero_point, config->scale);
 
-                ei_handle_cube(&cubes, x, y, vf, impulse->categories[ix - 1], config->threshold);
-            }
-        }
+#if EI_CLASSIFIER_FOMO_CLUSTERING == 1
+    if (ei_fomo_cluster(impulse,
+                        result,
+                        (const int8_t *)raw_output_mtx->buffer,
+                        config->out_width,
+                        config->out_height,
+                        threshold,
+                        config->zero_point,
+                        config->scale,
+                        config->threshold,
+                        config->object_detection_count)) {
+        return EI_IMPULSE_OK;
     }
-
-    process_cubes(result, &cubes, out_width_factor, config->object_detection_count);
-
-    return EI_IMPULSE_OK;
+#endif // EI_CLASSIFIER_FOMO_CLUSTERING == 1
+    return process_fomo_cubes_i8(impulse, result, raw_output_mtx, config, threshold);
 #else
     return EI_IMPULSE_LAST_LAYER_NOT_AVAILABLE;
 #endif
@@ -778,7 +1213,10 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov5_i8(ei_impulse_han
     size_t col_size = 5 + impulse->label_count;
     size_t row_count = config->output_features_count / col_size;
 
-    for (size_t ix = 0; ix < row_count; ix++) {
+    // only decode the rows with a score above the threshold
+    const ei_raw_threshold<uint8_t> threshold(config->threshold, config->zero_point, config->scale);
+
+    ei_for_each_candidate(raw_output_mtx->buffer + 4, row_count, col_size, threshold, [&](size_t ix) {
         size_t base_ix = ix * col_size;
         float xc = (raw_output_mtx->buffer[base_ix + 0] - config->zero_point) * config->scale;
         float yc = (raw_output_mtx->buffer[base_ix + 1] - config->zero_point) * config->scale;
@@ -800,7 +1238,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov5_i8(ei_impulse_han
         }
 
         if (w < 0 || h < 0) {
-            continue;
+            return;
         }
 
         float score = (raw_output_mtx->buffer[base_ix + 4] - config->zero_point) * config->scale;
@@ -833,7 +1271,7 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_yolov5_i8(ei_impulse_han
             r.value = score;
             results.push_back(r);
         }
-    }
+    });
 
     EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &config->nms_config, &results);
     if (nms_res != EI_IMPULSE_OK) {
@@ -1499,18 +1937,25 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_decode_detections_co
     size_t row_count = output_features_count / col_size;
 
     static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
     results.clear();
+    boxes.clear();
+    scores.clear();
+    classes.clear();
 
-    for (size_t cls_idx = 1; cls_idx < (size_t)(impulse->label_count + 1); cls_idx++)  {
+    // rejects most rows without dequantizing
+    const ei_raw_threshold<T> raw_threshold(threshold, zero_point, scale);
 
-        std::vector<float> boxes;
-        std::vector<float> scores;
-        std::vector<int> classes;
-        class_results.clear();
+    for (size_t cls_idx = 1; cls_idx < (size_t)(impulse->label_count + 1); cls_idx++)  {
 
         for (size_t ix = 0; ix < row_count; ix++) {
 
+            if (!raw_threshold.passes(data[ix * col_size + cls_idx])) {
+                continue;
+            }
+
             float score = (static_cast<float>(data[ix * col_size + cls_idx]) - zero_point) * scale;
 
             if ((score < threshold) || (score > 1.0f)) {
@@ -1590,24 +2035,21 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_decode_detections_co
             scores.push_back(score);
             classes.push_back((int)(cls_idx-1));
         }
+    }
 
-        size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
-                                              &class_results,
-                                              boxes.data(),
-                                              scores.data(),
-                                              classes.data(),
-                                              nr_boxes,
-                                              true /*clip_boxes*/,
-                                              &nms_config);
-
-        if (nms_res != EI_IMPULSE_OK) {
-            return nms_res;
-        }
+    size_t nr_boxes = scores.size();
+    EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
+                                          &results,
+                                          boxes.data(),
+                                          scores.data(),
+                                          classes.data(),
+                                          nr_boxes,
+                                          true /*clip_boxes*/,
+                                          &nms_config,
+                                          true /*per_class*/);
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
+    if (nms_res != EI_IMPULSE_OK) {
+        return nms_res;
     }
 
     prepare_nms_results_common(object_detection_count, result, &results);
@@ -1633,18 +2075,27 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  process_tao_yolov3_common(const
     size_t row_count = output_features_count / col_size;
 
     static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
 
     results.clear();
+    boxes.clear();
+    scores.clear();
+    classes.clear();
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
 
-        std::vector<float> boxes;
-        std::vector<float> scores;
-        std::vector<int> classes;
-        class_results.clear();
-
         for (size_t ix = 0; ix < row_count; ix++) {
             size_t data_ix = ix * col_size;
+            // score first, the box is only dequantized for the detections that pass
+            float r_10 = (static_cast<float>(data[data_ix + 10]) - zero_point) * scale;
+            float cls = (static_cast<float>(data[data_ix + 11 + cls_idx]) - zero_point) * scale;
+            float score = sigmoid(cls) * sigmoid(r_10);
+
+            if ((score < threshold) || (score > 1.0f)) {
+                continue;
+            }
+
             float r_0  = (static_cast<float>(data[data_ix +  0]) - zero_point) * scale;
             float r_1  = (static_cast<float>(data[data_ix +  1]) - zero_point) * scale;
             float r_2  = (static_cast<float>(data[data_ix +  2]) - zero_point) * scale;
@@ -1655,14 +2106,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  process_tao_yolov3_common(const
             float r_7  = (static_cast<float>(data[data_ix +  7]) - zero_point) * scale;
             float r_8  = (static_cast<float>(data[data_ix +  8]) - zero_point) * scale;
             float r_9  = (static_cast<float>(data[data_ix +  9]) - zero_point) * scale;
-            float r_10 = (static_cast<float>(data[data_ix + 10]) - zero_point) * scale;
-
-            float cls = (static_cast<float>(data[data_ix + 11 + cls_idx]) - zero_point) * scale;
-            float score = sigmoid(cls) * sigmoid(r_10);
-
-            if ((score < threshold) || (score > 1.0f)) {
-                continue;
-            }
 
             float by = r_0 + sigmoid(r_6) * r_4;
             float bx = r_1 + sigmoid(r_7) * r_5;
@@ -1687,23 +2130,20 @@ __attribute__((unused)) static EI_IMPULSE_ERROR  process_tao_yolov3_common(const
             scores.push_back(score);
             classes.push_back((int)cls_idx);
         }
+    }
 
-        size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
-                                              &class_results,
-                                              boxes.data(),
-                                              scores.data(),
-                                              classes.data(),
-                                              nr_boxes,
-                                              true /*clip_boxes*/,
-                                              &nms_config);
-        if (nms_res != EI_IMPULSE_OK) {
-            return nms_res;
-        }
-
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
+    size_t nr_boxes = scores.size();
+    EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
+                                          &results,
+                                          boxes.data(),
+                                          scores.data(),
+                                          classes.data(),
+                                          nr_boxes,
+                                          true /*clip_boxes*/,
+                                          &nms_config,
+                                          true /*per_class*/);
+    if (nms_res != EI_IMPULSE_OK) {
+        return nms_res;
     }
 
     prepare_nms_results_common(object_detection_count, result, &results);
@@ -1728,20 +2168,29 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_common(const
     size_t row_count = output_features_count / col_size;
 
     static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
     results.clear();
+    boxes.clear();
+    scores.clear();
+    classes.clear();
 
     const float grid_scale_xy = 1.0f;
 
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
 
-        std::vector<float> boxes;
-        std::vector<float> scores;
-        std::vector<int> classes;
-        class_results.clear();
-
         for (size_t ix = 0; ix < row_count; ix++) {
 
+            // score first, the box is only dequantized for the detections that pass
+            float r_10 = (static_cast<float>(data[ix * col_size + 10]) - zero_point) * scale;
+            float cls = (static_cast<float>(data[ix * col_size + 11 + cls_idx]) - zero_point) * scale;
+            float score = sigmoid(cls) * sigmoid(r_10);
+
+            if ((score < threshold) || (score > 1.0f)) {
+                continue;
+            }
+
             float r_0  = (static_cast<float>(data[ix * col_size +  0]) - zero_point) * scale;
             float r_1  = (static_cast<float>(data[ix * col_size +  1]) - zero_point) * scale;
             float r_2  = (static_cast<float>(data[ix * col_size +  2]) - zero_point) * scale;
@@ -1752,14 +2201,6 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_common(const
             float r_7  = (static_cast<float>(data[ix * col_size +  7]) - zero_point) * scale;
             float r_8  = (static_cast<float>(data[ix * col_size +  8]) - zero_point) * scale;
             float r_9  = (static_cast<float>(data[ix * col_size +  9]) - zero_point) * scale;
-            float r_10 = (static_cast<float>(data[ix * col_size + 10]) - zero_point) * scale;
-
-            float cls = (static_cast<float>(data[ix * col_size + 11 + cls_idx]) - zero_point) * scale;
-            float score = sigmoid(cls) * sigmoid(r_10);
-
-            if ((score < threshold) || (score > 1.0f)) {
-                continue;
-            }
 
             float pred_y = sigmoid(r_6) * grid_scale_xy - (grid_scale_xy - 1.0f) / 2.0f;
             float pred_x = sigmoid(r_7) * grid_scale_xy - (grid_scale_xy - 1.0f) / 2.0f;
@@ -1794,23 +2235,20 @@ __attribute__((unused)) static EI_IMPULSE_ERROR process_tao_yolov4_common(const
             scores.push_back(score);
             classes.push_back((int)cls_idx);
         }
+    }
 
-        size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
-                                              &class_results,
-                                              boxes.data(),
-                                              scores.data(),
-                                              classes.data(),
-                                              nr_boxes,
-                                              true /*clip_boxes*/,
-                                              &nms_config);
-        if (nms_res != EI_IMPULSE_OK) {
-            return nms_res;
-        }
-
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
+    size_t nr_boxes = scores.size();
+    EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
+                                          &results,
+                                          boxes.data(),
+                                          scores.data(),
+                                          classes.data(),
+                                          nr_boxes,
+                                          true /*clip_boxes*/,
+                                          &nms_config,
+                                          true /*per_class*/);
+    if (nms_res != EI_IMPULSE_OK) {
+        return nms_res;
     }
 
     prepare_nms_results_common(object_detection_count, result, &results);
@@ -2020,20 +2458,26 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
     size_t row_count = output_features_count / col_size;
 
     static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
     results.clear();
+    boxes.clear();
+    scores.clear();
+    classes.clear();
+
+    // rejects most rows without dequantizing
+    const ei_raw_threshold<T> raw_threshold(threshold, zero_point, scale);
 
     // (xmin, ymin, xmax, ymax, cls...)
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
 
-        std::vector<float> boxes;
-        std::vector<float> scores;
-        std::vector<int> classes;
-        class_results.clear();
-
-
         for (size_t ix = 0; ix < row_count; ix++) {
             size_t base_ix = ix * col_size;
+            if (!raw_threshold.passes(data[base_ix + 4 + cls_idx])) {
+                continue;
+            }
+
             float xmin  = (static_cast<float>(data[base_ix + 0]) - zero_point) * scale;
             float ymin  = (static_cast<float>(data[base_ix + 1]) - zero_point) * scale;
             float xmax  = (static_cast<float>(data[base_ix + 2]) - zero_point) * scale;
@@ -2081,25 +2525,22 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
                 classes.push_back((int)cls_idx);
             }
         }
+    }
 
-        size_t nr_boxes = scores.size();
-
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
-                                            &class_results,
-                                            boxes.data(),
-                                            scores.data(),
-                                            classes.data(),
-                                            nr_boxes,
-                                            true /*clip_boxes*/,
-                                            &nms_config);
+    size_t nr_boxes = scores.size();
 
-        if (nms_res != EI_IMPULSE_OK) {
-            return nms_res;
-        }
+    EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
+                                        &results,
+                                        boxes.data(),
+                                        scores.data(),
+                                        classes.data(),
+                                        nr_boxes,
+                                        true /*clip_boxes*/,
+                                        &nms_config,
+                                        true /*per_class*/);
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
+    if (nms_res != EI_IMPULSE_OK) {
+        return nms_res;
     }
 
     prepare_nms_results_common(object_detection_count, result, &results);
@@ -2188,18 +2629,25 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_commo
     size_t col_size = output_features_count / row_count;
 
     static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
     results.clear();
+    boxes.clear();
+    scores.clear();
+    classes.clear();
 
     // output shape: (num_classes + 4, num_detections) e.g. (5, 189)
     //  [0] -> (xcenter, ycenter, width, height, cls...)
+    const ei_raw_threshold<T> raw_threshold(threshold, zero_point, scale);
+
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
-        std::vector<float> boxes;
-        std::vector<float> scores;
-        std::vector<int> classes;
-        class_results.clear();
 
-        for (size_t det_idx = 0; det_idx < col_size; det_idx++) {
+        // only decode the detections with a score above the threshold, the scores
+        // of a class are contiguous
+        const T *cls_scores = data + (4 + cls_idx) * col_size;
+
+        ei_for_each_candidate(cls_scores, col_size, 1, raw_threshold, [&](size_t det_idx) {
 
             float xcenter = (static_cast<float>(data[0 * col_size + det_idx]) - zero_point) * scale;
             float ycenter = (static_cast<float>(data[1 * col_size + det_idx]) - zero_point) * scale;
@@ -2271,26 +2719,23 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_commo
                 scores.push_back(score);
                 classes.push_back((int)cls_idx);
             }
-        }
-
-        size_t nr_boxes = scores.size();
+        });
+    }
 
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
-                                            &class_results,
-                                            boxes.data(),
-                                            scores.data(),
-                                            classes.data(),
-                                            nr_boxes,
-                                            true /*clip_boxes*/,
-                                            &nms_config);
+    size_t nr_boxes = scores.size();
 
-        if (nms_res != EI_IMPULSE_OK) {
-            return nms_res;
-        }
+    EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse,
+                                        &results,
+                                        boxes.data(),
+                                        scores.data(),
+                                        classes.data(),
+                                        nr_boxes,
+                                        true /*clip_boxes*/,
+                                        &nms_config,
+                                        true /*per_class*/);
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
+    if (nms_res != EI_IMPULSE_OK) {
+        return nms_res;
     }
 
     prepare_nms_results_common(object_detection_count, result, &results);
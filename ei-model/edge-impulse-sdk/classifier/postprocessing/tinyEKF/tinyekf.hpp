@@ -166,6 +166,24 @@ public:
         delete[] u;
     }
 
+    /**
+     * Restart the filter from a new initial state, without reallocating.
+     * Only x and P change over time, the model matrices are kept.
+     */
+    void reset(const float *x0) {
+        memset(x, 0, sizeof(float) * this->EKF_N);
+        x[0] = x0[0];
+        x[1] = x0[1];
+        x[2] = x0[0];
+        x[3] = x0[1];
+
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                P[i * 4 + j] = (i == j) ? 1 : 0;
+            }
+        }
+    }
+
     void predict(const float *fx);
     bool update(const float *z, const float *hx);
     float *x;
@@ -34,13 +34,126 @@
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "edge-impulse-sdk/porting/ei_logging.h"
 #include "edge-impulse-sdk/classifier/ei_constants.h"
+#include "edge-impulse-sdk/dsp/config.hpp"
 #include <string.h>
 #include <stddef.h>
 
+#if EIDSP_USE_CMSIS_DSP
+#include "edge-impulse-sdk/CMSIS/DSP/Include/arm_math.h"
+#endif
+
+// SMLAD / UXTB16 path for cores with the DSP extension (Cortex-M4/M7/M33/M55)
+#ifndef EI_IMAGE_RESIZE_USE_DSP_EXT
+#if EIDSP_USE_CMSIS_DSP && defined(ARM_MATH_DSP)
+#define EI_IMAGE_RESIZE_USE_DSP_EXT 1
+#else
+#define EI_IMAGE_RESIZE_USE_DSP_EXT 0
+#endif
+#endif
+
 namespace ei {
 namespace image {
 namespace processing {
 
+namespace {
+
+// same fixed point format as resize_image()
+constexpr int RESIZE_FRAC_BITS = 14;
+constexpr int RESIZE_FRAC_VAL = (1 << RESIZE_FRAC_BITS);
+constexpr int RESIZE_FRAC_MASK = (RESIZE_FRAC_VAL - 1);
+
+// ITU-R 601-2 luma in 16.16, same weights as extract_image_features_quantized
+constexpr uint32_t GRAY_R = 19595;
+constexpr uint32_t GRAY_G = 38469;
+constexpr uint32_t GRAY_B = 7471;
+
+typedef struct {
+    uint32_t offset;    // offset of the left source pixel in the row, in bytes
+    uint32_t step;      // offset from the left to the right source pixel, 0 on the last column
+    uint32_t frac;      // 1 - x fraction in the low halfword, x fraction in the high halfword
+} resize_col_t;
+
+// scratch for the copying resizes, grows to the largest one seen until free_resize_scratch()
+uint8_t *resize_scratch = nullptr;
+size_t resize_scratch_size = 0;
+
+/**
+ * Horizontal pass, one source row to dst_width interpolated pixels
+ */
+void resize_row_horizontal(
+    const uint8_t *src_row,
+    const resize_col_t *cols,
+    int dst_width,
+    int pixel_size_B,
+    uint8_t *out)
+{
+    for (int x = 0; x < dst_width; x++) {
+        const uint8_t *p = src_row + cols[x].offset;
+        const uint32_t step = cols[x].step;
+        const uint32_t frac = cols[x].frac;
+
+        for (int color = 0; color < pixel_size_B; color++) {
+#if EI_IMAGE_RESIZE_USE_DSP_EXT == 1
+            uint32_t pair = p[color] | ((uint32_t)p[color + step] << 16);
+            *out++ = (uint8_t)(__SMLAD(pair, frac, RESIZE_FRAC_VAL / 2) >> RESIZE_FRAC_BITS);
+#else
+            uint32_t v = (p[color] * (frac & 0xffff)) + (p[color + step] * (frac >> 16));
+            *out++ = (uint8_t)((v + RESIZE_FRAC_VAL / 2) >> RESIZE_FRAC_BITS);
+#endif
+        }
+    }
+}
+
+/**
+ * Vertical pass, blends two horizontally interpolated rows
+ */
+void resize_row_vertical(
+    const uint8_t *top,
+    const uint8_t *bottom,
+    uint32_t y_frac,
+    size_t length,
+    uint8_t *out)
+{
+    const uint32_t ny_frac = RESIZE_FRAC_VAL - y_frac;
+    size_t ix = 0;
+
+#if EI_IMAGE_RESIZE_USE_DSP_EXT == 1
+    const uint32_t frac = ny_frac | (y_frac << 16);
+
+    for (; ix + 4 <= length; ix += 4) {
+        uint32_t t, b;
+        memcpy(&t, top + ix, 4);
+        memcpy(&b, bottom + ix, 4);
+
+        // bytes 0, 2 and 1, 3 widened to halfwords
+        uint32_t t02 = __UXTB16(t);
+        uint32_t b02 = __UXTB16(b);
+        uint32_t t13 = __UXTB16(__ROR(t, 8));
+        uint32_t b13 = __UXTB16(__ROR(b, 8));
+
+        // pair each top byte with its bottom byte: (top, bottom) . (1 - y, y)
+        out[ix + 0] = (uint8_t)(__SMLAD(__PKHBT(t02, b02, 16), frac, RESIZE_FRAC_VAL / 2) >> RESIZE_FRAC_BITS);
+        out[ix + 1] = (uint8_t)(__SMLAD(__PKHBT(t13, b13, 16), frac, RESIZE_FRAC_VAL / 2) >> RESIZE_FRAC_BITS);
+        out[ix + 2] = (uint8_t)(__SMLAD(__PKHTB(b02, t02, 16), frac, RESIZE_FRAC_VAL / 2) >> RESIZE_FRAC_BITS);
+        out[ix + 3] = (uint8_t)(__SMLAD(__PKHTB(b13, t13, 16), frac, RESIZE_FRAC_VAL / 2) >> RESIZE_FRAC_BITS);
+    }
+#endif
+
+    for (; ix < length; ix++) {
+        out[ix] = (uint8_t)((top[ix] * ny_frac + bottom[ix] * y_frac + RESIZE_FRAC_VAL / 2) >> RESIZE_FRAC_BITS);
+    }
+}
+
+void rgb888_row_to_grayscale(const uint8_t *rgb, int width, uint8_t *out)
+{
+    for (int x = 0; x < width; x++) {
+        out[x] = (uint8_t)((rgb[0] * GRAY_R + rgb[1] * GRAY_G + rgb[2] * GRAY_B) >> 16);
+        rgb += 3;
+    }
+}
+
+} // namespace
+
 /**
  * @brief Convert YUV to RGB
  *
@@ -257,71 +370,199 @@ int resize_image(
     int dstHeight,
     int pixel_size_B)
 {
-    // Copied from ei_camera.cpp in firmware-eta-compute
-    // Modified for RGB888
-    // This needs to be < 16 or it won't fit. Cortex-M4 only has SIMD for signed multiplies
-    constexpr int FRAC_BITS = 14;
-    constexpr int FRAC_VAL = (1 << FRAC_BITS);
-    constexpr int FRAC_MASK = (FRAC_VAL - 1);
-
-    uint32_t src_x_accum, src_y_accum; // accumulators and fractions for scaling the image
-    uint32_t x_frac, nx_frac, y_frac, ny_frac;
-    int x, y, ty;
-
-    if (srcHeight < 2) {
+    return crop_resize_image(
+        srcImage,
+        srcWidth,
+        srcHeight,
+        0,
+        0,
+        srcWidth,
+        srcHeight,
+        dstImage,
+        dstWidth,
+        dstHeight,
+        pixel_size_B);
+} // resizeImage()
+
+int crop_resize_image(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    int cropX,
+    int cropY,
+    int cropWidth,
+    int cropHeight,
+    uint8_t *dstImage,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B,
+    bool to_grayscale)
+{
+    const size_t src_stride = srcWidth * pixel_size_B;
+    const size_t dst_stride = dstWidth * (to_grayscale ? MONO_B_SIZE : pixel_size_B);
+
+    return crop_resize_image_rows(
+        [srcImage, src_stride](int y) -> const uint8_t * { return srcImage + y * src_stride; },
+        srcWidth,
+        srcHeight,
+        cropX,
+        cropY,
+        cropWidth,
+        cropHeight,
+        [dstImage, dst_stride](int y) -> uint8_t * { return dstImage + y * dst_stride; },
+        dstWidth,
+        dstHeight,
+        pixel_size_B,
+        to_grayscale);
+}
+
+int crop_resize_image_rows(
+    std::function<const uint8_t *(int)> get_src_row,
+    int srcWidth,
+    int srcHeight,
+    int cropX,
+    int cropY,
+    int cropWidth,
+    int cropHeight,
+    std::function<uint8_t *(int)> get_dst_row,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B,
+    bool to_grayscale,
+    uint8_t *scratch)
+{
+    if (cropX < 0 || cropY < 0 || cropWidth < 1 || cropHeight < 2 ||
+        cropX + cropWidth > srcWidth || cropY + cropHeight > srcHeight ||
+        dstWidth < 1 || dstHeight < 1) {
+        return EIDSP_PARAMETER_INVALID;
+    }
+    if (pixel_size_B != RGB888_B_SIZE && pixel_size_B != MONO_B_SIZE) {
+        return EIDSP_PARAMETER_INVALID;
+    }
+    if (to_grayscale && pixel_size_B != RGB888_B_SIZE) {
         return EIDSP_PARAMETER_INVALID;
     }
 
-    src_y_accum = 0;
-    const uint32_t src_x_frac = (srcWidth * FRAC_VAL) / dstWidth;
-    const uint32_t src_y_frac = (srcHeight * FRAC_VAL) / dstHeight;
+    const size_t row_size = dstWidth * pixel_size_B;
 
-    //from here out, *3 b/c RGB
-    srcWidth *= pixel_size_B;
-    //srcHeight not used for indexing
-    //dstWidth still needed as is
-    //dstHeight shouldn't be scaled
+    uint8_t *mem = scratch;
+    if (!mem) {
+        const size_t mem_size = crop_resize_scratch_size(dstWidth, pixel_size_B, to_grayscale);
+        if (mem_size > resize_scratch_size) {
+            free_resize_scratch();
+            resize_scratch = (uint8_t *)ei_malloc(mem_size);
+            if (!resize_scratch) {
+                return EIDSP_OUT_OF_MEM;
+            }
+            resize_scratch_size = mem_size;
+        }
+        mem = resize_scratch;
+    }
 
-    const uint8_t *s;
-    uint8_t *d;
+    resize_col_t *cols = (resize_col_t *)mem;
+    uint8_t *row_cache[2] = {
+        mem + dstWidth * sizeof(resize_col_t),
+        mem + dstWidth * sizeof(resize_col_t) + row_size
+    };
+    int row_cache_y[2] = { -1, -1 };
+    uint8_t *rgb_row = to_grayscale ? row_cache[1] + row_size : nullptr;
+
+    const uint32_t src_x_frac = (cropWidth * RESIZE_FRAC_VAL) / dstWidth;
+    const uint32_t src_y_frac = (cropHeight * RESIZE_FRAC_VAL) / dstHeight;
+
+    uint32_t src_x_accum = 0;
+    for (int x = 0; x < dstWidth; x++) {
+        uint32_t tx = src_x_accum >> RESIZE_FRAC_BITS;
+        uint32_t x_frac = src_x_accum & RESIZE_FRAC_MASK;
+        src_x_accum += src_x_frac;
+
+        cols[x].offset = tx * pixel_size_B;
+        // replicate the edge instead of reading past the crop (only happens when upscaling)
+        cols[x].step = ((int)tx + 1 < cropWidth) ? pixel_size_B : 0;
+        cols[x].frac = (RESIZE_FRAC_VAL - x_frac) | (x_frac << 16);
+    }
 
-    for (y = 0; y < dstHeight; y++) {
-        // do indexing computations
-        ty = src_y_accum >> FRAC_BITS; // src y
-        y_frac = src_y_accum & FRAC_MASK;
-        src_y_accum += src_y_frac;
-        ny_frac = FRAC_VAL - y_frac; // y fraction and 1.0 - y fraction
-
-        s = &srcImage[ty * srcWidth];
-        d = &dstImage[y * dstWidth * pixel_size_B]; //not scaled above
-        src_x_accum = 0;
-        for (x = 0; x < dstWidth; x++) {
-            uint32_t tx, p00, p01, p10, p11;
-            // do indexing computations
-            tx = (src_x_accum >> FRAC_BITS) * pixel_size_B;
-            x_frac = src_x_accum & FRAC_MASK;
-            nx_frac = FRAC_VAL - x_frac; // x fraction and 1.0 - x fraction
-            src_x_accum += src_x_frac;
-
-            //interpolate and write out
-            for (int color = 0; color < pixel_size_B;
-                 color++) // do pixel_size_B times for pixel_size_B colors
-            {
-                p00 = s[tx];
-                p10 = s[tx + pixel_size_B];
-                p01 = s[tx + srcWidth];
-                p11 = s[tx + srcWidth + pixel_size_B];
-                p00 = ((p00 * nx_frac) + (p10 * x_frac) + FRAC_VAL / 2) >> FRAC_BITS; // top line
-                p01 = ((p01 * nx_frac) + (p11 * x_frac) + FRAC_VAL / 2) >> FRAC_BITS; // bottom line
-                p00 = ((p00 * ny_frac) + (p01 * y_frac) + FRAC_VAL / 2) >> FRAC_BITS; //top + bottom
-                *d++ = (uint8_t)p00; // store new pixel
-                //ready next loop
-                tx++;
+    const size_t crop_offset = cropX * pixel_size_B;
+
+    // horizontal pass for source row ty, reusing whatever is still cached
+    auto get_row = [&](int ty, int keep_slot) -> const uint8_t * {
+        for (int slot = 0; slot < 2; slot++) {
+            if (row_cache_y[slot] == ty) {
+                return row_cache[slot];
             }
-        } // for x
-    } // for y
-    return EIDSP_OK;
-} // resizeImage()
+        }
+        // evict the other row, or the older one if nothing needs to be kept
+        int slot;
+        if (keep_slot >= 0) {
+            slot = keep_slot == 0 ? 1 : 0;
+        }
+        else {
+            slot = row_cache_y[0] <= row_cache_y[1] ? 0 : 1;
+        }
+        const uint8_t *src_row = get_src_row(cropY + ty);
+        if (!src_row) {
+            return nullptr;
+        }
+        resize_row_horizontal(src_row + crop_offset, cols, dstWidth, pixel_size_B, row_cache[slot]);
+        row_cache_y[slot] = ty;
+        return row_cache[slot];
+    };
+
+    int res = EIDSP_OK;
+
+    uint32_t src_y_accum = 0;
+    for (int y = 0; y < dstHeight; y++) {
+        int ty = src_y_accum >> RESIZE_FRAC_BITS;
+        uint32_t y_frac = src_y_accum & RESIZE_FRAC_MASK;
+        src_y_accum += src_y_frac;
+
+        const uint8_t *top = get_row(ty, -1);
+        const uint8_t *bottom = top;
+        if (top && y_frac != 0) {
+            int top_slot = (top == row_cache[0]) ? 0 : 1;
+            int by = (ty + 1 < cropHeight) ? ty + 1 : ty;
+            bottom = get_row(by, top_slot);
+        }
+
+        // sources are read before the destination row is requested, keeps in place resizing working
+        uint8_t *d = (top && bottom) ? get_dst_row(y) : nullptr;
+        if (!d) {
+            res = EIDSP_OUT_OF_BOUNDS;
+            break;
+        }
+        uint8_t *out = to_grayscale ? rgb_row : d;
+
+        if (y_frac == 0) {
+            // bottom row has no weight, the blend would return top as is
+            memcpy(out, top, row_size);
+        }
+        else {
+            resize_row_vertical(top, bottom, y_frac, row_size, out);
+        }
+
+        if (to_grayscale) {
+            rgb888_row_to_grayscale(rgb_row, dstWidth, d);
+        }
+    }
+
+    return res;
+}
+
+size_t crop_resize_scratch_size(int dstWidth, int pixel_size_B, bool to_grayscale)
+{
+    // column table, two cached horizontal rows and (for grayscale) one RGB output row
+    const size_t row_size = dstWidth * pixel_size_B;
+    return dstWidth * sizeof(resize_col_t) + row_size * (to_grayscale ? 3 : 2);
+}
+
+void free_resize_scratch(void)
+{
+    if (resize_scratch) {
+        ei_free(resize_scratch);
+        resize_scratch = nullptr;
+    }
+    resize_scratch_size = 0;
+}
 
 /**
  * @brief Calculate new dims that match the aspect ratio of destination
@@ -366,22 +607,19 @@ int crop_and_interpolate_rgb888(
     int cropWidth, cropHeight;
     // What are dimensions that maintain aspect ratio?
     calculate_crop_dims(srcWidth, srcHeight, dstWidth, dstHeight, cropWidth, cropHeight);
-    // Now crop to that dimension
-    int res = crop_image_rgb888_packed(
+    // Then crop and interpolate down to desired dimensions in one pass
+    return crop_resize_image(
         srcImage,
         srcWidth,
         srcHeight,
         (srcWidth - cropWidth) / 2,
         (srcHeight - cropHeight) / 2,
-        dstImage,
         cropWidth,
-        cropHeight);
-
-    if (res != EIDSP_OK) {
-        return res;
-    }
-    // Finally, interpolate down to desired dimensions, in place
-    return resize_image(dstImage, cropWidth, cropHeight, dstImage, dstWidth, dstHeight, 3);
+        cropHeight,
+        dstImage,
+        dstWidth,
+        dstHeight,
+        RGB888_B_SIZE);
 }
 
 int crop_and_interpolate_image(
@@ -397,24 +635,19 @@ int crop_and_interpolate_image(
     // What are dimensions that maintain aspect ratio?
     calculate_crop_dims(srcWidth, srcHeight, dstWidth, dstHeight, cropWidth, cropHeight);
 
-    // Now crop to that dimension
-    int res = cropImage(
+    // Then crop and interpolate down to desired dimensions in one pass
+    return crop_resize_image(
         srcImage,
-        srcWidth * pixel_size_B,
+        srcWidth,
         srcHeight,
-        ((srcWidth - cropWidth) / 2) * pixel_size_B,
+        (srcWidth - cropWidth) / 2,
         (srcHeight - cropHeight) / 2,
-        dstImage,
-        cropWidth * pixel_size_B,
+        cropWidth,
         cropHeight,
-        8);
-
-    if (res != EIDSP_OK) {
-        return res;
-    }
-
-    // Finally, interpolate down to desired dimensions, in place
-    return resize_image(dstImage, cropWidth, cropHeight, dstImage, dstWidth, dstHeight, pixel_size_B);
+        dstImage,
+        dstWidth,
+        dstHeight,
+        pixel_size_B);
 }
 
 int resize_image_using_mode(
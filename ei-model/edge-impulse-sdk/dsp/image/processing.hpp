@@ -34,6 +34,7 @@
 #include "edge-impulse-sdk/dsp/ei_utils.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "edge-impulse-sdk/dsp/returntypes.hpp"
+#include <functional>
 
 namespace ei { namespace image { namespace processing {
 
@@ -119,7 +120,9 @@ constexpr int MONO_B_SIZE = 1;
  * @param dstWidth Output image width in pixels
  * @param dstHeight Output image height in pixels
  * @param dstImage Output buffer, can be same as input buffer
- * @param pixel_size_B Size of pixels in Bytes.  3 for RGB, 1 for mono
+ * @param pixel_size_B Size of pixels in Bytes.  3 for RGB, 1 for mono (other sizes are rejected)
+ * @return EIDSP_OK, EIDSP_PARAMETER_INVALID for unsupported pixel sizes, or
+ *         EIDSP_OUT_OF_MEM if the resize scratch (see crop_resize_scratch_size) can't be grown
  */
 int resize_image(
     const uint8_t *srcImage,
@@ -130,6 +133,101 @@ int resize_image(
     int dstHeight,
     int pixel_size_B);
 
+/**
+ * @brief Crop, resize and optionally convert RGB888 to grayscale in one pass
+ * Uses the same fixed point bilinear interpolation as resize_image, and gives
+ * the same result as cropImage followed by resize_image when downscaling. When
+ * upscaling, edge pixels are replicated instead of reading past the crop.
+ * Rows are interpolated horizontally once and cached, then blended vertically.
+ * Uses SMLAD/UXTB16 on cores with the DSP extension.
+ * Can be done in place (set srcImage == dstImage) if the output isn't larger than the crop
+ * Only 1 and 3 byte pixels are supported.
+ * The scratch rows are kept in a buffer that grows to the largest resize seen
+ * and is released by free_resize_scratch() (called from run_classifier_deinit).
+ * It is shared with resize_image, so calls must not overlap between threads.
+ *
+ * @param srcImage Input image buffer
+ * @param srcWidth Input width in pixels
+ * @param srcHeight Input height in pixels
+ * @param cropX X coord of the first pixel to keep
+ * @param cropY Y coord of the first pixel to keep
+ * @param cropWidth Width of the region to keep, in pixels
+ * @param cropHeight Height of the region to keep, in pixels (at least 2)
+ * @param dstImage Output image buffer
+ * @param dstWidth Output width in pixels
+ * @param dstHeight Output height in pixels
+ * @param pixel_size_B Size of input pixels in Bytes. 3 for RGB, 1 for mono
+ * @param to_grayscale Convert RGB input to mono output (ITU-R 601-2 luma)
+ * @return EIDSP_OK, EIDSP_PARAMETER_INVALID, or EIDSP_OUT_OF_MEM if the scratch can't be grown
+ */
+int crop_resize_image(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    int cropX,
+    int cropY,
+    int cropWidth,
+    int cropHeight,
+    uint8_t *dstImage,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B,
+    bool to_grayscale = false);
+
+/**
+ * @brief Row streaming version of crop_resize_image, for images that are never
+ * fully in memory (e.g. captured or encoded a band at a time)
+ * Source rows are requested in increasing order, each at most once, and
+ * the returned pointer only has to stay valid until the next request.
+ * Destination rows are requested in order, row y is complete once row y + 1
+ * is requested or the function returns.
+ * Without a scratch buffer the shared resize scratch is used, see crop_resize_image.
+ *
+ * @param get_src_row Returns a pointer to source row y (full srcWidth), nullptr aborts
+ * @param srcWidth Input width in pixels
+ * @param srcHeight Input height in pixels
+ * @param cropX X coord of the first pixel to keep
+ * @param cropY Y coord of the first pixel to keep
+ * @param cropWidth Width of the region to keep, in pixels
+ * @param cropHeight Height of the region to keep, in pixels (at least 2)
+ * @param get_dst_row Returns where to write output row y, nullptr aborts
+ * @param dstWidth Output width in pixels
+ * @param dstHeight Output height in pixels
+ * @param pixel_size_B Size of input pixels in Bytes. 3 for RGB, 1 for mono
+ * @param to_grayscale Convert RGB input to mono output (ITU-R 601-2 luma)
+ * @param scratch Optional buffer of crop_resize_scratch_size() bytes, aligned for uint32_t
+ * @return EIDSP_OK, EIDSP_OUT_OF_BOUNDS if one of the callbacks aborted,
+ *         EIDSP_PARAMETER_INVALID, or EIDSP_OUT_OF_MEM if the shared scratch can't be grown
+ */
+int crop_resize_image_rows(
+    std::function<const uint8_t *(int)> get_src_row,
+    int srcWidth,
+    int srcHeight,
+    int cropX,
+    int cropY,
+    int cropWidth,
+    int cropHeight,
+    std::function<uint8_t *(int)> get_dst_row,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B,
+    bool to_grayscale = false,
+    uint8_t *scratch = nullptr);
+
+/**
+ * @brief Scratch needed by crop_resize_image_rows for a given output width
+ *
+ * @param dstWidth Output width in pixels
+ * @param pixel_size_B Size of input pixels in Bytes. 3 for RGB, 1 for mono
+ * @param to_grayscale Convert RGB input to mono output
+ */
+size_t crop_resize_scratch_size(int dstWidth, int pixel_size_B, bool to_grayscale = false);
+
+/**
+ * @brief Release the shared scratch used by resize_image and crop_resize_image
+ */
+void free_resize_scratch(void);
+
 /**
  * @brief Calculate new dims that match the aspect ratio of destination
  * This prevents a squashed look
@@ -1497,6 +1497,42 @@ public:
         return EIDSP_OK;
     }
 
+    /**
+     * Convert an int16_t buffer into a float buffer, multiplying every value by scale
+     * @param input
+     * @param output
+     * @param length
+     * @param scale
+     * @returns 0 if OK
+     */
+    static int int16_to_float(const EIDSP_i16 *input, float *output, size_t length, float scale) {
+#if EIDSP_USE_CMSIS_DSP
+        // q15 conversion divides by 2^15, fold that back into the scale (exact, power of two)
+        arm_q15_to_float(input, output, length);
+        arm_scale_f32(output, scale * 32768.0f, output, length);
+#else
+        for (size_t ix = 0; ix < length; ix++) {
+            output[ix] = static_cast<float>(input[ix]) * scale;
+        }
+#endif
+        return EIDSP_OK;
+    }
+
+    /**
+     * Pack R, G, B bytes into the 0xRRGGBB float format used by image signals
+     * @param input 3 * length bytes
+     * @param output
+     * @param length Number of pixels
+     * @returns 0 if OK
+     */
+    static int rgb888_to_float(const uint8_t *input, float *output, size_t length) {
+        for (size_t ix = 0; ix < length; ix++) {
+            output[ix] = static_cast<float>((input[0] << 16) | (input[1] << 8) | input[2]);
+            input += 3;
+        }
+        return EIDSP_OK;
+    }
+
 #if EIDSP_SIGNAL_C_FN_POINTER == 0
     /**
      * Create a signal structure from a buffer.
@@ -1510,6 +1546,7 @@ public:
     static int signal_from_buffer(const float *data, size_t data_size, signal_t *signal)
     {
         signal->total_length = data_size;
+        signal->capabilities = 0;
 #ifdef __MBED__
         signal->get_data = mbed::callback(&numpy::signal_get_data, data);
 #else
@@ -1520,6 +1557,47 @@ public:
         return EIDSP_OK;
     }
 
+    /**
+     * Create a signal structure from an int16_t buffer, e.g. raw sensor data.
+     * get_data returns every value multiplied by scale.
+     * @param data Buffer, make sure to keep this pointer alive
+     * @param data_size Number of values in the buffer
+     * @param scale Value of one LSB
+     * @param signal Output signal
+     * @returns EIDSP_OK if ok
+     */
+    static int signal_from_buffer(const int16_t *data, size_t data_size, float scale, signal_t *signal)
+    {
+        signal->total_length = data_size;
+        signal->get_data = [data, scale](size_t offset, size_t length, float *out_ptr) {
+            return numpy::int16_to_float(data + offset, out_ptr, length, scale);
+        };
+        return EIDSP_OK;
+    }
+
+    /**
+     * Create an image signal from an RGB888 frame buffer (R, G, B bytes per
+     * pixel). The image DSP blocks read the bytes directly through get_data_u8,
+     * so the frame doesn't need to be converted to one float per pixel.
+     * @param data Buffer of 3 * pixel_count bytes, make sure to keep this pointer alive
+     * @param pixel_count Number of pixels
+     * @param signal Output signal
+     * @returns EIDSP_OK if ok
+     */
+    static int signal_from_rgb888_buffer(const uint8_t *data, size_t pixel_count, signal_t *signal)
+    {
+        signal->total_length = pixel_count;
+        signal->capabilities = EI_SIGNAL_CAP_RGB888;
+        signal->get_data = [data](size_t offset, size_t length, float *out_ptr) {
+            return numpy::rgb888_to_float(data + offset * 3, out_ptr, length);
+        };
+        signal->get_data_u8 = [data](size_t offset, size_t length, uint8_t *out_ptr) {
+            memcpy(out_ptr, data + offset * 3, length * 3);
+            return EIDSP_OK;
+        };
+        return EIDSP_OK;
+    }
+
 #endif
 
 #if defined ( __GNUC__ )
@@ -1862,6 +1940,47 @@ public:
         return EIDSP_OK;
     }
 
+    /**
+     * Power spectrum of a frame, without allocating (except for a software FFT fallback)
+     * @param frame Row of a frame, with room for max(frame_size, fft_points) values.
+     *              It's zero padded in place and clobbered by the FFT.
+     * @param frame_size Size of the frame
+     * @param fft_output Scratch buffer, size should be fft_points / 2 + 1
+     * @param out_buffer Out buffer, size should be fft_points / 2 + 1
+     * @param out_buffer_size Buffer size
+     * @param fft_points (int): The length of FFT. If fft_length is greater than frame_len, the frames will be zero-padded.
+     * @returns EIDSP_OK if OK
+     */
+    static int power_spectrum(
+        float *frame,
+        size_t frame_size,
+        fft_complex_t *fft_output,
+        float *out_buffer,
+        size_t out_buffer_size,
+        uint16_t fft_points)
+    {
+        if (out_buffer_size != static_cast<size_t>(fft_points / 2 + 1)) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (frame_size < fft_points) {
+            memset(frame + frame_size, 0, (fft_points - frame_size) * sizeof(float));
+        }
+
+        auto res = ei::fft::hw_r2c_fft(frame, fft_output, fft_points);
+        if (handle_fft_hw_failure(res, fft_points)) {
+            EI_TRY(software_rfft(frame, fft_output, fft_points, out_buffer_size));
+        }
+
+        const float scale = 1.0f / static_cast<float>(fft_points);
+        for (size_t ix = 0; ix < out_buffer_size; ix++) {
+            out_buffer[ix] = scale *
+                (fft_output[ix].r * fft_output[ix].r + fft_output[ix].i * fft_output[ix].i);
+        }
+
+        return EIDSP_OK;
+    }
+
     static int welch_max_hold(
         float *input,
         size_t input_size,
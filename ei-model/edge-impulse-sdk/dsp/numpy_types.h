@@ -645,6 +645,12 @@ typedef enum {
     DCT_NORMALIZATION_ORTHO
 } DCT_NORMALIZATION_MODE;
 
+/**
+ * Typed accessors available on a signal_t, see signal_t::capabilities
+ */
+#define EI_SIGNAL_CAP_U8        (1 << 0)  // get_data_u8, one byte per sample
+#define EI_SIGNAL_CAP_RGB888    (1 << 1)  // get_data_u8, R, G, B bytes per pixel (get_data packs them as 0xRRGGBB)
+
 /**
  * @addtogroup ei_structs
  * @{
@@ -699,6 +705,25 @@ typedef struct ei_signal_t {
      *  preprocessing and inference.
     */
     size_t total_length;
+
+    /**
+     * Optional byte accessor, same `offset` and `length` (in samples) as
+     * get_data. It's only used when an EI_SIGNAL_CAP_* flag is set in
+     * `capabilities`; get_data must always be set.
+     * `get_data_u8`: one byte per sample (EI_SIGNAL_CAP_U8), or R, G, B bytes
+     *   per pixel (EI_SIGNAL_CAP_RGB888), so `out_ptr` holds 3 * `length` bytes
+    */
+#if EIDSP_SIGNAL_C_FN_POINTER == 1
+    int (*get_data_u8)(size_t, size_t, uint8_t *);
+#else
+    std::function<int(size_t offset, size_t length, uint8_t *out_ptr)> get_data_u8;
+#endif // EIDSP_SIGNAL_C_FN_POINTER == 1
+
+#ifdef __cplusplus
+    uint32_t capabilities = 0;
+#else
+    uint32_t capabilities; // EI_SIGNAL_CAP_* flags, must be 0 if no typed accessor is set
+#endif // __cplusplus
 } signal_t;
 
 /** @} */
@@ -47,9 +47,39 @@ typedef enum {
     filter_highpass = 2
 } filter_t;
 
+typedef enum {
+    analysis_fft = 0,
+    analysis_wavelet = 1
+} analysis_t;
+
 class feature {
 public:
 
+    /**
+     * Map the filter type string from the DSP config to filter_t
+     */
+    static filter_t get_filter_type(const char *filter_type)
+    {
+        if (strcmp(filter_type, "low") == 0) {
+            return filter_lowpass;
+        }
+        else if (strcmp(filter_type, "high") == 0) {
+            return filter_highpass;
+        }
+        return filter_none;
+    }
+
+    /**
+     * Map the analysis type string from the DSP config to analysis_t
+     */
+    static analysis_t get_analysis_type(const char *analysis_type)
+    {
+        if (strcmp(analysis_type, "Wavelet") == 0) {
+            return analysis_wavelet;
+        }
+        return analysis_fft;
+    }
+
     /**
      * Calculate the spectral features over a signal.
      * @param out_features Output matrix. Use `calculate_spectral_buffer_size` to calculate
@@ -273,16 +303,7 @@ public:
         output_matrix->cols = output_matrix_cols;
         output_matrix->rows = config_ptr->axes;
 
-        spectral::filter_t filter_type;
-        if (strcmp(config_ptr->filter_type, "low") == 0) {
-            filter_type = spectral::filter_lowpass;
-        }
-        else if (strcmp(config_ptr->filter_type, "high") == 0) {
-            filter_type = spectral::filter_highpass;
-        }
-        else {
-            filter_type = spectral::filter_none;
-        }
+        spectral::filter_t filter_type = get_filter_type(config_ptr->filter_type);
 
         ret = spectral::feature::spectral_analysis(
             output_matrix,
@@ -345,6 +366,31 @@ public:
         const float sampling_freq,
         const bool remove_mean = true,
         const bool transpose_and_scale_input = true)
+    {
+        return extract_spec_features(
+            input_matrix,
+            output_matrix,
+            config,
+            sampling_freq,
+            get_filter_type(config->filter_type),
+            remove_mean,
+            transpose_and_scale_input);
+    }
+
+    /**
+     * @brief Calculates the spectral analysis features, with the filter type
+     * already parsed from config->filter_type.
+     *
+     * @return the number of features calculated
+     */
+    static size_t extract_spec_features(
+        matrix_t *input_matrix,
+        matrix_t *output_matrix,
+        ei_dsp_config_spectral_analysis_t *config,
+        const float sampling_freq,
+        const filter_t filter_type,
+        const bool remove_mean,
+        const bool transpose_and_scale_input)
     {
         if (transpose_and_scale_input) {
             // transpose the matrix so we have one row per axis
@@ -359,7 +405,7 @@ public:
 
         // apply filter, if enabled
         // "zero" order filter allowed.  will still remove unwanted fft bins later
-        if (strcmp(config->filter_type, "low") == 0) {
+        if (filter_type == filter_lowpass) {
             if( config->filter_order ) {
                 EI_TRY(spectral::processing::butterworth_lowpass_filter(
                     input_matrix,
@@ -370,7 +416,7 @@ public:
             do_filter = true;
             is_high_pass = false;
         }
-        else if (strcmp(config->filter_type, "high") == 0) {
+        else if (filter_type == filter_highpass) {
             if( config->filter_order ) {
                 EI_TRY(spectral::processing::butterworth_highpass_filter(
                     input_matrix,
@@ -491,9 +537,24 @@ public:
         matrix_t *output_matrix,
         ei_dsp_config_spectral_analysis_t *config,
         const float sampling_freq)
+    {
+        return extract_spectral_analysis_features_v2(
+            input_matrix,
+            output_matrix,
+            config,
+            sampling_freq,
+            get_filter_type(config->filter_type));
+    }
+
+    static int extract_spectral_analysis_features_v2(
+        matrix_t *input_matrix,
+        matrix_t *output_matrix,
+        ei_dsp_config_spectral_analysis_t *config,
+        const float sampling_freq,
+        const filter_t filter_type)
     {
         size_t n_features =
-            extract_spec_features(input_matrix, output_matrix, config, sampling_freq);
+            extract_spec_features(input_matrix, output_matrix, config, sampling_freq, filter_type, true, true);
         return n_features == output_matrix->cols ? EIDSP_OK : EIDSP_MATRIX_SIZE_MISMATCH;
     }
 
@@ -526,8 +587,24 @@ public:
         return {0}; // to make linter happy
     }
 
-    // can do in-place or out-of-place
-    static size_t _decimate(matrix_t *input_matrix, matrix_t *output_matrix, size_t ratio)
+    /**
+     * Number of columns after decimating by ratio, in the steps from get_ratio_combo()
+     */
+    static size_t get_decimated_cols(size_t cols, int ratio)
+    {
+        if (ratio > 1) {
+            for (int r : get_ratio_combo(ratio)) {
+                cols = signal::get_decimated_size(cols, r);
+            }
+        }
+        return cols;
+    }
+
+    /**
+     * Decimator for one of the ratios from get_ratio_combo(), starts with
+     * the initial conditions scaled by the first sample it gets.
+     */
+    static signal::sos_decimator get_decimator(size_t ratio)
     {
         // generated by build_sav4_header in prepare.py
         static float sos_deci_3[] = {
@@ -567,24 +644,78 @@ public:
 
         assert(ratio == 3 || ratio == 10);
 
-        float* sos = ratio == 3 ? sos_deci_3 : sos_deci_10;
-        float* sos_zi = ratio == 3 ? sos_zi_deci_3 : sos_zi_deci_10;
+        const float* sos = ratio == 3 ? sos_deci_3 : sos_deci_10;
+        const float* sos_zi = ratio == 3 ? sos_zi_deci_3 : sos_zi_deci_10;
 
-        const size_t out_size = signal::get_decimated_size(input_matrix->cols, ratio);
+        return signal::sos_decimator(sos, sos_zi, 4, ratio);
+    }
+
+    /**
+     * Decimate, filter and (for extra_low_freq) decimate by 10 again, in one pass
+     * per row. The decimated rows are packed in place at the start of input_matrix,
+     * which is resized to the new number of columns.
+     * @param input_matrix Transposed input, one row per axis
+     * @param lf_signal Low frequency output, only if extra_low_freq (else nullptr),
+     *                  get_decimated_size(<decimated columns>, 10) columns
+     * @returns decimated number of columns
+     */
+    static size_t decimate_and_filter(
+        matrix_t *input_matrix,
+        matrix_t *lf_signal,
+        ei_dsp_config_spectral_analysis_t *config,
+        const float new_sampling_freq,
+        const filter_t filter_type)
+    {
+        ei_vector<int> ratio_combo = config->input_decimation_ratio > 1 ?
+            get_ratio_combo(config->input_decimation_ratio) : ei_vector<int>();
+        signal::sos_decimator stages[3];
+        size_t n_stages = 0;
+        for (int r : ratio_combo) {
+            assert(n_stages < 3);
+            stages[n_stages++] = get_decimator(r);
+        }
+        const size_t out_size = get_decimated_cols(input_matrix->cols, config->input_decimation_ratio);
+
+        const bool filter = config->filter_order &&
+            (filter_type == filter_lowpass || filter_type == filter_highpass);
+        const filters::butterworth filter_init(
+            filter ? config->filter_order : 0,
+            new_sampling_freq,
+            config->filter_cutoff,
+            filter_type == filter_highpass);
+        const signal::sos_decimator lf_init = get_decimator(10);
 
         for (size_t row = 0; row < input_matrix->rows; row++) {
-            const float *x = input_matrix->get_row_ptr(row);
-            float *y = output_matrix->get_row_ptr(row);
-            signal::sosfilt sosfilt(sos, sos_zi, 4);
-            signal::decimate_simple(
-                x,
-                input_matrix->cols,
-                y,
-                output_matrix->cols,
-                ratio,
-                sosfilt);
+            // output never gets ahead of the input, so this works in place
+            const float *x = input_matrix->buffer + (row * input_matrix->cols);
+            float *y = input_matrix->buffer + (row * out_size);
+            float *lf = lf_signal ? lf_signal->get_row_ptr(row) : nullptr;
+            filters::butterworth row_filter = filter_init;
+            signal::sos_decimator lf_decimator = lf_init;
+            for (size_t stage = 0; stage < n_stages; stage++) {
+                stages[stage].reset();
+            }
+
+            for (size_t ix = 0; ix < input_matrix->cols; ix++) {
+                float v = x[ix];
+                bool keep = true;
+                for (size_t stage = 0; stage < n_stages && keep; stage++) {
+                    keep = stages[stage].push(v, &v);
+                }
+                if (!keep) {
+                    continue;
+                }
+                if (filter) {
+                    v = row_filter.apply(v);
+                }
+                *y++ = v;
+                if (lf && lf_decimator.push(v, lf)) {
+                    lf++;
+                }
+            }
         }
 
+        input_matrix->cols = out_size;
         return out_size;
     }
 
@@ -593,76 +724,72 @@ public:
         matrix_t *output_matrix,
         ei_dsp_config_spectral_analysis_t *config_p,
         const float sampling_freq)
+    {
+        if (get_analysis_type(config_p->analysis_type) == analysis_wavelet) {
+            return wavelet::extract_wavelet_features(input_matrix, output_matrix, config_p, sampling_freq);
+        }
+
+        return extract_spectral_analysis_features_v4(
+            input_matrix,
+            output_matrix,
+            config_p,
+            sampling_freq,
+            get_filter_type(config_p->filter_type));
+    }
+
+    /**
+     * FFT analysis for implementation version 4, with the filter type
+     * already parsed from config->filter_type.
+     */
+    static int extract_spectral_analysis_features_v4(
+        matrix_t *input_matrix,
+        matrix_t *output_matrix,
+        ei_dsp_config_spectral_analysis_t *config_p,
+        const float sampling_freq,
+        const filter_t filter_type)
     {
         auto config_copy = *config_p;
         auto config = &config_copy;
-        if (strcmp(config->analysis_type, "Wavelet") == 0) {
-            return wavelet::extract_wavelet_features(input_matrix, output_matrix, config, sampling_freq);
-        }
-        else if (config->extra_low_freq == false && config->input_decimation_ratio == 1) {
+        if (config->extra_low_freq == false && config->input_decimation_ratio == 1) {
             size_t n_features =
-                extract_spec_features(input_matrix, output_matrix, config, sampling_freq);
+                extract_spec_features(input_matrix, output_matrix, config, sampling_freq, filter_type, true, true);
             return n_features == output_matrix->cols ? EIDSP_OK : EIDSP_MATRIX_SIZE_MISMATCH;
         }
         else {
             numpy::transpose_in_place(input_matrix);
             EI_TRY(numpy::scale(input_matrix, config->scale_axes));
 
-            if (config->input_decimation_ratio > 1) {
-                ei_vector<int> ratio_combo = get_ratio_combo(config->input_decimation_ratio);
-                size_t out_size = input_matrix->cols;
-                for (int r : ratio_combo) {
-                    out_size = _decimate(input_matrix, input_matrix, r);
-                }
-
-                // rearrange input matrix to be in the right shape after decimation
-                float* out = input_matrix->get_row_ptr(0) + out_size;
-                for(uint32_t r = 1; r < input_matrix->rows; r++) {
-                    float *row = input_matrix->get_row_ptr(r);
-                    for(size_t c = 0; c < out_size; c++) {
-                        *out++ = row[c];
-                    }
-                }
-                input_matrix->cols = out_size;
-            }
-
             float new_sampling_freq = sampling_freq / config->input_decimation_ratio;
 
-            // filter here, before decimating, instead of inside extract_spec_features
-            if (strcmp(config->filter_type, "low") == 0) {
-                if( config->filter_order ) {
-                    EI_TRY(spectral::processing::butterworth_lowpass_filter(
-                        input_matrix,
-                        new_sampling_freq,
-                        config->filter_cutoff,
-                        config->filter_order));
-                }
+            // decimate and filter here, instead of inside extract_spec_features, and
+            // decimate the low frequency signal before extract_spec_features modifies the matrix
+            constexpr size_t decimation = 10;
+            size_t decimated_size = 0;
+            if (config->extra_low_freq) {
+                decimated_size = signal::get_decimated_size(
+                    get_decimated_cols(input_matrix->cols, config->input_decimation_ratio),
+                    decimation);
             }
-            else if (strcmp(config->filter_type, "high") == 0) {
-                if( config->filter_order ) {
-                    EI_TRY(spectral::processing::butterworth_highpass_filter(
-                        input_matrix,
-                        new_sampling_freq,
-                        config->filter_cutoff,
-                        config->filter_order));
-                }
+            matrix_t lf_signal(input_matrix->rows, decimated_size);
+            if (config->extra_low_freq && !lf_signal.buffer) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
             }
-            
+            decimate_and_filter(
+                input_matrix,
+                config->extra_low_freq ? &lf_signal : nullptr,
+                config,
+                new_sampling_freq,
+                filter_type);
+
             // set the filter order to 0, so that we won't double filter
             config->filter_order = 0;
 
-            // do this before extract_spec_features because extract_spec_features modifies the matrix
-            constexpr size_t decimation = 10;
-            const size_t decimated_size =
-                signal::get_decimated_size(input_matrix->cols, decimation);
-            matrix_t lf_signal(input_matrix->rows, decimated_size);
-            _decimate(input_matrix, &lf_signal, decimation);
-
             size_t n_features = extract_spec_features(
                 input_matrix,
                 output_matrix,
                 config,
                 new_sampling_freq,
+                filter_type,
                 true,
                 false);
 
@@ -676,6 +803,7 @@ public:
                     &lf_features,
                     config,
                     new_sampling_freq / decimation,
+                    filter_type,
                     true,
                     false);
             }
@@ -41,6 +41,70 @@
 namespace ei {
 namespace spectral {
 namespace filters {
+    /**
+     * Butterworth filter in second-order steps, applied one sample at a time.
+     * butterworth_lowpass() and butterworth_highpass() run the same filter over a buffer.
+     */
+    class butterworth {
+    public:
+        static constexpr int MAX_STEPS = 8;
+
+        /**
+         * @param filter_order Even filter order (between 2..16)
+         * @param sampling_freq Sample frequency of the signal
+         * @param cutoff_freq Cut-off frequency of the signal
+         * @param highpass Highpass instead of lowpass
+         */
+        butterworth(int filter_order, float sampling_freq, float cutoff_freq, bool highpass)
+            : highpass(highpass)
+        {
+            n_steps = filter_order / 2;
+            assert(n_steps <= MAX_STEPS);
+            if (n_steps > MAX_STEPS) {
+                n_steps = MAX_STEPS;
+            }
+
+            float a = tan(M_PI * cutoff_freq / sampling_freq);
+            float a2 = pow(a, 2);
+
+            // Calculate the filter parameters
+            for (int ix = 0; ix < n_steps; ix++) {
+                float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
+                float norm = a2 + (2.0 * a * r) + 1.0;
+                A[ix] = highpass ? 1.0f / norm : a2 / norm;
+                d1[ix] = 2.0 * (1 - a2) / norm;
+                d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / norm;
+                w0[ix] = w1[ix] = w2[ix] = 0.0f;
+            }
+        }
+
+        float apply(float x)
+        {
+            for (int i = 0; i < n_steps; i++) {
+                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + x;
+                if (highpass) {
+                    x = A[i] * (w0[i] - (2.0 * w1[i]) + w2[i]);
+                }
+                else {
+                    x = A[i] * (w0[i] + (2.0 * w1[i]) + w2[i]);
+                }
+                w2[i] = w1[i];
+                w1[i] = w0[i];
+            }
+            return x;
+        }
+
+    private:
+        bool highpass;
+        int n_steps;
+        float A[MAX_STEPS];
+        float d1[MAX_STEPS];
+        float d2[MAX_STEPS];
+        float w0[MAX_STEPS];
+        float w1[MAX_STEPS];
+        float w2[MAX_STEPS];
+    };
+
     /**
      * The Butterworth filter has maximally flat frequency response in the passband.
      * @param filter_order Even filter order (between 2..8)
@@ -58,43 +122,12 @@ namespace filters {
         float *dest,
         size_t size)
     {
-        int n_steps = filter_order / 2;
-        float a = tan(M_PI * cutoff_freq / sampling_freq);
-        float a2 = pow(a, 2);
-        float *A = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
-        for(int ix = 0; ix < n_steps; ix++) {
-            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
-            sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = a2 / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
-        }
+        butterworth filter(filter_order, sampling_freq, cutoff_freq, false);
 
         // Apply the filter
         for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
-
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] + (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
-            }
+            dest[sx] = filter.apply(src[sx]);
         }
-
-        ei_dsp_free(A, n_steps*sizeof(float));
-        ei_dsp_free(d1, n_steps*sizeof(float));
-        ei_dsp_free(d2, n_steps*sizeof(float));
-        ei_dsp_free(w0, n_steps*sizeof(float));
-        ei_dsp_free(w1, n_steps*sizeof(float));
-        ei_dsp_free(w2, n_steps*sizeof(float));
     }
 
     /**
@@ -114,43 +147,12 @@ namespace filters {
         float *dest,
         size_t size)
     {
-        int n_steps = filter_order / 2;
-        float a = tan(M_PI * cutoff_freq / sampling_freq);
-        float a2 = pow(a, 2);
-        float *A = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_dsp_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
-        for (int ix = 0; ix < n_steps; ix++) {
-            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
-            sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = 1.0f / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
-        }
+        butterworth filter(filter_order, sampling_freq, cutoff_freq, true);
 
         // Apply the filter
         for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
-
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] - (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
-            }
+            dest[sx] = filter.apply(src[sx]);
         }
-
-        ei_dsp_free(A, n_steps*sizeof(float));
-        ei_dsp_free(d1, n_steps*sizeof(float));
-        ei_dsp_free(d2, n_steps*sizeof(float));
-        ei_dsp_free(w0, n_steps*sizeof(float));
-        ei_dsp_free(w1, n_steps*sizeof(float));
-        ei_dsp_free(w2, n_steps*sizeof(float));
     }
 
 } // namespace filters
@@ -186,6 +186,88 @@ public:
         }
     }
 
+    /**
+     * @brief Streaming version of decimate_simple() with second-order sections.
+     * Samples are pushed one at a time, every factor-th filtered sample is returned,
+     * so no buffer for the filtered signal is needed and decimators can be chained.
+     * The initial conditions are scaled by the first sample after reset(), like decimate_simple().
+     */
+    class sos_decimator {
+    public:
+        static constexpr size_t MAX_SECTIONS = 4;
+
+        sos_decimator() : coeff(nullptr), zi(nullptr), num_sections(0), factor(1)
+        {
+            reset();
+        }
+
+        sos_decimator(const float* coeff_, const float* zi_, size_t num_sections_, size_t factor_)
+            : coeff(coeff_),
+            zi(zi_),
+            num_sections(num_sections_),
+            factor(factor_)
+        {
+            assert(num_sections <= MAX_SECTIONS);
+            reset();
+        }
+
+        /**
+         * @brief Start a new signal
+         */
+        void reset()
+        {
+            phase = 0;
+            first = true;
+        }
+
+        /**
+         * @brief Filter a sample
+         * @param x Input sample
+         * @param y Output sample, only written when a sample is kept
+         * @returns true if a sample is kept (every factor-th, starting with the first)
+         */
+        bool push(float x, float* y)
+        {
+            if (first) {
+                for (size_t ix = 0; ix < num_sections * 2; ix++) {
+                    d[ix] = zi[ix] * x;
+                }
+                first = false;
+            }
+
+            // same as iir2() over the sections, one sample at a time
+            for (size_t sect = 0; sect < num_sections; sect++) {
+                const float* b = coeff + sect * 6;
+                const float* a = b + 3;
+                float* dd = d + sect * 2;
+                const float one_over_a0 = 1.0f / a[0];
+                const float xx = x;
+                x = b[0] * xx + dd[0];
+                x *= one_over_a0;
+                dd[0] = b[1] * xx - a[1] * x + dd[1];
+                dd[1] = b[2] * xx - a[2] * x;
+            }
+
+            bool keep = phase == 0;
+            if (keep) {
+                *y = x;
+            }
+            if (++phase == factor) {
+                phase = 0;
+            }
+            return keep;
+        }
+
+    private:
+        const float* coeff; // 6 * num_sections coefficients
+        const float* zi; // 2 * num_sections initial conditions
+        size_t num_sections;
+        size_t factor;
+        size_t phase;
+        bool first;
+        float d[MAX_SECTIONS * 2];
+    };
+
     /**
      * @brief Linear filter.
      * This is the counterpart of scipy.signal.lfilter with zero-phase=false. This function
@@ -72,223 +72,273 @@ inline void histo(const fvec &x, size_t nbins, fvec &h, bool normalize = false)
 class wavelet {
 
     static constexpr size_t NUM_FEATHERS_PER_COMP = 14;
+    static constexpr size_t MAX_FILTER_SIZE = 20;
+    static constexpr size_t NUM_ENTROPY_BINS = 100;
 
     template <size_t wave_size>
-    static void get_filter(const std::array<std::array<float, wave_size>, 2> wav, fvec &h, fvec &g)
+    static size_t get_filter(const std::array<std::array<float, wave_size>, 2> &wav, float *h, float *g)
     {
+        static_assert(wave_size <= MAX_FILTER_SIZE, "wavelet filter too long");
         size_t n = wav[0].size();
-        h.resize(n);
-        g.resize(n);
         for (size_t i = 0; i < n; i++) {
             h[i] = wav[0][n - i - 1];
             g[i] = wav[1][n - i - 1];
         }
+        return n;
     }
 
-    static void find_filter(const char *wav, fvec &h, fvec &g)
+    /**
+     * Copy the (reversed) decomposition filters of a wavelet into h and g
+     * @returns filter size, 0 if the wavelet is not in the list
+     */
+    static size_t find_filter(const char *wav, float *h, float *g)
     {
-        if (strcmp(wav, "bior1.3") == 0) get_filter<6>(bior1p3, h, g);
-        else if (strcmp(wav, "bior1.5") == 0) get_filter<10>(bior1p5, h, g);
-        else if (strcmp(wav, "bior2.2") == 0) get_filter<6>(bior2p2, h, g);
-        else if (strcmp(wav, "bior2.4") == 0) get_filter<10>(bior2p4, h, g);
-        else if (strcmp(wav, "bior2.6") == 0) get_filter<14>(bior2p6, h, g);
-        else if (strcmp(wav, "bior2.8") == 0) get_filter<18>(bior2p8, h, g);
-        else if (strcmp(wav, "bior3.1") == 0) get_filter<4>(bior3p1, h, g);
-        else if (strcmp(wav, "bior3.3") == 0) get_filter<8>(bior3p3, h, g);
-        else if (strcmp(wav, "bior3.5") == 0) get_filter<12>(bior3p5, h, g);
-        else if (strcmp(wav, "bior3.7") == 0) get_filter<16>(bior3p7, h, g);
-        else if (strcmp(wav, "bior3.9") == 0) get_filter<20>(bior3p9, h, g);
-        else if (strcmp(wav, "bior4.4") == 0) get_filter<10>(bior4p4, h, g);
-        else if (strcmp(wav, "bior5.5") == 0) get_filter<12>(bior5p5, h, g);
-        else if (strcmp(wav, "bior6.8") == 0) get_filter<18>(bior6p8, h, g);
-        else if (strcmp(wav, "coif1") == 0) get_filter<6>(coif1, h, g);
-        else if (strcmp(wav, "coif2") == 0) get_filter<12>(coif2, h, g);
-        else if (strcmp(wav, "coif3") == 0) get_filter<18>(coif3, h, g);
-        else if (strcmp(wav, "db2") == 0) get_filter<4>(db2, h, g);
-        else if (strcmp(wav, "db3") == 0) get_filter<6>(db3, h, g);
-        else if (strcmp(wav, "db4") == 0) get_filter<8>(db4, h, g);
-        else if (strcmp(wav, "db5") == 0) get_filter<10>(db5, h, g);
-        else if (strcmp(wav, "db6") == 0) get_filter<12>(db6, h, g);
-        else if (strcmp(wav, "db7") == 0) get_filter<14>(db7, h, g);
-        else if (strcmp(wav, "db8") == 0) get_filter<16>(db8, h, g);
-        else if (strcmp(wav, "db9") == 0) get_filter<18>(db9, h, g);
-        else if (strcmp(wav, "db10") == 0) get_filter<20>(db10, h, g);
-        else if (strcmp(wav, "haar") == 0) get_filter<2>(haar, h, g);
-        else if (strcmp(wav, "rbio1.3") == 0) get_filter<6>(rbio1p3, h, g);
-        else if (strcmp(wav, "rbio1.5") == 0) get_filter<10>(rbio1p5, h, g);
-        else if (strcmp(wav, "rbio2.2") == 0) get_filter<6>(rbio2p2, h, g);
-        else if (strcmp(wav, "rbio2.4") == 0) get_filter<10>(rbio2p4, h, g);
-        else if (strcmp(wav, "rbio2.6") == 0) get_filter<14>(rbio2p6, h, g);
-        else if (strcmp(wav, "rbio2.8") == 0) get_filter<18>(rbio2p8, h, g);
-        else if (strcmp(wav, "rbio3.1") == 0) get_filter<4>(rbio3p1, h, g);
-        else if (strcmp(wav, "rbio3.3") == 0) get_filter<8>(rbio3p3, h, g);
-        else if (strcmp(wav, "rbio3.5") == 0) get_filter<12>(rbio3p5, h, g);
-        else if (strcmp(wav, "rbio3.7") == 0) get_filter<16>(rbio3p7, h, g);
-        else if (strcmp(wav, "rbio3.9") == 0) get_filter<20>(rbio3p9, h, g);
-        else if (strcmp(wav, "rbio4.4") == 0) get_filter<10>(rbio4p4, h, g);
-        else if (strcmp(wav, "rbio5.5") == 0) get_filter<12>(rbio5p5, h, g);
-        else if (strcmp(wav, "rbio6.8") == 0) get_filter<18>(rbio6p8, h, g);
-        else if (strcmp(wav, "sym2") == 0) get_filter<4>(sym2, h, g);
-        else if (strcmp(wav, "sym3") == 0) get_filter<6>(sym3, h, g);
-        else if (strcmp(wav, "sym4") == 0) get_filter<8>(sym4, h, g);
-        else if (strcmp(wav, "sym5") == 0) get_filter<10>(sym5, h, g);
-        else if (strcmp(wav, "sym6") == 0) get_filter<12>(sym6, h, g);
-        else if (strcmp(wav, "sym7") == 0) get_filter<14>(sym7, h, g);
-        else if (strcmp(wav, "sym8") == 0) get_filter<16>(sym8, h, g);
-        else if (strcmp(wav, "sym9") == 0) get_filter<18>(sym9, h, g);
-        else if (strcmp(wav, "sym10") == 0) get_filter<20>(sym10, h, g);
-        else assert(0); // wavelet not in the list
+        if (strcmp(wav, "bior1.3") == 0) return get_filter<6>(bior1p3, h, g);
+        else if (strcmp(wav, "bior1.5") == 0) return get_filter<10>(bior1p5, h, g);
+        else if (strcmp(wav, "bior2.2") == 0) return get_filter<6>(bior2p2, h, g);
+        else if (strcmp(wav, "bior2.4") == 0) return get_filter<10>(bior2p4, h, g);
+        else if (strcmp(wav, "bior2.6") == 0) return get_filter<14>(bior2p6, h, g);
+        else if (strcmp(wav, "bior2.8") == 0) return get_filter<18>(bior2p8, h, g);
+        else if (strcmp(wav, "bior3.1") == 0) return get_filter<4>(bior3p1, h, g);
+        else if (strcmp(wav, "bior3.3") == 0) return get_filter<8>(bior3p3, h, g);
+        else if (strcmp(wav, "bior3.5") == 0) return get_filter<12>(bior3p5, h, g);
+        else if (strcmp(wav, "bior3.7") == 0) return get_filter<16>(bior3p7, h, g);
+        else if (strcmp(wav, "bior3.9") == 0) return get_filter<20>(bior3p9, h, g);
+        else if (strcmp(wav, "bior4.4") == 0) return get_filter<10>(bior4p4, h, g);
+        else if (strcmp(wav, "bior5.5") == 0) return get_filter<12>(bior5p5, h, g);
+        else if (strcmp(wav, "bior6.8") == 0) return get_filter<18>(bior6p8, h, g);
+        else if (strcmp(wav, "coif1") == 0) return get_filter<6>(coif1, h, g);
+        else if (strcmp(wav, "coif2") == 0) return get_filter<12>(coif2, h, g);
+        else if (strcmp(wav, "coif3") == 0) return get_filter<18>(coif3, h, g);
+        else if (strcmp(wav, "db2") == 0) return get_filter<4>(db2, h, g);
+        else if (strcmp(wav, "db3") == 0) return get_filter<6>(db3, h, g);
+        else if (strcmp(wav, "db4") == 0) return get_filter<8>(db4, h, g);
+        else if (strcmp(wav, "db5") == 0) return get_filter<10>(db5, h, g);
+        else if (strcmp(wav, "db6") == 0) return get_filter<12>(db6, h, g);
+        else if (strcmp(wav, "db7") == 0) return get_filter<14>(db7, h, g);
+        else if (strcmp(wav, "db8") == 0) return get_filter<16>(db8, h, g);
+        else if (strcmp(wav, "db9") == 0) return get_filter<18>(db9, h, g);
+        else if (strcmp(wav, "db10") == 0) return get_filter<20>(db10, h, g);
+        else if (strcmp(wav, "haar") == 0) return get_filter<2>(haar, h, g);
+        else if (strcmp(wav, "rbio1.3") == 0) return get_filter<6>(rbio1p3, h, g);
+        else if (strcmp(wav, "rbio1.5") == 0) return get_filter<10>(rbio1p5, h, g);
+        else if (strcmp(wav, "rbio2.2") == 0) return get_filter<6>(rbio2p2, h, g);
+        else if (strcmp(wav, "rbio2.4") == 0) return get_filter<10>(rbio2p4, h, g);
+        else if (strcmp(wav, "rbio2.6") == 0) return get_filter<14>(rbio2p6, h, g);
+        else if (strcmp(wav, "rbio2.8") == 0) return get_filter<18>(rbio2p8, h, g);
+        else if (strcmp(wav, "rbio3.1") == 0) return get_filter<4>(rbio3p1, h, g);
+        else if (strcmp(wav, "rbio3.3") == 0) return get_filter<8>(rbio3p3, h, g);
+        else if (strcmp(wav, "rbio3.5") == 0) return get_filter<12>(rbio3p5, h, g);
+        else if (strcmp(wav, "rbio3.7") == 0) return get_filter<16>(rbio3p7, h, g);
+        else if (strcmp(wav, "rbio3.9") == 0) return get_filter<20>(rbio3p9, h, g);
+        else if (strcmp(wav, "rbio4.4") == 0) return get_filter<10>(rbio4p4, h, g);
+        else if (strcmp(wav, "rbio5.5") == 0) return get_filter<12>(rbio5p5, h, g);
+        else if (strcmp(wav, "rbio6.8") == 0) return get_filter<18>(rbio6p8, h, g);
+        else if (strcmp(wav, "sym2") == 0) return get_filter<4>(sym2, h, g);
+        else if (strcmp(wav, "sym3") == 0) return get_filter<6>(sym3, h, g);
+        else if (strcmp(wav, "sym4") == 0) return get_filter<8>(sym4, h, g);
+        else if (strcmp(wav, "sym5") == 0) return get_filter<10>(sym5, h, g);
+        else if (strcmp(wav, "sym6") == 0) return get_filter<12>(sym6, h, g);
+        else if (strcmp(wav, "sym7") == 0) return get_filter<14>(sym7, h, g);
+        else if (strcmp(wav, "sym8") == 0) return get_filter<16>(sym8, h, g);
+        else if (strcmp(wav, "sym9") == 0) return get_filter<18>(sym9, h, g);
+        else if (strcmp(wav, "sym10") == 0) return get_filter<20>(sym10, h, g);
+        return 0; // wavelet not in the list
     }
 
-    static void calculate_entropy(const fvec &y, fvec &features)
-    {
-        fvec h;
-        histo(y, 100, h, true);
-        // entropy = -sum(prob * log(prob)
-        float entropy = 0.0f;
-        for (size_t i = 0; i < h.size(); i++) {
-            if (h[i] > 0.0f) {
-                entropy -= h[i] * log(h[i]);
-            }
-        }
-        features.push_back(entropy);
-    }
-
-    static float get_percentile_from_sorted(const fvec &sorted, float percentile)
+    static float get_percentile_from_sorted(const float *sorted, size_t size, float percentile)
     {
         // adding 0.5 is a trick to get rounding out of C flooring behavior during cast
-        size_t index = (size_t) ((percentile * (sorted.size()-1)) + 0.5);
+        size_t index = (size_t) ((percentile * (size-1)) + 0.5);
         return sorted[index];
     }
 
-    static void calculate_statistics(const fvec &y, fvec &features, float mean)
+    /**
+     * Calculate the features of one component: entropy, zero and mean crossings,
+     * percentiles (5, 25, 75, 95, 50), mean, stdev, variance, rms, skew and kurtosis.
+     * Same results as the numpy:: functions, but in two passes over y, and the
+     * percentiles by selection. y is reordered.
+     * @param features Out buffer, NUM_FEATHERS_PER_COMP values
+     */
+    static void extract_features(float *y, size_t size, float *features)
     {
-        fvec sorted = y;
-        std::sort(sorted.begin(), sorted.end());
-        features.push_back(get_percentile_from_sorted(sorted,0.05));
-        features.push_back(get_percentile_from_sorted(sorted,0.25));
-        features.push_back(get_percentile_from_sorted(sorted,0.75));
-        features.push_back(get_percentile_from_sorted(sorted,0.95));
-        features.push_back(get_percentile_from_sorted(sorted,0.5));
-
-        matrix_t x(1, y.size(), const_cast<float *>(y.data()));
-        matrix_t out(1, 1);
-
-        features.push_back(mean);
-        if (numpy::stdev(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        features.push_back(numpy::variance(const_cast<float *>(y.data()), y.size()));
-        if (numpy::rms(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        if (numpy::skew(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-        if (numpy::kurtosis(&x, &out) == EIDSP_OK)
-            features.push_back(out.get_row_ptr(0)[0]);
-    }
+        float sum = 0.0f;
+        float min = y[0];
+        float max = y[0];
+        for (size_t i = 0; i < size; i++) {
+            sum += y[i];
+            min = y[i] < min ? y[i] : min;
+            max = y[i] > max ? y[i] : max;
+        }
+        const float mean = sum / size;
 
-    static void calculate_crossings(const fvec &y, fvec &features, float mean)
-    {
+        uint32_t histogram[NUM_ENTROPY_BINS] = { 0 };
+        const float step = (max - min) / NUM_ENTROPY_BINS;
         size_t zc = 0;
-        for (size_t i = 1; i < y.size(); i++) {
-            if (y[i] * y[i - 1] < 0) {
-                zc++;
+        size_t mc = 0;
+        float m_2 = 0.0f;
+        float m_3 = 0.0f;
+        float m_4 = 0.0f;
+        float sum_squares = 0.0f;
+
+        for (size_t i = 0; i < size; i++) {
+            size_t bin = (y[i] - min) / step;
+            if (bin >= NUM_ENTROPY_BINS)
+                bin = NUM_ENTROPY_BINS - 1;
+            histogram[bin]++;
+
+            if (i > 0) {
+                if (y[i] * y[i - 1] < 0) {
+                    zc++;
+                }
+                if ((y[i] - mean) * (y[i - 1] - mean) < 0) {
+                    mc++;
+                }
             }
+
+            float diff = y[i] - mean;
+            float square_diff = diff * diff;
+            m_2 += square_diff;
+            m_3 += square_diff * diff;
+            m_4 += square_diff * square_diff;
+            sum_squares += y[i] * y[i];
         }
-        features.push_back(zc / (float)y.size());
 
-        size_t mc = 0;
-        for (size_t i = 1; i < y.size(); i++) {
-            if ((y[i] - mean) * (y[i - 1] - mean) < 0) {
-                mc++;
+        // entropy = -sum(prob * log(prob)
+        float entropy = 0.0f;
+        for (size_t i = 0; i < NUM_ENTROPY_BINS; i++) {
+            if (histogram[i] > 0) {
+                float prob = histogram[i] / (float)size;
+                entropy -= prob * log(prob);
             }
         }
-        features.push_back(mc / (float)y.size());
+        *features++ = entropy;
+
+        *features++ = zc / (float)size;
+        *features++ = mc / (float)size;
+
+        // only the order statistics we need, each search narrows the range for the next
+        const size_t i05 = (size_t) ((0.05f * (size-1)) + 0.5);
+        const size_t i25 = (size_t) ((0.25f * (size-1)) + 0.5);
+        const size_t i50 = (size_t) ((0.5f * (size-1)) + 0.5);
+        const size_t i75 = (size_t) ((0.75f * (size-1)) + 0.5);
+        const size_t i95 = (size_t) ((0.95f * (size-1)) + 0.5);
+        std::nth_element(y, y + i50, y + size);
+        if (i25 < i50) {
+            std::nth_element(y, y + i25, y + i50);
+        }
+        if (i05 < i25) {
+            std::nth_element(y, y + i05, y + i25);
+        }
+        if (i75 > i50) {
+            std::nth_element(y + i50 + 1, y + i75, y + size);
+        }
+        if (i95 > i75) {
+            std::nth_element(y + i75 + 1, y + i95, y + size);
+        }
+        *features++ = get_percentile_from_sorted(y, size, 0.05);
+        *features++ = get_percentile_from_sorted(y, size, 0.25);
+        *features++ = get_percentile_from_sorted(y, size, 0.75);
+        *features++ = get_percentile_from_sorted(y, size, 0.95);
+        *features++ = get_percentile_from_sorted(y, size, 0.5);
+
+        *features++ = mean;
+        *features++ = sqrt(m_2 / size); // stdev
+        *features++ = m_2 / (size - 1); // variance
+        *features++ = sqrt(sum_squares / static_cast<float>(size)); // rms
+
+        // skew = (m_3) / (m_2)^(3/2)
+        float m_2_pow = sqrt((m_2 / size) * (m_2 / size) * (m_2 / size));
+        *features++ = m_2_pow == 0.0f ? 0.0f : (m_3 / size) / m_2_pow;
+
+        // Fisher kurtosis = (m_4 / variance^2) - 3
+        float variance_sq = (m_2 / size) * (m_2 / size);
+        *features++ = variance_sq == 0.0f ? -3.0f : ((m_4 / size) / variance_sq) - 3.0f;
     }
 
-    static void
-    dwt(const float *x, size_t nx, const float *h, const float *g, size_t nh, fvec &a, fvec &d)
+    /**
+     * Decimate and filter one level, symmetric padding (default in PyWavelet) is
+     * applied on the fly
+     * @param a Out approximation coefficients, (nx + nh - 1) / 2
+     * @param d Out detail coefficients, (nx + nh - 1) / 2
+     * @returns Number of coefficients
+     */
+    static size_t dwt(const float *x, size_t nx, const float *h, const float *g, size_t nh, float *a, float *d)
     {
-        assert(nh <= 20 && nh > 0 && nx > 0);
-        size_t nx_padded = nx + nh * 2 - 2;
-        fvec x_padded(nx_padded);
-
-        // symmetric padding (default in PyWavelet)
-        for (size_t i = 0; i < nh - 2; i++)
-            x_padded[i] = x[nh - 3 - i];
-        for (size_t i = 0; i < nx; i++)
-            x_padded[i + nh - 2] = x[i];
-        for (size_t i = 0; i < nh; i++)
-            x_padded[i + nx + nh - 2] = x[nx - 1 - i];
-
-        size_t ny = (nx + nh - 1) / 2;
-        a.resize(ny);
-        d.resize(ny);
-
-        // decimate and filter
-        const float *xx = x_padded.data();
+        assert(nh <= MAX_FILTER_SIZE && nh > 0 && nx > 0);
+        const size_t pad = nh - 2; // x starts at this offset of the padded signal
+        const size_t ny = (nx + nh - 1) / 2;
+
         for (size_t i = 0; i < ny; i++) {
-            a[i] = dot(xx + 2 * i, h, nh);
-            d[i] = dot(xx + 2 * i, g, nh);
+            const float *xx;
+            float window[MAX_FILTER_SIZE];
+
+            if (2 * i >= pad && 2 * i + nh <= pad + nx) {
+                xx = x + (2 * i - pad);
+            }
+            else {
+                for (size_t k = 0; k < nh; k++) {
+                    size_t p = 2 * i + k;
+                    if (p < pad) {
+                        window[k] = x[pad - 1 - p];
+                    }
+                    else if (p < pad + nx) {
+                        window[k] = x[p - pad];
+                    }
+                    else {
+                        window[k] = x[nx - 1 - (p - pad - nx)];
+                    }
+                }
+                xx = window;
+            }
+
+            a[i] = dot(xx, h, nh);
+            d[i] = dot(xx, g, nh);
         }
 
-        numpy::underflow_handling(d.data(), d.size());
-        numpy::underflow_handling(a.data(), a.size());
-    }
+        numpy::underflow_handling(d, ny);
+        numpy::underflow_handling(a, ny);
 
-    static void extract_features(fvec& y, fvec &features)
-    {
-        matrix_t x(1, y.size(), const_cast<float *>(y.data()));
-        matrix_t out(1, 1);
-        if (numpy::mean(&x, &out) != EIDSP_OK)
-            assert(0);
-        float mean = out.get_row_ptr(0)[0];
-
-        calculate_entropy(y, features);
-        calculate_crossings(y, features, mean);
-        calculate_statistics(y, features, mean);
+        return ny;
     }
 
-    static void
-    wavedec_features(const float *x, int len, const char *wav, int level, fvec &features)
+    /**
+     * Decompose x and calculate the features of every component, in python order
+     * (approximation, then details from the last level to the first)
+     * @param scratch 2 * ny + (ny + 19) / 2 floats, with ny = (len + 19) / 2
+     * @param features Out buffer, (level + 1) * NUM_FEATHERS_PER_COMP values
+     */
+    static int wavedec_features(const float *x, size_t len, const char *wav, int level,
+        float *scratch, float *features)
     {
         assert(level > 0 && level < 8);
 
-        fvec h;
-        fvec g;
-        find_filter(wav, h, g);
-
-        features.clear();
-        fvec a;
-        fvec d;
-        dwt(x, len, h.data(), g.data(), h.size(), a, d);
-        extract_features(d, features);
-
-        for (int l = 1; l < level; l++) {
-            dwt(a.data(), a.size(), h.data(), g.data(), h.size(), a, d);
-            extract_features(d, features);
+        float h[MAX_FILTER_SIZE];
+        float g[MAX_FILTER_SIZE];
+        size_t nh = find_filter(wav, h, g);
+        if (nh == 0) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
         }
 
-        extract_features(a, features);
-
-        for (int l = 0; l <= level / 2; l++) { // reverse order to match python results.
-            for (int i = 0; i < (int)NUM_FEATHERS_PER_COMP; i++) {
-                std::swap(
-                    features[l * NUM_FEATHERS_PER_COMP + i],
-                    features[(level - l) * NUM_FEATHERS_PER_COMP + i]);
-            }
-        }
-    }
+        // detail, and ping-pong buffers for the approximation
+        const size_t ny = (len + nh - 1) / 2;
+        float *d = scratch;
+        float *a = d + ny;
+        float *a_next = a + ny;
 
-    static int dwt_features(const float *x, int len, const char *wav, int level, fvec &features)
-    {
-        assert(level <= 7);
+        const float *in = x;
+        size_t n = len;
+        for (int l = 0; l < level; l++) {
+            n = dwt(in, n, h, g, nh, a, d);
+            extract_features(d, n, features + (level - l) * NUM_FEATHERS_PER_COMP);
 
-        assert(features.size() == 0); // make sure features is empty
-        features.reserve((level + 1) * NUM_FEATHERS_PER_COMP);
+            in = a;
+            std::swap(a, a_next);
+        }
 
-        wavedec_features(x, len, wav, level, features);
+        extract_features(const_cast<float *>(in), n, features);
 
-        return features.size();
+        return EIDSP_OK;
     }
 
     static bool check_min_size(int len, int level)
@@ -333,26 +383,30 @@ public:
 
         EI_TRY(processing::subtract_mean(input_matrix));
 
-        int out_idx = 0;
+        assert(config->wavelet_level <= 7);
+        size_t num_features = (config->wavelet_level + 1) * NUM_FEATHERS_PER_COMP;
+        if (num_features * input_matrix->rows > output_matrix->rows * output_matrix->cols) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        // one scratch buffer for all axes and levels
+        const size_t data_size = input_matrix->cols;
+        const size_t ny = (data_size + MAX_FILTER_SIZE - 1) / 2;
+        EI_DSP_MATRIX(scratch, 1, 2 * ny + (ny + MAX_FILTER_SIZE - 1) / 2);
+
         for (size_t row = 0; row < input_matrix->rows; row++) {
             float *data_window = input_matrix->get_row_ptr(row);
-            size_t data_size = input_matrix->cols;
 
             if (!check_min_size(data_size, config->wavelet_level))
                 EIDSP_ERR(EIDSP_BUFFER_SIZE_MISMATCH);
 
-            fvec features;
-            size_t num_features = dwt_features(
+            EI_TRY(wavedec_features(
                 data_window,
                 data_size,
                 config->wavelet,
                 config->wavelet_level,
-                features);
-
-            assert(num_features == output_matrix->cols / input_matrix->rows);
-            for (size_t i = 0; i < num_features; i++) {
-                output_matrix->buffer[out_idx++] = features[i];
-            }
+                scratch.buffer,
+                output_matrix->buffer + row * num_features));
         }
         return EIDSP_OK;
     }
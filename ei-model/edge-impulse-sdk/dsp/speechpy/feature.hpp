@@ -266,125 +266,16 @@ public:
             *(out_features->buffer + i) = 0;
         }
 
-        const size_t power_spectrum_frame_size = (fft_length / 2 + 1);
-        // Computing the Mel filterbank
-        // converting the upper and lower frequencies to Mels.
-        // num_filter + 2 is because for num_filter filterbanks we need
-        // num_filter+2 point.
-        float *mels;
-        const int MELS_SIZE = num_filters + 2;
-        const size_t mem_size = MELS_SIZE * sizeof(float);
-        mels = (float*)ei_dsp_calloc(MELS_SIZE, sizeof(float));
-        EI_ERR_AND_RETURN_ON_NULL(mels, EIDSP_OUT_OF_MEM);
-        ei_unique_ptr_t __ptr__(mels,[mem_size](void* ptr){ei::ei_dsp_free_func(ptr, mem_size);});
-        uint16_t* bins = reinterpret_cast<uint16_t*>(mels); // alias the mels array so we can reuse the space
-
-        numpy::linspace(
-            functions::frequency_to_mel(static_cast<float>(low_frequency)),
-            functions::frequency_to_mel(static_cast<float>(high_frequency)),
-            num_filters + 2,
-            mels);
-
-        uint16_t max_bin = version >= 4 ? fft_length : power_spectrum_frame_size; // preserve a bug in v<4
-        // go to -1 size b/c special handling, see after
-        for (uint16_t ix = 0; ix < MELS_SIZE-1; ix++) {
-            mels[ix] = functions::mel_to_frequency(mels[ix]);
-            if (mels[ix] < low_frequency) {
-                mels[ix] = low_frequency;
-            }
-            if (mels[ix] > high_frequency) {
-                mels[ix] = high_frequency;
-            }
-            bins[ix] = get_fft_bin_from_hertz(max_bin, mels[ix], sampling_frequency);
-        }
-
-        // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
-        // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
-        // thus calculating the bucket to 64, not 65.
-        // we're adjusting this here a tiny bit to ensure we have the same result
-        mels[MELS_SIZE-1] = functions::mel_to_frequency(mels[MELS_SIZE-1]);
-        if (mels[MELS_SIZE-1] > high_frequency) {
-            mels[MELS_SIZE-1] = high_frequency;
-        }
-        mels[MELS_SIZE-1] -= 0.001;
-        bins[MELS_SIZE-1] = get_fft_bin_from_hertz(max_bin, mels[MELS_SIZE-1], sampling_frequency);
-
-        EI_DSP_MATRIX(power_spectrum_frame, 1, power_spectrum_frame_size);
-        if (!power_spectrum_frame.buffer) {
+        uint16_t max_bin = version >= 4 ? fft_length : (fft_length / 2 + 1); // preserve a bug in v<4
+        mel_frontend_t *frontend = get_mel_frontend(sampling_frequency, num_filters, fft_length,
+            low_frequency, high_frequency, max_bin, stack_frame_info.frame_length);
+        if (!frontend) {
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
 
-        // get signal data from the audio file
-        EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
-
         for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
-            // don't read outside of the audio buffer... we'll automatically zero pad then
-            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
-            size_t signal_length = stack_frame_info.frame_length;
-            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
-                signal_length = signal_length -
-                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
-            }
-
-            ret = stack_frame_info.signal->get_data(
-                signal_offset,
-                signal_length,
-                signal_frame.buffer
-            );
-            if (ret != 0) {
-                EIDSP_ERR(ret);
-            }
-
-            ret = numpy::power_spectrum(
-                signal_frame.buffer,
-                stack_frame_info.frame_length,
-                power_spectrum_frame.buffer,
-                power_spectrum_frame_size,
-                fft_length
-            );
-
-            if (ret != 0) {
-                EIDSP_ERR(ret);
-            }
-
-            float energy = numpy::sum(power_spectrum_frame.buffer, power_spectrum_frame_size);
-            if (energy == 0) {
-                energy = 1e-10;
-            }
-
-            if (out_energies) {
-                out_energies->buffer[ix] = energy;
-            }
-
-            auto row_ptr = out_features->get_row_ptr(ix);
-            for (size_t i = 0; i < num_filters; i++) {
-                size_t left = bins[i];
-                size_t middle = bins[i+1];
-                size_t right = bins[i+2];
-
-                assert(right < power_spectrum_frame_size);
-                // now we have weights and locations to move from fft to mel sgram
-                // both left and right become zero weights, so skip them
-
-                // middle always has weight of 1.0
-                // since we skip left and right, if left = middle we need to handle that
-                row_ptr[i] = power_spectrum_frame.buffer[middle];
-
-                for (size_t bin = left+1; bin < right; bin++) {
-                    if (bin < middle) {
-                        row_ptr[i] +=
-                            ((static_cast<float>(bin) - left) / (middle - left)) * // weight *
-                            power_spectrum_frame.buffer[bin];
-                    }
-                    // intentionally skip middle, handled above
-                    if (bin > middle) {
-                        row_ptr[i] +=
-                            ((right - static_cast<float>(bin)) / (right - middle)) * // weight *
-                            power_spectrum_frame.buffer[bin];
-                    }
-                }
-            }
-
+            ret = mel_frame(frontend, &stack_frame_info, ix, out_features->get_row_ptr(ix),
+                out_energies ? &out_energies->buffer[ix] : nullptr);
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
@@ -466,82 +357,16 @@ public:
             *(out_features->buffer + i) = 0;
         }
 
-        uint16_t coefficients = fft_length / 2 + 1;
-
-        // calculate the filterbanks first... preferably I would want to do the matrix multiplications
-        // whenever they happen, but OK...
-#if EIDSP_QUANTIZE_FILTERBANK
-        EI_DSP_QUANTIZED_MATRIX(filterbanks, num_filters, coefficients, &numpy::dequantize_zero_one);
-#else
-        EI_DSP_MATRIX(filterbanks, num_filters, coefficients);
-#endif
-        if (!filterbanks.buffer) {
+        // max_bin 0 selects the filterbank from feature::filterbanks()
+        mel_frontend_t *frontend = get_mel_frontend(sampling_frequency, num_filters, fft_length,
+            low_frequency, high_frequency, 0, stack_frame_info.frame_length);
+        if (!frontend) {
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
 
-        ret = feature::filterbanks(
-            &filterbanks, num_filters, coefficients, sampling_frequency, low_frequency, high_frequency, true);
-        if (ret != 0) {
-            EIDSP_ERR(ret);
-        }
         for (size_t ix = 0; ix < stack_frame_info.frame_ixs.size(); ix++) {
-            size_t power_spectrum_frame_size = (fft_length / 2 + 1);
-
-            EI_DSP_MATRIX(power_spectrum_frame, 1, power_spectrum_frame_size);
-            if (!power_spectrum_frame.buffer) {
-                EIDSP_ERR(EIDSP_OUT_OF_MEM);
-            }
-
-            // get signal data from the audio file
-            EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
-
-            // don't read outside of the audio buffer... we'll automatically zero pad then
-            size_t signal_offset = stack_frame_info.frame_ixs.at(ix);
-            size_t signal_length = stack_frame_info.frame_length;
-            if (signal_offset + signal_length > stack_frame_info.signal->total_length) {
-                signal_length = signal_length -
-                    (stack_frame_info.signal->total_length - (signal_offset + signal_length));
-            }
-
-            ret = stack_frame_info.signal->get_data(
-                signal_offset,
-                signal_length,
-                signal_frame.buffer
-            );
-            if (ret != 0) {
-                EIDSP_ERR(ret);
-            }
-
-            ret = numpy::power_spectrum(
-                signal_frame.buffer,
-                stack_frame_info.frame_length,
-                power_spectrum_frame.buffer,
-                power_spectrum_frame_size,
-                fft_length
-            );
-
-            if (ret != 0) {
-                EIDSP_ERR(ret);
-            }
-
-            float energy = numpy::sum(power_spectrum_frame.buffer, power_spectrum_frame_size);
-            if (energy == 0) {
-                energy = 1e-10;
-            }
-
-            if (out_energies) {
-                out_energies->buffer[ix] = energy;
-            }
-
-            // calculate the out_features directly here
-            ret = numpy::dot_by_row(
-                ix,
-                power_spectrum_frame.buffer,
-                power_spectrum_frame_size,
-                &filterbanks,
-                out_features
-            );
-
+            ret = mel_frame(frontend, &stack_frame_info, ix, out_features->get_row_ptr(ix),
+                out_energies ? &out_energies->buffer[ix] : nullptr);
             if (ret != 0) {
                 EIDSP_ERR(ret);
             }
@@ -813,6 +638,329 @@ public:
         size_matrix.cols = (uint32_t)cols;
         return size_matrix;
     }
+
+    /**
+     * Release the cached Mel filterbank and frame buffers used by mfe() and mfcc()
+     */
+    static void free_mel_frontend()
+    {
+        mel_frontend_t *frontend = mel_frontend();
+        const size_t coefficients = frontend->fft_length / 2 + 1;
+
+        free_mel_buffer(frontend->middle, frontend->num_filters * sizeof(uint16_t));
+        free_mel_buffer(frontend->start, frontend->num_filters * sizeof(uint16_t));
+        free_mel_buffer(frontend->offset, (frontend->num_filters + 1) * sizeof(uint32_t));
+        free_mel_buffer(frontend->weights, frontend->weights_size * sizeof(float));
+        free_mel_buffer(frontend->frame, frontend->frame_size * sizeof(float));
+        free_mel_buffer(frontend->fft, coefficients * sizeof(fft_complex_t));
+        free_mel_buffer(frontend->power, coefficients * sizeof(float));
+        memset(frontend, 0, sizeof(mel_frontend_t));
+    }
+
+private:
+    /**
+     * Mel filterbank in sparse form, and the buffers to run a frame through it.
+     * Filter i covers the bins from start[i], with weights[offset[i]] to weights[offset[i + 1] - 1].
+     * Built on first use and kept until the configuration changes (e.g. another impulse).
+     */
+    typedef struct {
+        uint32_t sampling_frequency;
+        uint32_t low_frequency;
+        uint32_t high_frequency;
+        uint16_t num_filters;
+        uint16_t fft_length;
+        uint16_t max_bin; // 0 for the filterbank from feature::filterbanks()
+        // bin with weight 1.0 added first (as mfe() always did), nullptr for max_bin 0
+        uint16_t *middle;
+        uint16_t *start;
+        uint32_t *offset;
+        float *weights;
+        uint32_t weights_size; // allocated weights (at least 1)
+        // frame buffer, max(frame_length, fft_length)
+        size_t frame_size;
+        float *frame;
+        fft_complex_t *fft;
+        float *power;
+    } mel_frontend_t;
+
+    static mel_frontend_t *mel_frontend()
+    {
+        static mel_frontend_t frontend = { 0 };
+        return &frontend;
+    }
+
+    static void free_mel_buffer(void *ptr, size_t size)
+    {
+        // the allocation tracker counts every free, also of nullptr
+        if (ptr) {
+            ei_dsp_free(ptr, size);
+        }
+    }
+
+    /**
+     * Build the sparse filterbank. For max_bin > 0 the filters have their peak on
+     * a bin (with weight 1.0) as in mfe(), otherwise they're taken from feature::filterbanks().
+     */
+    static int build_mel_filterbank(mel_frontend_t *frontend)
+    {
+        const uint16_t num_filters = frontend->num_filters;
+        const uint16_t coefficients = frontend->fft_length / 2 + 1;
+
+        frontend->start = (uint16_t*)ei_dsp_malloc(num_filters * sizeof(uint16_t));
+        frontend->offset = (uint32_t*)ei_dsp_malloc((num_filters + 1) * sizeof(uint32_t));
+        if (!frontend->start || !frontend->offset) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        if (frontend->max_bin == 0) {
+#if EIDSP_QUANTIZE_FILTERBANK
+            EI_DSP_QUANTIZED_MATRIX(filterbanks, num_filters, coefficients, &numpy::dequantize_zero_one);
+#else
+            EI_DSP_MATRIX(filterbanks, num_filters, coefficients);
+#endif
+            if (!filterbanks.buffer) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+
+            int ret = feature::filterbanks(&filterbanks, num_filters, coefficients,
+                frontend->sampling_frequency, frontend->low_frequency, frontend->high_frequency, false);
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+
+            // first pass for the non-zero span of every filter, second to copy the weights
+            uint32_t weights_size = 0;
+            for (uint16_t i = 0; i < num_filters; i++) {
+                auto row = filterbanks.buffer + (i * coefficients);
+                uint16_t first = 0, last = 0;
+                for (uint16_t bin = 0; bin < coefficients; bin++) {
+                    if (row[bin]) {
+                        if (last == 0) {
+                            first = bin;
+                        }
+                        last = bin + 1;
+                    }
+                }
+                frontend->start[i] = first;
+                frontend->offset[i] = weights_size;
+                weights_size += last - first;
+            }
+            frontend->offset[num_filters] = weights_size;
+
+            frontend->weights_size = weights_size > 0 ? weights_size : 1;
+            frontend->weights = (float*)ei_dsp_malloc(frontend->weights_size * sizeof(float));
+            if (!frontend->weights) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+            for (uint16_t i = 0; i < num_filters; i++) {
+                auto row = filterbanks.buffer + (i * coefficients) + frontend->start[i];
+                for (uint32_t w = frontend->offset[i]; w < frontend->offset[i + 1]; w++) {
+#if EIDSP_QUANTIZE_FILTERBANK
+                    frontend->weights[w] = numpy::dequantize_zero_one(*row++);
+#else
+                    frontend->weights[w] = *row++;
+#endif
+                }
+            }
+
+            return EIDSP_OK;
+        }
+
+        // Computing the Mel filterbank
+        // converting the upper and lower frequencies to Mels.
+        // num_filter + 2 is because for num_filter filterbanks we need
+        // num_filter+2 point.
+        const int MELS_SIZE = num_filters + 2;
+        const size_t mem_size = MELS_SIZE * sizeof(float);
+        float *mels = (float*)ei_dsp_calloc(MELS_SIZE, sizeof(float));
+        EI_ERR_AND_RETURN_ON_NULL(mels, EIDSP_OUT_OF_MEM);
+        ei_unique_ptr_t __ptr__(mels,[mem_size](void* ptr){ei::ei_dsp_free_func(ptr, mem_size);});
+        uint16_t* bins = reinterpret_cast<uint16_t*>(mels); // alias the mels array so we can reuse the space
+
+        numpy::linspace(
+            functions::frequency_to_mel(static_cast<float>(frontend->low_frequency)),
+            functions::frequency_to_mel(static_cast<float>(frontend->high_frequency)),
+            num_filters + 2,
+            mels);
+
+        // go to -1 size b/c special handling, see after
+        for (uint16_t ix = 0; ix < MELS_SIZE-1; ix++) {
+            mels[ix] = functions::mel_to_frequency(mels[ix]);
+            if (mels[ix] < frontend->low_frequency) {
+                mels[ix] = frontend->low_frequency;
+            }
+            if (mels[ix] > frontend->high_frequency) {
+                mels[ix] = frontend->high_frequency;
+            }
+            bins[ix] = get_fft_bin_from_hertz(frontend->max_bin, mels[ix], frontend->sampling_frequency);
+        }
+
+        // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
+        // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
+        // thus calculating the bucket to 64, not 65.
+        // we're adjusting this here a tiny bit to ensure we have the same result
+        mels[MELS_SIZE-1] = functions::mel_to_frequency(mels[MELS_SIZE-1]);
+        if (mels[MELS_SIZE-1] > frontend->high_frequency) {
+            mels[MELS_SIZE-1] = frontend->high_frequency;
+        }
+        mels[MELS_SIZE-1] -= 0.001;
+        bins[MELS_SIZE-1] = get_fft_bin_from_hertz(frontend->max_bin, mels[MELS_SIZE-1], frontend->sampling_frequency);
+
+        if (bins[MELS_SIZE-1] >= coefficients) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        frontend->middle = (uint16_t*)ei_dsp_malloc(num_filters * sizeof(uint16_t));
+        if (!frontend->middle) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        // both left and right become zero weights, so skip them
+        uint32_t weights_size = 0;
+        for (uint16_t i = 0; i < num_filters; i++) {
+            frontend->middle[i] = bins[i + 1];
+            frontend->start[i] = bins[i] + 1;
+            frontend->offset[i] = weights_size;
+            if (bins[i + 2] > bins[i] + 1) {
+                weights_size += bins[i + 2] - bins[i] - 1;
+            }
+        }
+        frontend->offset[num_filters] = weights_size;
+
+        frontend->weights_size = weights_size > 0 ? weights_size : 1;
+        frontend->weights = (float*)ei_dsp_malloc(frontend->weights_size * sizeof(float));
+        if (!frontend->weights) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        for (uint16_t i = 0; i < num_filters; i++) {
+            size_t left = bins[i];
+            size_t middle = bins[i+1];
+            size_t right = bins[i+2];
+            float *weight = frontend->weights + frontend->offset[i];
+
+            for (size_t bin = left+1; bin < right; bin++) {
+                // middle always has weight of 1.0, it's added separately
+                *weight++ = bin < middle ? ((static_cast<float>(bin) - left) / (middle - left)) :
+                            bin > middle ? ((right - static_cast<float>(bin)) / (right - middle)) :
+                            0.0f;
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Get the filterbank and buffers for a configuration, (re)building them if needed
+     * @returns nullptr when out of memory
+     */
+    static mel_frontend_t *get_mel_frontend(uint32_t sampling_frequency, uint16_t num_filters,
+        uint16_t fft_length, uint32_t low_frequency, uint32_t high_frequency,
+        uint16_t max_bin, size_t frame_length)
+    {
+        mel_frontend_t *frontend = mel_frontend();
+
+        if (!frontend->weights ||
+            frontend->sampling_frequency != sampling_frequency ||
+            frontend->num_filters != num_filters ||
+            frontend->fft_length != fft_length ||
+            frontend->low_frequency != low_frequency ||
+            frontend->high_frequency != high_frequency ||
+            frontend->max_bin != max_bin) {
+
+            free_mel_frontend();
+            frontend->sampling_frequency = sampling_frequency;
+            frontend->num_filters = num_filters;
+            frontend->fft_length = fft_length;
+            frontend->low_frequency = low_frequency;
+            frontend->high_frequency = high_frequency;
+            frontend->max_bin = max_bin;
+
+            frontend->fft = (fft_complex_t*)ei_dsp_malloc((fft_length / 2 + 1) * sizeof(fft_complex_t));
+            frontend->power = (float*)ei_dsp_malloc((fft_length / 2 + 1) * sizeof(float));
+            if (!frontend->fft || !frontend->power || build_mel_filterbank(frontend) != EIDSP_OK) {
+                free_mel_frontend();
+                return nullptr;
+            }
+        }
+
+        size_t frame_size = frame_length > fft_length ? frame_length : fft_length;
+        if (frame_size > frontend->frame_size) {
+            free_mel_buffer(frontend->frame, frontend->frame_size * sizeof(float));
+            frontend->frame = (float*)ei_dsp_malloc(frame_size * sizeof(float));
+            if (!frontend->frame) {
+                frontend->frame_size = 0;
+                return nullptr;
+            }
+            frontend->frame_size = frame_size;
+        }
+
+        return frontend;
+    }
+
+    /**
+     * Read a frame, and calculate its power spectrum, energy and Mel filterbank energies in one go
+     * @param frontend From get_mel_frontend()
+     * @param stack_frame_info Frames from processing::stack_frames()
+     * @param ix Frame index
+     * @param out_row num_filters filterbank energies
+     * @param out_energy Energy of the frame (optional)
+     */
+    static int mel_frame(mel_frontend_t *frontend, stack_frames_info_t *stack_frame_info,
+        size_t ix, float *out_row, float *out_energy)
+    {
+        const size_t power_spectrum_frame_size = frontend->fft_length / 2 + 1;
+
+        // don't read outside of the audio buffer... we'll automatically zero pad then
+        size_t signal_offset = stack_frame_info->frame_ixs.at(ix);
+        size_t signal_length = stack_frame_info->frame_length;
+        if (signal_offset + signal_length > stack_frame_info->signal->total_length) {
+            signal_length = signal_length -
+                (stack_frame_info->signal->total_length - (signal_offset + signal_length));
+        }
+
+        int ret = stack_frame_info->signal->get_data(
+            signal_offset,
+            signal_length,
+            frontend->frame
+        );
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+
+        ret = numpy::power_spectrum(
+            frontend->frame,
+            stack_frame_info->frame_length,
+            frontend->fft,
+            frontend->power,
+            power_spectrum_frame_size,
+            frontend->fft_length
+        );
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+
+        if (out_energy) {
+            float energy = numpy::sum(frontend->power, power_spectrum_frame_size);
+            if (energy == 0) {
+                energy = 1e-10;
+            }
+            *out_energy = energy;
+        }
+
+        for (uint16_t i = 0; i < frontend->num_filters; i++) {
+            const float *power = frontend->power + frontend->start[i];
+            const float *weight = frontend->weights + frontend->offset[i];
+            const float *weight_end = frontend->weights + frontend->offset[i + 1];
+
+            float sum = frontend->middle ? frontend->power[frontend->middle[i]] : 0.0f;
+            while (weight < weight_end) {
+                sum += *weight++ * *power++;
+            }
+            out_row[i] = sum;
+        }
+
+        return EIDSP_OK;
+    }
 };
 
 } // namespace speechpy
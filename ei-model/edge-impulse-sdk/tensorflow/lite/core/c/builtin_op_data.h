@@ -173,8 +173,28 @@ typedef struct {
 typedef enum {
   kTfLiteFullyConnectedWeightsFormatDefault = 0,
   kTfLiteFullyConnectedWeightsFormatShuffled4x16Int8 = 1,
+  // Edge Impulse: the weights tensor data points to a
+  // TfLiteFullyConnectedBlockSparseWeights struct (EON compiled models only).
+  kTfLiteFullyConnectedWeightsFormatBlockSparseInt8 = 2,
 } TfLiteFullyConnectedWeightsFormat;
 
+// Edge Impulse: int8 FULLY_CONNECTED weights with only the non-zero blocks
+// stored. Every output channel (row of the [output_depth, accum_depth] filter)
+// is split in blocks of kTfLiteFullyConnectedBlockSparseSize consecutive
+// weights, blocks that are all zero are left out. The weights tensor keeps its
+// dense dims and must be symmetric quantized (zero point 0).
+enum { kTfLiteFullyConnectedBlockSparseSize = 4 };
+
+typedef struct {
+  // output_depth + 1 entries, blocks of row r are [row_ptr[r], row_ptr[r + 1])
+  const uint16_t* row_ptr;
+  // accum_depth index of the first weight of every block
+  const uint16_t* block_col;
+  // kTfLiteFullyConnectedBlockSparseSize weights per block, zero padded when
+  // a block runs past accum_depth
+  const int8_t* values;
+} TfLiteFullyConnectedBlockSparseWeights;
+
 typedef struct {
   // Parameters for FullyConnected version 1 or above.
   TfLiteFusedActivation activation;
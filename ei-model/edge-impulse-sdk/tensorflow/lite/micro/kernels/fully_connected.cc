@@ -99,6 +99,8 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_STATUS(CalculateOpDataFullyConnected(
       context, params->activation, input->type, input, filter, bias, output,
       &(data->reference_op_data)));
+  TF_LITE_ENSURE_STATUS(PrepareFullyConnectedBlockSparse(
+      context, params, input, filter, &(data->reference_op_data)));
 
   int32_t buf_size = 0;
 
@@ -225,11 +227,20 @@ TfLiteStatus EvalQuantizedInt8(TfLiteContext* context, TfLiteNode* node,
   cmsis_nn_dims output_dims;
   cmsis_nn_context ctx;
 
+  if (data.reference_op_data.block_sparse_weights != nullptr) {
+    return EvalFullyConnectedBlockSparseInt8(data.reference_op_data, input,
+                                             filter, bias, output);
+  }
+
   PopulateCommonParams(context, &quant_params, &input_dims, &filter_dims,
                        &bias_dims, &output_dims, &ctx, data);
 
   const int32_t* bias_data =
       tflite::micro::GetOptionalTensorData<int32_t>(bias);
+  const int8_t* filter_data =
+      data.reference_op_data.block_sparse_unpacked != nullptr
+          ? data.reference_op_data.block_sparse_unpacked
+          : tflite::micro::GetTensorData<int8_t>(filter);
 
 #if EI_TFLITE_DISABLE_CONV_2D_IN_I8
     cmsis_nn_fc_params fc_params;
@@ -244,7 +255,7 @@ TfLiteStatus EvalQuantizedInt8(TfLiteContext* context, TfLiteNode* node,
         arm_fully_connected_s8(
             &ctx, &fc_params, &quant_params, &input_dims,
             tflite::micro::GetTensorData<int8_t>(input), &filter_dims,
-            tflite::micro::GetTensorData<int8_t>(filter), &bias_dims, bias_data,
+            filter_data, &bias_dims, bias_data,
             &output_dims, tflite::micro::GetTensorData<int8_t>(output)),
         ARM_CMSIS_NN_SUCCESS);
 #else
@@ -278,7 +289,7 @@ TfLiteStatus EvalQuantizedInt8(TfLiteContext* context, TfLiteNode* node,
         arm_convolve_1x1_s8_fast(
             &ctx, &conv_params, &per_channel_quant_params, &input_dims,
             tflite::micro::GetTensorData<int8_t>(input), &filter_dims,
-            tflite::micro::GetTensorData<int8_t>(filter), &bias_dims, bias_data,
+            filter_data, &bias_dims, bias_data,
             &output_dims, tflite::micro::GetTensorData<int8_t>(output)),
         ARM_CMSIS_NN_SUCCESS);
   } else {
@@ -294,7 +305,7 @@ TfLiteStatus EvalQuantizedInt8(TfLiteContext* context, TfLiteNode* node,
         arm_fully_connected_s8(
             &ctx, &fc_params, &quant_params, &input_dims,
             tflite::micro::GetTensorData<int8_t>(input), &filter_dims,
-            tflite::micro::GetTensorData<int8_t>(filter), &bias_dims, bias_data,
+            filter_data, &bias_dims, bias_data,
             &output_dims, tflite::micro::GetTensorData<int8_t>(output)),
         ARM_CMSIS_NN_SUCCESS);
   }
@@ -626,6 +637,10 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TfLiteTensor* output = micro_context->AllocateTempOutputTensor(node, kOutputTensor);
 
   TF_LITE_ENSURE_TYPES_EQ(context, input->type, output->type);
+  TF_LITE_ENSURE_MSG(context,
+                     params->weights_format !=
+                         kTfLiteFullyConnectedWeightsFormatBlockSparseInt8,
+                     "Block sparse weights are not supported by this kernel.");
   TF_LITE_ENSURE_MSG(context, input->type == filter->type,
                      "Hybrid models are not supported on TFLite Micro.");
 
@@ -1090,6 +1105,10 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
 
   TF_LITE_ENSURE(context, input  != nullptr);
   TF_LITE_ENSURE(context, output != nullptr);
+  TF_LITE_ENSURE_MSG(context,
+                     params->weights_format !=
+                         kTfLiteFullyConnectedWeightsFormatBlockSparseInt8,
+                     "Block sparse weights are not supported by this kernel.");
 
   if (!(input->type == kTfLiteFloat32 || input->type == kTfLiteInt8)) {
     // Unsupported datatype used by model
@@ -1465,6 +1484,10 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_OK(context, CalculateOpDataFullyConnected(
                                  context, params->activation, input->type,
                                  input, filter, bias, output, data));
+  TF_LITE_ENSURE_MSG(context,
+                     params->weights_format !=
+                         kTfLiteFullyConnectedWeightsFormatBlockSparseInt8,
+                     "Block sparse weights are not supported by this kernel.");
 
   micro_context->DeallocateTempTfLiteTensor(input);
   micro_context->DeallocateTempTfLiteTensor(filter);
@@ -1670,6 +1693,8 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_OK(context, CalculateOpDataFullyConnected(
                                  context, params->activation, input->type,
                                  input, filter, bias, output, data));
+  TF_LITE_ENSURE_OK(context, PrepareFullyConnectedBlockSparse(
+                                 context, params, input, filter, data));
 
   micro_context->DeallocateTempTfLiteTensor(input);
   micro_context->DeallocateTempTfLiteTensor(filter);
@@ -1746,12 +1771,18 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           break;
         }
         case kTfLiteInt8: {
+          if (data.block_sparse_weights != nullptr) {
+            return EvalFullyConnectedBlockSparseInt8(data, input, filter, bias,
+                                                     output);
+          }
           tflite::reference_integer_ops::FullyConnected(
               FullyConnectedParamsQuantized(data),
               tflite::micro::GetTensorShape(input),
               tflite::micro::GetTensorData<int8_t>(input),
               tflite::micro::GetTensorShape(filter),
-              tflite::micro::GetTensorData<int8_t>(filter),
+              data.block_sparse_unpacked != nullptr
+                  ? data.block_sparse_unpacked
+                  : tflite::micro::GetTensorData<int8_t>(filter),
               tflite::micro::GetTensorShape(bias),
               tflite::micro::GetOptionalTensorData<int32_t>(bias),
               tflite::micro::GetTensorShape(output),
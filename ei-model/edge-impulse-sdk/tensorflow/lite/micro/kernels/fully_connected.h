@@ -46,8 +46,21 @@ struct OpDataFullyConnected {
   // tensor is of n-bit precision that cannot be easily processed by kernels.
   int filter_buffer_index;
 #endif
+
+  // Edge Impulse: set by PrepareFullyConnectedBlockSparse(). For block sparse
+  // weights either the sparse kernel runs on block_sparse_weights, or, when
+  // the weights are too dense for that to pay off, they were expanded once
+  // into block_sparse_unpacked and the dense kernel runs on that.
+  const TfLiteFullyConnectedBlockSparseWeights* block_sparse_weights;
+  int8_t* block_sparse_unpacked;
 };
 
+// Edge Impulse: block sparse weights with more than this percentage of
+// non-zero blocks are expanded and run through the dense kernel instead.
+#ifndef EI_TFLITE_FC_BLOCK_SPARSE_MAX_DENSITY
+#define EI_TFLITE_FC_BLOCK_SPARSE_MAX_DENSITY 60
+#endif
+
 extern const int kFullyConnectedInputTensor;
 extern const int kFullyConnectedWeightsTensor;
 extern const int kFullyConnectedBiasTensor;
@@ -68,6 +81,29 @@ TfLiteStatus CalculateOpDataFullyConnected(
     TfLiteType data_type, const TfLiteTensor* input, const TfLiteTensor* filter,
     const TfLiteTensor* bias, TfLiteTensor* output, OpDataFullyConnected* data);
 
+// Edge Impulse: checks the weights format of the node and sets up
+// block_sparse_weights / block_sparse_unpacked in data. Must be called from
+// Prepare after CalculateOpDataFullyConnected().
+TfLiteStatus PrepareFullyConnectedBlockSparse(
+    TfLiteContext* context, const TfLiteFullyConnectedParams* params,
+    const TfLiteTensor* input, const TfLiteTensor* filter,
+    OpDataFullyConnected* data);
+
+// Edge Impulse: int8 fully connected over block sparse weights, gives the same
+// output as reference_integer_ops::FullyConnected() on the dense weights.
+void FullyConnectedBlockSparseInt8(
+    const FullyConnectedParams& params,
+    const TfLiteFullyConnectedBlockSparseWeights& weights, int batches,
+    int output_depth, int accum_depth, const int8_t* input_data,
+    const int32_t* bias_data, int8_t* output_data);
+
+// Edge Impulse: runs FullyConnectedBlockSparseInt8() for a node that was
+// prepared with block sparse weights.
+TfLiteStatus EvalFullyConnectedBlockSparseInt8(
+    const OpDataFullyConnected& data, const TfLiteEvalTensor* input,
+    const TfLiteEvalTensor* filter, const TfLiteEvalTensor* bias,
+    TfLiteEvalTensor* output);
+
 // This is the most generic TfLiteRegistration. The actual supported types may
 // still be target dependent. The only requirement is that every implementation
 // (reference or optimized) must define this function.
@@ -13,6 +13,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cstring>
+
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
 #include "edge-impulse-sdk/tensorflow/lite/c/builtin_op_data.h"
 #include "edge-impulse-sdk/tensorflow/lite/c/common.h"
 #include "edge-impulse-sdk/tensorflow/lite/kernels/internal/common.h"
@@ -24,6 +28,10 @@ limitations under the License.
 #include "edge-impulse-sdk/tensorflow/lite/micro/kernels/fully_connected.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/kernels/kernel_util.h"
 
+#if EI_CLASSIFIER_TFLITE_ENABLE_CMSIS_NN == 1
+#include "edge-impulse-sdk/CMSIS/NN/Include/arm_nnsupportfunctions.h"
+#endif
+
 namespace tflite {
 
 const int kFullyConnectedInputTensor = 0;
@@ -81,4 +89,150 @@ TfLiteStatus CalculateOpDataFullyConnected(
   return kTfLiteOk;
 }
 
+TfLiteStatus PrepareFullyConnectedBlockSparse(
+    TfLiteContext* context, const TfLiteFullyConnectedParams* params,
+    const TfLiteTensor* input, const TfLiteTensor* filter,
+    OpDataFullyConnected* data) {
+  data->block_sparse_weights = nullptr;
+  data->block_sparse_unpacked = nullptr;
+
+  if (params->weights_format !=
+      kTfLiteFullyConnectedWeightsFormatBlockSparseInt8) {
+    return kTfLiteOk;
+  }
+
+  TF_LITE_ENSURE_TYPES_EQ(context, input->type, kTfLiteInt8);
+  TF_LITE_ENSURE_TYPES_EQ(context, filter->type, kTfLiteInt8);
+  // Skipping a block is only exact if a stored 0 is a real 0.
+  TF_LITE_ENSURE_EQ(context, filter->params.zero_point, 0);
+
+  const auto* weights =
+      static_cast<const TfLiteFullyConnectedBlockSparseWeights*>(
+          filter->data.data);
+  TF_LITE_ENSURE(context, weights != nullptr);
+
+  const RuntimeShape filter_shape = GetTensorShape(filter);
+  const int filter_dim_count = filter_shape.DimensionsCount();
+  const int output_depth = filter_shape.Dims(filter_dim_count - 2);
+  const int accum_depth = filter_shape.Dims(filter_dim_count - 1);
+  const int block_size = kTfLiteFullyConnectedBlockSparseSize;
+  const int dense_blocks =
+      output_depth * ((accum_depth + block_size - 1) / block_size);
+  const int stored_blocks = weights->row_ptr[output_depth];
+
+  if (stored_blocks * 100 <=
+      dense_blocks * EI_TFLITE_FC_BLOCK_SPARSE_MAX_DENSITY) {
+    data->block_sparse_weights = weights;
+    return kTfLiteOk;
+  }
+
+  // Too dense for the index lookups to pay off, expand once and let the dense
+  // kernel run on it.
+  int8_t* unpacked = static_cast<int8_t*>(context->AllocatePersistentBuffer(
+      context, output_depth * accum_depth));
+  TF_LITE_ENSURE(context, unpacked != nullptr);
+
+  memset(unpacked, 0, output_depth * accum_depth);
+  for (int row = 0; row < output_depth; ++row) {
+    for (int block = weights->row_ptr[row]; block < weights->row_ptr[row + 1];
+         ++block) {
+      const int col = weights->block_col[block];
+      memcpy(&unpacked[row * accum_depth + col],
+             &weights->values[block * block_size],
+             std::min(block_size, accum_depth - col));
+    }
+  }
+  data->block_sparse_unpacked = unpacked;
+
+  return kTfLiteOk;
+}
+
+void FullyConnectedBlockSparseInt8(
+    const FullyConnectedParams& params,
+    const TfLiteFullyConnectedBlockSparseWeights& weights, int batches,
+    int output_depth, int accum_depth, const int8_t* input_data,
+    const int32_t* bias_data, int8_t* output_data) {
+  const int32_t input_offset = params.input_offset;
+  const int32_t output_offset = params.output_offset;
+  const int32_t output_multiplier = params.output_multiplier;
+  const int output_shift = params.output_shift;
+  const int32_t output_activation_min = params.quantized_activation_min;
+  const int32_t output_activation_max = params.quantized_activation_max;
+  const int block_size = kTfLiteFullyConnectedBlockSparseSize;
+
+#if EI_CLASSIFIER_TFLITE_ENABLE_CMSIS_NN == 1 && defined(ARM_MATH_DSP)
+  const uint32_t input_offset_s16x2 =
+      ((uint32_t)input_offset << 16) | ((uint32_t)input_offset & 0xFFFF);
+#endif
+
+  for (int b = 0; b < batches; ++b) {
+    const int8_t* input = input_data + b * accum_depth;
+
+    for (int out_c = 0; out_c < output_depth; ++out_c) {
+      int32_t acc = 0;
+
+      for (int block = weights.row_ptr[out_c];
+           block < weights.row_ptr[out_c + 1]; ++block) {
+        const int col = weights.block_col[block];
+        const int8_t* in = input + col;
+        const int8_t* w = weights.values + block * block_size;
+
+        if (col + block_size > accum_depth) {
+          // last block of the row is zero padded past accum_depth
+          for (int d = 0; d < accum_depth - col; ++d) {
+            acc += (in[d] + input_offset) * w[d];
+          }
+          continue;
+        }
+
+#if EI_CLASSIFIER_TFLITE_ENABLE_CMSIS_NN == 1 && defined(ARM_MATH_DSP)
+        const int32_t in_s8x4 = arm_nn_read_q7x4(in);
+        const int32_t w_s8x4 = arm_nn_read_q7x4(w);
+        const int32_t in_even = __SXTAB16(input_offset_s16x2, in_s8x4);
+        const int32_t in_odd =
+            __SXTAB16(input_offset_s16x2, __ROR((uint32_t)in_s8x4, 8));
+        const int32_t w_even = __SXTB16(w_s8x4);
+        const int32_t w_odd = __SXTB16(__ROR((uint32_t)w_s8x4, 8));
+        acc = __SMLAD(in_even, w_even, acc);
+        acc = __SMLAD(in_odd, w_odd, acc);
+#else
+        acc += (in[0] + input_offset) * w[0];
+        acc += (in[1] + input_offset) * w[1];
+        acc += (in[2] + input_offset) * w[2];
+        acc += (in[3] + input_offset) * w[3];
+#endif
+      }
+
+      if (bias_data) {
+        acc += bias_data[out_c];
+      }
+      acc = MultiplyByQuantizedMultiplier(acc, output_multiplier, output_shift);
+      acc += output_offset;
+      acc = std::max(acc, output_activation_min);
+      acc = std::min(acc, output_activation_max);
+      output_data[b * output_depth + out_c] = static_cast<int8_t>(acc);
+    }
+  }
+}
+
+TfLiteStatus EvalFullyConnectedBlockSparseInt8(
+    const OpDataFullyConnected& data, const TfLiteEvalTensor* input,
+    const TfLiteEvalTensor* filter, const TfLiteEvalTensor* bias,
+    TfLiteEvalTensor* output) {
+  const RuntimeShape output_shape = micro::GetTensorShape(output);
+  const RuntimeShape filter_shape = micro::GetTensorShape(filter);
+  const int output_dim_count = output_shape.DimensionsCount();
+
+  FullyConnectedBlockSparseInt8(
+      FullyConnectedParamsQuantized(data), *data.block_sparse_weights,
+      FlatSizeSkipDim(output_shape, output_dim_count - 1),
+      output_shape.Dims(output_dim_count - 1),
+      filter_shape.Dims(filter_shape.DimensionsCount() - 1),
+      micro::GetTensorData<int8_t>(input),
+      micro::GetOptionalTensorData<int32_t>(bias),
+      micro::GetTensorData<int8_t>(output));
+
+  return kTfLiteOk;
+}
+
 }  // namespace tflite
@@ -46,6 +46,7 @@
 #include "edge-impulse-sdk/classifier/ei_model_types.h"
 #include "edge-impulse-sdk/classifier/inferencing_engines/engines.h"
 #include "edge-impulse-sdk/classifier/postprocessing/ei_postprocessing_common.h"
+#include "edge-impulse-sdk/classifier/ei_static_pipeline.h"
 
 const char* ei_classifier_inferencing_categories_43_1[] = { "idle", "snake", "updown", "wave" };
 
@@ -77,7 +78,11 @@ ei_model_dsp_t ei_dsp_blocks_43_1[ei_dsp_blocks_43_1_size] = {
     { // DSP block 2
         2,
         33, // output size
+#if EI_CLASSIFIER_STATIC_PIPELINE == 1
+        &extract_spectral_analysis_features_static<spectral::analysis_fft, 2, spectral::filter_none>, // DSP function pointer
+#else
         &extract_spectral_analysis_features, // DSP function pointer
+#endif // EI_CLASSIFIER_STATIC_PIPELINE == 1
         (void*)&ei_dsp_config_43_2, // pointer to config struct
         ei_dsp_config_43_2_axes, // array of offsets into the input stream, one for each axis
         ei_dsp_config_43_2_axes_size, // number of axes
@@ -212,8 +217,23 @@ const ei_impulse_t impulse_43_1 = {
 
 ei_impulse_handle_t impulse_handle_43_1 = ei_impulse_handle_t( &impulse_43_1 );
 
+#if EI_CLASSIFIER_STATIC_PIPELINE == 1
+typedef ei_static_pipeline<
+    ei_static_dsp_blocks<
+        ei_static_dsp_block<0, 33, true, &extract_spectral_analysis_features_static<spectral::analysis_fft, 2, spectral::filter_none>>
+    >,
+    ei_static_learning_blocks<
+        ei_static_learning_block<0, &run_nn_inference>,
+        ei_static_learning_block<1, &run_kmeans_anomaly>
+    >
+> ei_static_pipeline_43_1_t;
+#endif // EI_CLASSIFIER_STATIC_PIPELINE == 1
+
 ei_impulse_handle_t& ei_default_impulse = impulse_handle_43_1;
 constexpr auto& ei_classifier_inferencing_categories = ei_classifier_inferencing_categories_43_1;
 const auto ei_dsp_blocks_size = ei_dsp_blocks_43_1_size;
 ei_model_dsp_t *ei_dsp_blocks = ei_dsp_blocks_43_1;
+#if EI_CLASSIFIER_STATIC_PIPELINE == 1
+typedef ei_static_pipeline_43_1_t ei_static_pipeline_t;
+#endif // EI_CLASSIFIER_STATIC_PIPELINE == 1
 #endif // _EI_CLASSIFIER_MODEL_VARIABLES_H_
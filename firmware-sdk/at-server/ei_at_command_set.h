@@ -44,7 +44,7 @@
  * If you are adding or modifying OPTIONAL commands,
  * just upgrade the release version.
  */
-#define AT_COMMAND_VERSION "1.8.0"
+#define AT_COMMAND_VERSION "1.8.3"
 
 /*************************************************************************************************/
 /* Required commands by Edge Impulse CLI Tools        */
@@ -126,6 +126,15 @@
 #define AT_BOOTMODE_HELP_TEXT       "Jump to bootloader"
 #define AT_INFO                     "INFO"
 #define AT_INFO_HELP_TEXT           "Prints details about compiled firmware and ML model"
+#define AT_MACHINEMODE              "MACHINEMODE"
+#define AT_MACHINEMODE_ARGS         "ENABLE"
+#define AT_MACHINEMODE_HELP_TEXT    "Lists or sets machine mode: no echo, requests as [ID:]AT+CMD, each one ends with ID:OK, ID:ERROR or ID:STARTED (completed later by ID:OK)"
+#define AT_RESULTFORMAT             "RESULTFORMAT"
+#define AT_RESULTFORMAT_ARGS        "FORMAT"
+#define AT_RESULTFORMAT_HELP_TEXT   "Lists or sets the inference result format: TEXT, BIN8 or BIN16 (binary frames with int8 or float16 scores)"
+#define AT_REPORTMODE               "REPORTMODE"
+#define AT_REPORTMODE_ARGS          "MODE,[THRESHOLD],[HYSTERESIS],[WINDOWS]"
+#define AT_REPORTMODE_HELP_TEXT     "Lists or sets which results are reported: ALL, ONCHANGE (top class changed), THRESHOLD (class events) or SUMMARY (class counts every WINDOWS results)"
 
 /*************************************************************************************************/
 /* HELP is not necessary as it is built-in into ATServer and
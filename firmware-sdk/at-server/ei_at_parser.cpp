@@ -33,83 +33,81 @@
  */
 
 #include "ei_at_parser.h"
-
-using namespace std;
+#include <cstring>
 
 void ATParser::init_result(void)
 {
     last_result.type = AT_UNKNOWN;
-    last_result.command.clear();
-    last_result.arguments.clear();
-    last_result.max_arg_len = 0;
+    last_result.command = "";
+    last_result.argument_count = 0;
 }
 
-const ATParseResult_t &ATParser::parse(string input)
+/**
+ * @brief Split an AT command in place, the line is cut with null terminators
+ * so the command and the arguments can be used without copying them.
+ *
+ * @param input null terminated line, modified unless the result is AT_UNKNOWN
+ */
+const ATParseResult_t &ATParser::parse(char *input)
 {
-    string tmp;
-    size_t pos = string::npos;
-    size_t delim1 = string::npos;
-    size_t delim2 = string::npos;
+    char *pos;
+    char *end;
 
     this->init_result();
 
-    if (input.size() == 0) {
-        last_result.type = AT_UNKNOWN;
+    if (input == nullptr) {
         return last_result;
     }
 
     // trim leading whitespaces
-    input = input.substr(input.find_first_not_of(" \t"));
+    input += strspn(input, " \t");
 
-    if (input.rfind("AT+", 0) != 0) {
+    if (strncmp(input, "AT+", 3) != 0) {
         last_result.type = AT_UNKNOWN;
         return last_result;
     }
 
     //remove "AT+"
-    input = input.substr(3);
+    input += 3;
 
     // trim spaces, newline and CR at the end
-    input = input.erase(input.find_last_not_of(" \r\n") + 1);
+    end = input + strlen(input);
+    while (end > input && (end[-1] == ' ' || end[-1] == '\r' || end[-1] == '\n')) {
+        end--;
+    }
+    *end = '\0';
 
     // extract command itself
-    pos = input.find_first_of("?=");
-    last_result.command = input.substr(0, pos);
+    pos = strpbrk(input, "?=");
+    last_result.command = input;
 
-    if (pos == string::npos) {
+    if (pos == nullptr) {
         last_result.type = AT_RUN;
+        return last_result;
     }
-    else if (input.at(pos) == '=') {
-        last_result.type = AT_WRITE;
-    }
-    else if (input.at(pos) == '?') {
-        last_result.type = AT_READ;
-    }
-    else {
-        last_result.type = AT_UNKNOWN;
+
+    last_result.type = (*pos == '=') ? AT_WRITE : AT_READ;
+    *pos = '\0';
+
+    if (last_result.type != AT_WRITE) {
+        return last_result;
     }
 
-    // check if command has arguments and extract them
-    if (pos != string::npos && input.at(pos) == '=') {
-        delim1 = pos;
-        delim2 = input.find_first_of(",", pos);
-        // we have arguments, let's extract them
-        while (delim2 != string::npos) {
-            //TODO: support args in a quote
-            tmp = string(input, delim1 + 1, delim2 - delim1 - 1);
-            last_result.arguments.push_back(tmp);
-            if (tmp.size() > last_result.max_arg_len) {
-                last_result.max_arg_len = tmp.size();
-            }
-            delim1 = delim2;
-            delim2 = input.find_first_of(",", delim1 + 1);
+    // split arguments on commas, there's always at least one (maybe empty) argument
+    //TODO: support args in a quote
+    char *arg = pos + 1;
+    while (true) {
+        if (last_result.argument_count < AT_MAX_ARGUMENTS) {
+            last_result.arguments[last_result.argument_count] = arg;
         }
-        //there is one more argument, behind last comma so, get it until end of command
-        tmp = string(input, delim1 + 1);
-        last_result.arguments.push_back(tmp);
-        if (tmp.size() > last_result.max_arg_len) {
-            last_result.max_arg_len = tmp.size();
+        last_result.argument_count++;
+
+        pos = strchr(arg, ',');
+        if (pos == nullptr) {
+            break;
         }
+        *pos = '\0';
+        arg = pos + 1;
     }
 
     return last_result;
@@ -34,8 +34,11 @@
 
 #ifndef AT_PARSER_H
 #define AT_PARSER_H
-#include <string>
-#include <vector>
+#include <cstddef>
+
+#ifndef AT_MAX_ARGUMENTS
+#define AT_MAX_ARGUMENTS 16
+#endif
 
 enum ATCommandType_t
 {
@@ -45,11 +48,15 @@ enum ATCommandType_t
     AT_UNKNOWN
 };
 
+/**
+ * Command and arguments point into the parsed line
+ */
 typedef struct {
     ATCommandType_t type;
-    std::string command;
-    std::vector<std::string> arguments;
-    unsigned int max_arg_len;
+    const char *command;
+    const char *arguments[AT_MAX_ARGUMENTS];
+    // can be more than AT_MAX_ARGUMENTS, only the first ones are stored
+    int argument_count;
 } ATParseResult_t;
 
 class ATParser {
@@ -60,7 +67,7 @@ private:
 public:
     ATParser() {};
     ~ATParser() {};
-    const ATParseResult_t &parse(std::string command);
+    const ATParseResult_t &parse(char *command);
 };
 
-#endif /* AT_PARSER_H */
\ No newline at end of file
+#endif /* AT_PARSER_H */
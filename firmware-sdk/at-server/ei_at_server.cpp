@@ -39,6 +39,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <functional>
 #include <vector>
 
@@ -53,12 +54,20 @@ static bool print_help_handler(void)
 
 ATServer::ATServer()
     : history(default_history_size)
+    , machine_mode(false)
+    , machine_line_overflow(false)
+    , command_failed(false)
+    , pending_count(0)
 {
     register_default_commands();
 }
 
 ATServer::ATServer(ATCommand_t *commands, size_t length, size_t max_history_size)
     : history(max_history_size)
+    , machine_mode(false)
+    , machine_line_overflow(false)
+    , command_failed(false)
+    , pending_count(0)
 {
     if (length == 0 || commands == nullptr) {
         register_default_commands();
@@ -95,6 +104,63 @@ void ATServer::register_default_commands(void)
     tmp.run_handler = at_info;
 
     this->registered_commands.push_back(tmp);
+
+    tmp.command = AT_MACHINEMODE;
+    tmp.help_text = AT_MACHINEMODE_HELP_TEXT;
+    tmp.run_handler = nullptr;
+    tmp.read_handler = [this](void) { return this->print_machine_mode(); };
+    tmp.write_handler = [this](const char **argv, const int argc) { return this->set_machine_mode(argv, argc); };
+    tmp.write_handler_args_list = string(AT_MACHINEMODE_ARGS);
+
+    this->registered_commands.push_back(tmp);
+
+    this->index_commands();
+}
+
+/**
+ * @brief Sort command_index by command name, called on every registration
+ */
+void ATServer::index_commands(void)
+{
+    this->command_index.resize(this->registered_commands.size());
+    for (size_t i = 0; i < this->command_index.size(); i++) {
+        this->command_index[i] = i;
+    }
+
+    // stable, so with duplicates the first registered one is found (as with a linear search)
+    std::stable_sort(this->command_index.begin(), this->command_index.end(), [this](size_t a, size_t b) {
+        return this->registered_commands[a].command < this->registered_commands[b].command;
+    });
+}
+
+/**
+ * @brief Binary search for a command in command_index
+ *
+ * @return nullptr if not registered
+ */
+ATCommand_t *ATServer::find_command(const char *command)
+{
+    size_t low = 0;
+    size_t high = this->command_index.size();
+
+    // first entry that is not less than command
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (strcmp(this->registered_commands[this->command_index[mid]].command.c_str(), command) < 0) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    if (low == this->command_index.size()) {
+        return nullptr;
+    }
+
+    ATCommand_t *cmd = &this->registered_commands[this->command_index[low]];
+    return (strcmp(cmd->command.c_str(), command) == 0) ? cmd : nullptr;
 }
 
 /**
@@ -107,8 +173,8 @@ void ATServer::register_default_commands(void)
  */
 bool ATServer::register_command(ATCommand_t &command)
 {
-    // we can't register user version of the AT+HELP command
-    if (command.command == AT_HELP) {
+    // we can't register user version of the AT+HELP and AT+MACHINEMODE commands
+    if (command.command == AT_HELP || command.command == AT_MACHINEMODE) {
         return false;
     }
 
@@ -123,6 +189,7 @@ bool ATServer::register_command(ATCommand_t &command)
     }
 
     this->registered_commands.push_back(command);
+    this->index_commands();
 
     return true;
 }
@@ -156,21 +223,22 @@ bool ATServer::register_handlers(
     bool (*write_handler)(const char **, const int),
     const char *write_handler_args_list)
 {
-    for (auto it = registered_commands.begin(); it != registered_commands.end(); ++it) {
-        if (it->command.compare(cmd) == 0) {
-            //TODO: add sanity checks?
-            it->run_handler = run_handler;
-            it->read_handler = read_handler;
-            it->write_handler = write_handler;
-            //TODO: parse write_handler_args_list and update write_handler_arg_count
-            if (write_handler_args_list != nullptr) {
-                it->write_handler_args_list = string(write_handler_args_list);
-            }
-            return true;
-        }
+    ATCommand_t *it = this->find_command(cmd);
+
+    if (it == nullptr) {
+        return false;
+    }
+
+    //TODO: add sanity checks?
+    it->run_handler = run_handler;
+    it->read_handler = read_handler;
+    it->write_handler = write_handler;
+    //TODO: parse write_handler_args_list and update write_handler_arg_count
+    if (write_handler_args_list != nullptr) {
+        it->write_handler_args_list = string(write_handler_args_list);
     }
 
-    return false;
+    return true;
 }
 
 bool ATServer::print_help(void)
@@ -218,11 +286,165 @@ bool ATServer::print_help(void)
     return true;
 }
 
+bool ATServer::print_machine_mode(void)
+{
+    ei_printf("%d\n", this->machine_mode ? 1 : 0);
+
+    return true;
+}
+
+bool ATServer::set_machine_mode(const char **argv, const int argc)
+{
+    if (argc < 1) {
+        ei_printf("Missing argument! Required: " AT_MACHINEMODE_ARGS "\n");
+        return true;
+    }
+
+    bool was_machine_mode = this->machine_mode;
+
+    this->machine_mode = (atoi(argv[0]) != 0);
+    this->machine_line.clear();
+    this->machine_line.reserve(AT_MACHINE_MAX_LINE);
+    this->machine_line_overflow = false;
+    this->pending_count = 0;
+
+    // entering from the interactive mode: the host syncs on this, there's no prompt
+    if (this->machine_mode && !was_machine_mode) {
+        ei_printf("OK\n");
+    }
+
+    return true;
+}
+
+/**
+ * @brief Command finished and ready for the next one. In machine mode there's no
+ * prompt, instead the oldest async command is reported as finished.
+ */
 void ATServer::print_prompt(void)
 {
+    if (this->machine_mode) {
+        this->complete_async_command();
+        return;
+    }
+
     ei_printf("> ");
 }
 
+/**
+ * @brief Mark the running command as failed, for handlers that return (true) after an
+ * error: machine mode then ends the request with ID:ERROR instead of ID:OK
+ */
+void ATServer::fail_command(void)
+{
+    this->command_failed = true;
+}
+
+/**
+ * @brief Report the oldest async command as finished (ID:OK, or ID:ERROR if it failed),
+ * for handlers that stop one (eg. AT+STOPIMPULSE). Does nothing in the interactive mode,
+ * where the prompt is enough.
+ */
+void ATServer::complete_async_command(bool success)
+{
+    if (!this->machine_mode || this->pending_count == 0) {
+        return;
+    }
+
+    ei_printf("%s:%s\n", this->pending_ids[0], success ? "OK" : "ERROR");
+    this->pending_count--;
+    memmove(this->pending_ids[0], this->pending_ids[1], this->pending_count * sizeof(this->pending_ids[0]));
+}
+
+/**
+ * @brief Machine mode input: no echo or line editing, \r and/or \n ends the request
+ */
+void ATServer::handle_machine(char c)
+{
+    if (c == '\r' || c == '\n') {
+        // empty lines (also from \r\n) are ignored
+        if (!this->machine_line.empty() || this->machine_line_overflow) {
+            this->execute_machine_line();
+        }
+        // clear() keeps the capacity, no allocation per request
+        this->machine_line.clear();
+        this->machine_line_overflow = false;
+        return;
+    }
+
+    if (c < 0x20 || c > 0x7e) {
+        return;
+    }
+
+    if (this->machine_line.size() < AT_MACHINE_MAX_LINE) {
+        this->machine_line.push_back(c);
+    }
+    else {
+        this->machine_line_overflow = true;
+    }
+}
+
+/**
+ * @brief Run a [ID:]AT+CMD request and tag its end with the ID: ID:OK, ID:ERROR, or ID:STARTED
+ * for an async command (followed by ID:OK when it finishes). Handler output isn't tagged,
+ * everything between two status lines belongs to the request of the second one, except
+ * the output of async commands which streams in between.
+ */
+void ATServer::execute_machine_line(void)
+{
+    char *line = &this->machine_line[0];
+    char id[AT_MACHINE_MAX_ID + 1] = "";
+    ATExecStatus_t status;
+
+    // the ID is everything before a ':' that comes before "AT+"
+    char *colon = strchr(line, ':');
+    char *at = strstr(line, "AT+");
+    if (colon != nullptr && (at == nullptr || colon < at)) {
+        size_t id_len = colon - line;
+
+        if (id_len > AT_MACHINE_MAX_ID) {
+            // nothing runs, the status line carries the ID cut to AT_MACHINE_MAX_ID
+            memcpy(id, line, AT_MACHINE_MAX_ID);
+            id[AT_MACHINE_MAX_ID] = '\0';
+            ei_printf("ID too long (max %d)\n%s:ERROR\n", AT_MACHINE_MAX_ID, id);
+            return;
+        }
+        memcpy(id, line, id_len);
+        id[id_len] = '\0';
+        line = colon + 1;
+    }
+
+    if (this->machine_line_overflow) {
+        ei_printf("Request too long (max %d)\n", AT_MACHINE_MAX_LINE);
+        status = AT_EXEC_ERROR;
+    }
+    else {
+        status = this->run_command(line);
+    }
+
+    switch (status) {
+    case AT_EXEC_DONE:
+        ei_printf("%s:OK\n", id);
+        break;
+    case AT_EXEC_ASYNC:
+        // only happens if async commands are never stopped, forget the oldest one
+        if (this->pending_count == AT_MACHINE_MAX_PENDING) {
+            this->pending_count--;
+            memmove(this->pending_ids[0], this->pending_ids[1], this->pending_count * sizeof(this->pending_ids[0]));
+        }
+        strcpy(this->pending_ids[this->pending_count++], id);
+        ei_printf("%s:STARTED\n", id);
+        break;
+    default:
+        ei_printf("%s:ERROR\n", id);
+        break;
+    }
+
+    // left with AT+MACHINEMODE=0
+    if (!this->machine_mode) {
+        this->print_prompt();
+    }
+}
+
 void ATServer::handle(char c)
 {
     string tmp;
@@ -230,6 +452,11 @@ void ATServer::handle(char c)
     static bool in_ctrl_char = false;
     static vector<char> control_sequence;
 
+    if (this->machine_mode) {
+        this->handle_machine(c);
+        return;
+    }
+
     // control characters start with 0x1b and end with a-zA-Z
     // typically \x1b[<LETTER> eg. \x1b[A
     if (in_ctrl_char) {
@@ -394,60 +621,63 @@ void ATServer::handle(char c)
 
 bool ATServer::execute(string &input)
 {
-    bool new_prompt_required = false;
-    char **args = nullptr;
-    ATParseResult_t res;
+    return this->run_command(&input[0]) != AT_EXEC_ASYNC;
+}
+
+/**
+ * @brief Parse (in place) and run a command
+ *
+ * @return AT_EXEC_ASYNC if the handler is still running (returned false),
+ *         AT_EXEC_ERROR if it called fail_command()
+ */
+ATExecStatus_t ATServer::run_command(char *input)
+{
+    const ATParseResult_t &res = parser.parse(input);
 
-    res = parser.parse(input);
     if (res.type == AT_UNKNOWN) {
-        ei_printf("Not a valid AT command (%s)\n", input.c_str());
-        return true;
+        ei_printf("Not a valid AT command (%s)\n", input);
+        return AT_EXEC_ERROR;
     }
 
     // exception for HELP command which is built-in
-    if (res.command == AT_HELP && res.type == AT_RUN) {
-        return this->print_help();
+    if (res.type == AT_RUN && strcmp(res.command, AT_HELP) == 0) {
+        this->print_help();
+        return AT_EXEC_DONE;
     }
 
     // find a command to execute
-    for (auto it = this->registered_commands.begin(); it != this->registered_commands.end(); ++it) {
-        if (it->command == res.command) {
-            // we've got a hit!
-            if (res.type == AT_RUN && it->run_handler) {
-                // simple command like AT+HELP
-                new_prompt_required = it->run_handler();
-            }
-            else if (res.type == AT_READ && it->read_handler) {
-                // read command like AT+CONFIG?
-                new_prompt_required = it->read_handler();
-            }
-            else if (res.type == AT_WRITE && it->write_handler) {
-                // write command like AT+DEVICEID=abcde
-                args = (char **)ei_malloc(res.arguments.size() * sizeof(char *));
-                for (unsigned int i = 0; i < res.arguments.size(); i++) {
-                    // one more byte for null terminator (in case of zero-length = empty argument eg. AT+RUN=123,,5)
-                    args[i] = (char *)ei_malloc(res.max_arg_len + 1);
-                    strncpy(args[i], res.arguments.at(i).c_str(), res.max_arg_len + 1);
-                }
-
-                new_prompt_required =
-                    it->write_handler((const char **)args, (int)res.arguments.size());
+    ATCommand_t *it = this->find_command(res.command);
+    if (it == nullptr) {
+        ei_printf("Command not found! (AT+%s)\n", res.command);
+        return AT_EXEC_ERROR;
+    }
 
-                // now we are freeing the memory
-                for (unsigned int i = 0; i < res.arguments.size(); i++) {
-                    ei_free(args[i]);
-                }
-                ei_free(args);
-            }
-            else {
-                ei_printf("No handler for command! (%s)\n", input.c_str());
-                return true;
-            }
-            return new_prompt_required;
+    bool done;
+    this->command_failed = false;
+    if (res.type == AT_RUN && it->run_handler) {
+        // simple command like AT+HELP
+        done = it->run_handler();
+    }
+    else if (res.type == AT_READ && it->read_handler) {
+        // read command like AT+CONFIG?
+        done = it->read_handler();
+    }
+    else if (res.type == AT_WRITE && it->write_handler) {
+        // write command like AT+DEVICEID=abcde, arguments point into the input line
+        if (res.argument_count > AT_MAX_ARGUMENTS) {
+            ei_printf("Too many arguments for AT+%s (max %d)\n", res.command, AT_MAX_ARGUMENTS);
+            return AT_EXEC_ERROR;
         }
+        done = it->write_handler((const char **)res.arguments, res.argument_count);
+    }
+    else {
+        ei_printf("No handler for command! (AT+%s)\n", res.command);
+        return AT_EXEC_ERROR;
     }
 
-    // we shouldn't be here!
-    ei_printf("Command not found! (AT+%s)\n", res.command.c_str());
-    return true;
+    if (!done) {
+        return AT_EXEC_ASYNC;
+    }
+
+    return this->command_failed ? AT_EXEC_ERROR : AT_EXEC_DONE;
 }
@@ -47,6 +47,23 @@ typedef std::function<bool(const char **, const int)> ATWriteHandler_t;
 
 const size_t default_history_size = 10;
 
+/* Machine mode: longest request line, ID and number of running async commands */
+#ifndef AT_MACHINE_MAX_LINE
+#define AT_MACHINE_MAX_LINE 512
+#endif
+#ifndef AT_MACHINE_MAX_ID
+#define AT_MACHINE_MAX_ID 16
+#endif
+#ifndef AT_MACHINE_MAX_PENDING
+#define AT_MACHINE_MAX_PENDING 4
+#endif
+
+typedef enum {
+    AT_EXEC_DONE,   // handler finished (or failed after printing its own message)
+    AT_EXEC_ASYNC,  // handler still running, it ends with print_prompt()
+    AT_EXEC_ERROR   // not a valid command (nothing has been run), or the handler called fail_command()
+} ATExecStatus_t;
+
 typedef struct {
     std::string command;
     std::string help_text;
@@ -60,9 +77,23 @@ class ATServer {
 private:
     ATHistory history;
     std::vector<ATCommand_t> registered_commands;
+    // registered_commands sorted by command, for the lookup (help keeps the registration order)
+    std::vector<size_t> command_index;
     LineBuffer buffer;
     ATParser parser;
+    bool machine_mode;
+    std::string machine_line;
+    bool machine_line_overflow;
+    bool command_failed;
+    // IDs of the async commands, oldest first
+    char pending_ids[AT_MACHINE_MAX_PENDING][AT_MACHINE_MAX_ID + 1];
+    size_t pending_count;
     void register_default_commands(void);
+    void index_commands(void);
+    ATCommand_t *find_command(const char *command);
+    ATExecStatus_t run_command(char *input);
+    void handle_machine(char c);
+    void execute_machine_line(void);
 
 protected:
     ATServer();
@@ -70,6 +101,8 @@ protected:
     ~ATServer();
     bool print_help(void);
     bool execute(std::string &command);
+    bool set_machine_mode(const char **argv, const int argc);
+    bool print_machine_mode(void);
 
 public:
     ATServer(ATServer &other) = delete;
@@ -86,6 +119,9 @@ public:
 
     void handle(char c);
     void print_prompt(void);
+    void fail_command(void);
+    void complete_async_command(bool success = true);
+    bool is_machine_mode(void) { return machine_mode; }
 
     bool register_command(ATCommand_t &command);
     bool register_command(
@@ -82,6 +82,41 @@ public:
             return false;
         }
 
+    /**
+     * @brief Optional. Call to driver to return a band of rows of the current frame,
+     * so snapshots can be taken without a full framebuffer. Same pixel format
+     * as ei_camera_capture_rgb888_packed_big_endian / _grayscale_, at the
+     * resolution passed to init() or set_resolution().
+     * A frame is read top to bottom in consecutive bands, first_row == 0
+     * starts a new capture.
+     *
+     * @param rows Output buffer, row_count * width * bytes per pixel
+     * @param first_row First row of the band
+     * @param row_count Number of rows in the band
+     * @param grayscale Return grayscale instead of RGB888 pixels
+     * @return true If successful
+     * @return false If not successful
+     */
+    virtual bool ei_camera_capture_rows_packed_big_endian(
+        uint8_t *rows,
+        uint32_t first_row,
+        uint32_t row_count,
+        bool grayscale)
+        {
+            // virtual. Only needed if supports_row_capture() returns true
+            return false;
+        }
+
+    /**
+     * @brief Check if ei_camera_capture_rows_packed_big_endian is implemented
+     *
+     * @return true if the driver can return a frame in bands
+     */
+    virtual bool supports_row_capture(void)
+    {
+        return false;
+    }
+
     /**
      * @brief Get the min resolution supported by camera
      *
@@ -96,6 +96,27 @@ typedef struct {
     uint32_t magic;
 } EiConfig;
 
+/**
+ * Keys of the config log records (see EiDeviceMemory::load_config_log)
+ */
+typedef enum {
+    EI_CONFIG_KEY_WIFI_SSID = 1,
+    EI_CONFIG_KEY_WIFI_PASSWORD,
+    EI_CONFIG_KEY_WIFI_SECURITY,
+    EI_CONFIG_KEY_SAMPLE_INTERVAL_MS,
+    EI_CONFIG_KEY_SAMPLE_LENGTH_MS,
+    EI_CONFIG_KEY_SENSOR_LABEL,
+    EI_CONFIG_KEY_SAMPLE_LABEL,
+    EI_CONFIG_KEY_SAMPLE_HMAC_KEY,
+    EI_CONFIG_KEY_UPLOAD_HOST,
+    EI_CONFIG_KEY_UPLOAD_PATH,
+    EI_CONFIG_KEY_UPLOAD_API_KEY,
+    EI_CONFIG_KEY_MGMT_URL,
+    EI_CONFIG_KEY_LONG_RECORDING_LENGTH_MS,
+    EI_CONFIG_KEY_LONG_RECORDING_INTERVAL_MS,
+    EI_CONFIG_KEY_LAST = EI_CONFIG_KEY_LONG_RECORDING_INTERVAL_MS
+} ei_config_key_t;
+
 typedef enum
 {
     eiStateIdle = 0,
@@ -132,50 +153,173 @@ protected:
 
 #if MULTI_FREQ_ENABLED == 1
     uint8_t fusioning;
-    uint32_t sample_interval;
 #endif
 
     EiDeviceMemory *memory;
 
+    // CRC of the value of each key in the config log, valid if its bit in config_saved is set
+    uint32_t config_crc[EI_CONFIG_KEY_LAST + 1];
+    uint32_t config_saved = 0;
+
+    /**
+     * @brief Value of a config key as it's stored, strings are cut at their size in EiConfig
+     */
+    void get_config_value(uint8_t key, const uint8_t **data, uint16_t *length)
+    {
+        const std::string *str = nullptr;
+        uint16_t max_length = 128;
+
+        switch (key) {
+            case EI_CONFIG_KEY_WIFI_SSID: str = &wifi_ssid; break;
+            case EI_CONFIG_KEY_WIFI_PASSWORD: str = &wifi_password; break;
+            case EI_CONFIG_KEY_SENSOR_LABEL: str = &sensor_label; max_length = 64; break;
+            case EI_CONFIG_KEY_SAMPLE_LABEL: str = &sample_label; break;
+            case EI_CONFIG_KEY_SAMPLE_HMAC_KEY: str = &sample_hmac_key; max_length = 33; break;
+            case EI_CONFIG_KEY_UPLOAD_HOST: str = &upload_host; break;
+            case EI_CONFIG_KEY_UPLOAD_PATH: str = &upload_path; break;
+            case EI_CONFIG_KEY_UPLOAD_API_KEY: str = &upload_api_key; break;
+            case EI_CONFIG_KEY_MGMT_URL: str = &management_url; break;
+            case EI_CONFIG_KEY_WIFI_SECURITY:
+                *data = (const uint8_t *)&wifi_security;
+                *length = sizeof(wifi_security);
+                return;
+            case EI_CONFIG_KEY_SAMPLE_INTERVAL_MS:
+                *data = (const uint8_t *)&sample_interval_ms;
+                *length = sizeof(sample_interval_ms);
+                return;
+            case EI_CONFIG_KEY_SAMPLE_LENGTH_MS:
+                *data = (const uint8_t *)&sample_length_ms;
+                *length = sizeof(sample_length_ms);
+                return;
+            case EI_CONFIG_KEY_LONG_RECORDING_LENGTH_MS:
+                *data = (const uint8_t *)&long_recording_length_ms;
+                *length = sizeof(long_recording_length_ms);
+                return;
+            case EI_CONFIG_KEY_LONG_RECORDING_INTERVAL_MS:
+                *data = (const uint8_t *)&long_recording_interval_ms;
+                *length = sizeof(long_recording_interval_ms);
+                return;
+            default:
+                *data = nullptr;
+                *length = 0;
+                return;
+        }
+
+        *data = (const uint8_t *)str->c_str();
+        *length = (str->size() > max_length) ? max_length : str->size();
+    }
+
+    void set_config_value(uint8_t key, const uint8_t *data, uint16_t length)
+    {
+        std::string *str = nullptr;
+        void *value = nullptr;
+        size_t value_size = 0;
+
+        switch (key) {
+            case EI_CONFIG_KEY_WIFI_SSID: str = &wifi_ssid; break;
+            case EI_CONFIG_KEY_WIFI_PASSWORD: str = &wifi_password; break;
+            case EI_CONFIG_KEY_SENSOR_LABEL: str = &sensor_label; break;
+            case EI_CONFIG_KEY_SAMPLE_LABEL: str = &sample_label; break;
+            case EI_CONFIG_KEY_SAMPLE_HMAC_KEY: str = &sample_hmac_key; break;
+            case EI_CONFIG_KEY_UPLOAD_HOST: str = &upload_host; break;
+            case EI_CONFIG_KEY_UPLOAD_PATH: str = &upload_path; break;
+            case EI_CONFIG_KEY_UPLOAD_API_KEY: str = &upload_api_key; break;
+            case EI_CONFIG_KEY_MGMT_URL: str = &management_url; break;
+            case EI_CONFIG_KEY_WIFI_SECURITY: value = &wifi_security; value_size = sizeof(wifi_security); break;
+            case EI_CONFIG_KEY_SAMPLE_INTERVAL_MS: value = &sample_interval_ms; value_size = sizeof(sample_interval_ms); break;
+            case EI_CONFIG_KEY_SAMPLE_LENGTH_MS: value = &sample_length_ms; value_size = sizeof(sample_length_ms); break;
+            case EI_CONFIG_KEY_LONG_RECORDING_LENGTH_MS: value = &long_recording_length_ms; value_size = sizeof(long_recording_length_ms); break;
+            case EI_CONFIG_KEY_LONG_RECORDING_INTERVAL_MS: value = &long_recording_interval_ms; value_size = sizeof(long_recording_interval_ms); break;
+            default:
+                // unknown key (newer firmware), skip it
+                return;
+        }
+
+        if (str) {
+            str->assign((const char *)data, length);
+        }
+        else if (length == value_size) {
+            memcpy(value, data, value_size);
+        }
+        else {
+            return;
+        }
+
+        config_crc[key] = EiDeviceMemory::crc32(data, length);
+        config_saved |= (1u << key);
+    }
+
+    static void load_config_record(void *ctx, uint8_t key, const uint8_t *data, uint16_t length)
+    {
+        static_cast<EiDeviceInfo *>(ctx)->set_config_value(key, data, length);
+    }
+
+    /**
+     * @brief Write all values to a new config log, when the current one is full
+     */
+    bool compact_config(void)
+    {
+        config_saved = 0;
+
+        if (!memory->start_config_compaction()) {
+            return false;
+        }
+
+        for (uint8_t key = 1; key <= EI_CONFIG_KEY_LAST; key++) {
+            const uint8_t *data;
+            uint16_t length;
+
+            get_config_value(key, &data, &length);
+            if (!memory->append_config_record(key, data, length)) {
+                return false;
+            }
+            config_crc[key] = EiDeviceMemory::crc32(data, length);
+            config_saved |= (1u << key);
+        }
+
+        return memory->finish_config_compaction();
+    }
+
 public:
     EiDeviceInfo(void) {};
     ~EiDeviceInfo(void) {};
     static EiDeviceInfo *get_device(void);
 
+    /**
+     * @brief Append the values that changed since the last save to the config log.
+     * This only erases flash when the log is full (or there's none yet).
+     */
     virtual bool save_config(void)
     {
-        EiConfig *buf = (EiConfig *)ei_malloc(sizeof(EiConfig));
-        if(buf == NULL) {
-            return false;
+        for (uint8_t key = 1; key <= EI_CONFIG_KEY_LAST; key++) {
+            const uint8_t *data;
+            uint16_t length;
+
+            get_config_value(key, &data, &length);
+            uint32_t crc = EiDeviceMemory::crc32(data, length);
+
+            if ((config_saved & (1u << key)) && config_crc[key] == crc) {
+                continue;
+            }
+            if (!memory->append_config_record(key, data, length)) {
+                return compact_config();
+            }
+            config_crc[key] = crc;
+            config_saved |= (1u << key);
         }
 
-        memset(buf, 0, sizeof(EiConfig));
-
-        strncpy(buf->wifi_ssid, wifi_ssid.c_str(), 128);
-        strncpy(buf->wifi_password, wifi_password.c_str(), 128);
-        buf->wifi_security = wifi_security;
-        buf->sample_interval_ms = sample_interval_ms;
-        buf->sample_length_ms = sample_length_ms;
-        buf->long_recording_interval_ms = long_recording_interval_ms;
-        buf->long_recording_length_ms = long_recording_length_ms;
-        strncpy(buf->sample_label, sample_label.c_str(), 128);
-        strncpy(buf->sample_hmac_key, sample_hmac_key.c_str(), 33);
-        strncpy(buf->sensor_label, sensor_label.c_str(), 64);
-        strncpy(buf->upload_host, upload_host.c_str(), 128);
-        strncpy(buf->upload_path, upload_path.c_str(), 128);
-        strncpy(buf->upload_api_key, upload_api_key.c_str(), 128);
-        strncpy(buf->mgmt_url, management_url.c_str(), 128);
-        buf->magic = 0xdeadbeef;
-
-        bool ret = memory->save_config((uint8_t *)buf, sizeof(EiConfig));
-
-        ei_free((void *)buf);
-
-        return ret;
+        return true;
     }
 
     virtual void load_config(void)
     {
+        config_saved = 0;
+
+        if (memory->load_config_log(load_config_record, this)) {
+            return;
+        }
+
+        // config from before the config log, it's moved to the log with the next save
         EiConfig *buf = (EiConfig *)ei_malloc(sizeof(EiConfig));
         if(buf == NULL) {
             return;
@@ -185,18 +329,18 @@ public:
         memory->load_config((uint8_t *)buf, sizeof(EiConfig));
 
         if (buf->magic == 0xdeadbeef) {
-            wifi_ssid = std::string(buf->wifi_ssid, 128);
-            wifi_password = std::string(buf->wifi_password, 128);
+            wifi_ssid = std::string(buf->wifi_ssid, strnlen(buf->wifi_ssid, 128));
+            wifi_password = std::string(buf->wifi_password, strnlen(buf->wifi_password, 128));
             wifi_security = buf->wifi_security;
             sample_interval_ms = buf->sample_interval_ms;
             sample_length_ms = buf->sample_length_ms;
-            sample_label = std::string(buf->sample_label, 128);
-            sample_hmac_key = std::string(buf->sample_hmac_key, 33);
-            upload_host = std::string(buf->upload_host, 128);
-            upload_path = std::string(buf->upload_path, 128);
-            upload_api_key = std::string(buf->upload_api_key, 128);
-            management_url = std::string(buf->mgmt_url, 128);
-            sensor_label = std::string(buf->sensor_label, 64);
+            sample_label = std::string(buf->sample_label, strnlen(buf->sample_label, 128));
+            sample_hmac_key = std::string(buf->sample_hmac_key, strnlen(buf->sample_hmac_key, 33));
+            upload_host = std::string(buf->upload_host, strnlen(buf->upload_host, 128));
+            upload_path = std::string(buf->upload_path, strnlen(buf->upload_path, 128));
+            upload_api_key = std::string(buf->upload_api_key, strnlen(buf->upload_api_key, 128));
+            management_url = std::string(buf->mgmt_url, strnlen(buf->mgmt_url, 128));
+            sensor_label = std::string(buf->sensor_label, strnlen(buf->sensor_label, 64));
             long_recording_interval_ms = buf->long_recording_interval_ms;
             long_recording_length_ms = buf->long_recording_length_ms;
         }
@@ -489,33 +633,23 @@ public:
     }
 
 #if MULTI_FREQ_ENABLED == 1
-	uint32_t actual_timer;
-    std::vector<float> multi_sample_interval;
+    const ei_fusion_schedule_t *multi_schedule;
+    uint32_t multi_countdown[NUM_MAX_FUSIONS];
     void (*sample_multi_read_callback)(uint8_t);
 
-    virtual bool start_multi_sample_thread(void (*sample_multi_read_cb)(uint8_t), float* fusion_sample_interval_ms, uint8_t num_fusioned)
+    /**
+     * @brief Call sample_multi_read_cb every schedule->tick_us with the sensors
+     * due in that tick, the first reading (all sensors) is done right away
+     */
+    virtual bool start_multi_sample_thread(void (*sample_multi_read_cb)(uint8_t), const ei_fusion_schedule_t *schedule, uint8_t num_fusioned)
     {
-        uint8_t i;
-        uint8_t flag = 0;
-
         this->sample_multi_read_callback = sample_multi_read_cb;
+        this->multi_schedule = schedule;
         this->fusioning = num_fusioned;
-        this->multi_sample_interval.clear();
-
-        for (i = 0; i < num_fusioned; i++){
-            this->multi_sample_interval.push_back(fusion_sample_interval_ms[i]);
-        }
-
-        /* to improve, we consider just a 2 sensors case for now */
-        this->sample_interval = ei_fusion_calc_multi_gcd(this->multi_sample_interval.data(), this->fusioning);
 
         /* force first reading */
-        for (i = 0; i < this->fusioning; i++){
-                flag |= (1<<i);
-        }
-        this->sample_multi_read_callback(flag);
+        this->sample_multi_read_callback(first_multi_sample_due());
 
-        this->actual_timer = 0;
         /*
         * TODO
         * start timer/thread
@@ -524,14 +658,41 @@ public:
         return false;
     }
 
-    virtual uint8_t get_fusioning(void)
+    /**
+     * @brief Restart the schedule, all sensors are read in the first tick
+     * @return sensors to read (bit flags)
+     */
+    uint8_t first_multi_sample_due(void)
     {
-        return fusioning;
+        uint8_t due = 0;
+
+        for (uint8_t i = 0; i < this->multi_schedule->sensor_count; i++) {
+            this->multi_countdown[i] = this->multi_schedule->period[i];
+            due |= (1 << i);
+        }
+        return due;
     }
 
-    virtual uint32_t get_sample_interval(void)
+    /**
+     * @brief Advance the schedule by one tick
+     * @return sensors to read (bit flags)
+     */
+    uint8_t next_multi_sample_due(void)
+    {
+        uint8_t due = 0;
+
+        for (uint8_t i = 0; i < this->multi_schedule->sensor_count; i++) {
+            if (--this->multi_countdown[i] == 0) {
+                this->multi_countdown[i] = this->multi_schedule->period[i];
+                due |= (1 << i);
+            }
+        }
+        return due;
+    }
+
+    virtual uint8_t get_fusioning(void)
     {
-        return sample_interval;
+        return fusioning;
     }
 
 #endif
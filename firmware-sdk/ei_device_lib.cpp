@@ -41,10 +41,21 @@
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/classifier/ei_signal_with_axes.h"
 
-extern "C" EI_IMPULSE_ERROR run_classifier(
-    signal_t *signal,
-    ei_impulse_result_t *result,
-    bool debug = false);
+typedef void (*ei_batch_result_fn_t)(size_t window_ix, ei_impulse_result_t *result, void *user_data);
+
+extern "C" EI_IMPULSE_ERROR run_classifier_batch(
+    signal_t *signals,
+    size_t signals_count,
+    ei_batch_result_fn_t result_fn,
+    void *user_data = nullptr,
+    bool debug = false,
+    size_t *classified_count = nullptr);
+
+/* Number of windows classified per run_classifier_batch() call when static
+ * data holds more than one window. */
+#ifndef EI_STATIC_DATA_BATCH_SIZE
+#define EI_STATIC_DATA_BATCH_SIZE   4
+#endif
 
 float *features;
 extern ei_impulse_handle_t& ei_default_impulse;
@@ -180,7 +191,8 @@ bool run_impulse_static_data(bool debug, size_t length, size_t buf_len)
     ei_printf("RESULT %d\r\n", res);
     ei_printf("END OUTPUT\r\n");
 
-    return true;
+    // the impulse failing fails the command too
+    return res == EI_IMPULSE_OK;
 }
 
 int raw_feature_get_data(size_t offset, size_t length, float *out_ptr)
@@ -189,49 +201,27 @@ int raw_feature_get_data(size_t offset, size_t length, float *out_ptr)
     return 0;
 }
 
-EI_IMPULSE_ERROR ei_start_impulse_static_data(bool debug, float* data, size_t size) {
-
-    features = data;
-
-    signal_t signal;            // Wrapper for raw input buffer
-    ei_impulse_result_t result = {0}; // Used to store inference output
-    EI_IMPULSE_ERROR res;       // Return code from inference
-
-    // Make sure that the length of the buffer matches expected input length
-    if (size != EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE) {
-        ei_printf("ERROR: The size of the input buffer is not correct.\r\n");
-        ei_printf("Expected %d items, but got %d\r\n",
-                EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE,
-                (int)size);
-        return EI_IMPULSE_ERROR_SHAPES_DONT_MATCH;
-    }
-
-    // Assign callback function to fill buffer used for preprocessing/inference
-    signal.total_length = EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE;
-    signal.get_data = &raw_feature_get_data;
-
-    // Perform DSP pre-processing and inference
-    res = run_classifier(&signal, &result, debug);
-
-    // Print return code and how long it took to perform inference
-    if(result.timing.dsp_us != 0) {
+static void print_static_data_result(ei_impulse_result_t *result)
+{
+    // Print how long it took to perform inference
+    if(result->timing.dsp_us != 0) {
         ei_printf("Timing: DSP %.3f ms, inference %.3f ms, anomaly %.3f ms\r\n",
-                result.timing.dsp_us / 1000.f,
-                result.timing.classification_us / 1000.f,
-                result.timing.anomaly_us / 1000.f);
+                result->timing.dsp_us / 1000.f,
+                result->timing.classification_us / 1000.f,
+                result->timing.anomaly_us / 1000.f);
     }
     else {
         ei_printf("Timing: DSP %d ms, inference %d ms, anomaly %d ms\r\n",
-                result.timing.dsp,
-                result.timing.classification,
-                result.timing.anomaly);
+                result->timing.dsp,
+                result->timing.classification,
+                result->timing.anomaly);
     }
 
     // Print the prediction results (object detection)
 #if EI_CLASSIFIER_OBJECT_DETECTION == 1
     ei_printf("Object detection bounding boxes:\r\n");
     for (uint32_t i = 0; i < EI_CLASSIFIER_OBJECT_DETECTION_COUNT; i++) {
-        ei_impulse_result_bounding_box_t bb = result.bounding_boxes[i];
+        ei_impulse_result_bounding_box_t bb = result->bounding_boxes[i];
         if (bb.value == 0) {
             continue;
         }
@@ -249,7 +239,7 @@ EI_IMPULSE_ERROR ei_start_impulse_static_data(bool debug, float* data, size_t si
     ei_printf("Predictions:\r\n");
     for (uint16_t i = 0; i < EI_CLASSIFIER_LABEL_COUNT; i++) {
         ei_printf("  %s: ", ei_default_impulse.impulse->categories[i]);
-        ei_printf_float(result.classification[i].value);
+        ei_printf_float(result->classification[i].value);
         ei_printf("\r\n");
     }
 #endif
@@ -257,8 +247,79 @@ EI_IMPULSE_ERROR ei_start_impulse_static_data(bool debug, float* data, size_t si
     // Print anomaly result (if it exists)
 #if EI_CLASSIFIER_HAS_ANOMALY == 1
     ei_printf("Anomaly prediction: ");
-    ei_printf_float(result.anomaly);
+    ei_printf_float(result->anomaly);
     ei_printf("\r\n");
 #endif
+}
+
+typedef struct {
+    size_t first_window;
+    size_t window_count;
+} static_data_batch_t;
+
+/**
+ * @brief      Print a window's result before the next window is classified, the
+ *             results of a batch share their storage
+ */
+static void static_data_batch_result(size_t window_ix, ei_impulse_result_t *result, void *user_data)
+{
+    const static_data_batch_t *batch = (const static_data_batch_t *)user_data;
+
+    if (batch->window_count > 1) {
+        ei_printf("Window %d:\r\n", (int)(batch->first_window + window_ix));
+    }
+    print_static_data_result(result);
+}
+
+EI_IMPULSE_ERROR ei_start_impulse_static_data(bool debug, float* data, size_t size) {
+
+    features = data;
+
+    signal_t signals[EI_STATIC_DATA_BATCH_SIZE];                // Wrappers for the windows in the raw input buffer
+    static_data_batch_t batch;                                  // Numbering of the printed results
+    EI_IMPULSE_ERROR res = EI_IMPULSE_OK;                       // Return code from inference
+
+    // Make sure that the length of the buffer matches expected input length,
+    // several windows can be sent back to back and are classified in batches
+    if (size == 0 || size % EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE != 0) {
+        ei_printf("ERROR: The size of the input buffer is not correct.\r\n");
+        ei_printf("Expected %d items (or a multiple of it), but got %d\r\n",
+                EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE,
+                (int)size);
+        return EI_IMPULSE_ERROR_SHAPES_DONT_MATCH;
+    }
+
+    size_t window_count = size / EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE;
+
+    for (size_t window = 0; window < window_count; window += EI_STATIC_DATA_BATCH_SIZE) {
+        size_t batch_size = window_count - window;
+        if (batch_size > EI_STATIC_DATA_BATCH_SIZE) {
+            batch_size = EI_STATIC_DATA_BATCH_SIZE;
+        }
+
+        // Assign callback function to fill buffer used for preprocessing/inference
+        for (size_t ix = 0; ix < batch_size; ix++) {
+            const float *window_data = features + (window + ix) * EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE;
+
+            signals[ix].total_length = EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE;
+            signals[ix].get_data = [window_data](size_t offset, size_t length, float *out_ptr) {
+                memcpy(out_ptr, window_data + offset, length * sizeof(float));
+                return 0;
+            };
+        }
+        batch.first_window = window;
+        batch.window_count = window_count;
+
+        // Perform DSP pre-processing and inference, only the windows before a
+        // failing one are printed
+        size_t classified = 0;
+        res = run_classifier_batch(signals, batch_size, static_data_batch_result, &batch, debug, &classified);
+
+        if (res != EI_IMPULSE_OK) {
+            ei_printf("ERR: Failed to run classifier on window %d (%d)\r\n", (int)(window + classified), res);
+            break;
+        }
+    }
+
     return res;
 }
@@ -38,6 +38,16 @@
 #include <cstdint>
 #include <cstring>
 
+/** "EICL", header of a config log block */
+#define EI_CONFIG_LOG_MAGIC             0x4c434945
+/** Longest value in a config log record */
+#define EI_CONFIG_LOG_MAX_VALUE_SIZE    128
+
+/**
+ * Callback for every record in the config log
+ */
+typedef void (*ei_config_record_cb_t)(void *ctx, uint8_t key, const uint8_t *data, uint16_t length);
+
 /**
  * @brief Interface class for all memory type storages in Edge Impulse compatible devices.
  * The memory should be organized in blocks because all EI sensor drivers depend on block organization.
@@ -92,6 +102,28 @@ protected:
      */
     uint32_t memory_size;
 
+    /**
+     * @brief config log state: block that is appended to, next free byte in that block,
+     * and sequence number of that block (the highest one is the current log)
+     */
+    uint32_t config_block = 0;
+    uint32_t config_offset = 0;
+    uint32_t config_sequence = 0;
+    bool config_log_valid = false;
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t sequence;
+    } config_log_header_t;
+
+    /**
+     * @brief key, 0x00, length (little endian), data padded to 4 bytes, CRC32 of the first 4 + length bytes
+     */
+    static uint32_t config_record_size(uint16_t length)
+    {
+        return 4 + ((length + 3) & ~3u) + 4;
+    }
+
 public:
     /**
      * @brief size of the memory block in bytes
@@ -179,6 +211,173 @@ public:
         return true;
     }
 
+    /**
+     * @brief CRC32 (IEEE 802.3)
+     */
+    static uint32_t crc32(const uint8_t *data, uint32_t length, uint32_t crc = 0)
+    {
+        crc = ~crc;
+        for (uint32_t i = 0; i < length; i++) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    /**
+     * @brief The config blocks hold a log of key/value records, so a setting is changed by
+     * appending a record instead of erasing and rewriting the whole config. Calls record_cb
+     * for every record, oldest first (so the last value of a key wins), and prepares the
+     * log for append_config_record(). Replay stops at the first record that doesn't pass
+     * its CRC (e.g. power loss while writing), the next append then compacts the log.
+     *
+     * @return false if there's no config log (erased, or config stored with save_config())
+     */
+    virtual bool load_config_log(ei_config_record_cb_t record_cb, void *ctx)
+    {
+        config_log_header_t header;
+        uint8_t record[4 + EI_CONFIG_LOG_MAX_VALUE_SIZE + 4];
+
+        config_log_valid = false;
+        config_block = 0;
+        config_sequence = 0;
+
+        for (uint32_t block = 0; block < used_blocks; block++) {
+            if (read_data((uint8_t *)&header, block * block_size, sizeof(header)) != sizeof(header)) {
+                continue;
+            }
+            if (header.magic != EI_CONFIG_LOG_MAGIC) {
+                continue;
+            }
+            if (!config_log_valid || (int32_t)(header.sequence - config_sequence) > 0) {
+                config_log_valid = true;
+                config_block = block;
+                config_sequence = header.sequence;
+            }
+        }
+
+        if (!config_log_valid) {
+            return false;
+        }
+
+        const uint32_t base = config_block * block_size;
+        config_offset = sizeof(config_log_header_t);
+
+        while (config_offset + config_record_size(0) <= block_size) {
+            if (read_data(record, base + config_offset, 4) != 4) {
+                config_offset = block_size;
+                break;
+            }
+            // erased (RAM erases to 0x00)
+            if ((record[0] == 0xFF && record[1] == 0xFF) || (record[0] == 0x00 && record[1] == 0x00)) {
+                break;
+            }
+
+            uint16_t length = record[2] | (record[3] << 8);
+            uint32_t size = config_record_size(length);
+            uint32_t crc;
+
+            if (record[1] != 0x00 || length > EI_CONFIG_LOG_MAX_VALUE_SIZE
+                || config_offset + size > block_size
+                || read_data(&record[4], base + config_offset + 4, size - 4) != size - 4) {
+                config_offset = block_size;
+                break;
+            }
+
+            memcpy(&crc, &record[size - 4], sizeof(crc));
+            if (crc != crc32(record, 4 + length)) {
+                config_offset = block_size;
+                break;
+            }
+
+            record_cb(ctx, record[0], &record[4], length);
+            config_offset += size;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Append a record to the config log
+     *
+     * @param key 0x01 - 0xFE
+     * @return false if there's no log yet or it's full, see start_config_compaction()
+     */
+    virtual bool append_config_record(uint8_t key, const uint8_t *data, uint16_t length)
+    {
+        uint8_t record[4 + EI_CONFIG_LOG_MAX_VALUE_SIZE + 4];
+        uint32_t size = config_record_size(length);
+
+        if (!config_log_valid || length > EI_CONFIG_LOG_MAX_VALUE_SIZE
+            || key == 0x00 || key == 0xFF || config_offset + size > block_size) {
+            return false;
+        }
+
+        memset(record, 0, size);
+        record[0] = key;
+        record[1] = 0x00;
+        record[2] = length & 0xFF;
+        record[3] = length >> 8;
+        memcpy(&record[4], data, length);
+        uint32_t crc = crc32(record, 4 + length);
+        memcpy(&record[size - 4], &crc, sizeof(crc));
+
+        if (write_data(record, config_block * block_size + config_offset, size) != size) {
+            // don't write over a partial record
+            config_offset = block_size;
+            return false;
+        }
+        config_offset += size;
+
+        return true;
+    }
+
+    /**
+     * @brief Start a new config log in the next config block (the same block if there's
+     * only one), the current values should then be written with append_config_record()
+     * and the log closed with finish_config_compaction(). The old log stays valid until then.
+     */
+    virtual bool start_config_compaction(void)
+    {
+        if (used_blocks == 0) {
+            return false;
+        }
+
+        uint32_t block = (config_block + 1) % used_blocks;
+        if (erase_data(block * block_size, block_size) != block_size) {
+            config_log_valid = false;
+            return false;
+        }
+
+        config_block = block;
+        config_offset = sizeof(config_log_header_t);
+        config_sequence++;
+        config_log_valid = true;
+
+        return true;
+    }
+
+    /**
+     * @brief Write the header of the new log, this makes it the current one
+     */
+    virtual bool finish_config_compaction(void)
+    {
+        config_log_header_t header = { EI_CONFIG_LOG_MAGIC, config_sequence };
+
+        if (!config_log_valid) {
+            return false;
+        }
+
+        if (write_data((uint8_t *)&header, config_block * block_size, sizeof(header)) != sizeof(header)) {
+            config_log_valid = false;
+            return false;
+        }
+
+        return true;
+    }
+
     virtual uint32_t
     read_sample_data(uint8_t *sample_data, uint32_t address, uint32_t sample_data_size)
     {
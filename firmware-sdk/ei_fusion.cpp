@@ -68,15 +68,13 @@ vector<fused_sensors_t> fused_sensors;
 static vector<ei_device_fusion_sensor_t *> fusion_sensors;
 int num_fusions, num_fusion_axis;
 #if MULTI_FREQ_ENABLED == 1
-#define MULTI_FREQ_MAX_FREQ_NOT_SET     (-1.0f)
-
 #ifndef MULTI_FREQ_MAX_INC_FACTOR
 #define MULTI_FREQ_MAX_INC_FACTOR       (10)
 #endif
 
-static float multi_sampling_freq[NUM_MAX_FUSIONS];
-static float multi_freq_combination[NUM_MAX_FUSIONS][EI_MAX_FREQUENCIES];
-static fusion_sample_format_t* old_data;    // store old samples for multi
+static ei_fusion_schedule_t multi_schedule;
+static int multi_axis_offset[NUM_MAX_FUSIONS];  // first axis of each sensor in the sample
+static fusion_sample_format_t* multi_data;      // last value of every axis
 #endif
 
 /* Private function prototypes --------------------------------------------- */
@@ -93,10 +91,12 @@ static bool add_sensor(int sensor_ix, char *name_buffer);
 static bool add_axis(int sensor_ix, char *name_buffer);
 static float highest_frequency(float *frequencies, size_t size);
 #if MULTI_FREQ_ENABLED == 1
-static float calc_gcd(float time1, float time2);
-static void get_multi_freq_combinations(int row, int col, float* mat_period, float* actual_comb, int ix, vector<float>* freq_comb, vector<int>* mem_fact, float allowed_period);
-static void clean_multi_freq_combinations(int n, int col, float* mat_period, float* actual_comb, int ix, float* actual_max);
-static bool ei_fusion_calc_optimal_frequencies(uint8_t row, uint8_t col, float freq_objective);
+static uint32_t to_millihertz(float frequency);
+static uint32_t calc_gcd(uint32_t a, uint32_t b);
+static uint32_t calc_lcm(uint32_t a, uint32_t b);
+static bool next_multi_freq_combination(int *comb_ix, const int *freq_count, int n);
+static void get_multi_freq_combinations(const int *sensor_ix, int n, vector<uint32_t>* freq_comb, vector<int>* mem_fact);
+static bool ei_fusion_calc_schedule(float freq_objective);
 #endif
 /**
  * @brief Add sensor to fusion list
@@ -229,63 +229,49 @@ void ei_fusion_read_axis_data(void)
  */
 void ei_fusion_multi_read_axis_data(uint8_t flag_read)
 {
-   EiDeviceInfo* dev = EiDeviceInfo::get_device();
-   fusion_sample_format_t *sensor_data;
-   fusion_sample_format_t *data;
-   uint32_t loc = 0;
-
-   if (flag_read != 0) {
-       data = (fusion_sample_format_t *)ei_malloc(sizeof(fusion_sample_format_t) * num_fusion_axis);
-       if (data == NULL) {
-           return;
-       }
-
-       for (int i = 0; i < num_fusions; i++) {
-
-           sensor_data = NULL;
-           if ((fusion_sensors[i]->read_data != NULL)
-                   && ((flag_read & (1 << i)) == (1 << i)) ) {
-               sensor_data = fusion_sensors[i]->read_data(
-                   fusion_sensors[i]->num_axis); // read sensor data from sensor file
-           }
-
-           if (sensor_data != NULL) {
-               for (int j = 0; j < fusion_sensors[i]->num_axis; j++, loc++) {
-                   if (fusion_sensors[i]->axis_flag_used & (1 << j)) {
-                       data[loc] = *(sensor_data + j); // add sensor data to fusion data
-                       if (old_data != nullptr) {
-
-                        old_data[loc] = data[loc];       // store in old structure
-                        }
-                   }
-               }
-           }
-           else { // No data, zero fill
-               for (int j = 0; j < fusion_sensors[i]->num_axis; j++, loc++) {
-                   if (fusion_sensors[i]->axis_flag_used & (1 << j)) {
-                       data[loc] = old_data[loc];       // not sampled, use last value
-                   }
-               }
-           }
-       }
-
-       if (fusion_cb_sampler(
-               (const void *)&data[0],
-               (sizeof(fusion_sample_format_t) * num_fusion_axis))) {
-           dev->stop_sample_thread(); // if last sample detach
-           ei_free(old_data);
-           // send fusion data to sampler
-       }
-
-       ei_free(data);
-   }
-   else {
-       if (fusion_cb_sampler(nullptr, 0)) {
-           dev->stop_sample_thread(); // if last sample detach
-           ei_free(old_data);
-       }
-   }
+    EiDeviceInfo* dev = EiDeviceInfo::get_device();
+    fusion_sample_format_t *sensor_data;
+    bool done;
+
+    if (multi_data == nullptr) {
+        return;
+    }
+
+    // only read the sensors that are due, the others keep their last value
+    for (uint8_t due = flag_read; due != 0; due &= (due - 1)) {
+        int i = __builtin_ctz(due);
+
+        if (fusion_sensors[i]->read_data == NULL) {
+            continue;
+        }
+        sensor_data = fusion_sensors[i]->read_data(
+            fusion_sensors[i]->num_axis); // read sensor data from sensor file
+        if (sensor_data == NULL) {
+            continue;
+        }
+
+        int loc = multi_axis_offset[i];
+        for (int j = 0; j < fusion_sensors[i]->num_axis; j++) {
+            if (fusion_sensors[i]->axis_flag_used & (1 << j)) {
+                multi_data[loc++] = *(sensor_data + j); // add sensor data to fusion data
+            }
+        }
+    }
+
+    if (flag_read != 0) {
+        done = fusion_cb_sampler(
+            (const void *)&multi_data[0],
+            (sizeof(fusion_sample_format_t) * num_fusion_axis)); // send fusion data to sampler
+    }
+    else {
+        done = fusion_cb_sampler(nullptr, 0);
+    }
 
+    if (done) {
+        dev->stop_sample_thread(); // if last sample detach
+        ei_free(multi_data);
+        multi_data = nullptr;
+    }
 }
 #endif
 
@@ -317,10 +303,13 @@ bool ei_fusion_sample_start(sampler_callback callsampler, float sample_interval_
 
 #if MULTI_FREQ_ENABLED == 1
 /**
+ * @brief      Wrapper for start_multi_sample_thread, every sensor is sampled
+ *             at its highest frequency that divides the sampling frequency
  *
- * @param callsampler
- * @param multi_sample_interval_ms
- * @return
+ * @param[in]  callsampler               callback function from ei_sampler
+ * @param[in]  multi_sample_interval_ms  sample interval from ei_sampler
+ *
+ * @retval  false if initialisation failed
  */
 bool ei_multi_fusion_sample_start(sampler_callback callsampler, float multi_sample_interval_ms)
 {
@@ -330,15 +319,30 @@ bool ei_multi_fusion_sample_start(sampler_callback callsampler, float multi_samp
     if ((fusion_cb_sampler == NULL) || (num_fusions < 2)) {   /* */
         return false;
     }
-    else {
-        if (ei_fusion_calc_optimal_frequencies(num_fusions, EI_MAX_FREQUENCIES, (1000.0f/multi_sample_interval_ms)) == false) {
-            ei_printf("ERR: Unable to calculate the optimal frequency\n");
-            return false;
+
+    if (ei_fusion_calc_schedule(1000.0f / multi_sample_interval_ms) == false) {
+        ei_printf("ERR: Unable to calculate the optimal frequency\n");
+        return false;
+    }
+
+    int loc = 0;
+    for (int i = 0; i < num_fusions; i++) {
+        multi_axis_offset[i] = loc;
+        for (int j = 0; j < fusion_sensors[i]->num_axis; j++) {
+            if (fusion_sensors[i]->axis_flag_used & (1 << j)) {
+                loc++;
+            }
         }
-        // TODO calc of optimal frequencies.
-        dev->start_multi_sample_thread(ei_fusion_multi_read_axis_data, multi_sampling_freq, num_fusions); // what about multi_sample_interval_ms ?
-        return true;
     }
+
+    ei_free(multi_data);
+    multi_data = (fusion_sample_format_t *)ei_calloc(num_fusion_axis, sizeof(fusion_sample_format_t));
+    if (multi_data == NULL) {
+        return false;
+    }
+
+    dev->start_multi_sample_thread(ei_fusion_multi_read_axis_data, &multi_schedule, num_fusions);
+    return true;
 }
 #endif
 
@@ -408,9 +412,6 @@ bool ei_fusion_setup_data_sampling(void)
     bool ret = false;
 
 #if MULTI_FREQ_ENABLED == 1
-    old_data = (fusion_sample_format_t *)ei_malloc(sizeof(fusion_sample_format_t) * num_fusion_axis);
-    memset(old_data, 0, sizeof(fusion_sample_format_t) * num_fusion_axis);
-
     if (num_fusions == 1) {
         ret = ei_sampler_start_sampling(
                 &payload,
@@ -423,11 +424,6 @@ bool ei_fusion_setup_data_sampling(void)
                 &ei_multi_fusion_sample_start,
                 (sizeof(fusion_sample_format_t) * num_fusion_axis));
     }
-
-    if (ret == false) {
-        ei_free(old_data);  //
-    }
-
 #else
     ret = ei_sampler_start_sampling(
             &payload,
@@ -567,28 +563,13 @@ static void print_all_combinations(
         }
         else {
 #if (MULTI_FREQ_ENABLED == 1)
-            float mat_period[NUM_MAX_FUSIONS][EI_MAX_FREQUENCIES] = {{0.0}};
-            float mat_freq[NUM_MAX_FUSIONS][EI_MAX_FREQUENCIES] = {{0.0}};
-            float combination[NUM_MAX_FUSIONS] = {0.0};
-            float max_freq = MULTI_FREQ_MAX_FREQ_NOT_SET;
-            int starting_ix = 0;
             const int mem_inc_threshold = MULTI_FREQ_MAX_INC_FACTOR;
             int how_many_under_threshold = 0;
 
-            vector<float> found_freq_combinations;
+            vector<uint32_t> found_freq_combinations;
             vector<int> mem_increase_factor;
 
-            for (int j = 0; j < r; j++) {                         // per sensors
-                for (int z = 0; z < EI_MAX_FREQUENCIES; z++) {     // per freq
-                    if (fusable_sensor_list[data[j]].frequencies[z] != 0.0) {
-                        mat_period[j][z] = 1.f/fusable_sensor_list[data[j]].frequencies[z];
-                        mat_freq[j][z] = fusable_sensor_list[data[j]].frequencies[z];
-                    }
-                }
-            }
-
-            clean_multi_freq_combinations(r, EI_MAX_FREQUENCIES, (float*)mat_freq, combination, starting_ix, &max_freq);
-            get_multi_freq_combinations(r, EI_MAX_FREQUENCIES, (float*)mat_period, combination, starting_ix, &found_freq_combinations, &mem_increase_factor, max_freq);
+            get_multi_freq_combinations(data, r, &found_freq_combinations, &mem_increase_factor);
 
             for (size_t j = 0; j < mem_increase_factor.size(); j++) {
                 if (mem_increase_factor.at(j) < mem_inc_threshold) {
@@ -598,10 +579,10 @@ static void print_all_combinations(
 
             for (size_t j = 0; j < found_freq_combinations.size(); j++) {
                 if ((how_many_under_threshold > 0) && (mem_increase_factor.at(j) < mem_inc_threshold)) {
-                    sens.frequencies.push_back(found_freq_combinations.at(j));
+                    sens.frequencies.push_back(found_freq_combinations.at(j) / 1000.0f);
                 }
                 else if (how_many_under_threshold == 0) {
-                    sens.frequencies.push_back(found_freq_combinations.at(j));
+                    sens.frequencies.push_back(found_freq_combinations.at(j) / 1000.0f);
                 }
             }
 
@@ -773,255 +754,188 @@ static float highest_frequency(float *frequencies, size_t size)
 }
 #if MULTI_FREQ_ENABLED == 1
 /**
- *
- * @param time1
- * @param time2
- * @return
+ * @brief Frequencies are handled as integer mHz, so the GCD / LCM are exact, also
+ * for frequencies (like 3Hz) that don't have a whole number of us period
  */
-static float calc_gcd(float fnum1, float fnum2)
+static uint32_t to_millihertz(float frequency)
 {
-    float temp;
-
-    while(1)
-    {
-        if (fnum1 < fnum2)
-        {
-            temp = fnum2;
-            fnum2 = fnum1;
-            fnum1 = temp;
-        }
-
-        if (fabs(fnum2) < 0.001)
-        {
-            break;
-        }
+    return (frequency > 0.0f) ? (uint32_t)lroundf(frequency * 1000.0f) : 0;
+}
 
-        temp = fnum1;
-        fnum1 = fnum2;
-        fnum2 = temp - floor(temp / fnum2) * fnum2;
+static uint32_t calc_gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t temp = a % b;
+        a = b;
+        b = temp;
     }
 
-    return fnum1;
+    return a;
 }
 
 /**
- * @brief Get the multi freq combinations object
- *
- * @param n
- * @param mat_period
- * @param actual_comb
- * @param ix
- * @param psens
+ * @return the LCM of a and b, 0 if it doesn't fit in 32 bits
  */
-static void get_multi_freq_combinations(int n, int col, float* mat_period, float* actual_comb, int ix, vector<float>* freq_comb, vector<int>* mem_fact, float allowed_period)
+static uint32_t calc_lcm(uint32_t a, uint32_t b)
 {
-    int i;
+    uint64_t lcm = (uint64_t)(a / calc_gcd(a, b)) * b;
 
-    if (ix == n) {
-        for (i = 0; i < n; i++) {
-            if (actual_comb[i] == 0.0) {
-                return; // make no sense to calc gcd for this combination
-            }
+    return (lcm > UINT32_MAX) ? 0 : (uint32_t)lcm;
+}
+
+/**
+ * @brief Step to the next combination of one frequency per sensor
+ *
+ * @param comb_ix frequency index per sensor
+ * @param freq_count number of frequencies per sensor
+ * @param n number of sensors
+ * @return false once all combinations are done
+ */
+static bool next_multi_freq_combination(int *comb_ix, const int *freq_count, int n)
+{
+    for (int i = n - 1; i >= 0; i--) {
+        if (++comb_ix[i] < freq_count[i]) {
+            return true;
         }
-        float freq = ei_fusion_calc_multi_gcd(actual_comb, (uint8_t)n);
-        int local_mem_fac = 0;
+        comb_ix[i] = 0;
+    }
 
-        freq = roundf(10.f/(freq))/10.f;
+    return false;
+}
 
-        if ((freq > allowed_period) && (allowed_period != MULTI_FREQ_MAX_FREQ_NOT_SET)) {
+/**
+ * @brief Get the sampling frequencies of all combinations of sensor frequencies.
+ * A combination is sampled at the LCM of its frequencies, and can't go above the
+ * highest frequency of a combination where all frequencies are multiples of each other.
+ *
+ * @param sensor_ix index in fusable_sensor_list per sensor
+ * @param n number of sensors
+ * @param freq_comb sampling frequencies found (mHz)
+ * @param mem_fact per sampling frequency, the sum of ticks between the sensor readings
+ * (1 if a sensor runs at the sampling frequency)
+ */
+static void get_multi_freq_combinations(const int *sensor_ix, int n, vector<uint32_t>* freq_comb, vector<int>* mem_fact)
+{
+    uint32_t mat_freq[NUM_MAX_FUSIONS][EI_MAX_FREQUENCIES];
+    int freq_count[NUM_MAX_FUSIONS] = { 0 };
+    int comb_ix[NUM_MAX_FUSIONS] = { 0 };
+    uint32_t comb[NUM_MAX_FUSIONS];
+    uint32_t max_freq = 0;   // 0 if there's no harmonic combination
+
+    for (int i = 0; i < n; i++) {                         // per sensors
+        for (int z = 0; z < EI_MAX_FREQUENCIES; z++) {     // per freq
+            uint32_t freq = to_millihertz(fusable_sensor_list[sensor_ix[i]].frequencies[z]);
+            if (freq != 0) {
+                mat_freq[i][freq_count[i]++] = freq;
+            }
+        }
+        if (freq_count[i] == 0) {
             return;
         }
+    }
 
-        if (find(begin(*freq_comb), end(*freq_comb), freq) != end(*freq_comb)) {  /* already present, let's check if better mem increase */
-            size_t j;
-            for (j = 0; j < freq_comb->size(); j++) {
-                if (freq_comb->at(j) == freq) {
-                    break;
-                }
-            }
-            // let's check if we can found a better combination with the same result.
-            for (i = 0; i < n; i++) {
-                int temp = (int)(freq*actual_comb[i]);
+    do {
+        bool harmonic = true;
+        uint32_t highest = 0;
 
-                if (temp == 1) {
-                    local_mem_fac = 1;  // if equal of one of the starting freq, we want to keep it!
+        for (int i = 0; i < n; i++) {
+            comb[i] = mat_freq[i][comb_ix[i]];
+            if (comb[i] > highest) {
+                highest = comb[i];
+            }
+        }
+        for (int i = 0; i < (n - 1) && harmonic; i++) {
+            for (int j = i + 1; j < n; j++) {
+                if ((comb[i] > comb[j]) ? (comb[i] % comb[j]) : (comb[j] % comb[i])) {
+                    harmonic = false;
                     break;
                 }
-                else {
-                    local_mem_fac += (int)(freq*actual_comb[i]);
-                }
-
             }
-            if (local_mem_fac < mem_fact->at(j)) {
-                mem_fact->at(j) = local_mem_fac;
-            }
-
-            return; // element already present, no need to add it.
         }
 
-        for (i = 0; i < n; i++) {
-            int temp = (int)(freq*actual_comb[i]);
-
-            if (temp == 1) {
-                local_mem_fac = 1;  // if equal of one of the starting freq, we want to keep it!
-                break;
-            }
-            else {
-                local_mem_fac += (int)(freq*actual_comb[i]);
-            }
+        if (harmonic && highest > max_freq) {
+            max_freq = highest;
         }
+    } while (next_multi_freq_combination(comb_ix, freq_count, n));
 
-        mem_fact->push_back(local_mem_fac);
-        freq_comb->push_back(freq);
+    do {
+        uint32_t freq = 1;
+        int local_mem_fac = 0;
 
-    } else {
-        for (i = 0; i < col; i++) {
-            actual_comb[ix] = mat_period[ix*col + i];
-            get_multi_freq_combinations(n, col, mat_period, actual_comb, ix + 1, freq_comb, mem_fact, allowed_period);
+        for (int i = 0; i < n && freq != 0; i++) {
+            comb[i] = mat_freq[i][comb_ix[i]];
+            freq = calc_lcm(freq, comb[i]);
         }
-    }
-}
-
-/**
- * @brief
- *
- * @param n
- * @param col
- * @param ix
- * @param actual_comb
- * @param actual_max
- */
-static void clean_multi_freq_combinations(int n, int col,float* mat_period, float* actual_comb, int ix, float* actual_max)
-{
-    if (ix == n) {
 
-        bool natural_mult = true;
-
-        for (int i = 0; i < (n-1); i++) {
-            for (int j = i + 1; j < n; j++) {
-                if (actual_comb[j] < actual_comb[i]) {
+        if ((freq == 0) || ((max_freq != 0) && (freq > max_freq))) {
+            continue;
+        }
 
-                    if (fmodf(actual_comb[i], actual_comb[j]) != 0.0f) {
-                        return;
-                    }
-                }
-                else {
-                    if (fmodf(actual_comb[j], actual_comb[i]) != 0.0f) {
-                        return;
-                    }
-                }
+        for (int i = 0; i < n; i++) {
+            if (comb[i] == freq) {
+                local_mem_fac = 1;  // if equal of one of the starting freq, we want to keep it!
+                break;
             }
+            local_mem_fac += freq / comb[i];
         }
 
-        if (natural_mult == true) {
-            float temp_max = 0.0f;
-
-            for (int i = 0; i < (n-1); i++) {
-                temp_max = actual_comb[i];
-
-                for (int j = i + 1; j < n; j++) {
-                    if (temp_max < actual_comb[j]) {
-                        temp_max = actual_comb[j];
-                    }
-                }
+        size_t j;
+        for (j = 0; j < freq_comb->size(); j++) {
+            if (freq_comb->at(j) == freq) {
+                break;
             }
+        }
 
-            if (temp_max > *actual_max) {
-                *actual_max = temp_max;
+        if (j < freq_comb->size()) {  /* already present, keep the lowest mem increase */
+            if (local_mem_fac < mem_fact->at(j)) {
+                mem_fact->at(j) = local_mem_fac;
             }
         }
-
-        return;
-    } else {
-        for (int i = 0; i < col; i++) {
-            actual_comb[ix] = mat_period[ix*col + i];
-
-            clean_multi_freq_combinations(n, col, mat_period, actual_comb, ix + 1, actual_max);
+        else {
+            freq_comb->push_back(freq);
+            mem_fact->push_back(local_mem_fac);
         }
-    }
-
+    } while (next_multi_freq_combination(comb_ix, freq_count, n));
 }
 
 /**
- * @brief
+ * @brief Pick per sensor the highest frequency that divides the sampling frequency,
+ * and build the schedule: the sensor is read every (sampling frequency / frequency)
+ * ticks
  *
- * @param mat_period
- * @param actual_comb
- * @return true
- * @return false
+ * @param freq_objective sampling frequency
+ * @return false if a sensor has no matching frequency
  */
-static bool ei_fusion_calc_optimal_frequencies(uint8_t row, uint8_t col, float freq_objective)
+static bool ei_fusion_calc_schedule(float freq_objective)
 {
-    uint8_t found = 0;
-    int32_t optimal_values = 0;
+    const uint32_t objective = to_millihertz(freq_objective);
+    uint32_t *ratio = multi_schedule.period;
 
-    if (freq_objective == 0.0) {
+    if (objective == 0) {
         return false;
     }
 
-    memset(multi_sampling_freq, 0, sizeof(multi_sampling_freq));
-    memset(multi_freq_combination, 0, sizeof(multi_freq_combination));
+    for (int i = 0; i < num_fusions; i++) {  // for each sensors
+        ratio[i] = 0;
 
-    for (int i = 0; i < row; i++) {
-        for (int j = 0; j < col; j++) {
-            //
-            multi_freq_combination[i][j] = fusion_sensors[i]->frequencies[j];
-        }
-    }
+        for (int j = 0; j < EI_MAX_FREQUENCIES; j++) {  // for each freq
+            uint32_t freq = to_millihertz(fusion_sensors[i]->frequencies[j]);
 
-    for (int i = 0; i < row; i++) {  // for each sensors
-        optimal_values = INT32_MAX;
-
-        for (int j = 0; j < col; j++) {  // for each freq
-            if ((freq_objective >= multi_freq_combination[i][j])
-                && (multi_freq_combination[i][j] != 0.0f)) {
-                if (fmodf(freq_objective, multi_freq_combination[i][j]) == 0.0f) {
-                    int32_t temp = freq_objective/multi_freq_combination[i][j];
-                    if (temp < optimal_values) {
-                        optimal_values = temp;
-                        multi_sampling_freq[i] = multi_freq_combination[i][j];
-                    }
-                }
+            if ((freq != 0) && (freq <= objective) && ((objective % freq) == 0)
+                && ((ratio[i] == 0) || ((objective / freq) < ratio[i]))) {
+                ratio[i] = objective / freq;
             }
         }
 
-        if (optimal_values != INT32_MAX) {
-            found++;
+        if (ratio[i] == 0) {
+            return false;
         }
     }
 
-    if (found == row) {
-        return true;
-    }
-    else{
-        return false;
-    }
-}
+    multi_schedule.tick_us = (uint32_t)((1000000000ULL + objective / 2) / objective);
+    multi_schedule.sensor_count = (uint8_t)num_fusions;
 
-/**
- * @brief
- *
- * @param numbers
- * @param how_may
- * @return float the gcd of the array
- */
-float ei_fusion_calc_multi_gcd(float* numbers, uint8_t how_many)
-{
-    uint8_t i;
-    float inttime1;
-
-
-    if (how_many < 2) {
-        return 0.f;
-    }
-
-    inttime1 = numbers[0];
-
-    for (i = 1; i < how_many; i++) {
-        inttime1 = calc_gcd(inttime1, (numbers[i]));
-    }
-
-    return (inttime1);
+    return true;
 }
 
 bool ei_is_fusion(void)
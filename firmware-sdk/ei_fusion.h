@@ -61,6 +61,21 @@
 
 #define EI_MAX_FREQUENCIES 5
 
+#if MULTI_FREQ_ENABLED == 1
+/**
+ * Multi frequency sampling schedule. Every sensor is read at an integer fraction
+ * of the sampling frequency, every period[i] ticks, counted down per sensor so
+ * any combination of frequencies fits (3Hz + 1000Hz is a period of 1 and 1000).
+ */
+typedef struct {
+    // timer period, sampling interval in us
+    uint32_t tick_us;
+    uint8_t sensor_count;
+    // ticks between two readings of each sensor
+    uint32_t period[NUM_MAX_FUSIONS];
+} ei_fusion_schedule_t;
+#endif
+
 /** Format used in input list. Can either contain sensor names or axes names */
 typedef enum
 {
@@ -116,7 +131,6 @@ bool ei_fusion_setup_data_sampling(void);
 #if MULTI_FREQ_ENABLED == 1
 bool ei_multi_fusion_sample_start(sampler_callback callsampler, float multi_sample_interval_ms);
 void ei_fusion_multi_read_axis_data(uint8_t flag_read);
-float ei_fusion_calc_multi_gcd(float* numbers, uint8_t how_many);
 bool ei_is_fusion(void);
 #endif
 
@@ -43,7 +43,8 @@
 #include "malloc.h" //for memalign
 #endif
 
-#include <memory>
+#include <algorithm>
+#include <cstring>
 
 #include "edge-impulse-sdk/dsp/ei_utils.h"
 #include "edge-impulse-sdk/dsp/image/image.hpp"
@@ -51,6 +52,13 @@
 #include "firmware-sdk/at_base64_lib.h"
 #include "firmware-sdk/ei_device_interface.h"
 #include "firmware-sdk/ei_image_lib.h"
+#include "firmware-sdk/jpeg/JPEGENC.h"
+
+// set to 1 to send snapshots JPEG encoded instead of as raw pixels, only for
+// hosts that decode them (the daemon expects raw pixels by default)
+#ifndef EI_CAMERA_SNAPSHOT_JPEG
+#define EI_CAMERA_SNAPSHOT_JPEG 0
+#endif
 
 // *********************************** AT cmd functions ***************
 
@@ -75,6 +83,344 @@ static void change_to_normal_baud()
     ei_sleep(100);
 }
 
+// *********************************** Snapshot pipeline ***************
+// Frames are captured, resized, encoded and sent one band of rows at a time,
+// so RAM use scales with the snapshot width, not with the frame size.
+
+// rows per band, a multiple of the JPEG MCU height (8 for 4:4:4, 16 for 4:2:0)
+#define SNAPSHOT_BAND_ROWS 16
+
+using ei::image::processing::RGB888_B_SIZE;
+using ei::image::processing::MONO_B_SIZE;
+
+/**
+ * Sensor side of the pipeline, hands out rows of the captured frame in
+ * increasing order (rows can be skipped or repeated within a band, going
+ * back to an earlier band returns nullptr). Uses (in order of preference) band capture from the
+ * driver, the driver's own framebuffer or, as a last resort, a full
+ * framebuffer allocated here.
+ */
+class SnapshotSource {
+public:
+    SnapshotSource(EiCamera *camera, int width, int height, int pixel_size_B)
+        : camera(camera)
+        , width(width)
+        , height(height)
+        , pixel_size_B(pixel_size_B)
+        , stride(width * pixel_size_B)
+        , frame(nullptr)
+        , band(nullptr)
+        , band_first(0)
+        , band_rows(0)
+        , owns_frame(false)
+    {
+    }
+
+    ~SnapshotSource()
+    {
+        if (band) {
+            ei_free(band);
+        }
+        if (owns_frame) {
+            free(frame);
+        }
+    }
+
+    bool begin()
+    {
+        if (pixel_size_B != RGB888_B_SIZE && pixel_size_B != MONO_B_SIZE) {
+            ei_printf("ERR: Wrong pixel size, not supported: %d\n", pixel_size_B);
+            return false;
+        }
+
+#if SEND_TEST_IMAGE
+        band = (uint8_t *)ei_malloc(stride);
+        return band != nullptr;
+#else
+        if (camera->supports_row_capture()) {
+            band = (uint8_t *)ei_malloc(stride * SNAPSHOT_BAND_ROWS);
+            if (!band) {
+                ei_printf("ERR: Cannot allocate memory for snapshot band\n");
+                return false;
+            }
+            return read_band(0);
+        }
+
+        if (!camera->get_fb_ptr(&frame)) {
+#if ALLIGNED_BUFFER
+            // 32 BYTE aligned buffer
+            frame = reinterpret_cast<uint8_t *>(memalign(32, stride * height));
+#else
+            frame = reinterpret_cast<uint8_t *>(malloc(stride * height));
+#endif
+            if (!frame) {
+                ei_printf("ERR: Cannot allocate memory for framebuffer\n");
+                return false;
+            }
+            owns_frame = true;
+        }
+
+        if (pixel_size_B == RGB888_B_SIZE) {
+            return camera->ei_camera_capture_rgb888_packed_big_endian(frame, stride * height);
+        }
+        return camera->ei_camera_capture_grayscale_packed_big_endian(frame, stride * height);
+#endif
+    }
+
+    const uint8_t *get_row(int y)
+    {
+        if (y < 0 || y >= height) {
+            return nullptr;
+        }
+#if SEND_TEST_IMAGE
+        // counter pattern, continuous over the whole frame
+        for (int x = 0; x < width; x++) {
+            uint32_t pixel = y * width + x;
+            if (pixel_size_B == RGB888_B_SIZE) {
+                uint32_t counter = pixel * 100;
+                band[x * 3] = counter & 0xff;
+                band[x * 3 + 1] = counter >> 8;
+                band[x * 3 + 2] = counter >> 16;
+            }
+            else {
+                band[x] = pixel & 0xff;
+            }
+        }
+        return band;
+#else
+        if (frame) {
+            return frame + y * stride;
+        }
+        // bands are captured top to bottom, rows above the current band are gone
+        if (y < band_first) {
+            ei_printf("ERR: Snapshot row %d requested after row %d\n", y, band_first);
+            return nullptr;
+        }
+        // bands have to be read in sequence, skip the rows we don't need
+        while (y >= band_first + band_rows) {
+            if (!read_band(band_first + band_rows)) {
+                return nullptr;
+            }
+        }
+        return band + (y - band_first) * stride;
+#endif
+    }
+
+private:
+    EiCamera *camera;
+    int width;
+    int height;
+    int pixel_size_B;
+    size_t stride;
+    uint8_t *frame;
+    uint8_t *band;
+    int band_first;
+    int band_rows;
+    bool owns_frame;
+
+    bool read_band(int first_row)
+    {
+        band_first = first_row;
+        band_rows = std::min(SNAPSHOT_BAND_ROWS, height - first_row);
+        if (band_rows <= 0) {
+            return false;
+        }
+        return camera->ei_camera_capture_rows_packed_big_endian(
+            band,
+            first_row,
+            band_rows,
+            pixel_size_B == MONO_B_SIZE);
+    }
+};
+
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+static int32_t snapshot_jpeg_write(JPEGFILE *pFile, uint8_t *pBuf, int32_t iLen)
+{
+    base64_encode_chunk(reinterpret_cast<const char *>(pBuf), iLen, ei_putchar);
+    return iLen;
+}
+
+static void *snapshot_jpeg_open(const char *szFilename)
+{
+    // file handle isn't used in the internals, just return non NULL.
+    return (void *)1;
+}
+#endif
+
+/**
+ * Output side of the pipeline, collects SNAPSHOT_BAND_ROWS rows and then
+ * sends them as base64, JPEG encoded if EI_CAMERA_SNAPSHOT_JPEG is set.
+ */
+class SnapshotSink {
+public:
+    SnapshotSink(int width, int height, int pixel_size_B)
+        : width(width)
+        , height(height)
+        , pixel_size_B(pixel_size_B)
+        // round up to whole MCUs, the encoder always reads full 8x8 or 16x16 blocks
+        , pitch(((width + 15) & ~15) * pixel_size_B)
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+        , jpg(nullptr)
+#endif
+        , band(nullptr)
+        , band_first(0)
+        , rows_written(0)
+        , jpeg_error(false)
+    {
+    }
+
+    ~SnapshotSink()
+    {
+        if (band) {
+            ei_free(band);
+        }
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+        if (jpg) {
+            ei_free(jpg);
+        }
+#endif
+    }
+
+    bool begin()
+    {
+        band = (uint8_t *)ei_malloc(pitch * SNAPSHOT_BAND_ROWS);
+        if (!band) {
+            ei_printf("ERR: Cannot allocate memory for snapshot band\n");
+            return false;
+        }
+
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+        // plain data, initialized by open()
+        jpg = (JPEGClass *)ei_malloc(sizeof(JPEGClass));
+        if (!jpg) {
+            ei_printf("ERR: Cannot allocate memory for JPEG encoder\n");
+            return false;
+        }
+
+        int rc = jpg->open("snapshot.jpg", snapshot_jpeg_open, nullptr, nullptr, snapshot_jpeg_write, nullptr);
+        if (rc == JPEG_SUCCESS) {
+            rc = jpg->encodeBegin(
+                &jpe,
+                width,
+                height,
+                pixel_size_B == RGB888_B_SIZE ? JPEG_PIXEL_RGB888 : JPEG_PIXEL_GRAYSCALE,
+                JPEG_SUBSAMPLE_444,
+                JPEG_Q_BEST);
+        }
+        if (rc != JPEG_SUCCESS) {
+            ei_printf("ERR: Failed to start JPEG encoder (%d)\n", rc);
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    /**
+     * Where to write row y, rows must be written in order.
+     * Sends the previous band once the first row of the next one is requested.
+     * Skipping a row, or going back to a band that was sent, returns nullptr.
+     */
+    uint8_t *get_row(int y)
+    {
+        if (y < band_first || y > rows_written || y >= height) {
+            ei_printf("ERR: Snapshot row %d written out of order\n", y);
+            return nullptr;
+        }
+        if (y >= band_first + SNAPSHOT_BAND_ROWS) {
+            if (!flush(SNAPSHOT_BAND_ROWS)) {
+                return nullptr;
+            }
+            band_first += SNAPSHOT_BAND_ROWS;
+        }
+        rows_written = y + 1;
+        return band + (y - band_first) * pitch;
+    }
+
+    bool end()
+    {
+        bool isOK = flush(rows_written - band_first);
+
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+        if (jpg) {
+            jpg->close();
+        }
+#endif
+        base64_encode_finish(ei_putchar);
+
+        return isOK && !jpeg_error;
+    }
+
+private:
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+    JPEGENCODE jpe;
+#endif
+    int width;
+    int height;
+    int pixel_size_B;
+    size_t pitch;
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+    // ~5 KB of encoder state, only allocated while a snapshot is sent
+    JPEGClass *jpg;
+#endif
+    uint8_t *band;
+    int band_first;
+    int rows_written;
+    bool jpeg_error;
+
+    bool flush(int rows)
+    {
+        if (jpeg_error) {
+            return false;
+        }
+        if (rows <= 0) {
+            return true;
+        }
+
+#if EI_CAMERA_SNAPSHOT_JPEG == 1
+        const int mcu = jpe.cy;
+        const int padded_rows = ((rows + mcu - 1) / mcu) * mcu;
+        const size_t row_size = width * pixel_size_B;
+
+        for (int y = 0; y < padded_rows; y++) {
+            uint8_t *row = band + y * pitch;
+
+            if (y >= rows) {
+                // replicate the last row into the partial MCU
+                memcpy(row, band + (rows - 1) * pitch, row_size);
+            }
+            else if (pixel_size_B == RGB888_B_SIZE) {
+                // the encoder expects BGR
+                for (size_t ix = 0; ix < row_size; ix += 3) {
+                    uint8_t r = row[ix];
+                    row[ix] = row[ix + 2];
+                    row[ix + 2] = r;
+                }
+            }
+            // replicate the last column into the partial MCU
+            for (size_t ix = row_size; ix < pitch; ix++) {
+                row[ix] = row[ix - pixel_size_B];
+            }
+        }
+
+        for (int y = 0; y < padded_rows; y += mcu) {
+            do {
+                int rc = jpg->addMCU(&jpe, band + y * pitch + jpe.x * pixel_size_B, pitch);
+                if (rc != JPEG_SUCCESS) {
+                    ei_printf("ERR: Failed to encode snapshot (%d)\n", rc);
+                    jpeg_error = true;
+                    return false;
+                }
+            } while (jpe.x != 0);
+        }
+#else
+        for (int y = 0; y < rows; y++) {
+            base64_encode_chunk(reinterpret_cast<const char *>(band + y * pitch), width * pixel_size_B, ei_putchar);
+        }
+#endif
+        return true;
+    }
+};
+
 static bool ei_camera_take_snapshot_encode_and_output_no_init(size_t width, size_t height)
 {
     using namespace ei::image::processing;
@@ -103,95 +449,62 @@ static bool ei_camera_take_snapshot_encode_and_output_no_init(size_t width, size
         height = fb_resoluton.height;
     }
 
-    uint32_t size = width * height * pixel_size_B;
+    SnapshotSource source(camera, width, height, pixel_size_B);
+    SnapshotSink sink(final_width, final_height, pixel_size_B);
 
-#if ALLIGNED_BUFFER
-    // 32 BYTE aligned buffer
-    auto image_p = std::unique_ptr<uint8_t, decltype(free) *> { reinterpret_cast<uint8_t *>(
-                                                                    memalign(32, size)),
-                                                                free };
-    auto image = image_p.get();
-#else // more portable version
-
-    // try to get framebuffer to be used for image transformations
-    // from the camera
-    // if the camera driver does not make it possible
-    // then create our own second framebuffer
-    uint8_t* image = nullptr;
-    if (!camera->get_fb_ptr(&image)) {
-        std::unique_ptr<uint8_t[]> image_p(new uint8_t[size]);
-        if (!image_p) {
-            ei_printf("ERR: Cannot allocate memory for framebuffer\n");
-            return false;
-        }
-        image = image_p.get();
-    }
-    else {
-        camera->get_fb_ptr(&image);
+    if (!source.begin() || !sink.begin()) {
+        return false;
     }
 
-#endif
+    bool isOK = true;
 
-#if SEND_TEST_IMAGE
-    uint32_t counter = 0;
-    switch(pixel_size_B) {
-        case RGB888_B_SIZE:
-            for (int i = 0; i < size; i += 3) {
-                image[i] = counter & 0xff;
-                image[i + 1] = counter >> 8;
-                image[i + 2] = counter >> 16;
-                counter += 100;
+    if (needs_a_resize) {
+        int crop_width, crop_height;
+        // keep the aspect ratio of the snapshot, same as crop_and_interpolate_image
+        calculate_crop_dims(width, height, final_width, final_height, crop_width, crop_height);
+
+        // own scratch, the shared resize scratch belongs to the inference thread
+        uint8_t *scratch = (uint8_t *)ei_malloc(crop_resize_scratch_size(final_width, pixel_size_B));
+        int res = ei::EIDSP_OUT_OF_MEM;
+        if (scratch) {
+            res = crop_resize_image_rows(
+                [&source](int y) { return source.get_row(y); },
+                width,
+                height,
+                (width - crop_width) / 2,
+                (height - crop_height) / 2,
+                crop_width,
+                crop_height,
+                [&sink](int y) { return sink.get_row(y); },
+                final_width,
+                final_height,
+                pixel_size_B,
+                false,
+                scratch);
+            ei_free(scratch);
+        }
+        else {
+            ei_printf("ERR: Failed to allocate resize scratch\n");
+        }
+        isOK = (res == ei::EIDSP_OK);
+    }
+    else {
+        for (size_t y = 0; y < height && isOK; y++) {
+            const uint8_t *src = source.get_row(y);
+            uint8_t *dst = sink.get_row(y);
+            if (src && dst) {
+                memcpy(dst, src, width * pixel_size_B);
             }
-            break;
-        case MONO_B_SIZE:
-            for (int i = 0; i < size; i += 1) {
-                if (counter >= 256) { counter = 0; }
-                image[i] = counter;
-                counter += 1;
+            else {
+                isOK = false;
             }
-            break;
-        default:
-            ei_printf("ERR: Wrong pixel size, not supported: %d\n", pixel_size_B);
-            break;
-    }
-#else
-    bool isOK = false;
-    switch(pixel_size_B) {
-        case RGB888_B_SIZE:
-            isOK = camera->ei_camera_capture_rgb888_packed_big_endian(image, size);
-            break;
-        case MONO_B_SIZE:
-            isOK = camera->ei_camera_capture_grayscale_packed_big_endian(image, size);
-            break;
-        default:
-            ei_printf("ERR: Wrong pixel size, not supported: %d\n", pixel_size_B);
-            break;
-    }
-
-    if (!isOK) {
-        return false;
-    }
-
-    if (needs_a_resize) {
-        // interpolate in place
-        ei::image::processing::crop_and_interpolate_image(
-            image,
-            width,
-            height,
-            image,
-            final_width,
-            final_height,
-            pixel_size_B);
+        }
     }
-#endif
 
-    // recalculate size b/c now we want to send just the interpolated bytes
-    base64_encode(
-        reinterpret_cast<char *>(image),
-        final_height * final_width * pixel_size_B,
-        ei_putchar);
+    // always terminate the base64 stream, the daemon waits for it
+    isOK &= sink.end();
 
-    return true;
+    return isOK;
 }
 
 extern bool
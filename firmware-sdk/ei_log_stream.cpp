@@ -0,0 +1,88 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_log_stream.h"
+#include "ei_device_memory.h"
+
+static uint8_t *put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+size_t ei_log_record_encode(
+    uint8_t *buf,
+    size_t buf_len,
+    uint32_t format_id,
+    const uint32_t *args,
+    uint8_t arg_count,
+    uint16_t sequence,
+    uint32_t timestamp_ms)
+{
+    const size_t payload_len = 8 + 4 * (size_t)arg_count;
+    const size_t record_len = EI_LOG_RECORD_HEADER_SIZE + payload_len + EI_LOG_RECORD_CRC_SIZE;
+    uint8_t *p = buf;
+
+    if (arg_count > EI_LOG_RECORD_MAX_ARGS || buf_len < record_len) {
+        return 0;
+    }
+
+    *p++ = EI_LOG_RECORD_SYNC_0;
+    *p++ = EI_LOG_RECORD_SYNC_1;
+    *p++ = EI_LOG_RECORD_VERSION;
+    *p++ = arg_count;
+    p = put_u16(p, sequence);
+    p = put_u16(p, (uint16_t)payload_len);
+
+    p = put_u32(p, format_id);
+    p = put_u32(p, timestamp_ms);
+    for (uint8_t ix = 0; ix < arg_count; ix++) {
+        p = put_u32(p, args[ix]);
+    }
+
+    p = put_u32(p, EiDeviceMemory::crc32(buf, (uint32_t)(p - buf)));
+
+    return (size_t)(p - buf);
+}
@@ -0,0 +1,156 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_LOG_STREAM_H
+#define EI_LOG_STREAM_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+/**
+ * Deferred log records: instead of formatting, a hot path sends the ID of its format
+ * string and the raw arguments, and the host formats them (tools/ei_result_decoder.py
+ * with --sources). The ID is the FNV-1a hash of the format string, computed at compile
+ * time, so the string isn't even in the firmware. Each record is one frame, with the
+ * header of a result frame (see ei_result_stream.h) and its own sync bytes:
+ *
+ *   0  u8[2]  sync (0xEB 0x91)
+ *   2  u8     version (EI_LOG_RECORD_VERSION)
+ *   3  u8     number of arguments
+ *   4  u16    sequence number, +1 per record
+ *   6  u16    payload length
+ *   8         payload:
+ *       u32   format ID
+ *       u32   timestamp (ms)
+ *       u32   arguments, integers as 32 bit, float and double as float
+ *   ...u32    CRC32 (as zlib) of everything before it
+ *
+ * Strings can't be arguments, use one format per string instead.
+ */
+#define EI_LOG_RECORD_SYNC_0            0xEB
+#define EI_LOG_RECORD_SYNC_1            0x91
+#define EI_LOG_RECORD_VERSION           1
+#define EI_LOG_RECORD_HEADER_SIZE       8
+#define EI_LOG_RECORD_CRC_SIZE          4
+#define EI_LOG_RECORD_MAX_ARGS          8
+
+/** Largest record */
+#define EI_LOG_RECORD_MAX_SIZE \
+    (EI_LOG_RECORD_HEADER_SIZE + 8 + 4 * EI_LOG_RECORD_MAX_ARGS + EI_LOG_RECORD_CRC_SIZE)
+
+#ifndef EI_LOG_RECORDS_ENABLED
+#define EI_LOG_RECORDS_ENABLED          0
+#endif
+
+/**
+ * @brief FNV-1a hash of a format string, the ID of its records
+ */
+constexpr uint32_t ei_log_format_id(const char *format, uint32_t hash = 2166136261u)
+{
+    return *format ? ei_log_format_id(format + 1, (hash ^ (uint8_t)*format) * 16777619u) : hash;
+}
+
+/**
+ * @brief Encode a log record
+ *
+ * @param buf output, at least EI_LOG_RECORD_MAX_SIZE
+ * @param format_id ei_log_format_id() of the format string
+ * @param args arguments as 32 bit words
+ * @param arg_count number of arguments, at most EI_LOG_RECORD_MAX_ARGS
+ * @param sequence sequence number of the record
+ * @param timestamp_ms time of the record
+ * @return record length, 0 if buf is too small or there are too many arguments
+ */
+size_t ei_log_record_encode(
+    uint8_t *buf,
+    size_t buf_len,
+    uint32_t format_id,
+    const uint32_t *args,
+    uint8_t arg_count,
+    uint16_t sequence,
+    uint32_t timestamp_ms);
+
+/**
+ * @brief Send a log record, implemented by the port (numbers the records and
+ * queues them for the serial port)
+ */
+void ei_log_record_send(uint32_t format_id, const uint32_t *args, uint8_t arg_count);
+
+static inline uint32_t ei_log_word(float value)
+{
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+static inline uint32_t ei_log_word(double value)
+{
+    return ei_log_word((float)value);
+}
+
+template<typename T>
+static inline uint32_t ei_log_word(T value)
+{
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                  "log record arguments are numbers, use a format per string instead");
+    static_assert(sizeof(T) <= sizeof(uint32_t), "log record arguments are at most 32 bit");
+    return (uint32_t)value;
+}
+
+template<typename... Args>
+static inline void ei_log_record(uint32_t format_id, Args... args)
+{
+    static_assert(sizeof...(Args) <= EI_LOG_RECORD_MAX_ARGS, "too many log record arguments");
+    // leading 0, so there's an array without arguments too
+    const uint32_t words[] = { 0, ei_log_word(args)... };
+
+    ei_log_record_send(format_id, &words[1], (uint8_t)sizeof...(Args));
+}
+
+/**
+ * @brief printf-like output for hot paths: a log record with EI_LOG_RECORDS_ENABLED,
+ * ei_printf otherwise. The format must be a string literal.
+ */
+#if EI_LOG_RECORDS_ENABLED == 1
+#define EI_LOG_RECORD(format, ...) \
+    ei_log_record(std::integral_constant<uint32_t, ei_log_format_id(format)>::value, ##__VA_ARGS__)
+#else
+#define EI_LOG_RECORD(format, ...) ei_printf(format, ##__VA_ARGS__)
+#endif
+
+#endif /* EI_LOG_STREAM_H */
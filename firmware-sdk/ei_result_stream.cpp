@@ -0,0 +1,195 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_result_stream.h"
+#include "ei_device_memory.h"
+#include <cmath>
+#include <cstring>
+
+static const char *result_format_names[] = { "TEXT", "BIN8", "BIN16" };
+
+static uint8_t *put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+static uint32_t saturate_u32(int64_t value)
+{
+    return value < 0 ? 0 : (value > UINT32_MAX ? UINT32_MAX : (uint32_t)value);
+}
+
+/**
+ * @brief IEEE 754 half precision, rounded to nearest even
+ */
+static uint16_t float_to_half(float value)
+{
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+
+    const uint16_t sign = (f >> 16) & 0x8000;
+    const int32_t exponent = (int32_t)((f >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = f & 0x7fffff;
+    uint32_t half;
+    uint32_t rest;
+    uint32_t middle;
+
+    if (((f >> 23) & 0xff) == 0xff) {
+        // inf, nan
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 31) {
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0) {
+        // subnormal (or 0)
+        if (exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        const uint32_t shift = 14 - exponent;
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        middle = 1u << (shift - 1);
+    }
+    else {
+        half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+        rest = mantissa & 0x1fff;
+        middle = 0x1000;
+    }
+
+    // a carry into the exponent is still correct
+    if (rest > middle || (rest == middle && (half & 1))) {
+        half++;
+    }
+
+    return sign | (uint16_t)half;
+}
+
+size_t ei_result_frame_encode(
+    uint8_t *buf,
+    size_t buf_len,
+    const ei_impulse_t *impulse,
+    const ei_impulse_result_t *result,
+    ei_result_format_t format,
+    uint16_t sequence,
+    uint32_t timestamp_ms)
+{
+    const bool f16 = (format == EI_RESULT_FORMAT_BINARY_F16);
+    const uint8_t label_count = impulse->label_count > UINT8_MAX ? UINT8_MAX : (uint8_t)impulse->label_count;
+    const size_t payload_len = 21 + label_count * (f16 ? 2 : 1) + (impulse->has_anomaly ? 2 : 0);
+    const size_t frame_len = EI_RESULT_FRAME_HEADER_SIZE + payload_len + EI_RESULT_FRAME_CRC_SIZE;
+    uint8_t flags = 0;
+    uint8_t *p = buf;
+
+    if (buf_len < frame_len) {
+        return 0;
+    }
+
+    if (f16) {
+        flags |= EI_RESULT_FLAG_F16;
+    }
+    if (impulse->has_anomaly) {
+        flags |= EI_RESULT_FLAG_ANOMALY;
+    }
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    if (result->gate.decision != EI_GATE_RAN) {
+        flags |= EI_RESULT_FLAG_SKIPPED;
+    }
+#endif
+
+    *p++ = EI_RESULT_FRAME_SYNC_0;
+    *p++ = EI_RESULT_FRAME_SYNC_1;
+    *p++ = EI_RESULT_FRAME_VERSION;
+    *p++ = flags;
+    p = put_u16(p, sequence);
+    p = put_u16(p, (uint16_t)payload_len);
+
+    p = put_u32(p, timestamp_ms);
+    p = put_u32(p, saturate_u32(result->timing.dsp_us));
+    p = put_u32(p, saturate_u32(result->timing.classification_us));
+    p = put_u32(p, saturate_u32(result->timing.postprocessing_us));
+    p = put_u32(p, saturate_u32(result->timing.anomaly_us));
+    *p++ = label_count;
+
+    for (uint8_t ix = 0; ix < label_count; ix++) {
+        const float value = result->classification[ix].value;
+
+        if (f16) {
+            p = put_u16(p, float_to_half(value));
+        }
+        else {
+            const float q = roundf(value * 127.0f);
+            *p++ = (uint8_t)(int8_t)(q > 127.0f ? 127 : (q < -128.0f ? -128 : (int)q));
+        }
+    }
+
+    if (impulse->has_anomaly) {
+        p = put_u16(p, float_to_half(result->anomaly));
+    }
+
+    p = put_u32(p, EiDeviceMemory::crc32(buf, (uint32_t)(p - buf)));
+
+    return (size_t)(p - buf);
+}
+
+const char *ei_result_format_name(ei_result_format_t format)
+{
+    if ((size_t)format >= sizeof(result_format_names) / sizeof(result_format_names[0])) {
+        return "?";
+    }
+    return result_format_names[format];
+}
+
+bool ei_result_format_from_name(const char *name, ei_result_format_t *format)
+{
+    for (size_t ix = 0; ix < sizeof(result_format_names) / sizeof(result_format_names[0]); ix++) {
+        if (strcmp(name, result_format_names[ix]) == 0) {
+            *format = (ei_result_format_t)ix;
+            return true;
+        }
+    }
+    return false;
+}
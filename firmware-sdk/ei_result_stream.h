@@ -0,0 +1,114 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_RESULT_STREAM_H
+#define EI_RESULT_STREAM_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstddef>
+#include <cstdint>
+#include "edge-impulse-sdk/classifier/ei_model_types.h"
+
+/**
+ * Binary inference results, for hosts that read results faster than they can be
+ * formatted as text. Each result is one frame, all fields are little endian:
+ *
+ *   0  u8[2]  sync (0xEB 0x90)
+ *   2  u8     version (EI_RESULT_FRAME_VERSION)
+ *   3  u8     flags (EI_RESULT_FLAG_*)
+ *   4  u16    sequence number, +1 per frame
+ *   6  u16    payload length
+ *   8         payload:
+ *       u32   timestamp (ms)
+ *       u32   DSP, classification, postprocessing and anomaly time (us)
+ *       u8    number of scores
+ *       ...   scores in label order, int8 (score * 127) or float16
+ *       [f16] anomaly score, if EI_RESULT_FLAG_ANOMALY
+ *   ...u32    CRC32 (as zlib) of everything before it
+ *
+ * Text can be interleaved on the same channel, a decoder looks for the sync bytes
+ * and drops frames that don't pass the CRC.
+ */
+#define EI_RESULT_FRAME_SYNC_0          0xEB
+#define EI_RESULT_FRAME_SYNC_1          0x90
+#define EI_RESULT_FRAME_VERSION         1
+#define EI_RESULT_FRAME_HEADER_SIZE     8
+#define EI_RESULT_FRAME_CRC_SIZE        4
+
+#define EI_RESULT_FLAG_F16              0x01  // scores are float16, int8 otherwise
+#define EI_RESULT_FLAG_ANOMALY          0x02  // anomaly score after the scores
+#define EI_RESULT_FLAG_SKIPPED          0x04  // learning blocks didn't run (impulse gate)
+
+/** Largest frame for label_count labels */
+#define EI_RESULT_FRAME_MAX_SIZE(label_count) \
+    (EI_RESULT_FRAME_HEADER_SIZE + 21 + 2 * (label_count) + 2 + EI_RESULT_FRAME_CRC_SIZE)
+
+typedef enum {
+    EI_RESULT_FORMAT_TEXT = 0,
+    EI_RESULT_FORMAT_BINARY_INT8,
+    EI_RESULT_FORMAT_BINARY_F16
+} ei_result_format_t;
+
+/**
+ * @brief AT+RESULTFORMAT name of a format: TEXT, BIN8 or BIN16
+ */
+const char *ei_result_format_name(ei_result_format_t format);
+
+/**
+ * @brief Format from its AT+RESULTFORMAT name (case sensitive)
+ *
+ * @param[out] format left as is if the name is unknown
+ * @return false if the name is unknown
+ */
+bool ei_result_format_from_name(const char *name, ei_result_format_t *format);
+
+/**
+ * @brief Encode a result frame
+ *
+ * @param buf output, at least EI_RESULT_FRAME_MAX_SIZE(impulse->label_count)
+ * @param format EI_RESULT_FORMAT_BINARY_INT8 or EI_RESULT_FORMAT_BINARY_F16
+ * @param sequence sequence number of the frame
+ * @param timestamp_ms time of the result
+ * @return frame length, 0 if buf is too small
+ */
+size_t ei_result_frame_encode(
+    uint8_t *buf,
+    size_t buf_len,
+    const ei_impulse_t *impulse,
+    const ei_impulse_result_t *result,
+    ei_result_format_t format,
+    uint16_t sequence,
+    uint32_t timestamp_ms);
+
+#endif /* EI_RESULT_STREAM_H */
@@ -38,6 +38,7 @@
 #include <cstdlib>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <memory>
 
 #define REMOTE_MANAGEMENT_VERSION   3
@@ -207,151 +208,224 @@ int get_hello_msg(uint8_t* buf, size_t buf_len, EiDeviceInfo* device)
     return encoded.len;
 }
 
-unique_ptr<DecodedMessage> decode_message(const uint8_t* buf, size_t buf_len, EiDeviceInfo *device)
+/**
+ * @brief FNV-1a hash, constexpr for the labels we know about
+ */
+static constexpr uint32_t label_hash(const char *label, uint32_t hash = 2166136261u)
+{
+    return *label ? label_hash(label + 1, (hash ^ (uint8_t)*label) * 16777619u) : hash;
+}
+
+static uint32_t label_hash(UsefulBufC label)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t ix = 0; ix < label.len; ix++) {
+        hash = (hash ^ ((const uint8_t *)label.ptr)[ix]) * 16777619u;
+    }
+
+    return hash;
+}
+
+typedef enum {
+    LABEL_UNKNOWN,
+    LABEL_HELLO,
+    LABEL_ERR,
+    LABEL_START_SNAPSHOT,
+    LABEL_STOP_SNAPSHOT,
+    LABEL_SAMPLE,
+    LABEL_PATH,
+    LABEL_LABEL,
+    LABEL_HMAC_KEY,
+    LABEL_INTERVAL,
+    LABEL_LENGTH,
+    LABEL_SENSOR
+} label_t;
+
+#define LABEL_CASE(name, id) \
+    case label_hash(name): \
+        return (label.len == sizeof(name) - 1 && memcmp(label.ptr, name, label.len) == 0) ? id : LABEL_UNKNOWN
+
+/**
+ * @brief Match a label against the input, by hash and then by length and content
+ */
+static label_t find_label(UsefulBufC label)
+{
+    switch (label_hash(label)) {
+        LABEL_CASE("hello", LABEL_HELLO);
+        LABEL_CASE("err", LABEL_ERR);
+        LABEL_CASE("startSnapshot", LABEL_START_SNAPSHOT);
+        LABEL_CASE("stopSnapshot", LABEL_STOP_SNAPSHOT);
+        LABEL_CASE("sample", LABEL_SAMPLE);
+        LABEL_CASE("path", LABEL_PATH);
+        LABEL_CASE("label", LABEL_LABEL);
+        LABEL_CASE("hmacKey", LABEL_HMAC_KEY);
+        LABEL_CASE("interval", LABEL_INTERVAL);
+        LABEL_CASE("length", LABEL_LENGTH);
+        LABEL_CASE("sensor", LABEL_SENSOR);
+    default:
+        return LABEL_UNKNOWN;
+    }
+}
+
+/**
+ * @brief Slice of at most REMOTE_MGMT_MAX_STRING_LEN bytes of a decoded string
+ */
+static UsefulBufC cut_string(UsefulBufC str)
+{
+    if (str.len > REMOTE_MGMT_MAX_STRING_LEN) {
+        str.len = REMOTE_MGMT_MAX_STRING_LEN;
+    }
+    return str;
+}
+
+static MessageType decoder_error(
+    QCBORDecodeContext *ctx,
+    remote_mgmt_message_t *msg,
+    decode_result_t err_code,
+    UsefulBufC err_message)
+{
+    QCBORDecode_Finish(ctx);
+    msg->type = MessageType::DecoderErrorType;
+    msg->decoder_error.err_code = err_code;
+    msg->decoder_error.err_message = cut_string(err_message);
+    return msg->type;
+}
+
+static std::string usefulbuf_to_string(UsefulBufC str)
+{
+    return str.ptr ? std::string((const char *)str.ptr, str.len) : std::string();
+}
+
+MessageType decode_message_in_place(UsefulBufC buf, remote_mgmt_message_t *msg, EiDeviceInfo *device)
 {
     QCBORDecodeContext ctx;
     QCBORItem item;
-    char buffer[128] = { 0 };
-    char sensor_name[128] = { 0 };
-    char label_buf[128] = { 0 };
-    uint32_t length = 0;
-    float interval = 0;
 
-    QCBORDecode_Init(&ctx, (UsefulBufC){ buf, buf_len}, QCBOR_DECODE_MODE_NORMAL);
+    QCBORDecode_Init(&ctx, buf, QCBOR_DECODE_MODE_NORMAL);
 
     // first one needs to be a map...
     if (QCBORDecode_GetNext(&ctx, &item) != QCBOR_SUCCESS || item.uDataType != QCBOR_TYPE_MAP) {
-        QCBORDecode_Finish(&ctx);
-        auto ret = make_unique_ptr<DecoderError>();
-        ret->err_code = ERR_MAP_EXPECTED;
-        ret->err_message = "Expected map on in main body";
-        return ret;
+        return decoder_error(&ctx, msg, ERR_MAP_EXPECTED, UsefulBuf_FROM_SZ_LITERAL("Expected map on in main body"));
     }
 
     // then we expect labels and handle them
     while (QCBORDecode_GetNext(&ctx, &item) == QCBOR_SUCCESS && item.uLabelType == QCBOR_TYPE_TEXT_STRING) {
-        memset(label_buf, 0, sizeof(label_buf));
-        memcpy(label_buf, item.label.string.ptr, item.label.string.len > 127 ? 127 : item.label.string.len);
-
-        if (strcmp(label_buf, "hello") == 0) {
-            auto ret = make_unique_ptr<HelloResponse>();
-            if (item.uDataType == QCBOR_TYPE_TRUE) {
-                ret->status = true;
-            }
-            else {
-                ret->status = false;
-                if(QCBORDecode_GetNext(&ctx, &item) == QCBOR_SUCCESS && item.uLabelType == QCBOR_TYPE_TEXT_STRING) {
-                    memset(buffer, 0, sizeof(buffer));
-                    memcpy(buffer, item.label.string.ptr, item.label.string.len > 127 ? 127 : item.label.string.len);
-                    ret->err_message = buffer;
-                }
+        switch (find_label(item.label.string)) {
+        case LABEL_HELLO:
+            msg->type = MessageType::HelloResponseType;
+            msg->hello_response.status = (item.uDataType == QCBOR_TYPE_TRUE);
+            msg->hello_response.err_message = NULLUsefulBufC;
+            // on failure the reason follows, eg. { "hello": false, "err": "..." }
+            if (!msg->hello_response.status && QCBORDecode_GetNext(&ctx, &item) == QCBOR_SUCCESS
+                && item.uLabelType == QCBOR_TYPE_TEXT_STRING && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
+                msg->hello_response.err_message = cut_string(item.val.string);
             }
             QCBORDecode_Finish(&ctx);
-            return ret;
-        }
-        else if (strcmp(label_buf, "err") == 0) {
-            auto ret = make_unique_ptr<ErrorResponse>();
-            if (item.uDataType == QCBOR_TYPE_TEXT_STRING) {
-                memset(buffer, 0, sizeof(buffer));
-                memcpy(buffer, item.val.string.ptr, item.val.string.len >= 127 ? 127 : item.val.string.len);
-                ret->err_message = buffer;
-            }
+            return msg->type;
+
+        case LABEL_ERR:
+            msg->type = MessageType::ErrorResponseType;
+            msg->error_response.err_message =
+                (item.uDataType == QCBOR_TYPE_TEXT_STRING) ? cut_string(item.val.string) : NULLUsefulBufC;
             QCBORDecode_Finish(&ctx);
-            return ret;
-        }
-        else if (strcmp(label_buf, "startSnapshot") == 0) {
-            auto ret = make_unique_ptr<StreamingStartRequest>();
-            if (item.uDataType == QCBOR_TYPE_TRUE) {
-                ret->status = true;
-            }
-            else {
-                ret->status = false;
-            }
+            return msg->type;
+
+        case LABEL_START_SNAPSHOT:
+            msg->type = MessageType::StreamingStartRequestType;
+            msg->streaming_start_request.status = (item.uDataType == QCBOR_TYPE_TRUE);
             QCBORDecode_Finish(&ctx);
-            return ret;
-        }
-        else if (strcmp(label_buf, "stopSnapshot") == 0) {
-            auto ret = make_unique_ptr<StreamingStopRequest>();
-            if (item.uDataType == QCBOR_TYPE_TRUE) {
-                ret->status = true;
-            }
-            else {
-                ret->status = false;
-            }
+            return msg->type;
+
+        case LABEL_STOP_SNAPSHOT:
+            msg->type = MessageType::StreamingStopRequestType;
+            msg->streaming_stop_request.status = (item.uDataType == QCBOR_TYPE_TRUE);
             QCBORDecode_Finish(&ctx);
-            return ret;
-        }
-        else if (strcmp(label_buf, "sample") == 0) {
+            return msg->type;
+
+        case LABEL_SAMPLE:
             if (item.uDataType != QCBOR_TYPE_MAP) {
-                QCBORDecode_Finish(&ctx);
-                auto ret = make_unique_ptr<DecoderError>();
-                ret->err_code = ERR_UNEXPECTED_TYPE;
-                ret->err_message = "Unexpected type for 'sample'";
-                return ret;
+                return decoder_error(&ctx, msg, ERR_UNEXPECTED_TYPE, UsefulBuf_FROM_SZ_LITERAL("Unexpected type for 'sample'"));
             }
 
+            msg->sample_request.sensor = NULLUsefulBufC;
             while (QCBORDecode_GetNext(&ctx, &item) == QCBOR_SUCCESS && item.uLabelType == QCBOR_TYPE_TEXT_STRING) {
-                memset(label_buf, 0, sizeof(label_buf));
-                memcpy(label_buf, item.label.string.ptr, item.label.string.len > 127 ? 127 : item.label.string.len);
+                label_t label = find_label(item.label.string);
 
-                if (strcmp(label_buf, "path") == 0 && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
-                    memset(buffer, 0, sizeof(buffer));
-                    memcpy(buffer, item.val.string.ptr, item.val.string.len >= sizeof(buffer) ? sizeof(buffer) : item.val.string.len);
-                    device->set_upload_path(buffer, false);
+                if (label == LABEL_PATH && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
+                    device->set_upload_path(usefulbuf_to_string(cut_string(item.val.string)), false);
                 }
-                else if (strcmp(label_buf, "label") == 0 && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
-                    memset(buffer, 0, sizeof(buffer));
-                    memcpy(buffer, item.val.string.ptr, item.val.string.len >= sizeof(buffer) ? sizeof(buffer) : item.val.string.len);
-                    device->set_sample_label(buffer, false);
+                else if (label == LABEL_LABEL && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
+                    device->set_sample_label(usefulbuf_to_string(cut_string(item.val.string)), false);
                 }
-                else if (strcmp(label_buf, "hmacKey") == 0 && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
-                    memset(buffer, 0, sizeof(buffer));
-                    memcpy(buffer, item.val.string.ptr, item.val.string.len >= sizeof(buffer) ? sizeof(buffer) : item.val.string.len);
-                    device->set_sample_hmac_key(buffer, false);
+                else if (label == LABEL_HMAC_KEY && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
+                    device->set_sample_hmac_key(usefulbuf_to_string(cut_string(item.val.string)), false);
                 }
-                else if (strcmp(label_buf, "interval") == 0 && item.uDataType == QCBOR_TYPE_INT64) {
-                    interval = (float)item.val.int64;
-                    device->set_sample_interval_ms(interval, false);
+                else if (label == LABEL_INTERVAL && item.uDataType == QCBOR_TYPE_INT64) {
+                    device->set_sample_interval_ms((float)item.val.int64, false);
                 }
-                else if (strcmp(label_buf, "interval") == 0 && item.uDataType == QCBOR_TYPE_DOUBLE) {
-                    interval = item.val.dfnum;
-                    device->set_sample_interval_ms(interval, false);
+                else if (label == LABEL_INTERVAL && item.uDataType == QCBOR_TYPE_DOUBLE) {
+                    device->set_sample_interval_ms(item.val.dfnum, false);
                 }
-                else if (strcmp(label_buf, "length") == 0 && item.uDataType == QCBOR_TYPE_INT64) {
-                    length = (uint32_t)item.val.int64;
-                    device->set_sample_length_ms(length, false);
+                else if (label == LABEL_LENGTH && item.uDataType == QCBOR_TYPE_INT64) {
+                    device->set_sample_length_ms((uint32_t)item.val.int64, false);
                 }
-                else if (strcmp(label_buf, "sensor") == 0 && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
-                    memset(sensor_name, 0, sizeof(sensor_name));
-                    memcpy(sensor_name, item.val.string.ptr, item.val.string.len >= sizeof(sensor_name) ? sizeof(sensor_name) : item.val.string.len);
+                else if (label == LABEL_SENSOR && item.uDataType == QCBOR_TYPE_TEXT_STRING) {
+                    msg->sample_request.sensor = cut_string(item.val.string);
                 }
                 else {
-                    QCBORDecode_Finish(&ctx);
-                    auto ret = make_unique_ptr<DecoderError>();
-                    ret->err_code = ERR_UNKNOWN_FIELD;
-                    ret->err_message = label_buf;
-                    return ret;
+                    return decoder_error(&ctx, msg, ERR_UNKNOWN_FIELD, item.label.string);
                 }
             }
             QCBORDecode_Finish(&ctx);
-            auto ret = make_unique_ptr<SampleRequest>();
-            ret->sensor = sensor_name;
+            msg->type = MessageType::SampleRequestType;
             device->save_config();
-            return ret;
-        }
-        else {
-            QCBORDecode_Finish(&ctx);
-            auto ret = make_unique_ptr<DecoderError>();
-            ret->err_code = ERR_UNKNOWN_FIELD;
-            ret->err_message = label_buf;
-            return ret;
+            return msg->type;
+
+        default:
+            return decoder_error(&ctx, msg, ERR_UNKNOWN_FIELD, item.label.string);
         }
     }
 
-    QCBORDecode_Finish(&ctx);
+    return decoder_error(&ctx, msg, ERR_UNKNOWN, UsefulBuf_FROM_SZ_LITERAL("Decoder loop terminasted"));
+}
 
-    auto ret = make_unique_ptr<DecoderError>();
-    ret->err_code = ERR_UNKNOWN;
-    ret->err_message = "Decoder loop terminasted";
-    return ret;
+unique_ptr<DecodedMessage> decode_message(const uint8_t* buf, size_t buf_len, EiDeviceInfo *device)
+{
+    remote_mgmt_message_t msg;
+
+    switch (decode_message_in_place((UsefulBufC){ buf, buf_len }, &msg, device)) {
+    case MessageType::HelloResponseType: {
+        auto ret = make_unique_ptr<HelloResponse>();
+        ret->status = msg.hello_response.status;
+        ret->err_message = usefulbuf_to_string(msg.hello_response.err_message);
+        return ret;
+    }
+    case MessageType::ErrorResponseType: {
+        auto ret = make_unique_ptr<ErrorResponse>();
+        ret->err_message = usefulbuf_to_string(msg.error_response.err_message);
+        return ret;
+    }
+    case MessageType::SampleRequestType: {
+        auto ret = make_unique_ptr<SampleRequest>();
+        ret->sensor = usefulbuf_to_string(msg.sample_request.sensor);
+        return ret;
+    }
+    case MessageType::StreamingStartRequestType: {
+        auto ret = make_unique_ptr<StreamingStartRequest>();
+        ret->status = msg.streaming_start_request.status;
+        return ret;
+    }
+    case MessageType::StreamingStopRequestType: {
+        auto ret = make_unique_ptr<StreamingStopRequest>();
+        ret->status = msg.streaming_stop_request.status;
+        return ret;
+    }
+    default: {
+        auto ret = make_unique_ptr<DecoderError>();
+        ret->err_code = msg.decoder_error.err_code;
+        ret->err_message = usefulbuf_to_string(msg.decoder_error.err_message);
+        return ret;
+    }
+    }
 }
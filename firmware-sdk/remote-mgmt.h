@@ -37,6 +37,7 @@
 #include <string>
 #include <memory>
 #include "ei_device_info_lib.h"
+#include "QCBOR/inc/UsefulBuf.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -116,6 +117,40 @@ public:
     }
 };
 
+// longest string taken from a message, longer ones are cut (as in the 128 byte buffers they were copied to)
+#define REMOTE_MGMT_MAX_STRING_LEN  127
+
+/**
+ * @brief Message decoded by decode_message_in_place. Strings point into the decoded
+ * buffer (they are not NUL terminated), so the message is valid as long as the buffer is.
+ * They are at most REMOTE_MGMT_MAX_STRING_LEN bytes, as are the strings set on the device.
+ */
+typedef struct {
+    MessageType type;
+    union {
+        struct {
+            decode_result_t err_code;
+            UsefulBufC err_message;
+        } decoder_error;
+        struct {
+            bool status;
+            UsefulBufC err_message;
+        } hello_response;
+        struct {
+            UsefulBufC err_message;
+        } error_response;
+        struct {
+            UsefulBufC sensor;
+        } sample_request;
+        struct {
+            bool status;
+        } streaming_start_request;
+        struct {
+            bool status;
+        } streaming_stop_request;
+    };
+} remote_mgmt_message_t;
+
 /**
  * @brief This message should be sent after receiving SampleRequest (it is ack message)
  * @param buf Buffer to write the message to
@@ -186,6 +221,19 @@ int get_snapshot_frame_msg(uint8_t* buf, size_t buf_len, const char* frame);
 */
 int get_hello_msg(uint8_t* buf, size_t buf_len, EiDeviceInfo* device);
 
+/**
+ * @brief Decode a message from Remote Management Service, without copies or heap allocations.
+ * Sample settings from a SampleRequest are applied to the device (and saved).
+ * @param buf Encoded message
+ * @param msg Caller-supplied storage for the decoded message
+ * @param device device instance
+ * @return msg->type
+ */
+MessageType decode_message_in_place(UsefulBufC buf, remote_mgmt_message_t *msg, EiDeviceInfo *device);
+
+/**
+ * @brief As decode_message_in_place, with the message and its strings on the heap
+ */
 std::unique_ptr<DecodedMessage> decode_message(const uint8_t* buf, size_t buf_len, EiDeviceInfo *device);
 
 #ifdef __cplusplus
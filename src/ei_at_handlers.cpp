@@ -43,6 +43,7 @@ inline bool check_args_num(const int &required, const int &received)
 {
     if(received < required) {
         ei_printf("Too few arguments! Required: %d\n", required);
+        ATServer::get_instance()->fail_command();
         return false;
     }
 
@@ -60,6 +61,7 @@ bool at_set_device_id(const char **argv, const int argc)
 {
     if(argc < 1) {
         ei_printf("Missing argument!\n");
+        ATServer::get_instance()->fail_command();
         return true;
     }
 
@@ -81,6 +83,7 @@ bool at_set_upload_host(const char **argv, const int argc)
 {
     if(argc < 1) {
         ei_printf("Missing argument!\n");
+        ATServer::get_instance()->fail_command();
         return true;
     }
 
@@ -104,6 +107,7 @@ bool at_set_upload_settings(const char **argv, const int argc)
 {
     if(argc < 2) {
         ei_printf("Missing argument! Required: " AT_UPLOADSETTINGS_ARGS "\n");
+        ATServer::get_instance()->fail_command();
         return true;
     }
 
@@ -127,6 +131,7 @@ bool at_set_mgmt_url(const char **argv, const int argc)
 {
     if(argc < 1) {
         ei_printf("Missing argument!\n");
+        ATServer::get_instance()->fail_command();
         return true;
     }
 
@@ -151,6 +156,7 @@ bool at_set_sample_settings(const char **argv, const int argc)
 {
     if(argc < 3) {
         ei_printf("Missing argument! Required: " AT_SAMPLESETTINGS_ARGS "\n");
+        ATServer::get_instance()->fail_command();
         return true;
     }
 
@@ -197,6 +203,7 @@ bool at_read_buffer(const char **argv, const int argc)
 {
     if(argc < 2) {
         ei_printf("Missing argument! Required: " AT_READBUFFER_ARGS "\n");
+        ATServer::get_instance()->fail_command();
         return true;
     }
 
@@ -229,6 +236,7 @@ bool at_read_buffer(const char **argv, const int argc)
     if (!success) {
         ei_printf("ERR: Failed to read from buffer\n");
         dev->set_state(eiStateIdle);
+        ATServer::get_instance()->fail_command();
     }
     else {
         ei_printf("\n");
@@ -244,6 +252,7 @@ bool at_sample_start(const char **argv, const int argc)
     dev->set_serial_channel(UART);
     if(argc < 1) {
         ei_printf("Missing sensor name!\n");
+        ATServer::get_instance()->fail_command();
         return true;
     }
 
@@ -257,6 +266,7 @@ bool at_sample_start(const char **argv, const int argc)
             if (!sensor_list[ix].start_sampling_cb()) {
                 ei_printf("ERR: Failed to start sampling\n");
                 dev->set_state(eiStateIdle);
+                ATServer::get_instance()->fail_command();
             }
             else {
                 dev->set_state(eiStateFinished);
@@ -269,6 +279,7 @@ bool at_sample_start(const char **argv, const int argc)
         if (!ei_fusion_setup_data_sampling()) {
             ei_printf("ERR: Failed to start sensor fusion sampling\n");
             dev->set_state(eiStateIdle);
+            ATServer::get_instance()->fail_command();
         }
         else {
             dev->set_state(eiStateFinished);
@@ -276,6 +287,7 @@ bool at_sample_start(const char **argv, const int argc)
     }
     else {
         ei_printf("ERR: Failed to find sensor '%s' in the sensor list\n", argv[0]);
+        ATServer::get_instance()->fail_command();
     }
 
     return true;
@@ -287,6 +299,12 @@ bool at_run_impulse(void)
     dev->set_serial_channel(UART);
     ei_start_impulse(false, false);
 
+    if (!is_inference_running()) {
+        ATServer::get_instance()->fail_command();
+        return true;
+    }
+
+    // still running, the prompt comes once it's stopped
     return false;
 }
 
@@ -296,6 +314,11 @@ bool at_run_impulse_cont(void)
     dev->set_serial_channel(UART);
     ei_start_impulse(true, false);
 
+    if (!is_inference_running()) {
+        ATServer::get_instance()->fail_command();
+        return true;
+    }
+
     return false;
 }
 
@@ -304,15 +327,110 @@ bool at_run_impulse_static_data(const char **argv, const int argc)
     EiDeviceNRF *dev = static_cast<EiDeviceNRF*>(EiDeviceInfo::get_device());
     dev->set_serial_channel(UART);
     if (check_args_num(2, argc) == false) {
-        return false;
+        return true;
     }
 
     bool debug = (argv[0][0] == 'y');
     size_t length = (size_t)atoi(argv[1]);
 
-    bool res = run_impulse_static_data(debug, length, TRANSFER_BUF_LEN);
+    // synchronous, so done also if it failed
+    if (!run_impulse_static_data(debug, length, TRANSFER_BUF_LEN)) {
+        ATServer::get_instance()->fail_command();
+    }
+
+    return true;
+}
 
-    return res;
+bool at_get_result_format(void)
+{
+    ei_printf("%s\n", ei_result_format_name(ei_get_result_format()));
+
+    return true;
+}
+
+bool at_set_result_format(const char **argv, const int argc)
+{
+    ei_result_format_t format;
+
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    if (ei_result_format_from_name(argv[0], &format) == false) {
+        ei_printf("Unknown format '%s', expected TEXT, BIN8 or BIN16\n", argv[0]);
+        ATServer::get_instance()->fail_command();
+        return true;
+    }
+
+    ei_set_result_format(format);
+    ei_printf("OK\n");
+
+    return true;
+}
+
+static const char *report_mode_names[] = { "ALL", "ONCHANGE", "THRESHOLD", "SUMMARY" };
+
+bool at_get_report_mode(void)
+{
+    ei_report_config_t config;
+
+    ei_get_report_config(&config);
+    ei_printf("%s,", report_mode_names[config.mode]);
+    ei_printf_float(config.threshold);
+    ei_printf(",");
+    ei_printf_float(config.hysteresis);
+    ei_printf(",%u\n", config.summary_windows);
+
+    return true;
+}
+
+bool at_set_report_mode(const char **argv, const int argc)
+{
+    ei_report_config_t config;
+    size_t ix;
+    char *end;
+
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    for (ix = 0; ix < ARRAY_SIZE(report_mode_names); ix++) {
+        if (strcmp(argv[0], report_mode_names[ix]) == 0) {
+            break;
+        }
+    }
+    if (ix == ARRAY_SIZE(report_mode_names)) {
+        ei_printf("Unknown mode '%s', expected ALL, ONCHANGE, THRESHOLD or SUMMARY\n", argv[0]);
+        ATServer::get_instance()->fail_command();
+        return true;
+    }
+
+    // omitted (or empty) arguments keep their current value, anything else has to be a number
+    ei_get_report_config(&config);
+    config.mode = (ei_report_mode_t)ix;
+    bool numbers_ok = true;
+    if (argc > 1 && argv[1][0] != '\0') {
+        config.threshold = strtof(argv[1], &end);
+        numbers_ok &= (*end == '\0');
+    }
+    if (argc > 2 && argv[2][0] != '\0') {
+        config.hysteresis = strtof(argv[2], &end);
+        numbers_ok &= (*end == '\0');
+    }
+    if (argc > 3 && argv[3][0] != '\0') {
+        unsigned long windows = strtoul(argv[3], &end, 10);
+        numbers_ok &= (*end == '\0' && windows <= UINT16_MAX);
+        config.summary_windows = (uint16_t)windows;
+    }
+
+    if (numbers_ok == false || ei_set_report_config(&config) == false) {
+        ei_printf("Invalid report settings, threshold must be 0..1, hysteresis 0..threshold, windows 1..65535\n");
+        ATServer::get_instance()->fail_command();
+        return true;
+    }
+    ei_printf("OK\n");
+
+    return true;
 }
 
 bool at_stop_impulse(void)
@@ -320,6 +438,8 @@ bool at_stop_impulse(void)
     EiDeviceNRF *dev = static_cast<EiDeviceNRF*>(EiDeviceInfo::get_device());
     dev->set_serial_channel(UART);
     ei_stop_impulse();
+    // in machine mode this ends the AT+RUNIMPULSE request
+    ATServer::get_instance()->complete_async_command();
 
     return true;
 }
@@ -343,7 +463,9 @@ bool at_set_wifi(const char **argv, const int argc)
     unsigned int security = 0;
 
     if (argc < 1) {
-        return -EINVAL;
+        ei_printf("Missing argument! Required: " AT_WIFI_ARGS "\n");
+        ATServer::get_instance()->fail_command();
+        return true;
     }
 
     /* PSK (optional) */
@@ -363,12 +485,14 @@ bool at_set_wifi(const char **argv, const int argc)
     //waithing to connect to wifi
     if(cmd_wifi_connecting() < 0) {
         ei_printf("ERR: Failed to connect to WiFi\n");
-        return false;
+        ATServer::get_instance()->fail_command();
+        return true;
     }
     //waitinhg to connect to dhcp
     if(cmd_dhcp_configured() < 0) {
         ei_printf("ERR: Failed to configure DHCP\n");
-        return false;
+        ATServer::get_instance()->fail_command();
+        return true;
     }
     ei_ws_client_start(dev, nullptr);
     ei_sleep(100);
@@ -481,6 +605,8 @@ ATServer *ei_at_init(void)
     at->register_command(AT_RUNIMPULSE, AT_RUNIMPULSE_HELP_TEXT, at_run_impulse, nullptr, nullptr, nullptr);
     at->register_command(AT_RUNIMPULSECONT, AT_RUNIMPULSECONT_HELP_TEXT, at_run_impulse_cont, nullptr, nullptr, nullptr);
     at->register_command("STOPIMPULSE", "", at_stop_impulse, nullptr, nullptr, nullptr);
+    at->register_command(AT_RESULTFORMAT, AT_RESULTFORMAT_HELP_TEXT, nullptr, at_get_result_format, at_set_result_format, AT_RESULTFORMAT_ARGS);
+    at->register_command(AT_REPORTMODE, AT_REPORTMODE_HELP_TEXT, nullptr, at_get_report_mode, at_set_report_mode, AT_REPORTMODE_ARGS);
     at->register_command(AT_RUNIMPULSESTATIC, AT_RUNIMPULSESTATIC_HELP_TEXT, nullptr, nullptr, at_run_impulse_static_data, AT_RUNIMPULSESTATIC_ARGS);
 #ifdef CONFIG_WIFI_NRF700X
     at->register_command(AT_WIFI, AT_WIFI_HELP_TEXT, nullptr, &at_get_wifi, &at_set_wifi, AT_WIFI_ARGS);
@@ -19,14 +19,18 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/uart.h>
+#include <zephyr/sys/ring_buffer.h>
 #include <zephyr/bluetooth/addr.h>
 #include <zephyr/bluetooth/bluetooth.h>
+#include <stdarg.h>
+#include <stdio.h>
 #include "ei_device_nordic.h"
 #include "flash_memory.h"
 #include "ei_at_handlers.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "edge-impulse-sdk/dsp/ei_utils.h"
 #include "firmware-sdk/ei_device_memory.h"
+#include "firmware-sdk/ei_log_stream.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ei_device_nordic, LOG_LEVEL_DBG);
@@ -52,6 +56,20 @@ void set_max_data_output_baudrate_c(void);
 void set_default_data_output_baudrate_c(void);
 
 const struct device *uart;
+RING_BUF_DECLARE(uart_rx_ring, CONFIG_EI_UART_RX_BUFFER_SIZE);
+RING_BUF_DECLARE(uart_tx_ring, CONFIG_EI_UART_TX_BUFFER_SIZE);
+// serializes thread context writers of uart_tx_ring (and the ei_printf buffer), recursive
+K_MUTEX_DEFINE(uart_tx_mutex);
+// guards ring_buf_put, which interrupts can call too (they don't take the mutex)
+static struct k_spinlock uart_tx_lock;
+// given by the ISR when it made space in uart_tx_ring
+K_SEM_DEFINE(uart_tx_space, 0, 1);
+// bytes dropped because uart_tx_ring was full in an interrupt or the UART stalled
+static atomic_t uart_tx_dropped = ATOMIC_INIT(0);
+static bool uart_irq_ready = false;
+
+// a writer gives up when the UART doesn't take anything for this long
+#define UART_TX_STALL_MS    100
 
 static void led_work_handler(struct k_work *work)
 {
@@ -139,23 +157,9 @@ static void sampler_work_handler(struct k_work *work)
     if (dev->get_fusioning() == 1) {
         dev->sample_read_callback();
     }
-    else {
-        uint8_t flag = 0;
-        uint8_t i = 0;
-
-        // update actual time
-        dev->actual_timer += dev->get_sample_interval();
-
-        for (i = 0; i < dev->get_fusioning(); i++){
-            if (((uint32_t)(dev->actual_timer % (uint32_t)dev->multi_sample_interval.at(i))) == 0) {   /* check if period of sensor is a multiple of actual time*/
-                flag |= (1<<i);                                                                     /* if so, time to sample it! */
-            }
-        }
-
-        if (dev->sample_multi_read_callback != nullptr){
-            dev->sample_multi_read_callback(flag);
-        }
-
+    else if (dev->sample_multi_read_callback != nullptr) {
+        /* sensors due in this tick */
+        dev->sample_multi_read_callback(dev->next_multi_sample_due());
     }
 
 #else
@@ -165,7 +169,8 @@ static void sampler_work_handler(struct k_work *work)
 
 EiDeviceInfo* EiDeviceInfo::get_device(void)
 {
-    static EiFlashMemory memory(sizeof(EiConfig));
+    // two blocks for the config log, so compaction never erases the current one
+    static EiFlashMemory memory(2 * 4096);
     static EiDeviceNRF dev(&memory);
 
     return &dev;
@@ -234,7 +239,6 @@ bool EiDeviceNRF::start_sample_thread(void (*sample_read_cb)(void), float sample
 {
     this->sample_read_callback = sample_read_cb;
 #if MULTI_FREQ_ENABLED == 1
-    this->actual_timer = 0;
     this->fusioning = 1;
 #endif
 
@@ -248,7 +252,6 @@ bool EiDeviceNRF::stop_sample_thread(void)
     k_timer_stop(&sampler_timer);
 
 #if MULTI_FREQ_ENABLED == 1
-    this->actual_timer = 0;
     this->fusioning = 0;
 #endif
 
@@ -256,31 +259,16 @@ bool EiDeviceNRF::stop_sample_thread(void)
 }
 
 #if MULTI_FREQ_ENABLED == 1
-bool EiDeviceNRF::start_multi_sample_thread(void (*sample_multi_read_cb)(uint8_t), float* multi_sample_interval_ms, uint8_t num_fusioned)
+bool EiDeviceNRF::start_multi_sample_thread(void (*sample_multi_read_cb)(uint8_t), const ei_fusion_schedule_t *schedule, uint8_t num_fusioned)
 {
-    uint8_t i;
-    uint8_t flag = 0;
-
     this->sample_multi_read_callback = sample_multi_read_cb;
+    this->multi_schedule = schedule;
     this->fusioning = num_fusioned;
 
-    this->multi_sample_interval.clear();
-
-    for (i = 0; i < num_fusioned; i++){
-        this->multi_sample_interval.push_back(1.f/multi_sample_interval_ms[i]*1000.f);
-    }
-
-    this->sample_interval = ei_fusion_calc_multi_gcd(this->multi_sample_interval.data(), this->fusioning);
-
     /* force first reading */
-    for (i = 0; i < this->fusioning; i++){
-            flag |= (1<<i);
-    }
-    this->sample_multi_read_callback(flag);
+    this->sample_multi_read_callback(first_multi_sample_due());
 
-    this->actual_timer = 0;
-
-    k_timer_start(&sampler_timer, K_MSEC(this->sample_interval), K_MSEC(this->sample_interval));
+    k_timer_start(&sampler_timer, K_USEC(schedule->tick_us), K_USEC(schedule->tick_us));
 
     return true;
 }
@@ -382,6 +370,108 @@ int EiDeviceNRF::get_wifi_config(char *ssid, char *password, int *security)
     return 0;
 }
 
+/**
+ * @brief      Move received bytes to uart_rx_ring, so nothing is lost while
+ *             the main loop runs a command, and send uart_tx_ring
+ *
+ */
+static void uart_isr(const struct device *dev, void *user_data)
+{
+    uint8_t buf[32];
+    uint8_t *data;
+    uint32_t len;
+    int ret;
+
+    ARG_UNUSED(user_data);
+
+    if (!uart_irq_update(dev)) {
+        return;
+    }
+
+    if (uart_irq_rx_ready(dev)) {
+        while ((ret = uart_fifo_read(dev, buf, sizeof(buf))) > 0) {
+            // dropped if the main loop doesn't keep up
+            ring_buf_put(&uart_rx_ring, buf, ret);
+        }
+    }
+
+    if (uart_irq_tx_ready(dev)) {
+        len = ring_buf_get_claim(&uart_tx_ring, &data, CONFIG_EI_UART_TX_BUFFER_SIZE);
+        if (len == 0) {
+            uart_irq_tx_disable(dev);
+            ring_buf_get_finish(&uart_tx_ring, 0);
+            return;
+        }
+        ret = uart_fifo_fill(dev, data, len);
+        ring_buf_get_finish(&uart_tx_ring, ret > 0 ? ret : 0);
+        k_sem_give(&uart_tx_space);
+    }
+}
+
+static uint32_t uart_tx_put(const uint8_t *data, size_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&uart_tx_lock);
+    uint32_t put = ring_buf_put(&uart_tx_ring, data, len);
+    k_spin_unlock(&uart_tx_lock, key);
+
+    uart_irq_tx_enable(uart);
+
+    return put;
+}
+
+/**
+ * @brief      Queue bytes for the UART. Waits if uart_tx_ring is full, for
+ *             at most UART_TX_STALL_MS without progress. Never waits in an
+ *             interrupt, what doesn't fit is dropped (and counted).
+ *
+ */
+void uart_write(const uint8_t *data, size_t len)
+{
+    // before uart_init, or if it failed
+    if (!uart_irq_ready) {
+        printf("%.*s", (int)len, (const char *)data);
+        return;
+    }
+
+    if (k_is_in_isr()) {
+        uint32_t put = uart_tx_put(data, len);
+        if (put < len) {
+            atomic_add(&uart_tx_dropped, len - put);
+        }
+        return;
+    }
+
+    k_mutex_lock(&uart_tx_mutex, K_FOREVER);
+    while (len > 0) {
+        uint32_t put = uart_tx_put(data, len);
+
+        data += put;
+        len -= put;
+        if (len > 0 && put == 0 && k_sem_take(&uart_tx_space, K_MSEC(UART_TX_STALL_MS)) != 0) {
+            // the UART stopped sending, don't hold the mutex (and the caller) forever
+            atomic_add(&uart_tx_dropped, len);
+            break;
+        }
+    }
+    k_mutex_unlock(&uart_tx_mutex);
+}
+
+/**
+ * @brief      Wait until everything queued has been sent (eg. before changing
+ *             the baudrate)
+ *
+ */
+static void uart_flush(void)
+{
+    if (!uart_irq_ready) {
+        return;
+    }
+
+    for (int i = 0; i < 100 && !(ring_buf_is_empty(&uart_tx_ring) && uart_irq_tx_complete(uart)); i++) {
+        k_sleep(K_MSEC(1));
+    }
+}
+
 /**
  * @brief      Init development kit UART
  *
@@ -400,6 +490,10 @@ int uart_init(void)
         return -ENXIO;
     }
 
+    uart_irq_callback_user_data_set(uart, uart_isr, NULL);
+    uart_irq_rx_enable(uart);
+    uart_irq_ready = true;
+
     return err;
 }
 
@@ -412,9 +506,9 @@ int uart_init(void)
  */
 char uart_getchar(void)
 {
-    unsigned char rcv_char;
+    uint8_t rcv_char;
 
-    if (uart_poll_in(uart, &rcv_char) == 0) {
+    if (ring_buf_get(&uart_rx_ring, &rcv_char, 1) == 1) {
         return rcv_char;
     }
     else{
@@ -422,6 +516,26 @@ char uart_getchar(void)
     }
 }
 
+/**
+ * @brief      Get char from UART, overrides the SDK version reading the
+ *             UART FIFO, which is emptied by uart_isr
+ *
+ * @return     rcv_char If successful
+ * @return     0 If not successful
+ *
+ */
+char ei_getchar(void)
+{
+    uint8_t rcv_char;
+
+    if (ring_buf_get(&uart_rx_ring, &rcv_char, 1) == 1) {
+        return rcv_char;
+    }
+    else {
+        return 0;
+    }
+}
+
 /**
  * @brief      Get char from UART
  *
@@ -430,7 +544,77 @@ char uart_getchar(void)
  */
 void ei_putchar(char c)
 {
-    uart_poll_out(uart, c);
+    uart_write((const uint8_t *)&c, 1);
+}
+
+/**
+ * @brief      Printf over the UART, overrides the SDK version that goes through
+ *             the (unbuffered) stdout, so the caller doesn't wait for the UART.
+ *             In an interrupt the output is cut to 128 bytes and never waits.
+ *
+ */
+void ei_printf(const char *format, ...)
+{
+    static char print_buf[1024];
+    va_list args;
+    int r;
+
+    if (k_is_in_isr()) {
+        char isr_buf[128];
+
+        va_start(args, format);
+        r = vsnprintf(isr_buf, sizeof(isr_buf), format, args);
+        va_end(args);
+
+        if (r > 0) {
+            uart_write((const uint8_t *)isr_buf, MIN((size_t)r, sizeof(isr_buf) - 1));
+        }
+        return;
+    }
+
+    k_mutex_lock(&uart_tx_mutex, K_FOREVER);
+
+    va_start(args, format);
+    r = vsnprintf(print_buf, sizeof(print_buf), format, args);
+    va_end(args);
+
+    if (r > 0) {
+        uart_write((const uint8_t *)print_buf, MIN((size_t)r, sizeof(print_buf) - 1));
+    }
+
+    k_mutex_unlock(&uart_tx_mutex);
+}
+
+/**
+ * @brief      Queue a log record (see ei_log_stream.h), the host formats it
+ *
+ */
+void ei_log_record_send(uint32_t format_id, const uint32_t *args, uint8_t arg_count)
+{
+    // atomic, records can come from interrupts (which skip the mutex)
+    static atomic_t log_sequence = ATOMIC_INIT(0);
+    uint8_t record[EI_LOG_RECORD_MAX_SIZE];
+    size_t record_len;
+    const bool in_isr = k_is_in_isr();
+
+    if (!in_isr) {
+        k_mutex_lock(&uart_tx_mutex, K_FOREVER);
+    }
+
+    record_len = ei_log_record_encode(record, sizeof(record), format_id, args, arg_count,
+                                      (uint16_t)atomic_inc(&log_sequence), (uint32_t)ei_read_timer_ms());
+    if (record_len > 0) {
+        uart_write(record, record_len);
+    }
+
+    if (!in_isr) {
+        k_mutex_unlock(&uart_tx_mutex);
+    }
+}
+
+void ei_printf_float(float f)
+{
+    ei_printf("%f", f);
 }
 
 void set_max_data_output_baudrate_c(void)
@@ -462,6 +646,7 @@ void set_default_data_output_baudrate_c(void)
 
     cfg.baudrate = DEFAULT_BAUD;
 
+    uart_flush();
     if (uart_configure(uart, &cfg)) {
         LOG_ERR("ERR: can't set UART config!");
         ei_printf("ERR: can't set UART config!\n");
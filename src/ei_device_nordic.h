@@ -72,11 +72,12 @@ public:
     int set_wifi_config(const char *ssid, const char *password, const int security);
     int get_wifi_config(char *ssid, char *password, int *security);
 #if MULTI_FREQ_ENABLED == 1
-    bool start_multi_sample_thread(void (*sample_multi_read_cb)(uint8_t), float* multi_sample_interval_ms, uint8_t num_fusioned);
+    bool start_multi_sample_thread(void (*sample_multi_read_cb)(uint8_t), const ei_fusion_schedule_t *schedule, uint8_t num_fusioned) override;
 #endif
 };
 
 int uart_init(void);
 char uart_getchar(void);
+void uart_write(const uint8_t *data, size_t len);
 
 #endif /* EI_DEVICE_NORDIC */
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_impulse_scheduler.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include <cstring>
+
+EiImpulseScheduler::EiImpulseScheduler(ei_scheduler_run_fn run_fn,
+                                       float *ring_buffer,
+                                       size_t ring_frames,
+                                       size_t frame_size,
+                                       float interval_ms)
+    : run_fn(run_fn)
+    , ring(ring_buffer)
+    , ring_mask(0)
+    , frame_size(frame_size)
+    , interval_us((uint32_t)(interval_ms * 1000.0f))
+    , model_count(0)
+    , frames_written(0)
+{
+    // a zero mask disables the scheduler, register_model() will refuse everything
+    if (ring_frames != 0 && (ring_frames & (ring_frames - 1)) == 0) {
+        ring_mask = (uint32_t)ring_frames - 1;
+    }
+    else {
+        ei_printf("ERR: scheduler ring size (%u) must be a power of two\n", (unsigned)ring_frames);
+    }
+}
+
+int EiImpulseScheduler::register_model(ei_impulse_handle_t *handle,
+                                       size_t hop_frames,
+                                       uint8_t priority,
+                                       uint32_t deadline_ms,
+                                       ei_scheduler_result_cb result_cb)
+{
+    if (handle == nullptr || handle->impulse == nullptr || run_fn == nullptr || ring_mask == 0) {
+        return -1;
+    }
+
+    if (model_count >= EI_SCHEDULER_MAX_MODELS) {
+        ei_printf("ERR: Too many models, max %d\n", EI_SCHEDULER_MAX_MODELS);
+        return -1;
+    }
+
+    const ei_impulse_t *impulse = handle->impulse;
+
+    if (impulse->raw_samples_per_frame != frame_size) {
+        ei_printf("ERR: %s expects %u axes, stream has %u\n",
+                  impulse->impulse_name,
+                  (unsigned)impulse->raw_samples_per_frame,
+                  (unsigned)frame_size);
+        return -1;
+    }
+
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 1
+    // ei_impulse_result_t is sized for the default impulse
+    if (impulse->label_count > EI_CLASSIFIER_LABEL_COUNT) {
+        ei_printf("ERR: %s has %u labels, result struct holds %u\n",
+                  impulse->impulse_name,
+                  (unsigned)impulse->label_count,
+                  (unsigned)EI_CLASSIFIER_LABEL_COUNT);
+        return -1;
+    }
+#endif
+
+    size_t window_frames = impulse->raw_sample_count;
+
+    if (window_frames > ring_mask || hop_frames == 0) {
+        ei_printf("ERR: invalid window (%u) or hop (%u) size\n",
+                  (unsigned)window_frames, (unsigned)hop_frames);
+        return -1;
+    }
+
+    model_slot_t *model = &models[model_count];
+
+    model->handle = handle;
+    model->result_cb = result_cb;
+    model->window_frames = window_frames;
+    model->hop_frames = hop_frames;
+    model->priority = priority;
+    model->deadline_us = deadline_ms ? deadline_ms * 1000 : hop_frames * interval_us;
+    model->next_end = frames_written.load() + window_frames;
+    memset(&model->stats, 0, sizeof(model->stats));
+
+    return model_count++;
+}
+
+void EiImpulseScheduler::reset(void)
+{
+    frames_written.store(0);
+
+    for (int ix = 0; ix < model_count; ix++) {
+        models[ix].next_end = models[ix].window_frames;
+        memset(&models[ix].stats, 0, sizeof(models[ix].stats));
+    }
+}
+
+bool EiImpulseScheduler::push_frame(const float *frame, size_t size)
+{
+    if (size != frame_size || ring_mask == 0) {
+        return false;
+    }
+
+    uint32_t written = frames_written.load(std::memory_order_relaxed);
+
+    memcpy(&ring[(written & ring_mask) * frame_size], frame, frame_size * sizeof(float));
+
+    // publish the frame only after it's in the ring
+    frames_written.store(written + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool EiImpulseScheduler::is_stale(const model_slot_t *model, uint32_t window_end, uint32_t written)
+{
+    // oldest frame of the window has been overwritten by the producer
+    return (written - (window_end - model->window_frames)) > (ring_mask + 1);
+}
+
+int EiImpulseScheduler::pick_next(uint32_t written, uint64_t now_us)
+{
+    int next = -1;
+    uint64_t next_deadline = 0;
+
+    for (int ix = 0; ix < model_count; ix++) {
+        model_slot_t *model = &models[ix];
+
+        if ((int32_t)(written - model->next_end) < 0) {
+            continue;
+        }
+
+        if (is_stale(model, model->next_end, written)) {
+            // we fell behind, skip to the newest complete window
+            uint32_t behind = written - model->next_end;
+            uint32_t skipped = behind / model->hop_frames;
+
+            model->next_end += skipped * model->hop_frames;
+            model->stats.overruns += skipped;
+            if (is_stale(model, model->next_end, written)) {
+                continue;
+            }
+        }
+
+        uint64_t release_us = now_us - (uint64_t)(written - model->next_end) * interval_us;
+        uint64_t deadline = release_us + model->deadline_us;
+
+        if (next < 0
+            || model->priority < models[next].priority
+            || (model->priority == models[next].priority && deadline < next_deadline)) {
+            next = ix;
+            next_deadline = deadline;
+        }
+    }
+
+    return next;
+}
+
+int EiImpulseScheduler::read_view(uint32_t first_frame, size_t offset, size_t length, float *out_ptr)
+{
+    size_t ring_size = (ring_mask + 1) * frame_size;
+    size_t start = ((first_frame & ring_mask) * frame_size + offset) % ring_size;
+    size_t first_part = ring_size - start;
+
+    if (first_part >= length) {
+        memcpy(out_ptr, &ring[start], length * sizeof(float));
+    }
+    else {
+        memcpy(out_ptr, &ring[start], first_part * sizeof(float));
+        memcpy(out_ptr + first_part, &ring[0], (length - first_part) * sizeof(float));
+    }
+
+    return 0;
+}
+
+bool EiImpulseScheduler::has_pending(void)
+{
+    uint32_t written = frames_written.load(std::memory_order_acquire);
+
+    for (int ix = 0; ix < model_count; ix++) {
+        if ((int32_t)(written - models[ix].next_end) >= 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool EiImpulseScheduler::run_next(bool debug)
+{
+    uint32_t written = frames_written.load(std::memory_order_acquire);
+    uint64_t now_us = ei_read_timer_us();
+
+    int ix = pick_next(written, now_us);
+    if (ix < 0) {
+        return false;
+    }
+
+    model_slot_t *model = &models[ix];
+    uint32_t window_end = model->next_end;
+    uint32_t first_frame = window_end - model->window_frames;
+    uint64_t release_us = now_us - (uint64_t)(written - window_end) * interval_us;
+
+    model->next_end += model->hop_frames;
+
+    ei::signal_t signal;
+    signal.total_length = model->window_frames * frame_size;
+    signal.get_data = [this, first_frame](size_t offset, size_t length, float *out_ptr) {
+        return this->read_view(first_frame, offset, length, out_ptr);
+    };
+
+    ei_impulse_result_t result = {};
+
+    uint64_t start_us = ei_read_timer_us();
+    EI_IMPULSE_ERROR res = run_fn(model->handle, &signal, &result, debug);
+    uint64_t end_us = ei_read_timer_us();
+
+    if (res != EI_IMPULSE_OK) {
+        ei_printf("ERR: Failed to run %s (%d)\n", model->handle->impulse->impulse_name, res);
+        return true;
+    }
+
+    // the producer may have lapped us while the DSP was reading the window
+    if (is_stale(model, window_end, frames_written.load(std::memory_order_acquire))) {
+        model->stats.overruns++;
+        return true;
+    }
+
+    uint32_t cpu_us = (uint32_t)(end_us - start_us);
+    uint32_t latency_us = (uint32_t)(end_us - release_us);
+
+    model->stats.runs++;
+    model->stats.dsp_us += result.timing.dsp_us;
+    model->stats.classification_us += result.timing.classification_us;
+    model->stats.anomaly_us += result.timing.anomaly_us;
+    model->stats.cpu_us += cpu_us;
+    model->stats.latency_us += latency_us;
+    if (cpu_us > model->stats.cpu_us_max) {
+        model->stats.cpu_us_max = cpu_us;
+    }
+    if (latency_us > model->stats.latency_us_max) {
+        model->stats.latency_us_max = latency_us;
+    }
+    if (latency_us > model->deadline_us) {
+        model->stats.deadline_misses++;
+    }
+
+    if (model->result_cb) {
+        model->result_cb(ix, model->handle, &result);
+    }
+
+    return true;
+}
+
+const ei_scheduler_model_stats_t *EiImpulseScheduler::get_stats(int model_id)
+{
+    if (model_id < 0 || model_id >= model_count) {
+        return nullptr;
+    }
+
+    return &models[model_id].stats;
+}
+
+void EiImpulseScheduler::print_stats(void)
+{
+    for (int ix = 0; ix < model_count; ix++) {
+        const ei_scheduler_model_stats_t *stats = &models[ix].stats;
+        uint32_t runs = stats->runs ? stats->runs : 1;
+
+        ei_printf("Model %d (%s), priority %u, window %u, hop %u\n",
+                  ix,
+                  models[ix].handle->impulse->impulse_name,
+                  (unsigned)models[ix].priority,
+                  (unsigned)models[ix].window_frames,
+                  (unsigned)models[ix].hop_frames);
+        ei_printf("\tRuns: %u, overruns: %u, deadline misses: %u\n",
+                  (unsigned)stats->runs,
+                  (unsigned)stats->overruns,
+                  (unsigned)stats->deadline_misses);
+        ei_printf("\tAvg DSP: %u us, classification: %u us, anomaly: %u us\n",
+                  (unsigned)(stats->dsp_us / runs),
+                  (unsigned)(stats->classification_us / runs),
+                  (unsigned)(stats->anomaly_us / runs));
+        ei_printf("\tCPU avg/max: %u/%u us, latency avg/max: %u/%u us\n",
+                  (unsigned)(stats->cpu_us / runs),
+                  (unsigned)stats->cpu_us_max,
+                  (unsigned)(stats->latency_us / runs),
+                  (unsigned)stats->latency_us_max);
+    }
+}
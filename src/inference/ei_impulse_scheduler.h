@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EI_IMPULSE_SCHEDULER_H
+#define EI_IMPULSE_SCHEDULER_H
+
+/* Include ----------------------------------------------------------------- */
+#include "edge-impulse-sdk/classifier/ei_model_types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef EI_SCHEDULER_MAX_MODELS
+#define EI_SCHEDULER_MAX_MODELS     4
+#endif
+
+/**
+ * Smallest valid ring size (a power of two larger than the window) for
+ * windows of up to window_frames frames
+ */
+constexpr size_t ei_scheduler_ring_frames(size_t window_frames, size_t ring_frames = 1)
+{
+    return (ring_frames > window_frames) ? ring_frames : ei_scheduler_ring_frames(window_frames, ring_frames << 1);
+}
+
+/**
+ * Function used to run a single window through an impulse, normally
+ * run_classifier(ei_impulse_handle_t*, ...) from ei_run_classifier.h.
+ * The SDK can only be included from a single translation unit, so the
+ * scheduler gets it passed in instead of calling it directly.
+ */
+typedef EI_IMPULSE_ERROR (*ei_scheduler_run_fn)(ei_impulse_handle_t *handle,
+                                                 ei::signal_t *signal,
+                                                 ei_impulse_result_t *result,
+                                                 bool debug);
+
+/**
+ * Called from run_next() with the result of every window that completed.
+ */
+typedef void (*ei_scheduler_result_cb)(int model_id,
+                                       ei_impulse_handle_t *handle,
+                                       ei_impulse_result_t *result);
+
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns;          // windows dropped because the ring was overwritten before/while running
+    uint32_t deadline_misses;
+    uint64_t dsp_us;            // sums of the SDK timing fields
+    uint64_t classification_us;
+    uint64_t anomaly_us;
+    uint64_t cpu_us;            // sum of wall time spent in run_fn
+    uint32_t cpu_us_max;
+    uint64_t latency_us;        // sum of (completion - last sample of the window arrived)
+    uint32_t latency_us_max;
+} ei_scheduler_model_stats_t;
+
+/**
+ * Runs several impulses over one fused sample stream.
+ *
+ * Samples are written once into a shared ring buffer by push_frame() (sampler
+ * context). Every registered model has its own window and hop size and reads
+ * its window straight from the ring through a signal_t view, so no per-model
+ * copy of the raw data is kept. run_next() (inference thread) picks the ready
+ * window with the highest priority (lowest number, same as Zephyr threads),
+ * breaking ties by earliest deadline.
+ *
+ * One producer and one consumer are supported without locking.
+ */
+class EiImpulseScheduler {
+public:
+    /**
+     * @param run_fn        classifier entry point, see ei_scheduler_run_fn
+     * @param ring_buffer   storage for ring_frames * frame_size samples
+     * @param ring_frames   ring size in frames, must be a power of two and
+     *                      larger than the biggest registered window
+     * @param frame_size    number of values per fused sample (axes)
+     * @param interval_ms   sampling interval of the stream
+     */
+    EiImpulseScheduler(ei_scheduler_run_fn run_fn,
+                       float *ring_buffer,
+                       size_t ring_frames,
+                       size_t frame_size,
+                       float interval_ms);
+
+    /**
+     * @brief      Add an impulse to the schedule
+     *
+     * The window length comes from the impulse (raw_sample_count frames).
+     *
+     * @param      handle         impulse to run, raw_samples_per_frame must match the stream
+     * @param[in]  hop_frames     frames between two consecutive windows
+     * @param[in]  priority       lower number runs first
+     * @param[in]  deadline_ms    time after the window is complete it should be classified,
+     *                            0 uses the hop period
+     * @param[in]  result_cb      result handler, can be nullptr
+     *
+     * @return     model id or -1 on error
+     */
+    int register_model(ei_impulse_handle_t *handle,
+                       size_t hop_frames,
+                       uint8_t priority,
+                       uint32_t deadline_ms,
+                       ei_scheduler_result_cb result_cb);
+
+    /**
+     * @brief      Drop all buffered samples and statistics, keeps the registered models
+     */
+    void reset(void);
+
+    /**
+     * @brief      Append one fused sample to the ring, safe to call from the sampler
+     *
+     * @return     false if frame_size doesn't match the stream
+     */
+    bool push_frame(const float *frame, size_t frame_size);
+
+    /**
+     * @brief      Run the most urgent pending window, if any
+     *
+     * @return     true if a model was run
+     */
+    bool run_next(bool debug = false);
+
+    /**
+     * @brief      Check if any model has a complete window waiting
+     */
+    bool has_pending(void);
+
+    const ei_scheduler_model_stats_t *get_stats(int model_id);
+    void print_stats(void);
+
+    int get_model_count(void) { return model_count; }
+
+private:
+    typedef struct {
+        ei_impulse_handle_t *handle;
+        ei_scheduler_result_cb result_cb;
+        uint32_t window_frames;
+        uint32_t hop_frames;
+        uint32_t deadline_us;
+        uint8_t priority;
+        uint32_t next_end;      // absolute frame index (exclusive) where the next window ends
+        ei_scheduler_model_stats_t stats;
+    } model_slot_t;
+
+    ei_scheduler_run_fn run_fn;
+    float *ring;
+    uint32_t ring_mask;
+    size_t frame_size;
+    uint32_t interval_us;
+
+    model_slot_t models[EI_SCHEDULER_MAX_MODELS];
+    int model_count;
+
+    // total number of frames pushed, only written by push_frame()
+    std::atomic<uint32_t> frames_written;
+
+    bool is_stale(const model_slot_t *model, uint32_t window_end, uint32_t written);
+    int pick_next(uint32_t written, uint64_t now_us);
+    int read_view(uint32_t first_frame, size_t offset, size_t length, float *out_ptr);
+};
+
+#endif /* EI_IMPULSE_SCHEDULER_H */
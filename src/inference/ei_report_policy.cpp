@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_report_policy.h"
+#include <cstring>
+
+/* top_class before the first report */
+#define NOT_REPORTED    0xFFFF
+
+EiReportPolicy::EiReportPolicy(void)
+    : config_sequence(0), applied_sequence(0)
+{
+    config.mode = EI_REPORT_ALL;
+    config.threshold = 0.6f;
+    config.hysteresis = 0.1f;
+    config.summary_windows = 100;
+    pending_config = config;
+
+    reset();
+}
+
+bool EiReportPolicy::configure(const ei_report_config_t *new_config)
+{
+    if (new_config->threshold < 0.0f || new_config->threshold > 1.0f
+        || new_config->hysteresis < 0.0f || new_config->hysteresis > new_config->threshold
+        || new_config->summary_windows == 0) {
+        return false;
+    }
+
+    // one writer (the AT commands), so only update() can see an odd sequence
+    const uint32_t sequence = config_sequence.load(std::memory_order_relaxed);
+
+    config_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    pending_config = *new_config;
+    config_sequence.store(sequence + 2, std::memory_order_release);
+
+    return true;
+}
+
+void EiReportPolicy::get_config(ei_report_config_t *out_config)
+{
+    *out_config = pending_config;
+}
+
+bool EiReportPolicy::apply_pending_config(void)
+{
+    const uint32_t sequence = config_sequence.load(std::memory_order_acquire);
+    ei_report_config_t next;
+
+    if (sequence == applied_sequence || (sequence & 1)) {
+        return false;
+    }
+
+    next = pending_config;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (config_sequence.load(std::memory_order_relaxed) != sequence) {
+        // configure() wrote meanwhile, take it next time
+        return false;
+    }
+
+    config = next;
+    applied_sequence = sequence;
+    reset();
+
+    return true;
+}
+
+void EiReportPolicy::reset(void)
+{
+    top_class = NOT_REPORTED;
+    active_mask = 0;
+    changed_mask = 0;
+    memset(histogram, 0, sizeof(histogram));
+    window_count = 0;
+}
+
+/**
+ * @brief      The highest class if it reaches the threshold. The current top class
+ *             stays until it drops below threshold - hysteresis, or another class
+ *             reaches the threshold.
+ */
+uint16_t EiReportPolicy::find_top_class(const ei_impulse_result_t *result, uint16_t label_count, uint16_t current)
+{
+    uint16_t top = 0;
+
+    if (label_count == 0) {
+        return EI_REPORT_UNCERTAIN;
+    }
+
+    for (uint16_t ix = 1; ix < label_count; ix++) {
+        if (result->classification[ix].value > result->classification[top].value) {
+            top = ix;
+        }
+    }
+
+    if (result->classification[top].value >= config.threshold) {
+        return top;
+    }
+    if (current < label_count && result->classification[current].value >= config.threshold - config.hysteresis) {
+        return current;
+    }
+
+    return EI_REPORT_UNCERTAIN;
+}
+
+ei_report_decision_t EiReportPolicy::update(const ei_impulse_result_t *result, uint16_t label_count)
+{
+    apply_pending_config();
+
+    if (label_count > EI_REPORT_MAX_LABELS) {
+        label_count = EI_REPORT_MAX_LABELS;
+    }
+
+    switch (config.mode) {
+    case EI_REPORT_ON_CHANGE: {
+        uint16_t top = find_top_class(result, label_count, top_class);
+
+        if (top == top_class) {
+            return EI_REPORT_SKIP;
+        }
+        top_class = top;
+        return EI_REPORT_RESULT;
+    }
+    case EI_REPORT_THRESHOLD: {
+        uint32_t active = active_mask;
+
+        for (uint16_t ix = 0; ix < label_count; ix++) {
+            const uint32_t bit = 1UL << ix;
+            const float value = result->classification[ix].value;
+
+            if (!(active & bit) && value >= config.threshold) {
+                active |= bit;
+            }
+            else if ((active & bit) && value < config.threshold - config.hysteresis) {
+                active &= ~bit;
+            }
+        }
+
+        changed_mask = active ^ active_mask;
+        active_mask = active;
+        return changed_mask ? EI_REPORT_EVENT : EI_REPORT_SKIP;
+    }
+    case EI_REPORT_SUMMARY: {
+        // the previous summary has been reported
+        if (window_count >= config.summary_windows) {
+            memset(histogram, 0, sizeof(histogram));
+            window_count = 0;
+        }
+
+        top_class = find_top_class(result, label_count, top_class);
+        histogram[top_class == EI_REPORT_UNCERTAIN ? label_count : top_class]++;
+        window_count++;
+        return (window_count >= config.summary_windows) ? EI_REPORT_SUMMARY_READY : EI_REPORT_SKIP;
+    }
+    default:
+        return EI_REPORT_RESULT;
+    }
+}
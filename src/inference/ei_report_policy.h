@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EI_REPORT_POLICY_H
+#define EI_REPORT_POLICY_H
+
+/* Include ----------------------------------------------------------------- */
+#include "edge-impulse-sdk/classifier/ei_classifier_types.h"
+#include <atomic>
+#include <cstdint>
+
+/* Classes above this are ignored (events use a 32 bit mask) */
+#ifndef EI_REPORT_MAX_LABELS
+#define EI_REPORT_MAX_LABELS        32
+#endif
+
+/* No class above the threshold */
+#define EI_REPORT_UNCERTAIN         0xFFFE
+
+typedef enum {
+    EI_REPORT_ALL = 0,          // every result
+    EI_REPORT_ON_CHANGE,        // when the top class changes
+    EI_REPORT_THRESHOLD,        // when a class crosses the threshold, with hysteresis
+    EI_REPORT_SUMMARY           // histogram of the top classes every summary_windows results
+} ei_report_mode_t;
+
+typedef enum {
+    EI_REPORT_SKIP = 0,         // nothing to report
+    EI_REPORT_RESULT,           // report the result
+    EI_REPORT_EVENT,            // report the result and the changes of get_changed_mask()
+    EI_REPORT_SUMMARY_READY     // report get_histogram() instead of the result
+} ei_report_decision_t;
+
+typedef struct {
+    ei_report_mode_t mode;
+    float threshold;            // score for a class to be the top class / start an event
+    float hysteresis;           // ... and it ends below threshold - hysteresis
+    uint16_t summary_windows;
+} ei_report_config_t;
+
+/**
+ * Decides which inference results are worth sending, so a mostly idle device
+ * doesn't report every window.
+ *
+ * A class counts (as top class, or as an active event) once its score reaches the
+ * threshold, and keeps counting until it drops below threshold - hysteresis, so
+ * results close to the threshold don't toggle the reports.
+ *
+ * configure() and get_config() can be called from another thread than update(),
+ * the new config is picked up (and the state reset) by the next update() or
+ * apply_pending_config(). The
+ * config is handed over with a sequence counter, so update() never waits for
+ * configure() and never sees half of a config; if configure() is writing, the
+ * next update() takes it. Everything else is for the thread of update().
+ */
+class EiReportPolicy {
+public:
+    EiReportPolicy(void);
+
+    /**
+     * @return     false if the config is invalid (threshold not in 0..1,
+     *             hysteresis not in 0..threshold, or no summary windows)
+     */
+    bool configure(const ei_report_config_t *new_config);
+
+    /**
+     * @brief      The last config set with configure(), from the thread of configure()
+     */
+    void get_config(ei_report_config_t *out_config);
+
+    /**
+     * @brief      Take the config of configure() and reset, unless it's being written.
+     *             update() does this itself, call it before get_mode() when results
+     *             don't go through update() (eg. every result in EI_REPORT_ALL)
+     *
+     * @return     true if a new config was applied
+     */
+    bool apply_pending_config(void);
+
+    /* Mode in use by update(), as of the last update() or apply_pending_config() */
+    ei_report_mode_t get_mode(void) { return config.mode; }
+
+    /**
+     * @brief      Forget the previous results (eg. when inference is started)
+     */
+    void reset(void);
+
+    /**
+     * @brief      Feed a result, once per window
+     */
+    ei_report_decision_t update(const ei_impulse_result_t *result, uint16_t label_count);
+
+    /* Top class reported last (ON_CHANGE), index or EI_REPORT_UNCERTAIN */
+    uint16_t get_top_class(void) { return top_class; }
+
+    /* Active classes and the ones that changed in the last update (THRESHOLD) */
+    uint32_t get_active_mask(void) { return active_mask; }
+    uint32_t get_changed_mask(void) { return changed_mask; }
+
+    /* Windows per top class, label_count entries and then the uncertain ones (SUMMARY) */
+    const uint16_t *get_histogram(void) { return histogram; }
+    uint16_t get_window_count(void) { return window_count; }
+
+private:
+    ei_report_config_t config;
+    ei_report_config_t pending_config;
+    // odd while configure() writes pending_config, +2 per configure()
+    std::atomic<uint32_t> config_sequence;
+    uint32_t applied_sequence;
+
+    uint16_t top_class;
+    uint32_t active_mask;
+    uint32_t changed_mask;
+    uint16_t histogram[EI_REPORT_MAX_LABELS + 1];
+    uint16_t window_count;
+
+    uint16_t find_top_class(const ei_impulse_result_t *result, uint16_t label_count, uint16_t current);
+};
+
+#endif /* EI_REPORT_POLICY_H */
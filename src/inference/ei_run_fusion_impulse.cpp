@@ -19,16 +19,26 @@
 #if defined(EI_CLASSIFIER_SENSOR) && ((EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_FUSION) || (EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_ACCELEROMETER))
 #include "edge-impulse-sdk/classifier/ei_run_classifier.h"
 #include "edge-impulse-sdk/classifier/ei_print_results.h"
+#if defined(CONFIG_EI_INFERENCE_SMOOTHING) && (EI_CLASSIFIER_OBJECT_DETECTION != 1)
+#define SMOOTHING_ENABLED   1
+#include "edge-impulse-sdk/classifier/ei_classifier_smooth.h"
+#endif
 #include "edge-impulse-sdk/dsp/numpy.hpp"
 #include "firmware-sdk/ei_fusion.h"
+#include "firmware-sdk/ei_result_stream.h"
+#include "firmware-sdk/ei_log_stream.h"
+#include "ei_report_policy.h"
+#include "ei_run_impulse.h"
 #include "ei_device_nordic.h"
 #include <zephyr/kernel.h>
 #include "cJSON.h"
 #include <zephyr/logging/log.h>
+#include <atomic>
 LOG_MODULE_REGISTER(run_impulse);
 
 typedef enum {
     INFERENCE_STOPPED,
+    INFERENCE_STARTING,
     INFERENCE_WAITING,
     INFERENCE_SAMPLING,
     INFERENCE_DATA_READY
@@ -39,14 +49,120 @@ static uint16_t samples_per_inference;
 static inference_state_t state = INFERENCE_STOPPED;
 static bool continuous_mode = false;
 static bool debug_mode = false;
+// requested by ei_start_impulse, applied by the inference thread
+static bool start_continuous = false;
+static bool start_debug = false;
+// smoothing, scheduler and continuous classifier state are set up (inference thread only)
+static bool session_active = false;
+// stopped on an error, not by the user (read and cleared by ei_impulse_failed())
+static std::atomic<bool> impulse_failed(false);
 static bool is_fusion = false;
+static ei_result_format_t result_format = EI_RESULT_FORMAT_TEXT;
+static uint16_t result_sequence = 0;
+static EiReportPolicy report_policy;
+#if defined(CONFIG_EI_INFERENCE_SAMPLES_I16) && (EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_ACCELEROMETER)
+/* Keep the window as int16, 0.002 m/s2 per LSB covers +/- 6.6 g */
+#define SAMPLES_I16_SCALE   0.002f
+static int16_t samples_circ_buff[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
+#else
 static float samples_circ_buff[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
+#endif
 static int samples_wr_index = 0;
 static EiDeviceNRF *dev = static_cast<EiDeviceNRF*>(EiDeviceInfo::get_device());
+#ifdef CONFIG_EI_INFERENCE_SCHEDULER
+#if CONFIG_EI_INFERENCE_SCHEDULER_RING_FRAMES > 0
+#define SCHEDULER_RING_FRAMES   ei_scheduler_ring_frames(CONFIG_EI_INFERENCE_SCHEDULER_RING_FRAMES - 1)
+#else
+// a slice of slack, so the sampler can run ahead while a window is classified
+#define SCHEDULER_RING_FRAMES   ei_scheduler_ring_frames(EI_CLASSIFIER_RAW_SAMPLE_COUNT + EI_CLASSIFIER_SLICE_SIZE)
+#endif
+
+static EI_IMPULSE_ERROR scheduler_run(ei_impulse_handle_t *handle, signal_t *signal,
+                                      ei_impulse_result_t *result, bool debug)
+{
+    return run_classifier(handle, signal, result, debug);
+}
+
+static float scheduler_ring[SCHEDULER_RING_FRAMES * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME];
+static EiImpulseScheduler scheduler(scheduler_run, scheduler_ring, SCHEDULER_RING_FRAMES,
+                                    EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME, EI_CLASSIFIER_INTERVAL_MS);
+// continuous inference runs through the scheduler
+static bool scheduler_mode = false;
+#endif
+#ifdef SMOOTHING_ENABLED
+static ei_classifier_smooth_t smooth;
+static const char *smoothed_label = "uncertain";
+
+static void setup_smoothing(void)
+{
+#ifdef CONFIG_EI_INFERENCE_SMOOTHING_MAJORITY
+    ei_classifier_smooth_init(&smooth, CONFIG_EI_INFERENCE_SMOOTHING_READINGS,
+                              CONFIG_EI_INFERENCE_SMOOTHING_MIN_SAME,
+                              CONFIG_EI_INFERENCE_SMOOTHING_CONFIDENCE / 100.0f);
+#else
+    // the number of readings sets the EMA length
+    ei_classifier_smooth_init(&smooth, CONFIG_EI_INFERENCE_SMOOTHING_READINGS,
+                              CONFIG_EI_INFERENCE_SMOOTHING_READINGS,
+                              CONFIG_EI_INFERENCE_SMOOTHING_CONFIDENCE / 100.0f);
+#ifdef CONFIG_EI_INFERENCE_SMOOTHING_HYSTERESIS
+    ei_classifier_smooth_set_mode(&smooth, EI_CLASSIFIER_SMOOTH_HYSTERESIS,
+                                  CONFIG_EI_INFERENCE_SMOOTHING_RELEASE_CONFIDENCE / 100.0f);
+#else
+    ei_classifier_smooth_set_mode(&smooth, EI_CLASSIFIER_SMOOTH_EMA);
+#endif
+#endif
+    smoothed_label = "uncertain";
+}
+#endif
+
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+static ei_impulse_gate_config_t gate_config = {
+    .energy_threshold = CONFIG_EI_INFERENCE_GATE_ENERGY_THRESHOLD / 1000.0f,
+    .learn_margin = 1.5f,
+    .learn_min_confidence = 0.8f,
+    .idle_label_ix = 0,
+    .stable_windows = CONFIG_EI_INFERENCE_GATE_STABLE_WINDOWS,
+    .stable_energy_delta = 0.1f,
+    .max_skipped = CONFIG_EI_INFERENCE_GATE_MAX_SKIPPED,
+};
+
+/**
+ * @brief      Enable the impulse gate if the model has an 'idle' class
+ */
+static void setup_impulse_gate(void)
+{
+    for (uint16_t ix = 0; ix < ei_default_impulse.impulse->label_count; ix++) {
+        if (strcmp(ei_default_impulse.impulse->categories[ix], "idle") == 0) {
+            gate_config.idle_label_ix = ix;
+            if (ei_set_impulse_gate(&ei_default_impulse, &gate_config) == EI_IMPULSE_OK) {
+                return;
+            }
+            break;
+        }
+    }
+
+    ei_printf("WARN: no 'idle' class in the model, impulse gate disabled\n");
+    ei_set_impulse_gate(&ei_default_impulse, nullptr);
+}
+#endif
+
+/**
+ * @brief      Stop after an error in the inference thread, the AT thread then
+ *             ends the request that started the impulse (ei_impulse_failed())
+ */
+static void stop_on_error(void)
+{
+    // a stop or restart request that came in meanwhile has ended the request already
+    if(state != INFERENCE_STOPPED && state != INFERENCE_STARTING) {
+        state = INFERENCE_STOPPED;
+        impulse_failed = true;
+    }
+}
 
 static inline inference_state_t set_thread_state(inference_state_t new_state)
 {
-    if(state != INFERENCE_STOPPED) {
+    // a stop or (re)start request wins over the running inference
+    if(state != INFERENCE_STOPPED && state != INFERENCE_STARTING) {
         state = new_state;
     }
 
@@ -60,14 +176,28 @@ static inline inference_state_t set_thread_state(inference_state_t new_state)
 bool samples_callback(const void *raw_sample, uint32_t raw_sample_size)
 {
     if(state != INFERENCE_SAMPLING) {
-        // stop collecting samples if we are not in SAMPLING state
-        return true;
+        // stop collecting samples if we are not in SAMPLING state, except while
+        // a slice is classified in continuous mode (the sampler keeps running)
+        return !(continuous_mode == true && state == INFERENCE_DATA_READY);
     }
 
     float *sample = (float *)raw_sample;
 
+#ifdef CONFIG_EI_INFERENCE_SCHEDULER
+    if(scheduler_mode == true) {
+        // the inference thread picks up complete windows from the ring
+        scheduler.push_frame(sample, raw_sample_size / sizeof(float));
+        return false;
+    }
+#endif
+
     for(int i = 0; i < (int)(raw_sample_size / sizeof(float)); i++) {
+#ifdef SAMPLES_I16_SCALE
+        float value = roundf(sample[i] / SAMPLES_I16_SCALE);
+        samples_circ_buff[samples_wr_index++] = (int16_t)(value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value));
+#else
         samples_circ_buff[samples_wr_index++] = sample[i];
+#endif
         if(samples_wr_index > EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE) {
             /* start from beginning of the circular buffer */
             samples_wr_index = 0;
@@ -75,7 +205,7 @@ bool samples_callback(const void *raw_sample, uint32_t raw_sample_size)
         if(samples_wr_index >= samples_per_inference) {
             // we don't care about current state, it will be handled in the thread or next call of samples_callback
             set_thread_state(INFERENCE_DATA_READY);
-            return true;
+            return continuous_mode == false;
         }
     }
 
@@ -86,8 +216,29 @@ static void process_results(ei_impulse_result_t* result)
 {
     char *string = NULL;
 
-    if(dev->get_serial_channel() == UART) {
+    if(dev->get_serial_channel() == UART && result_format != EI_RESULT_FORMAT_TEXT) {
+        static uint8_t frame[EI_RESULT_FRAME_MAX_SIZE(EI_CLASSIFIER_LABEL_COUNT)];
+        size_t frame_len = ei_result_frame_encode(frame, sizeof(frame), ei_default_impulse.impulse, result,
+                                                  result_format, result_sequence++, (uint32_t)ei_read_timer_ms());
+
+        uart_write(frame, frame_len);
+    }
+    else if(dev->get_serial_channel() == UART) {
         ei_print_results(&ei_default_impulse, result);
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+        if(result->gate.decision != EI_GATE_RAN) {
+            // a format per decision, log records don't take strings
+            if(result->gate.decision == EI_GATE_SKIPPED_LOW_ENERGY) {
+                EI_LOG_RECORD("Skipped (idle), energy: %f\n", result->gate.energy);
+            }
+            else {
+                EI_LOG_RECORD("Skipped (stable), energy: %f\n", result->gate.energy);
+            }
+        }
+#endif
+#ifdef SMOOTHING_ENABLED
+        ei_printf("Smoothed: %s\n", smoothed_label);
+#endif
     }
     else {
         cJSON *response = cJSON_CreateObject();
@@ -106,6 +257,9 @@ static void process_results(ei_impulse_result_t* result)
 #if EI_CLASSIFIER_HAS_ANOMALY == 1
         cJSON_AddNumberToObject(response, "anomaly", result->anomaly);
 #endif
+#ifdef SMOOTHING_ENABLED
+        cJSON_AddStringToObject(response, "smoothed", smoothed_label);
+#endif
 
         string = cJSON_PrintUnformatted(response);
         if (string == NULL) {
@@ -121,34 +275,250 @@ static void process_results(ei_impulse_result_t* result)
     }
 }
 
+static void print_summary(void)
+{
+    const uint16_t *histogram = report_policy.get_histogram();
+
+    ei_printf("Summary of %u windows:", report_policy.get_window_count());
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT && ix < EI_REPORT_MAX_LABELS; ix++) {
+        ei_printf(" %s: %u,", ei_classifier_inferencing_categories[ix], histogram[ix]);
+    }
+    ei_printf(" uncertain: %u\n", histogram[EI_CLASSIFIER_LABEL_COUNT < EI_REPORT_MAX_LABELS ?
+                                             EI_CLASSIFIER_LABEL_COUNT : EI_REPORT_MAX_LABELS]);
+}
+
+/**
+ * @brief      Report the result if the report policy says so
+ */
+static void report_results(ei_impulse_result_t* result)
+{
+    switch (report_policy.update(result, EI_CLASSIFIER_LABEL_COUNT)) {
+        case EI_REPORT_RESULT:
+            process_results(result);
+            break;
+        case EI_REPORT_EVENT:
+            process_results(result);
+            if (result_format == EI_RESULT_FORMAT_TEXT) {
+                for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT && ix < EI_REPORT_MAX_LABELS; ix++) {
+                    if (report_policy.get_changed_mask() & (1UL << ix)) {
+                        ei_printf("Event: %s %s\n", ei_classifier_inferencing_categories[ix],
+                                  (report_policy.get_active_mask() & (1UL << ix)) ? "started" : "ended");
+                    }
+                }
+            }
+            break;
+        case EI_REPORT_SUMMARY_READY:
+            print_summary();
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief      Smooth and report the result of the default impulse
+ */
+static void handle_result(ei_impulse_result_t* result)
+{
+    // the EI_REPORT_ALL path below doesn't go through update(), pick up AT+REPORTMODE here
+    report_policy.apply_pending_config();
+
+#ifdef SMOOTHING_ENABLED
+    // every slice in continuous mode (once the model window is filled),
+    // so the smoothed label follows the signal
+    if(continuous_mode == false || print_results >= 0) {
+        smoothed_label = ei_classifier_smooth_update(&smooth, result);
+    }
+#endif
+
+    if(continuous_mode == true && report_policy.get_mode() == EI_REPORT_ALL) {
+        if(++print_results >= (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW >> 1)) {
+            process_results(result);
+            print_results = 0;
+        }
+    }
+    else if(continuous_mode == true) {
+        // every slice, once the model window is filled
+        if(print_results < 0) {
+            print_results++;
+        }
+        else {
+            report_results(result);
+        }
+    }
+    else {
+        report_results(result);
+    }
+}
+
+static void start_sampling(void)
+{
+#if MULTI_FREQ_ENABLED == 1
+    if (is_fusion) {
+        ei_multi_fusion_sample_start(&samples_callback, EI_CLASSIFIER_INTERVAL_MS);
+    }
+    else {
+        ei_fusion_sample_start(&samples_callback, EI_CLASSIFIER_INTERVAL_MS);
+    }
+#else
+    ei_fusion_sample_start(&samples_callback, EI_CLASSIFIER_INTERVAL_MS);
+#endif
+    dev->set_state(eiStateSampling);
+}
+
+#ifdef CONFIG_EI_INFERENCE_SCHEDULER
+__attribute__((weak)) void ei_scheduler_register_models(EiImpulseScheduler *scheduler)
+{
+}
+
+static void scheduler_result(int model_id, ei_impulse_handle_t *handle, ei_impulse_result_t *result);
+#endif
+
+/**
+ * @brief      Set up the state of a new inference run. Runs on the inference
+ *             thread, so nothing is (re)initialized while a window is classified.
+ */
+static bool start_session(void)
+{
+    continuous_mode = start_continuous;
+    debug_mode = start_debug;
+    session_active = true;
+    samples_wr_index = 0;
+    report_policy.reset();
+
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    // only sampled continuous windows are gated, never static data or batches
+    if (continuous_mode == true) {
+        setup_impulse_gate();
+    }
+#endif
+#ifdef SMOOTHING_ENABLED
+    setup_smoothing();
+#endif
+
+#ifdef CONFIG_EI_INFERENCE_SCHEDULER
+    scheduler_mode = continuous_mode;
+    if (scheduler_mode == true) {
+        if (scheduler.get_model_count() == 0) {
+            if (scheduler.register_model(&ei_default_impulse, EI_CLASSIFIER_SLICE_SIZE,
+                                         CONFIG_EI_INFERENCE_THREAD_PRIO, 0, scheduler_result) != 0) {
+                ei_printf("ERR: Failed to schedule the impulse\n");
+                return false;
+            }
+            ei_scheduler_register_models(&scheduler);
+        }
+        scheduler.reset();
+        // every scheduled window is complete, so report from the first one
+        print_results = 0;
+        return true;
+    }
+#endif
+
+    if (continuous_mode == true) {
+        samples_per_inference = EI_CLASSIFIER_SLICE_SIZE * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
+        // In order to have meaningful classification results, continuous inference has to run over
+        // the complete model window. So the first iterations will print out garbage.
+        // We now use a fixed length moving average filter of half the slices per model window and
+        // only print when we run the complete maf buffer to prevent printing the same classification multiple times.
+        print_results = -(EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW);
+        run_classifier_init();
+    }
+    else {
+        samples_per_inference = EI_CLASSIFIER_RAW_SAMPLE_COUNT * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Release the state of the inference run, on every way into
+ *             INFERENCE_STOPPED (stop command, error) and before a restart
+ */
+static void end_session(void)
+{
+    run_classifier_deinit();
+#if EI_CLASSIFIER_GATE_ENABLED == 1
+    ei_set_impulse_gate(&ei_default_impulse, nullptr);
+#endif
+#ifdef CONFIG_EI_INFERENCE_SCHEDULER
+    if (scheduler_mode == true) {
+        scheduler.print_stats();
+    }
+#endif
+#ifdef SMOOTHING_ENABLED
+    ei_classifier_smooth_free(&smooth);
+#endif
+    /* reset samples buffer */
+    samples_wr_index = 0;
+    session_active = false;
+}
+
+#ifdef CONFIG_EI_INFERENCE_SCHEDULER
+
+static void scheduler_result(int model_id, ei_impulse_handle_t *handle, ei_impulse_result_t *result)
+{
+    if(model_id == 0) {
+        handle_result(result);
+    }
+    else if(dev->get_serial_channel() == UART && result_format == EI_RESULT_FORMAT_TEXT) {
+        ei_printf("%s:\n", handle->impulse->impulse_name);
+        ei_print_results(handle, result);
+    }
+}
+#endif
+
 void ei_inference_thread(void* param1, void* param2, void* param3)
 {
     while(1) {
         switch(state) {
             case INFERENCE_STOPPED:
+                if(session_active == true) {
+                    end_session();
+                }
                 // nothing to do
                 ei_sleep(5);
                 continue;
+            case INFERENCE_STARTING:
+                if(session_active == true) {
+                    // restarted before the previous run was torn down
+                    end_session();
+                }
+                if(start_session() == false) {
+                    if(state == INFERENCE_STARTING) {
+                        state = INFERENCE_STOPPED;
+                        impulse_failed = true;
+                    }
+                    continue;
+                }
+                if(continuous_mode == true) {
+                    if(state == INFERENCE_STARTING) {
+                        state = INFERENCE_SAMPLING;
+                        // the sampler keeps running until inference is stopped
+                        start_sampling();
+                    }
+                }
+                else if(state == INFERENCE_STARTING) {
+                    // it's time to prepare for sampling
+                    EI_LOG_RECORD("Starting inferencing in 2 seconds...\n");
+                    state = INFERENCE_WAITING;
+                }
+                continue;
             case INFERENCE_WAITING:
                 ei_sleep(2000);
-                if(set_thread_state(INFERENCE_SAMPLING) == INFERENCE_STOPPED) {
-                    // if someone stopped inference during delay, go to thread loop iteration
+                if(set_thread_state(INFERENCE_SAMPLING) != INFERENCE_SAMPLING) {
+                    // if someone stopped or restarted inference during delay, go to thread loop iteration
                     continue;
                 }
                 // start sampling now, don't collect samples during waiting period
-#if MULTI_FREQ_ENABLED == 1
-                if (is_fusion) {
-                    ei_multi_fusion_sample_start(&samples_callback, EI_CLASSIFIER_INTERVAL_MS);
-                }
-                else {
-                    ei_fusion_sample_start(&samples_callback, EI_CLASSIFIER_INTERVAL_MS);
-                }
-#else
-                ei_fusion_sample_start(&samples_callback, EI_CLASSIFIER_INTERVAL_MS);
-#endif
-                dev->set_state(eiStateSampling);
+                start_sampling();
                 continue;
             case INFERENCE_SAMPLING:
+#ifdef CONFIG_EI_INFERENCE_SCHEDULER
+                if(scheduler_mode == true) {
+                    // run every window that completed, most urgent first
+                    while(state == INFERENCE_SAMPLING && scheduler.run_next(debug_mode));
+                }
+#endif
                 // wait for data to be collected through callback
                 ei_sleep(1);
                 continue;
@@ -169,13 +539,17 @@ void ei_inference_thread(void* param1, void* param2, void* param3)
         samples_wr_index = 0;
 
         // Create a data structure to represent this window of data
+#ifdef SAMPLES_I16_SCALE
+        int err = numpy::signal_from_buffer(samples_circ_buff, EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, SAMPLES_I16_SCALE, &signal);
+#else
         int err = numpy::signal_from_buffer(samples_circ_buff, EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, &signal);
+#endif
         if (err != 0) {
-            ei_printf("ERR: signal_from_buffer failed (%d)\n", err);
+            EI_LOG_RECORD("ERR: signal_from_buffer failed (%d)\n", err);
         }
 
         // run the impulse: DSP, neural network and the Anomaly algorithm
-        ei_impulse_result_t result = { 0 };
+        ei_impulse_result_t result = {};
         EI_IMPULSE_ERROR ei_error;
         if(continuous_mode == true) {
             ei_error = run_classifier_continuous(&signal, &result, debug_mode);
@@ -185,26 +559,21 @@ void ei_inference_thread(void* param1, void* param2, void* param3)
         }
 
         if (ei_error != EI_IMPULSE_OK) {
-            ei_printf("Failed to run impulse (%d)", ei_error);
-            set_thread_state(INFERENCE_STOPPED);
+            EI_LOG_RECORD("ERR: Failed to run impulse (%d)\n", ei_error);
+            stop_on_error();
             continue;
         }
 
-        if(continuous_mode == true) {
-            if(++print_results >= (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW >> 1)) {
-                process_results(&result);
-                print_results = 0;
-            }
-        }
-        else {
-            process_results(&result);
-        }
+        handle_result(&result);
 
         if(continuous_mode == true) {
             set_thread_state(INFERENCE_SAMPLING);
         }
         else {
-            ei_printf("Starting inferencing in 2 seconds...\n");
+            // only chatty if every result is reported anyway
+            if(report_policy.get_mode() == EI_REPORT_ALL) {
+                EI_LOG_RECORD("Starting inferencing in 2 seconds...\n");
+            }
             set_thread_state(INFERENCE_WAITING);
         }
     }
@@ -218,8 +587,8 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
         return;
     }
 
-    continuous_mode = continuous;
-    debug_mode = debug;
+    start_continuous = continuous;
+    start_debug = debug;
 #if MULTI_FREQ_ENABLED == 1
     is_fusion = ei_is_fusion();
 #endif
@@ -236,33 +605,17 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
     dev->set_sample_length_ms(EI_CLASSIFIER_RAW_SAMPLE_COUNT * EI_CLASSIFIER_INTERVAL_MS);
     dev->set_sample_interval_ms(EI_CLASSIFIER_INTERVAL_MS);
 
-    if (continuous == true) {
-        samples_per_inference = EI_CLASSIFIER_SLICE_SIZE * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
-        // In order to have meaningful classification results, continuous inference has to run over
-        // the complete model window. So the first iterations will print out garbage.
-        // We now use a fixed length moving average filter of half the slices per model window and
-        // only print when we run the complete maf buffer to prevent printing the same classification multiple times.
-        print_results = -(EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW);
-        run_classifier_init();
-        state = INFERENCE_SAMPLING;
-    }
-    else {
-        samples_per_inference = EI_CLASSIFIER_RAW_SAMPLE_COUNT * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
-        // it's time to prepare for sampling
-        ei_printf("Starting inferencing in 2 seconds...\n");
-        state = INFERENCE_WAITING;
-    }
+    // the inference thread sets up smoothing, the gate and the classifier state
+    state = INFERENCE_STARTING;
 }
 
 void ei_stop_impulse(void)
 {
     if(state != INFERENCE_STOPPED) {
-        set_thread_state(INFERENCE_STOPPED);
+        state = INFERENCE_STOPPED;
         ei_printf("Inferencing stopped by user\r\n");
         dev->set_state(eiStateFinished);
-        /* reset samples buffer */
-        samples_wr_index = 0;
-        run_classifier_deinit();
+        // the inference thread releases the run's state once it sees the stop
     }
 }
 
@@ -271,6 +624,31 @@ bool is_inference_running(void)
     return (state != INFERENCE_STOPPED);
 }
 
+bool ei_impulse_failed(void)
+{
+    return impulse_failed.exchange(false);
+}
+
+void ei_set_result_format(ei_result_format_t format)
+{
+    result_format = format;
+}
+
+ei_result_format_t ei_get_result_format(void)
+{
+    return result_format;
+}
+
+bool ei_set_report_config(const ei_report_config_t *config)
+{
+    return report_policy.configure(config);
+}
+
+void ei_get_report_config(ei_report_config_t *config)
+{
+    report_policy.get_config(config);
+}
+
 K_THREAD_DEFINE(inference_thread_id, CONFIG_EI_INFERENCE_THREAD_STACK,
                 ei_inference_thread, NULL, NULL, NULL,
                 CONFIG_EI_INFERENCE_THREAD_PRIO, 0, 0);
@@ -19,11 +19,28 @@
 #define EI_RUN_IMPULSE_H
 
 #include <cstdint>
+#include "firmware-sdk/ei_result_stream.h"
+#include "ei_report_policy.h"
+#include "ei_impulse_scheduler.h"
 
 void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed = false);
 // on Zephyr OS this function is replaced with a thread
 // void ei_run_impulse(void);
 void ei_stop_impulse(void);
 bool is_inference_running(void);
+// true once after the impulse stopped itself on an error
+bool ei_impulse_failed(void);
+void ei_set_result_format(ei_result_format_t format);
+ei_result_format_t ei_get_result_format(void);
+bool ei_set_report_config(const ei_report_config_t *config);
+void ei_get_report_config(ei_report_config_t *config);
+
+/**
+ * With CONFIG_EI_INFERENCE_SCHEDULER, continuous inference runs the default
+ * impulse through an EiImpulseScheduler. Override this (it's weak) to register
+ * more impulses on the same sensor stream, e.g. from a multi-impulse deployment.
+ * Called once, after the default impulse is registered as model 0.
+ */
+void ei_scheduler_register_models(EiImpulseScheduler *scheduler);
 
 #endif /* EI_RUN_IMPULSE_H */
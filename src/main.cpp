@@ -68,7 +68,8 @@ int main(void)
         char data = uart_getchar();
 
         while(data != 0xFF) {
-            if(is_inference_running() && data == 'b') {
+            // in machine mode 'b' can be part of a pipelined request, AT+STOPIMPULSE stops instead
+            if(is_inference_running() && data == 'b' && !at->is_machine_mode()) {
                 ei_stop_impulse();
                 at->print_prompt();
                 continue;
@@ -77,6 +78,15 @@ int main(void)
             at->handle(data);
             data = uart_getchar();
         }
+        // the impulse stopped on an error, end its AT+RUNIMPULSE request
+        if(ei_impulse_failed()) {
+            if(at->is_machine_mode()) {
+                at->complete_async_command(false);
+            }
+            else {
+                at->print_prompt();
+            }
+        }
         ei_sleep(1);
     }
 }
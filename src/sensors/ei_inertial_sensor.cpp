@@ -32,6 +32,15 @@ LOG_MODULE_REGISTER(acc_sensor);
 
 const struct device *iis2dlpc;
 
+/**
+ * @brief      sensor_value to float without going through double, the
+ *             FPU is single precision only
+ */
+static inline float sensor_value_to_f32(const struct sensor_value *val)
+{
+    return (float)val->val1 + (float)val->val2 / 1000000.0f;
+}
+
 static void iis2dlpc_config(const struct device *iis2dlpc)
 {
     struct sensor_value odr_attr, fs_attr;
@@ -96,9 +105,9 @@ float *ei_fusion_acc_read_data(int n_samples)
     }
     else {
         sensor_channel_get(iis2dlpc, SENSOR_CHAN_ACCEL_XYZ, accel2);
-        acceleration_g[0] = sensor_value_to_double(&accel2[0]);
-        acceleration_g[1] = sensor_value_to_double(&accel2[1]);
-        acceleration_g[2] = sensor_value_to_double(&accel2[2]);
+        acceleration_g[0] = sensor_value_to_f32(&accel2[0]);
+        acceleration_g[1] = sensor_value_to_f32(&accel2[1]);
+        acceleration_g[2] = sensor_value_to_f32(&accel2[2]);
     }
 
     return acceleration_g;
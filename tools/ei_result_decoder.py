@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025 EdgeImpulse Inc.
+#
+# Decodes binary inference results (AT+RESULTFORMAT=BIN8 or BIN16), see
+# firmware-sdk/ei_result_stream.h for the frame format, and log records
+# (CONFIG_EI_LOG_RECORDS), see firmware-sdk/ei_log_stream.h. The format strings
+# of the log records are read from the firmware sources (--sources). Text on
+# the same channel is skipped.
+#
+# Usage:
+#   ei_result_decoder.py --port /dev/ttyACM0 [--labels idle,wave,...] [--sources src firmware-sdk]
+#   ei_result_decoder.py --file capture.bin [--labels idle,wave,...] [--sources src firmware-sdk]
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+SYNC = b'\xeb\x90'
+LOG_SYNC = b'\xeb\x91'
+SYNC_RE = re.compile(b'\xeb[\x90\x91]')
+VERSION = 1
+LOG_VERSION = 1
+HEADER = struct.Struct('<2sBBHH')
+TIMING = struct.Struct('<IIIIIB')
+LOG_PAYLOAD = struct.Struct('<II')
+LOG_MAX_ARGS = 8
+FLAG_F16 = 0x01
+FLAG_ANOMALY = 0x02
+FLAG_SKIPPED = 0x04
+
+LOG_RECORD_RE = re.compile(r'EI_LOG_RECORD\(\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+STRING_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+CONVERSION_RE = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcfFeEgG%])')
+
+
+def format_id(fmt):
+    """ei_log_format_id(): FNV-1a of the format string"""
+    h = 2166136261
+    for b in fmt.encode('utf-8'):
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def load_formats(dirs):
+    """Format strings of the EI_LOG_RECORD calls in the sources, by ID"""
+    formats = {}
+    for d in dirs:
+        for root, _, files in os.walk(d):
+            for name in files:
+                if not name.endswith(('.c', '.cpp', '.h')):
+                    continue
+                with open(os.path.join(root, name), encoding='utf-8', errors='replace') as f:
+                    text = f.read()
+                for m in LOG_RECORD_RE.finditer(text):
+                    literal = ''.join(STRING_RE.findall(m.group(1)))
+                    fmt = literal.encode('utf-8').decode('unicode_escape')
+                    formats[format_id(fmt)] = fmt
+    return formats
+
+
+def format_log(fmt, args):
+    """printf on the 32 bit arguments of a log record"""
+    args = list(args)
+
+    def convert(m):
+        flags, _, conv = m.groups()
+        if conv == '%':
+            return '%'
+        word = args.pop(0) if args else 0
+        if conv in 'di':
+            value = struct.unpack('<i', struct.pack('<I', word))[0]
+        elif conv in 'fFeEgG':
+            value = struct.unpack('<f', struct.pack('<I', word))[0]
+        elif conv == 'c':
+            value = chr(word & 0xff)
+        else:
+            value = word
+        return ('%' + flags + conv) % value
+
+    return CONVERSION_RE.sub(convert, fmt)
+
+
+class ResultDecoder:
+    def __init__(self, formats=None):
+        self.buf = bytearray()
+        self.formats = formats or {}
+        self.last_sequence = None
+        self.last_log_sequence = None
+        self.crc_errors = 0
+        self.lost = 0
+        self.lost_logs = 0
+
+    def feed(self, data):
+        """Add received bytes, yields the decoded results and log records (dicts)"""
+        self.buf += data
+        while True:
+            m = SYNC_RE.search(self.buf)
+            if m is None:
+                # keep a trailing sync byte
+                del self.buf[:max(0, len(self.buf) - 1)]
+                return
+            del self.buf[:m.start()]
+            if len(self.buf) < HEADER.size:
+                return
+            sync, version, flags, sequence, payload_len = HEADER.unpack_from(self.buf)
+            frame_len = HEADER.size + payload_len + 4
+            if sync == LOG_SYNC:
+                valid = version == LOG_VERSION and flags <= LOG_MAX_ARGS and \
+                    payload_len == LOG_PAYLOAD.size + 4 * flags
+            else:
+                valid = version == VERSION and payload_len >= TIMING.size
+            if not valid:
+                del self.buf[:1]
+                continue
+            if len(self.buf) < frame_len:
+                return
+            frame = bytes(self.buf[:frame_len])
+            crc, = struct.unpack_from('<I', frame, frame_len - 4)
+            if zlib.crc32(frame[:-4]) != crc:
+                self.crc_errors += 1
+                del self.buf[:1]
+                continue
+            del self.buf[:frame_len]
+            if sync == LOG_SYNC:
+                result = self.decode_log(frame, flags, sequence)
+            else:
+                result = self.decode(frame, flags, sequence)
+            if result is not None:
+                yield result
+
+    def decode(self, frame, flags, sequence):
+        timestamp, dsp, classification, postprocessing, anomaly, count = \
+            TIMING.unpack_from(frame, HEADER.size)
+        offset = HEADER.size + TIMING.size
+        if flags & FLAG_F16:
+            scores = list(struct.unpack_from('<%de' % count, frame, offset))
+            offset += 2 * count
+        else:
+            scores = [v / 127.0 for v in struct.unpack_from('<%db' % count, frame, offset)]
+            offset += count
+        result = {
+            'sequence': sequence,
+            'timestamp_ms': timestamp,
+            'timing_us': {
+                'dsp': dsp,
+                'classification': classification,
+                'postprocessing': postprocessing,
+                'anomaly': anomaly,
+            },
+            'scores': scores,
+            'skipped': bool(flags & FLAG_SKIPPED),
+        }
+        if flags & FLAG_ANOMALY:
+            result['anomaly'], = struct.unpack_from('<e', frame, offset)
+
+        if self.last_sequence is not None:
+            self.lost += (sequence - self.last_sequence - 1) & 0xffff
+        self.last_sequence = sequence
+
+        return result
+
+    def decode_log(self, frame, arg_count, sequence):
+        fmt_id, timestamp = LOG_PAYLOAD.unpack_from(frame, HEADER.size)
+        args = struct.unpack_from('<%dI' % arg_count, frame, HEADER.size + LOG_PAYLOAD.size)
+        if fmt_id in self.formats:
+            text = format_log(self.formats[fmt_id], args)
+        else:
+            text = 'unknown format 0x%08x %s\n' % (fmt_id, ' '.join('0x%08x' % a for a in args))
+
+        if self.last_log_sequence is not None:
+            self.lost_logs += (sequence - self.last_log_sequence - 1) & 0xffff
+        self.last_log_sequence = sequence
+
+        return {
+            'sequence': sequence,
+            'timestamp_ms': timestamp,
+            'format_id': fmt_id,
+            'args': list(args),
+            'log': text,
+        }
+
+
+def format_result(result, labels):
+    if 'log' in result:
+        return '[%5d] %10d ms  %s' % (result['sequence'], result['timestamp_ms'], result['log'].rstrip('\n'))
+    names = labels if labels and len(labels) == len(result['scores']) \
+        else ['#%d' % i for i in range(len(result['scores']))]
+    scores = ' '.join('%s: %.3f' % (n, s) for n, s in zip(names, result['scores']))
+    timing = result['timing_us']
+    line = '[%5d] %10d ms  %s' % (result['sequence'], result['timestamp_ms'], scores)
+    if 'anomaly' in result:
+        line += '  anomaly: %.3f' % result['anomaly']
+    line += '  (DSP %d us, NN %d us)' % (timing['dsp'], timing['classification'])
+    if result['skipped']:
+        line += ' skipped'
+    return line
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode binary Edge Impulse inference results')
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--port', help='serial port (requires pyserial)')
+    source.add_argument('--file', help='captured serial data')
+    parser.add_argument('--baudrate', type=int, default=115200)
+    parser.add_argument('--labels', help='comma separated labels, in model order')
+    parser.add_argument('--sources', nargs='+', default=[],
+                        help='firmware source directories, for the log record format strings')
+    args = parser.parse_args()
+
+    labels = args.labels.split(',') if args.labels else None
+    decoder = ResultDecoder(load_formats(args.sources))
+
+    if args.file:
+        with open(args.file, 'rb') as f:
+            for result in decoder.feed(f.read()):
+                print(format_result(result, labels))
+    else:
+        import serial
+        with serial.Serial(args.port, args.baudrate, timeout=0.1) as port:
+            try:
+                while True:
+                    for result in decoder.feed(port.read(4096)):
+                        print(format_result(result, labels), flush=True)
+            except KeyboardInterrupt:
+                pass
+
+    print('CRC errors: %d, lost frames: %d, lost log records: %d' %
+          (decoder.crc_errors, decoder.lost, decoder.lost_logs), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
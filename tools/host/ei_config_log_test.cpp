@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Replays the config log of EiDeviceInfo on two RAM config blocks:
+ * - a config in the old EiConfig layout is loaded and moved to the log
+ * - random setter sequences survive a reload (replay) and the compactions,
+ *   with one erase per compaction instead of one per save
+ * - a torn last record is dropped, the next save compacts
+ * - an interrupted compaction leaves the old log current
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "firmware-sdk/ei_device_info_lib.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static const uint32_t ram_block_size = 4096;
+
+static int failures = 0;
+static std::mt19937 rng(7);
+
+class ConfigRAM : public EiDeviceRAM<ram_block_size, 4> {
+public:
+    uint32_t erases = 0;
+
+    ConfigRAM() : EiDeviceRAM<ram_block_size, 4>(2 * ram_block_size) {}
+
+    uint32_t erase_data(uint32_t address, uint32_t num_bytes) override
+    {
+        erases++;
+        return EiDeviceRAM<ram_block_size, 4>::erase_data(address, num_bytes);
+    }
+
+    uint8_t *raw(void) { return ram_memory; }
+    uint32_t current_block(void) { return config_block; }
+    uint32_t current_offset(void) { return config_offset; }
+};
+
+class ConfigDevice : public EiDeviceInfo {
+public:
+    ConfigDevice(EiDeviceMemory *mem)
+    {
+        memory = mem;
+        load_config();
+    }
+
+    void init_device_id(void) override {}
+};
+
+EiDeviceInfo *EiDeviceInfo::get_device(void)
+{
+    return nullptr;
+}
+
+typedef struct {
+    std::string label;
+    std::string host;
+    std::string path;
+    float interval;
+    uint32_t length;
+} config_model_t;
+
+static bool matches(ConfigDevice &dev, const config_model_t &m)
+{
+    return dev.get_sample_label() == m.label
+        && dev.get_upload_host() == m.host
+        && dev.get_upload_path() == m.path
+        && dev.get_sample_interval_ms() == m.interval
+        && dev.get_sample_length_ms() == m.length;
+}
+
+static std::string random_string(size_t max_length)
+{
+    std::string s(1 + rng() % max_length, 'a');
+
+    for (char &c : s) {
+        c = 'a' + rng() % 26;
+    }
+    return s;
+}
+
+static void test_legacy(void)
+{
+    ConfigRAM ram;
+    EiConfig legacy;
+
+    memset(&legacy, 0, sizeof(legacy));
+    strcpy(legacy.upload_host, "legacy.host");
+    legacy.sample_interval_ms = 16.0f;
+    legacy.magic = 0xdeadbeef;
+    ram.save_config((uint8_t *)&legacy, sizeof(legacy));
+
+    ConfigDevice dev(&ram);
+    CHECK(dev.get_upload_host() == "legacy.host");
+    CHECK(dev.get_sample_interval_ms() == 16.0f);
+
+    // the first save starts the log
+    dev.set_sample_label("first");
+    ConfigDevice reloaded(&ram);
+    CHECK(reloaded.get_upload_host() == "legacy.host");
+    CHECK(reloaded.get_sample_label() == "first");
+}
+
+static void test_replay(void)
+{
+    ConfigRAM ram;
+    ConfigDevice dev(&ram);
+    config_model_t m = { "label", "host", "path", 10.0f, 1000 };
+    const int saves = 3000;
+
+    dev.set_sample_label(m.label);
+    dev.set_upload_host(m.host);
+    dev.set_upload_path(m.path);
+    dev.set_sample_interval_ms(m.interval);
+    dev.set_sample_length_ms(m.length);
+    ram.erases = 0;
+
+    for (int ix = 0; ix < saves; ix++) {
+        switch (rng() % 5) {
+            case 0: m.label = random_string(40); dev.set_sample_label(m.label); break;
+            case 1: m.host = random_string(120); dev.set_upload_host(m.host); break;
+            case 2: m.path = random_string(8); dev.set_upload_path(m.path); break;
+            case 3: m.interval = (rng() % 1000) / 8.0f; dev.set_sample_interval_ms(m.interval); break;
+            case 4: m.length = rng() % 100000; dev.set_sample_length_ms(m.length); break;
+        }
+
+        if (ix % 97 == 0) {
+            ConfigDevice reloaded(&ram);
+            CHECK(matches(reloaded, m));
+        }
+    }
+
+    printf("%d saves: %u erases\n", saves, (unsigned)ram.erases);
+    CHECK(ram.erases > 0);
+    CHECK(ram.erases < saves / 50);
+
+    // nothing changed, nothing appended
+    uint32_t offset = ram.current_offset();
+    CHECK(dev.save_config());
+    CHECK(ram.current_offset() == offset);
+
+    ConfigDevice reloaded(&ram);
+    CHECK(matches(reloaded, m));
+}
+
+static void test_torn_record(void)
+{
+    ConfigRAM ram;
+    ConfigDevice dev(&ram);
+
+    dev.set_sample_label("kept");
+    dev.set_upload_path("/torn");
+    // power lost while the last record was written
+    ram.raw()[ram.current_block() * ram_block_size + ram.current_offset() - 1] ^= 0x55;
+
+    ConfigDevice torn(&ram);
+    CHECK(torn.get_sample_label() == "kept");
+    CHECK(torn.get_upload_path() != "/torn");
+
+    // the log is closed at the torn record, the next save compacts
+    ram.erases = 0;
+    torn.set_upload_path("/after");
+    CHECK(ram.erases == 1);
+
+    ConfigDevice reloaded(&ram);
+    CHECK(reloaded.get_sample_label() == "kept");
+    CHECK(reloaded.get_upload_path() == "/after");
+}
+
+static void test_interrupted_compaction(void)
+{
+    ConfigRAM ram;
+    ConfigDevice dev(&ram);
+    const uint8_t value[] = "new";
+
+    dev.set_sample_label("old");
+    const uint32_t block = ram.current_block();
+
+    // power lost before the header of the new log was written
+    CHECK(ram.start_config_compaction());
+    CHECK(ram.append_config_record(EI_CONFIG_KEY_SAMPLE_LABEL, value, 3));
+
+    ConfigDevice reloaded(&ram);
+    CHECK(ram.current_block() == block);
+    CHECK(reloaded.get_sample_label() == "old");
+
+    // and the compaction after that one takes over
+    CHECK(ram.start_config_compaction());
+    CHECK(ram.append_config_record(EI_CONFIG_KEY_SAMPLE_LABEL, value, 3));
+    CHECK(ram.finish_config_compaction());
+
+    ConfigDevice compacted(&ram);
+    CHECK(ram.current_block() != block);
+    CHECK(compacted.get_sample_label() == "new");
+}
+
+int main(void)
+{
+    test_legacy();
+    test_replay();
+    test_torn_record();
+    test_interrupted_compaction();
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
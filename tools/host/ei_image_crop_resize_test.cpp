@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Checks that crop_resize_image() is bit exact with the implementation it
+ * replaced: cropImage() followed by the per pixel resize_image() loop, copied
+ * below as it was. Random image sizes, crops and pixel formats, squashed
+ * resizes, in place crop_and_interpolate_image() and grayscale output.
+ *
+ * The old loop reads one pixel / row past the crop when upscaling, the new
+ * one replicates the edge instead. Upscales are checked against the old loop
+ * with that one index clamped.
+ *
+ * Built twice: with the portable C path, and (ei_image_crop_resize_dsp_test)
+ * with the SMLAD/UXTB16 path of processing.cpp on emulated intrinsics.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(EI_IMAGE_RESIZE_USE_DSP_EXT) && EI_IMAGE_RESIZE_USE_DSP_EXT == 1
+// the Cortex-M DSP intrinsics processing.cpp uses, as in cmsis_gcc.h
+static inline uint32_t __SMLAD(uint32_t op1, uint32_t op2, uint32_t op3)
+{
+    return (uint32_t)((int32_t)op3 +
+        (int16_t)(op1 & 0xffff) * (int16_t)(op2 & 0xffff) +
+        (int16_t)(op1 >> 16) * (int16_t)(op2 >> 16));
+}
+static inline uint32_t __UXTB16(uint32_t op1)
+{
+    return op1 & 0x00ff00ffu;
+}
+static inline uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+    return (op1 >> op2) | (op1 << (32 - op2));
+}
+#define __PKHBT(ARG1, ARG2, ARG3) ((((uint32_t)(ARG1)) & 0x0000ffffu) | ((((uint32_t)(ARG2)) << (ARG3)) & 0xffff0000u))
+#define __PKHTB(ARG1, ARG2, ARG3) ((((uint32_t)(ARG1)) & 0xffff0000u) | ((((uint32_t)(ARG2)) >> (ARG3)) & 0x0000ffffu))
+
+// replaces the copy in the SDK library, nothing else linked here uses it
+#include "edge-impulse-sdk/dsp/image/processing.cpp"
+#define RESIZE_PATH "SMLAD/UXTB16 (emulated)"
+#else
+#include "edge-impulse-sdk/dsp/image/processing.hpp"
+#define RESIZE_PATH "C"
+#endif
+
+using namespace ei;
+using namespace ei::image::processing;
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static const int iterations = 500;
+
+static int failures = 0;
+
+namespace legacy {
+
+/**
+ * resize_image() before crop_resize_image(), unchanged except for
+ * clamp_edges: don't read past the last column / row (upscaling only)
+ */
+int resize_image(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    uint8_t *dstImage,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B,
+    bool clamp_edges = false)
+{
+    constexpr int FRAC_BITS = 14;
+    constexpr int FRAC_VAL = (1 << FRAC_BITS);
+    constexpr int FRAC_MASK = (FRAC_VAL - 1);
+
+    uint32_t src_x_accum, src_y_accum;
+    uint32_t x_frac, nx_frac, y_frac, ny_frac;
+    int x, y, ty;
+
+    if (srcHeight < 2) {
+        return EIDSP_PARAMETER_INVALID;
+    }
+
+    const int srcPixels = srcWidth;
+    src_y_accum = 0;
+    const uint32_t src_x_frac = (srcWidth * FRAC_VAL) / dstWidth;
+    const uint32_t src_y_frac = (srcHeight * FRAC_VAL) / dstHeight;
+
+    srcWidth *= pixel_size_B;
+
+    const uint8_t *s;
+    uint8_t *d;
+
+    for (y = 0; y < dstHeight; y++) {
+        ty = src_y_accum >> FRAC_BITS;
+        y_frac = src_y_accum & FRAC_MASK;
+        src_y_accum += src_y_frac;
+        ny_frac = FRAC_VAL - y_frac;
+
+        const int next_row = (clamp_edges && ty + 1 >= srcHeight) ? 0 : srcWidth;
+
+        s = &srcImage[ty * srcWidth];
+        d = &dstImage[y * dstWidth * pixel_size_B];
+        src_x_accum = 0;
+        for (x = 0; x < dstWidth; x++) {
+            uint32_t tx, p00, p01, p10, p11;
+            const int next_col = (clamp_edges && (int)(src_x_accum >> FRAC_BITS) + 1 >= srcPixels) ? 0 : pixel_size_B;
+            tx = (src_x_accum >> FRAC_BITS) * pixel_size_B;
+            x_frac = src_x_accum & FRAC_MASK;
+            nx_frac = FRAC_VAL - x_frac;
+            src_x_accum += src_x_frac;
+
+            for (int color = 0; color < pixel_size_B; color++) {
+                p00 = s[tx];
+                p10 = s[tx + next_col];
+                p01 = s[tx + next_row];
+                p11 = s[tx + next_row + next_col];
+                p00 = ((p00 * nx_frac) + (p10 * x_frac) + FRAC_VAL / 2) >> FRAC_BITS;
+                p01 = ((p01 * nx_frac) + (p11 * x_frac) + FRAC_VAL / 2) >> FRAC_BITS;
+                p00 = ((p00 * ny_frac) + (p01 * y_frac) + FRAC_VAL / 2) >> FRAC_BITS;
+                *d++ = (uint8_t)p00;
+                tx++;
+            }
+        }
+    }
+    return EIDSP_OK;
+}
+
+/**
+ * crop_and_interpolate_image() before crop_resize_image(): crop, then resize in place
+ */
+int crop_and_interpolate_image(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    uint8_t *dstImage,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B)
+{
+    int cropWidth, cropHeight;
+    calculate_crop_dims(srcWidth, srcHeight, dstWidth, dstHeight, cropWidth, cropHeight);
+
+    int res = cropImage(
+        srcImage,
+        srcWidth * pixel_size_B,
+        srcHeight,
+        ((srcWidth - cropWidth) / 2) * pixel_size_B,
+        (srcHeight - cropHeight) / 2,
+        dstImage,
+        cropWidth * pixel_size_B,
+        cropHeight,
+        8);
+
+    if (res != EIDSP_OK) {
+        return res;
+    }
+
+    return resize_image(dstImage, cropWidth, cropHeight, dstImage, dstWidth, dstHeight, pixel_size_B);
+}
+
+} // namespace legacy
+
+static int rand_range(int lo, int hi)
+{
+    return lo + rand() % (hi - lo + 1);
+}
+
+/**
+ * Random pixels, with one spare row at the end: the old loop reads it
+ * (with zero weight) when the last source row is hit exactly
+ */
+static std::vector<uint8_t> make_image(int width, int height, int pixel_size_B)
+{
+    std::vector<uint8_t> image((width * (height + 1) + 1) * pixel_size_B);
+    for (auto &px : image) {
+        px = (uint8_t)rand();
+    }
+    return image;
+}
+
+static void to_grayscale(const uint8_t *rgb, int pixels, uint8_t *out)
+{
+    for (int ix = 0; ix < pixels; ix++, rgb += 3) {
+        out[ix] = (uint8_t)((rgb[0] * 19595 + rgb[1] * 38469 + rgb[2] * 7471) >> 16);
+    }
+}
+
+/**
+ * The old way of cropping and resizing: crop into a scratch buffer, then resize
+ */
+static void reference_crop_resize(
+    const uint8_t *src, int src_width, int crop_x, int crop_y, int crop_width, int crop_height,
+    uint8_t *dst, int dst_width, int dst_height, int pixel_size_B, bool gray)
+{
+    std::vector<uint8_t> crop((crop_width * (crop_height + 1) + 1) * pixel_size_B);
+    std::vector<uint8_t> rgb(dst_width * dst_height * pixel_size_B);
+    const bool upscale = dst_width > crop_width || dst_height > crop_height;
+
+    for (int y = 0; y < crop_height; y++) {
+        memcpy(&crop[y * crop_width * pixel_size_B],
+               &src[((crop_y + y) * src_width + crop_x) * pixel_size_B],
+               crop_width * pixel_size_B);
+    }
+    legacy::resize_image(crop.data(), crop_width, crop_height, rgb.data(), dst_width, dst_height,
+                         pixel_size_B, upscale);
+
+    if (gray) {
+        to_grayscale(rgb.data(), dst_width * dst_height, dst);
+    }
+    else {
+        memcpy(dst, rgb.data(), rgb.size());
+    }
+}
+
+static void test_resize(void)
+{
+    for (int it = 0; it < iterations; it++) {
+        const int bpp = (it & 1) ? RGB888_B_SIZE : MONO_B_SIZE;
+        const int sw = rand_range(2, 200), sh = rand_range(2, 160);
+        const int dw = rand_range(1, sw), dh = rand_range(1, sh);
+        std::vector<uint8_t> src = make_image(sw, sh, bpp);
+        std::vector<uint8_t> expected(dw * dh * bpp), actual(dw * dh * bpp);
+
+        CHECK(legacy::resize_image(src.data(), sw, sh, expected.data(), dw, dh, bpp) == EIDSP_OK);
+        CHECK(resize_image(src.data(), sw, sh, actual.data(), dw, dh, bpp) == EIDSP_OK);
+        if (memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+            printf("FAIL resize %dx%dx%d -> %dx%d\n", sw, sh, bpp, dw, dh);
+            failures++;
+        }
+    }
+}
+
+static void test_crop_and_interpolate_in_place(void)
+{
+    for (int it = 0; it < iterations; it++) {
+        const int bpp = (it & 1) ? RGB888_B_SIZE : MONO_B_SIZE;
+        const int sw = rand_range(2, 200), sh = rand_range(2, 160);
+        const int dw = rand_range(1, sw), dh = rand_range(1, sh);
+        int cw, ch;
+
+        // the old version can only scale down
+        calculate_crop_dims(sw, sh, dw, dh, cw, ch);
+        if (ch < 2 || dw > cw || dh > ch) {
+            continue;
+        }
+
+        std::vector<uint8_t> expected = make_image(sw, sh, bpp);
+        std::vector<uint8_t> actual(expected);
+
+        // a crop that doesn't fit the image (tall output from a wide image) is rejected by both
+        int expected_res = legacy::crop_and_interpolate_image(expected.data(), sw, sh, expected.data(), dw, dh, bpp);
+        int res = crop_and_interpolate_image(actual.data(), sw, sh, actual.data(), dw, dh, bpp);
+        CHECK(res == expected_res);
+        if (res == EIDSP_OK && memcmp(expected.data(), actual.data(), dw * dh * bpp) != 0) {
+            printf("FAIL crop_and_interpolate %dx%dx%d -> %dx%d\n", sw, sh, bpp, dw, dh);
+            failures++;
+        }
+    }
+}
+
+/**
+ * Arbitrary crops, scaled up or down, RGB / mono / RGB to grayscale,
+ * through the buffer and the row streaming entry points
+ */
+static void test_crop_resize(void)
+{
+    for (int it = 0; it < iterations; it++) {
+        const int bpp = (it & 1) ? RGB888_B_SIZE : MONO_B_SIZE;
+        const bool gray = bpp == RGB888_B_SIZE && (rand() & 2);
+        const int out_bpp = gray ? MONO_B_SIZE : bpp;
+        const int sw = rand_range(2, 200), sh = rand_range(2, 160);
+        const int cx = rand_range(0, sw - 1), cy = rand_range(0, sh - 2);
+        const int cw = rand_range(1, sw - cx), ch = rand_range(2, sh - cy);
+        const int dw = rand_range(1, 2 * cw), dh = rand_range(1, 2 * ch);
+        std::vector<uint8_t> src = make_image(sw, sh, bpp);
+        std::vector<uint8_t> expected(dw * dh * out_bpp), actual(dw * dh * out_bpp), rows(dw * dh * out_bpp);
+
+        reference_crop_resize(src.data(), sw, cx, cy, cw, ch, expected.data(), dw, dh, bpp, gray);
+
+        CHECK(crop_resize_image(src.data(), sw, sh, cx, cy, cw, ch, actual.data(), dw, dh, bpp, gray) == EIDSP_OK);
+        if (memcmp(expected.data(), actual.data(), expected.size()) != 0) {
+            printf("FAIL crop_resize %dx%dx%d crop %d,%d %dx%d -> %dx%d%s\n",
+                   sw, sh, bpp, cx, cy, cw, ch, dw, dh, gray ? " gray" : "");
+            failures++;
+        }
+
+        // source rows in increasing order, each at most once
+        int last_src_row = -1;
+        bool src_order_ok = true;
+        int last_dst_row = -1;
+        bool dst_order_ok = true;
+        // every other run streams through a caller owned scratch instead of the shared one
+        std::vector<uint32_t> scratch((crop_resize_scratch_size(dw, bpp, gray) + 3) / 4);
+        uint8_t *scratch_ptr = (it & 2) ? reinterpret_cast<uint8_t *>(scratch.data()) : nullptr;
+
+        int res = crop_resize_image_rows(
+            [&](int y) -> const uint8_t * {
+                src_order_ok &= y > last_src_row && y >= cy && y < cy + ch;
+                last_src_row = y;
+                return &src[y * sw * bpp];
+            },
+            sw, sh, cx, cy, cw, ch,
+            [&](int y) -> uint8_t * {
+                dst_order_ok &= y == last_dst_row + 1;
+                last_dst_row = y;
+                return &rows[y * dw * out_bpp];
+            },
+            dw, dh, bpp, gray, scratch_ptr);
+
+        CHECK(res == EIDSP_OK);
+        CHECK(src_order_ok);
+        CHECK(dst_order_ok && last_dst_row == dh - 1);
+        CHECK(memcmp(expected.data(), rows.data(), expected.size()) == 0);
+    }
+}
+
+static void test_invalid(void)
+{
+    std::vector<uint8_t> src = make_image(16, 16, RGB888_B_SIZE);
+    std::vector<uint8_t> dst(16 * 16 * RGB888_B_SIZE);
+
+    // crop outside the image, too short, bad pixel size, grayscale from mono
+    CHECK(crop_resize_image(src.data(), 16, 16, 8, 0, 9, 16, dst.data(), 4, 4, 3) == EIDSP_PARAMETER_INVALID);
+    CHECK(crop_resize_image(src.data(), 16, 16, 0, 0, 16, 1, dst.data(), 4, 4, 3) == EIDSP_PARAMETER_INVALID);
+    CHECK(crop_resize_image(src.data(), 16, 16, 0, 0, 16, 16, dst.data(), 4, 4, 2) == EIDSP_PARAMETER_INVALID);
+    CHECK(crop_resize_image(src.data(), 16, 16, 0, 0, 16, 16, dst.data(), 4, 4, 1, true) == EIDSP_PARAMETER_INVALID);
+
+    // aborting callbacks
+    CHECK(crop_resize_image_rows(
+        [](int y) -> const uint8_t * { return nullptr; }, 16, 16, 0, 0, 16, 16,
+        [&](int y) -> uint8_t * { return dst.data(); }, 4, 4, 3) == EIDSP_OUT_OF_BOUNDS);
+    CHECK(crop_resize_image_rows(
+        [&](int y) -> const uint8_t * { return &src[y * 16 * 3]; }, 16, 16, 0, 0, 16, 16,
+        [](int y) -> uint8_t * { return nullptr; }, 4, 4, 3) == EIDSP_OUT_OF_BOUNDS);
+}
+
+int main(void)
+{
+    srand(1);
+
+    printf("resize path: %s\n", RESIZE_PATH);
+
+    test_resize();
+    test_crop_and_interpolate_in_place();
+    test_crop_resize();
+    test_invalid();
+
+    // shared scratch is released and grown again on the next resize
+    free_resize_scratch();
+    test_resize();
+    free_resize_scratch();
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
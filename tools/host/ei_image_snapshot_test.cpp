@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+/**
+ * Runs the band based snapshot pipeline of ei_image_lib.cpp against a fake
+ * camera that captures in bands:
+ * - rows are captured top to bottom, each band once, also when rows are skipped
+ * - going back to a band that was already captured fails instead of reading
+ *   outside the band, same for rows past the frame
+ * - the sink rejects skipped rows and rows of a band that was already sent
+ * - a resized snapshot is bit exact with crop_resize_image() on the full frame
+ */
+
+/* Include ----------------------------------------------------------------- */
+// the pipeline classes are local to the translation unit
+#include "firmware-sdk/ei_image_lib.cpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static int failures = 0;
+
+static uint8_t pixel_value(uint32_t x, uint32_t y, uint32_t channel)
+{
+    return (uint8_t)(x * 7 + y * 13 + channel * 61);
+}
+
+class BandCamera : public EiCamera {
+public:
+    std::vector<uint32_t> bands;
+    uint16_t width = 0;
+    uint16_t height = 0;
+
+    bool init(uint16_t w, uint16_t h) override
+    {
+        set_resolution(search_resolution(w, h));
+        return true;
+    }
+
+    bool ei_camera_capture_rows_packed_big_endian(
+        uint8_t *rows,
+        uint32_t first_row,
+        uint32_t row_count,
+        bool grayscale) override
+    {
+        const uint32_t channels = grayscale ? 1 : 3;
+
+        bands.push_back(first_row);
+        for (uint32_t y = 0; y < row_count; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                for (uint32_t c = 0; c < channels; c++) {
+                    *rows++ = pixel_value(x, first_row + y, c);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool supports_row_capture(void) override
+    {
+        return true;
+    }
+
+    ei_device_snapshot_resolutions_t get_min_resolution(void) override
+    {
+        return resolutions[0];
+    }
+
+    void get_resolutions(ei_device_snapshot_resolutions_t **res, uint8_t *res_num) override
+    {
+        *res = resolutions;
+        *res_num = 2;
+    }
+
+    bool set_resolution(const ei_device_snapshot_resolutions_t res) override
+    {
+        width = res.width;
+        height = res.height;
+        return true;
+    }
+
+private:
+    ei_device_snapshot_resolutions_t resolutions[2] = { { 40, 30 }, { 100, 75 } };
+};
+
+class SnapshotDevice : public EiDeviceInfo {
+public:
+    std::string color_depth = "RGB";
+
+    void init_device_id(void) override {}
+
+    EiSnapshotProperties get_snapshot_list(void) override
+    {
+        EiSnapshotProperties props = {};
+        props.has_snapshot = true;
+        props.color_depth = color_depth;
+        return props;
+    }
+};
+
+static BandCamera camera;
+static SnapshotDevice device;
+static std::string output;
+
+EiCamera *EiCamera::get_camera()
+{
+    return &camera;
+}
+
+EiDeviceInfo *EiDeviceInfo::get_device(void)
+{
+    return &device;
+}
+
+void ei_putchar(char c)
+{
+    output.push_back(c);
+}
+
+bool ei_user_invoke_stop_lib(void)
+{
+    return true;
+}
+
+static void test_source_order(void)
+{
+    const int width = 20, height = 40;
+
+    camera.width = width;
+    camera.height = height;
+    camera.bands.clear();
+
+    SnapshotSource source(&camera, width, height, MONO_B_SIZE);
+    CHECK(source.begin());
+
+    // skipping rows still reads every band once, in order
+    const int rows[] = { 0, 0, 5, 15, 21, 39 };
+    for (int y : rows) {
+        const uint8_t *row = source.get_row(y);
+        CHECK(row != nullptr);
+        if (row) {
+            CHECK(row[0] == pixel_value(0, y, 0));
+            CHECK(row[width - 1] == pixel_value(width - 1, y, 0));
+        }
+    }
+    CHECK(camera.bands == std::vector<uint32_t>({ 0, 16, 32 }));
+
+    // earlier bands can't be captured again, rows past the frame don't exist
+    CHECK(source.get_row(31) == nullptr);
+    CHECK(source.get_row(height) == nullptr);
+    CHECK(source.get_row(-1) == nullptr);
+    CHECK(source.get_row(35) != nullptr);
+    CHECK(camera.bands.size() == 3);
+}
+
+static void test_sink_order(void)
+{
+    SnapshotSink sink(20, 40, MONO_B_SIZE);
+    CHECK(sink.begin());
+
+    CHECK(sink.get_row(1) == nullptr);
+    CHECK(sink.get_row(0) != nullptr);
+    CHECK(sink.get_row(0) != nullptr);
+    for (int y = 1; y <= SNAPSHOT_BAND_ROWS; y++) {
+        CHECK(sink.get_row(y) != nullptr);
+    }
+    // the first band went out when row 16 was requested
+    CHECK(sink.get_row(SNAPSHOT_BAND_ROWS - 1) == nullptr);
+    CHECK(sink.get_row(SNAPSHOT_BAND_ROWS + 2) == nullptr);
+    CHECK(sink.end());
+}
+
+static void test_snapshot_resize(const char *color_depth, int pixel_size_B)
+{
+    const int width = 64, height = 48;
+
+    device.color_depth = color_depth;
+    camera.bands.clear();
+    output.clear();
+
+    CHECK(ei_camera_take_snapshot_output_on_serial(width, height, false));
+
+    // captured at 100x75 in order, resized to the snapshot size
+    CHECK(camera.width == 100 && camera.height == 75);
+    CHECK(camera.bands == std::vector<uint32_t>({ 0, 16, 32, 48, 64 }));
+
+    std::vector<uint8_t> frame(camera.width * camera.height * pixel_size_B);
+    for (int y = 0; y < camera.height; y++) {
+        for (int x = 0; x < camera.width; x++) {
+            for (int c = 0; c < pixel_size_B; c++) {
+                frame[(y * camera.width + x) * pixel_size_B + c] = pixel_value(x, y, c);
+            }
+        }
+    }
+
+    int crop_width, crop_height;
+    ei::image::processing::calculate_crop_dims(camera.width, camera.height, width, height, crop_width, crop_height);
+
+    std::vector<uint8_t> expected(width * height * pixel_size_B);
+    CHECK(ei::image::processing::crop_resize_image(
+        frame.data(), camera.width, camera.height,
+        (camera.width - crop_width) / 2, (camera.height - crop_height) / 2, crop_width, crop_height,
+        expected.data(), width, height, pixel_size_B) == ei::EIDSP_OK);
+
+    std::vector<unsigned char> actual = base64_decode(output);
+    CHECK(actual == std::vector<unsigned char>(expected.begin(), expected.end()));
+}
+
+int main(void)
+{
+    test_source_order();
+    test_sink_order();
+    test_snapshot_resize("RGB", RGB888_B_SIZE);
+    test_snapshot_resize("Grayscale", MONO_B_SIZE);
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
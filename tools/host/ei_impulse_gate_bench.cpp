@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Replays a recording window by window through the impulse without a gate and
+ * with a few gate configurations, and reports the CPU time per window, how many
+ * windows were skipped and how often the gated top class differs from the ungated one.
+ *
+ *   ei_impulse_gate_bench [recording.csv] [idle duty cycle in %]
+ *
+ * The recording has one sample per line, the model's axes separated by commas
+ * (a header line is skipped). Without one, a synthetic recording is generated:
+ * idle stretches (sensor noise and gravity) with bursts of motion.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if EI_CLASSIFIER_GATE_ENABLED != 1
+#error "Build with -DEI_CLASSIFIER_GATE_ENABLED=1"
+#endif
+
+static const size_t axes = EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
+static const size_t window = EI_CLASSIFIER_RAW_SAMPLE_COUNT;
+static const size_t synthetic_windows = 2000;
+
+typedef struct {
+    const char *name;
+    ei_impulse_gate_config_t config;
+} gate_setup_t;
+
+static const gate_setup_t setups[] = {
+    // CONFIG_EI_INFERENCE_GATE defaults: learned threshold only
+    { "learned", { 0.0f, 1.5f, 0.8f, 0, 0, 0.1f, 10 } },
+    { "learned+stable", { 0.0f, 1.5f, 0.8f, 0, 3, 0.1f, 10 } },
+    { "fixed 0.1", { 0.1f, 0.0f, 0.8f, 0, 0, 0.1f, 10 } },
+};
+
+typedef struct {
+    uint64_t time_us;
+    uint32_t ran;
+    uint32_t skipped_idle;
+    uint32_t skipped_stable;
+    uint32_t disagree;          // top class differs from the ungated run
+    uint32_t missed_active;     // ungated: not idle, gated: idle
+} replay_stats_t;
+
+static uint32_t rand_state = 12345;
+
+static float rand_uniform(void)
+{
+    rand_state = rand_state * 1664525u + 1013904223u;
+    return (rand_state >> 8) / 16777216.0f;
+}
+
+static void make_recording(std::vector<float> &samples, int idle_percent)
+{
+    const size_t frames = synthetic_windows * window;
+    size_t ix = 0;
+
+    samples.resize(frames * axes);
+
+    while (ix < frames) {
+        // stretches of 2..10 windows
+        size_t length = (size_t)(window * (2 + rand_uniform() * 8));
+        bool idle = rand_uniform() * 100 < idle_percent;
+        // the model's classes need large movements on one or more axes
+        uint32_t motion_axes = 1 + (uint32_t)(rand_uniform() * ((1 << axes) - 1));
+        float amplitude = 20.0f + rand_uniform() * 40.0f;
+        float freq = 0.1f + rand_uniform() * 0.3f;
+
+        for (size_t fx = 0; fx < length && ix < frames; fx++, ix++) {
+            for (size_t ax = 0; ax < axes; ax++) {
+                float v = 0.02f * (rand_uniform() - 0.5f) + (ax == 2 ? 9.81f : 0.0f);
+                if (!idle && (motion_axes & (1 << ax))) {
+                    v += amplitude * sinf(freq * fx + ax);
+                }
+                samples[ix * axes + ax] = v;
+            }
+        }
+    }
+}
+
+static bool load_recording(const char *path, std::vector<float> &samples)
+{
+    FILE *f = fopen(path, "r");
+    char line[256];
+
+    if (f == nullptr) {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line;
+        float frame[axes];
+        size_t ax;
+
+        for (ax = 0; ax < axes; ax++) {
+            char *end;
+            frame[ax] = strtof(p, &end);
+            if (end == p) {
+                break;
+            }
+            p = (*end == ',') ? end + 1 : end;
+        }
+        // header or malformed line
+        if (ax == axes) {
+            samples.insert(samples.end(), frame, frame + axes);
+        }
+    }
+    fclose(f);
+
+    return true;
+}
+
+static int top_class(const ei_impulse_result_t *result)
+{
+    int top = 0;
+
+    for (int ix = 1; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        if (result->classification[ix].value > result->classification[top].value) {
+            top = ix;
+        }
+    }
+
+    return top;
+}
+
+static bool run_window(ei_impulse_handle_t *handle, float *data, ei_impulse_result_t *result, uint64_t *time_us)
+{
+    signal_t signal;
+
+    numpy::signal_from_buffer(data, window * axes, &signal);
+    memset(result, 0, sizeof(*result));
+
+    uint64_t start_us = ei_read_timer_us();
+    EI_IMPULSE_ERROR res = run_classifier(handle, &signal, result, false);
+    *time_us += ei_read_timer_us() - start_us;
+
+    if (res != EI_IMPULSE_OK) {
+        printf("ERR: run_classifier failed (%d)\n", res);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<float> samples;
+    int idle_percent = (argc > 2) ? atoi(argv[2]) : 80;
+
+    if (argc > 1 && strcmp(argv[1], "-") != 0) {
+        if (!load_recording(argv[1], samples)) {
+            printf("ERR: can't read %s\n", argv[1]);
+            return 1;
+        }
+        printf("Recording: %s\n", argv[1]);
+    }
+    else {
+        make_recording(samples, idle_percent);
+        printf("Recording: synthetic, %d%% idle\n", idle_percent);
+    }
+
+    const size_t windows = samples.size() / (window * axes);
+    const size_t setup_count = sizeof(setups) / sizeof(setups[0]);
+    const int idle_ix = setups[0].config.idle_label_ix;
+
+    std::vector<int> reference_top(windows);
+    uint64_t reference_us = 0;
+    uint32_t reference_idle = 0;
+    ei_impulse_handle_t reference(ei_default_impulse.impulse);
+    ei_impulse_result_t result;
+
+    for (size_t wx = 0; wx < windows; wx++) {
+        if (!run_window(&reference, &samples[wx * window * axes], &result, &reference_us)) {
+            return 1;
+        }
+        reference_top[wx] = top_class(&result);
+        reference_idle += (reference_top[wx] == idle_ix);
+    }
+
+    printf("%u windows of %u samples, %u classified as %s without the gate\n\n",
+           (unsigned)windows, (unsigned)window, (unsigned)reference_idle,
+           ei_default_impulse.impulse->categories[idle_ix]);
+    printf("%-16s %10s %8s %8s %8s %10s %10s\n",
+           "gate", "us/window", "ran", "idle", "stable", "disagree", "missed");
+    printf("%-16s %10.1f %8u %8s %8s %10s %10s\n",
+           "none", (double)reference_us / windows, (unsigned)windows, "-", "-", "-", "-");
+
+    for (size_t sx = 0; sx < setup_count; sx++) {
+        ei_impulse_handle_t handle(ei_default_impulse.impulse);
+        replay_stats_t stats = { 0 };
+
+        if (ei_set_impulse_gate(&handle, &setups[sx].config) != EI_IMPULSE_OK) {
+            return 1;
+        }
+
+        for (size_t wx = 0; wx < windows; wx++) {
+            if (!run_window(&handle, &samples[wx * window * axes], &result, &stats.time_us)) {
+                return 1;
+            }
+
+            switch (result.gate.decision) {
+                case EI_GATE_SKIPPED_LOW_ENERGY: stats.skipped_idle++; break;
+                case EI_GATE_SKIPPED_STABLE: stats.skipped_stable++; break;
+                default: stats.ran++; break;
+            }
+
+            int top = top_class(&result);
+            if (top != reference_top[wx]) {
+                stats.disagree++;
+                if (top == idle_ix) {
+                    stats.missed_active++;
+                }
+            }
+        }
+
+        printf("%-16s %10.1f %8u %8u %8u %9.2f%% %9.2f%%\n",
+               setups[sx].name,
+               (double)stats.time_us / windows,
+               (unsigned)stats.ran,
+               (unsigned)stats.skipped_idle,
+               (unsigned)stats.skipped_stable,
+               100.0 * stats.disagree / windows,
+               100.0 * stats.missed_active / windows);
+
+        ei_set_impulse_gate(&handle, nullptr);
+    }
+
+    printf("\ndisagree: top class differs from the ungated run, missed: ... and the gate reported idle\n");
+
+    return 0;
+}
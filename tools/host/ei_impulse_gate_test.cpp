@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Checks the impulse gate on windows of a known energy (an axis alternating
+ * between -a and a has energy a):
+ * - the learned threshold goes down when the idle windows get quieter, so a
+ *   window that would have been skipped before runs again
+ * - windows skipped as idle don't raise the learned threshold
+ * - once the gate is disabled (the firmware does that when a session ends),
+ *   run_classifier runs the full impulse on idle windows
+ * - run_classifier_batch (static data) bypasses an enabled gate and reports
+ *   each window's own result
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if EI_CLASSIFIER_GATE_ENABLED != 1
+#error "Build with -DEI_CLASSIFIER_GATE_ENABLED=1"
+#endif
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static const size_t axes = EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
+static const size_t window = EI_CLASSIFIER_RAW_SAMPLE_COUNT;
+
+static int failures = 0;
+static float samples[window * axes];
+
+// learned threshold only, no stable skips, no forced runs
+static const ei_impulse_gate_config_t gate_config = { 0.0f, 1.5f, 0.8f, 0, 0, 0.1f, 0 };
+
+/**
+ * @brief      Gate one window of the given energy, a run is fed back as idle
+ *
+ * @return     the gate decision
+ */
+static uint8_t gate_window(ei_impulse_handle_t *handle, float energy, float *threshold)
+{
+    signal_t signal;
+    ei_impulse_result_classification_t classification[EI_CLASSIFIER_LABEL_COUNT];
+    ei_impulse_result_t result = {};
+
+    for (size_t ix = 0; ix < window; ix++) {
+        for (size_t ax = 0; ax < axes; ax++) {
+            samples[ix * axes + ax] = (ax == 0) ? ((ix & 1) ? energy : -energy) : 1.0f;
+        }
+    }
+    numpy::signal_from_buffer(samples, window * axes, &signal);
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    result.classification = classification;
+#endif
+    (void)classification;
+
+    if (!ei_gate_check(handle, &signal, &result)) {
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            result.classification[ix].value = (ix == gate_config.idle_label_ix) ? 1.0f : 0.0f;
+        }
+        ei_gate_update(handle, &result);
+    }
+    if (threshold) {
+        *threshold = result.gate.threshold;
+    }
+
+    return result.gate.decision;
+}
+
+static void test_threshold_decays(void)
+{
+    ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    float threshold = 0.0f;
+
+    CHECK(ei_set_impulse_gate(&handle, &gate_config) == EI_IMPULSE_OK);
+    for (int ix = 0; ix < 100; ix++) {
+        gate_window(&handle, 1.0f, nullptr);
+    }
+    CHECK(gate_window(&handle, 0.6f, &threshold) == EI_GATE_SKIPPED_LOW_ENERGY);
+    CHECK(fabsf(threshold - 1.5f) < 0.01f);
+
+    // the sensor got quieter
+    for (int ix = 0; ix < 500; ix++) {
+        CHECK(gate_window(&handle, 0.2f, nullptr) == EI_GATE_SKIPPED_LOW_ENERGY);
+    }
+    CHECK(gate_window(&handle, 0.6f, &threshold) == EI_GATE_RAN);
+    CHECK(threshold < 0.5f);
+
+    ei_set_impulse_gate(&handle, nullptr);
+}
+
+static void test_threshold_no_ratchet(void)
+{
+    ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    float threshold = 0.0f;
+
+    CHECK(ei_set_impulse_gate(&handle, &gate_config) == EI_IMPULSE_OK);
+    for (int ix = 0; ix < 100; ix++) {
+        gate_window(&handle, 1.0f, nullptr);
+    }
+
+    // just below the threshold: skipped, but must not push it up
+    for (int ix = 0; ix < 500; ix++) {
+        CHECK(gate_window(&handle, 1.45f, nullptr) == EI_GATE_SKIPPED_LOW_ENERGY);
+    }
+    CHECK(gate_window(&handle, 1.6f, &threshold) == EI_GATE_RAN);
+    CHECK(threshold <= 1.5f + 1e-4f);
+
+    ei_set_impulse_gate(&handle, nullptr);
+}
+
+static void test_disabled(void)
+{
+    ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    signal_t signal;
+    ei_impulse_result_t result = {};
+
+    CHECK(ei_set_impulse_gate(&handle, &gate_config) == EI_IMPULSE_OK);
+    for (int ix = 0; ix < 100; ix++) {
+        gate_window(&handle, 1.0f, nullptr);
+    }
+    CHECK(gate_window(&handle, 0.1f, nullptr) == EI_GATE_SKIPPED_LOW_ENERGY);
+
+    CHECK(ei_set_impulse_gate(&handle, nullptr) == EI_IMPULSE_OK);
+    numpy::signal_from_buffer(samples, window * axes, &signal);
+    CHECK(run_classifier(&handle, &signal, &result, false) == EI_IMPULSE_OK);
+    CHECK(result.gate.decision == EI_GATE_RAN);
+}
+
+typedef struct {
+    size_t count;
+    float scores[2][EI_CLASSIFIER_LABEL_COUNT];
+    uint8_t decisions[2];
+} batch_record_t;
+
+static void batch_result(size_t window_ix, ei_impulse_result_t *result, void *user_data)
+{
+    batch_record_t *record = (batch_record_t *)user_data;
+
+    if (window_ix < 2) {
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            record->scores[window_ix][ix] = result->classification[ix].value;
+        }
+        record->decisions[window_ix] = result->gate.decision;
+    }
+    record->count++;
+}
+
+static void test_batch_bypass(void)
+{
+    ei_impulse_handle_t handle(ei_default_impulse.impulse);
+    static float windows[2][window * axes];
+    signal_t signals[2];
+    batch_record_t record = {};
+    size_t classified = 0;
+
+    CHECK(ei_set_impulse_gate(&handle, &gate_config) == EI_IMPULSE_OK);
+    for (int ix = 0; ix < 100; ix++) {
+        gate_window(&handle, 1.0f, nullptr);
+    }
+
+    // an idle window, then a moving one
+    for (size_t ix = 0; ix < window * axes; ix++) {
+        windows[0][ix] = (ix % axes == 2) ? 9.81f : 0.0f;
+        windows[1][ix] = 15.0f * sinf(0.5f * ix);
+    }
+    numpy::signal_from_buffer(windows[0], window * axes, &signals[0]);
+    numpy::signal_from_buffer(windows[1], window * axes, &signals[1]);
+
+    CHECK(run_classifier_batch(&handle, signals, 2, batch_result, &record, false, &classified) == EI_IMPULSE_OK);
+    CHECK(classified == 2 && record.count == 2);
+    CHECK(record.decisions[0] == EI_GATE_RAN && record.decisions[1] == EI_GATE_RAN);
+    CHECK(memcmp(record.scores[0], record.scores[1], sizeof(record.scores[0])) != 0);
+    // still enabled afterwards
+    CHECK(handle.gate_config == &gate_config);
+
+    ei_set_impulse_gate(&handle, nullptr);
+}
+
+int main(void)
+{
+    test_threshold_decays();
+    test_threshold_no_ratchet();
+    test_disabled();
+    test_batch_bypass();
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
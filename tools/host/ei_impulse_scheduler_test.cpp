@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Runs two impulses through EiImpulseScheduler on one synthetic accelerometer
+ * stream. The tree ships a single generated model, so the second model is a
+ * separate handle (own state, hop and priority) of the same impulse.
+ * Every scheduled result is compared with run_classifier() on a copy of the window.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "src/inference/ei_impulse_scheduler.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static const size_t axes = EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
+static const size_t window = EI_CLASSIFIER_RAW_SAMPLE_COUNT;
+static const size_t ring_frames = ei_scheduler_ring_frames(2 * window);
+static const size_t hop_a = window / 4;
+static const size_t hop_b = window / 2;
+static const size_t stream_frames = 6 * window;
+
+static int failures = 0;
+static float ring[ring_frames * axes];
+static float stream[stream_frames * axes];
+static ei_impulse_handle_t second_impulse(ei_default_impulse.impulse);
+
+typedef struct {
+    int model_id;
+    float scores[EI_CLASSIFIER_LABEL_COUNT];
+} run_record_t;
+
+static run_record_t runs[256];
+static size_t run_count = 0;
+
+static EI_IMPULSE_ERROR scheduler_run(ei_impulse_handle_t *handle, signal_t *signal,
+                                      ei_impulse_result_t *result, bool debug)
+{
+    return run_classifier(handle, signal, result, debug);
+}
+
+static void record_result(int model_id, ei_impulse_handle_t *handle, ei_impulse_result_t *result)
+{
+    if (run_count < sizeof(runs) / sizeof(runs[0])) {
+        runs[run_count].model_id = model_id;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            runs[run_count].scores[ix] = result->classification[ix].value;
+        }
+    }
+    run_count++;
+}
+
+/**
+ * Idle and moving sections, so the windows don't all classify the same
+ */
+static void make_stream(void)
+{
+    for (size_t ix = 0; ix < stream_frames; ix++) {
+        float amplitude = ((ix / window) % 2) ? 12.0f : 0.3f;
+        for (size_t ax = 0; ax < axes; ax++) {
+            stream[ix * axes + ax] = amplitude * sinf(0.35f * ix + ax) + (ax == 2 ? 9.81f : 0.0f);
+        }
+    }
+}
+
+static bool reference_scores(size_t window_end, float *scores)
+{
+    signal_t signal;
+    ei_impulse_result_t result = { 0 };
+
+    numpy::signal_from_buffer(&stream[(window_end - window) * axes], window * axes, &signal);
+    if (run_classifier(&signal, &result, false) != EI_IMPULSE_OK) {
+        return false;
+    }
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        scores[ix] = result.classification[ix].value;
+    }
+    return true;
+}
+
+static void test_register(void)
+{
+    static float small_ring[64 * axes];
+    EiImpulseScheduler too_small(scheduler_run, small_ring, 64, axes, EI_CLASSIFIER_INTERVAL_MS);
+    EiImpulseScheduler not_pow2(scheduler_run, ring, ring_frames - 1, axes, EI_CLASSIFIER_INTERVAL_MS);
+    EiImpulseScheduler wrong_axes(scheduler_run, ring, ring_frames / 2, axes + 1, EI_CLASSIFIER_INTERVAL_MS);
+    EiImpulseScheduler scheduler(scheduler_run, ring, ring_frames, axes, EI_CLASSIFIER_INTERVAL_MS);
+
+    CHECK(too_small.register_model(&ei_default_impulse, hop_a, 0, 0, nullptr) < 0);
+    CHECK(not_pow2.register_model(&ei_default_impulse, hop_a, 0, 0, nullptr) < 0);
+    CHECK(wrong_axes.register_model(&ei_default_impulse, hop_a, 0, 0, nullptr) < 0);
+    CHECK(scheduler.register_model(&ei_default_impulse, 0, 0, 0, nullptr) < 0);
+    CHECK(scheduler.register_model(&ei_default_impulse, hop_a, 0, 0, nullptr) == 0);
+    CHECK(scheduler.push_frame(stream, axes + 1) == false);
+}
+
+/**
+ * Drained after every frame: all windows run, in window order per model,
+ * and give the same result as the impulse on a copy of the window
+ */
+static void test_two_models(void)
+{
+    EiImpulseScheduler scheduler(scheduler_run, ring, ring_frames, axes, EI_CLASSIFIER_INTERVAL_MS);
+
+    CHECK(scheduler.register_model(&ei_default_impulse, hop_a, 1, 0, record_result) == 0);
+    CHECK(scheduler.register_model(&second_impulse, hop_b, 0, 0, record_result) == 1);
+
+    run_count = 0;
+    size_t next_end[2] = { window, window };
+    const size_t hops[2] = { hop_a, hop_b };
+    size_t expected_runs[2] = { 0, 0 };
+
+    for (size_t ix = 0; ix < stream_frames; ix++) {
+        CHECK(scheduler.push_frame(&stream[ix * axes], axes));
+
+        size_t first = run_count;
+        while (scheduler.run_next());
+
+        for (int model = 0; model < 2; model++) {
+            if (ix + 1 == next_end[model]) {
+                expected_runs[model]++;
+                next_end[model] += hops[model];
+            }
+        }
+
+        // both due on the same frame: the higher priority (second) model goes first
+        if (run_count - first == 2) {
+            CHECK(runs[first].model_id == 1 && runs[first + 1].model_id == 0);
+        }
+
+        for (size_t rx = first; rx < run_count && rx < sizeof(runs) / sizeof(runs[0]); rx++) {
+            float scores[EI_CLASSIFIER_LABEL_COUNT];
+            CHECK(reference_scores(ix + 1, scores));
+            CHECK(memcmp(scores, runs[rx].scores, sizeof(scores)) == 0);
+        }
+    }
+
+    CHECK(scheduler.get_stats(0)->runs == expected_runs[0]);
+    CHECK(scheduler.get_stats(1)->runs == expected_runs[1]);
+    CHECK(scheduler.get_stats(0)->overruns == 0);
+    CHECK(scheduler.get_stats(1)->overruns == 0);
+    CHECK(run_count == expected_runs[0] + expected_runs[1]);
+
+    scheduler.print_stats();
+}
+
+/**
+ * Not drained while the producer laps the ring: stale windows are counted as
+ * overruns and skipped, the newest complete window still runs
+ */
+static void test_overrun(void)
+{
+    EiImpulseScheduler scheduler(scheduler_run, ring, ring_frames, axes, EI_CLASSIFIER_INTERVAL_MS);
+
+    CHECK(scheduler.register_model(&ei_default_impulse, hop_a, 0, 0, record_result) == 0);
+
+    run_count = 0;
+    for (size_t ix = 0; ix < stream_frames; ix++) {
+        scheduler.push_frame(&stream[ix * axes], axes);
+    }
+    while (scheduler.run_next());
+
+    const ei_scheduler_model_stats_t *stats = scheduler.get_stats(0);
+    CHECK(stats->overruns > 0);
+    CHECK(stats->runs > 0);
+    CHECK(stats->runs + stats->overruns == (stream_frames - window) / hop_a + 1);
+    CHECK(scheduler.has_pending() == false);
+
+    scheduler.reset();
+    CHECK(scheduler.get_stats(0)->runs == 0);
+    CHECK(scheduler.has_pending() == false);
+}
+
+int main(void)
+{
+    make_stream();
+
+    test_register();
+    test_two_models();
+    test_overrun();
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Compares BinnedNonMaxSuppression (what ei_run_nms uses) with the priority
+ * queue NonMaxSuppression it replaced, on synthetic clustered detections like
+ * a dense detector outputs:
+ * - selections on random sets, class agnostic and per class (against one
+ *   NonMaxSuppression run per class), must be identical
+ * - time per call for 100 to 10000 boxes
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "model-parameters/model_metadata.h"
+// the NMS code is only built for object detection models, the tree ships an accelerometer model
+#undef EI_HAS_YOLOV5
+#define EI_HAS_YOLOV5 1
+#include "edge-impulse-sdk/classifier/ei_nms.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+
+static const int equivalence_sets = 2000;
+static const float image_size = 640.0f;
+
+static std::mt19937 rng(3);
+
+typedef struct {
+    std::vector<float> boxes;   // [y1, x1, y2, x2]
+    std::vector<float> scores;
+    std::vector<int> classes;
+} detections_t;
+
+/**
+ * Boxes clustered around n / 20 objects, some with flipped corners
+ */
+static void make_detections(int count, int class_count, float image, detections_t *d)
+{
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    const int objects = std::max(1, count / 20);
+    std::vector<float> cx(objects), cy(objects), size(objects);
+
+    d->boxes.resize(4 * count);
+    d->scores.resize(count);
+    d->classes.resize(count);
+
+    for (int o = 0; o < objects; o++) {
+        cx[o] = uniform(rng) * image;
+        cy[o] = uniform(rng) * image;
+        size[o] = 4 + uniform(rng) * image / 8;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const int o = rng() % objects;
+        const float w = size[o] * (0.7f + 0.6f * uniform(rng));
+        const float h = size[o] * (0.7f + 0.6f * uniform(rng));
+        const float x = cx[o] + (uniform(rng) - 0.5f) * size[o] * 0.6f;
+        const float y = cy[o] + (uniform(rng) - 0.5f) * size[o] * 0.6f;
+
+        d->boxes[4 * i + 0] = y - h / 2;
+        d->boxes[4 * i + 1] = x - w / 2;
+        d->boxes[4 * i + 2] = y + h / 2;
+        d->boxes[4 * i + 3] = x + w / 2;
+        if (rng() % 2) {
+            std::swap(d->boxes[4 * i + 0], d->boxes[4 * i + 2]);
+        }
+        d->scores[i] = uniform(rng);
+        d->classes[i] = rng() % class_count;
+    }
+}
+
+/**
+ * The old per class flow: one NonMaxSuppression per class on that class's boxes
+ */
+static std::set<int> reference_per_class(const detections_t &d, int class_count, float iou, float threshold)
+{
+    std::set<int> selected;
+
+    for (int c = 0; c < class_count; c++) {
+        std::vector<float> boxes, scores;
+        std::vector<int> map;
+
+        for (size_t i = 0; i < d.scores.size(); i++) {
+            if (d.classes[i] == c) {
+                boxes.insert(boxes.end(), &d.boxes[4 * i], &d.boxes[4 * i + 4]);
+                scores.push_back(d.scores[i]);
+                map.push_back(i);
+            }
+        }
+
+        std::vector<int> indices(scores.size() + 1);
+        std::vector<float> kept_scores(scores.size() + 1);
+        int kept = 0;
+        NonMaxSuppression(boxes.data(), scores.size(), scores.data(), scores.size(), iou, threshold, 0.0f,
+                          indices.data(), kept_scores.data(), &kept);
+        for (int k = 0; k < kept; k++) {
+            selected.insert(map[indices[k]]);
+        }
+    }
+
+    return selected;
+}
+
+static int check_equivalence(void)
+{
+    std::vector<int> order, next, cell_head(EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE);
+    std::vector<int> indices_a, indices_b;
+    std::vector<float> scores_a, scores_b;
+    int mismatches = 0;
+
+    for (int it = 0; it < equivalence_sets; it++) {
+        const int count = 1 + rng() % 600;
+        const int class_count = 1 + rng() % 4;
+        const bool per_class = it % 2;
+        const float iou = (rng() % 10) / 10.0f;
+        const float threshold = (rng() % 5) / 10.0f;
+        // the per class reference doesn't limit the total output
+        const int max_output = (!per_class && rng() % 3 == 0) ? 1 + rng() % 20 : count;
+        detections_t d;
+
+        make_detections(count, class_count, 50 + rng() % 500, &d);
+        order.resize(count);
+        next.resize(count);
+        indices_a.resize(count);
+        indices_b.resize(count);
+        scores_a.resize(count);
+        scores_b.resize(count);
+
+        std::set<int> expected;
+        if (per_class) {
+            expected = reference_per_class(d, class_count, iou, threshold);
+        }
+        else {
+            int kept = 0;
+            NonMaxSuppression(d.boxes.data(), count, d.scores.data(), max_output, iou, threshold, 0.0f,
+                              indices_a.data(), scores_a.data(), &kept);
+            expected.insert(indices_a.begin(), indices_a.begin() + kept);
+        }
+
+        int kept = 0;
+        BinnedNonMaxSuppression(d.boxes.data(), count, d.scores.data(), per_class ? d.classes.data() : nullptr,
+                                max_output, iou, threshold, order.data(), next.data(), cell_head.data(),
+                                indices_b.data(), scores_b.data(), &kept);
+        std::set<int> actual(indices_b.begin(), indices_b.begin() + kept);
+
+        if (actual != expected) {
+            if (mismatches < 5) {
+                printf("FAIL set %d: %d boxes, iou %.1f, %s: %u vs %u selected\n", it, count, iou,
+                       per_class ? "per class" : "class agnostic",
+                       (unsigned)expected.size(), (unsigned)actual.size());
+            }
+            mismatches++;
+        }
+    }
+
+    printf("%d random sets, %d mismatches\n\n", equivalence_sets, mismatches);
+
+    return mismatches;
+}
+
+static void benchmark(void)
+{
+    std::vector<int> order, next, cell_head(EI_NMS_GRID_SIZE * EI_NMS_GRID_SIZE);
+    std::vector<int> indices_a, indices_b;
+    std::vector<float> scores_a, scores_b;
+
+    printf("%8s %8s %14s %14s %8s\n", "boxes", "kept", "reference us", "binned us", "speedup");
+
+    for (int count : { 100, 300, 1000, 3000, 10000 }) {
+        detections_t d;
+        make_detections(count, 1, image_size, &d);
+        order.resize(count);
+        next.resize(count);
+        indices_a.resize(count);
+        indices_b.resize(count);
+        scores_a.resize(count);
+        scores_b.resize(count);
+
+        const int reps = std::max(3, 20000 / count);
+        int kept_a = 0, kept_b = 0;
+
+        // warm up caches and the allocator
+        NonMaxSuppression(d.boxes.data(), count, d.scores.data(), count, 0.5f, 0.25f, 0.0f,
+                          indices_a.data(), scores_a.data(), &kept_a);
+        BinnedNonMaxSuppression(d.boxes.data(), count, d.scores.data(), nullptr, count, 0.5f, 0.25f,
+                                order.data(), next.data(), cell_head.data(),
+                                indices_b.data(), scores_b.data(), &kept_b);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            NonMaxSuppression(d.boxes.data(), count, d.scores.data(), count, 0.5f, 0.25f, 0.0f,
+                              indices_a.data(), scores_a.data(), &kept_a);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            BinnedNonMaxSuppression(d.boxes.data(), count, d.scores.data(), nullptr, count, 0.5f, 0.25f,
+                                    order.data(), next.data(), cell_head.data(),
+                                    indices_b.data(), scores_b.data(), &kept_b);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        const double reference_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / reps;
+        const double binned_us = std::chrono::duration<double, std::micro>(t2 - t1).count() / reps;
+
+        printf("%8d %8d %14.1f %14.1f %7.1fx%s\n", count, kept_b, reference_us, binned_us,
+               reference_us / binned_us, kept_a == kept_b ? "" : " (kept differs!)");
+    }
+}
+
+int main(void)
+{
+    int mismatches = check_equivalence();
+
+    benchmark();
+    ei_nms_free_scratch();
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Fuzzes and times the remote management decoder on messages encoded with the
+ * vendored QCBOR:
+ * - a corpus of the server messages decodes to the expected results
+ * - strings are cut at REMOTE_MGMT_MAX_STRING_LEN
+ * - random mutations of the corpus: decode_message() and decode_message_in_place()
+ *   agree, and the in-place strings are slices of the input
+ * - time per message of both
+ *
+ *   ei_remote_mgmt_bench [mutations]
+ *
+ * For a sanitizer run, pass the flags in the environment (the Makefile adds to them):
+ *
+ *   CFLAGS=-fsanitize=address,undefined CXXFLAGS=-fsanitize=address,undefined \
+ *       make BUILD=build-asan build-asan/ei_remote_mgmt_bench
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "firmware-sdk/ei_device_info_lib.h"
+#include "firmware-sdk/remote-mgmt.h"
+#include "QCBOR/inc/qcbor.h"
+#include "ei_sampler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+typedef std::vector<uint8_t> message_t;
+
+static int failures = 0;
+static std::mt19937 rng(1234);
+
+static EiDeviceRAM<4096, 4> ram(2 * 4096);
+
+class TestDevice : public EiDeviceInfo {
+public:
+    TestDevice()
+    {
+        memory = &ram;
+    }
+
+    void init_device_id(void) override {}
+};
+
+static TestDevice device;
+
+EiDeviceInfo *EiDeviceInfo::get_device(void)
+{
+    return &device;
+}
+
+bool ei_sampler_start_sampling(void *v_ptr_payload, starter_callback ei_sample_start, uint32_t sample_size)
+{
+    return false;
+}
+
+static message_t encode(std::function<void(QCBOREncodeContext *)> add_items)
+{
+    static uint8_t buffer[1024];
+    QCBOREncodeContext ec;
+    UsefulBufC encoded;
+
+    QCBOREncode_Init(&ec, (UsefulBuf){ buffer, sizeof(buffer) });
+    add_items(&ec);
+    if (QCBOREncode_Finish(&ec, &encoded)) {
+        return message_t();
+    }
+
+    return message_t((const uint8_t *)encoded.ptr, (const uint8_t *)encoded.ptr + encoded.len);
+}
+
+static void make_corpus(std::vector<message_t> &corpus, const std::string &long_string)
+{
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_AddBoolToMap(e, "hello", true);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_AddBoolToMap(e, "hello", false);
+        QCBOREncode_AddSZStringToMap(e, "err", "Invalid API key");
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_AddSZStringToMap(e, "err", "Device not found");
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_AddBoolToMap(e, "startSnapshot", true);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_AddBoolToMap(e, "stopSnapshot", true);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_OpenMapInMap(e, "sample");
+        QCBOREncode_AddSZStringToMap(e, "path", "/api/training/data");
+        QCBOREncode_AddSZStringToMap(e, "label", "idle");
+        QCBOREncode_AddSZStringToMap(e, "hmacKey", "0123456789abcdef");
+        QCBOREncode_AddInt64ToMap(e, "interval", 10);
+        QCBOREncode_AddInt64ToMap(e, "length", 2000);
+        QCBOREncode_AddSZStringToMap(e, "sensor", "Accelerometer");
+        QCBOREncode_CloseMap(e);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_OpenMapInMap(e, "sample");
+        QCBOREncode_AddDoubleToMap(e, "interval", 16.5);
+        QCBOREncode_AddSZStringToMap(e, "labels", "x");
+        QCBOREncode_CloseMap(e);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([&long_string](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_OpenMapInMap(e, "sample");
+        QCBOREncode_AddSZStringToMap(e, "label", long_string.c_str());
+        QCBOREncode_AddSZStringToMap(e, "sensor", long_string.c_str());
+        QCBOREncode_CloseMap(e);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_AddInt64ToMap(e, "sample", 3);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_AddBoolToMap(e, "unknown", false);
+        QCBOREncode_CloseMap(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenArray(e);
+        QCBOREncode_CloseArray(e);
+    }));
+    corpus.push_back(encode([](QCBOREncodeContext *e) {
+        QCBOREncode_OpenMap(e);
+        QCBOREncode_CloseMap(e);
+    }));
+}
+
+static std::string to_string(UsefulBufC str)
+{
+    return str.ptr ? std::string((const char *)str.ptr, str.len) : std::string();
+}
+
+static bool in_message(UsefulBufC str, const message_t &m)
+{
+    return str.ptr == nullptr
+        || (str.len <= REMOTE_MGMT_MAX_STRING_LEN
+            && (const uint8_t *)str.ptr >= m.data()
+            && (const uint8_t *)str.ptr + str.len <= m.data() + m.size());
+}
+
+/**
+ * Both decoders on one message: same type and strings, in-place strings in the input
+ */
+static bool decoders_agree(const message_t &m)
+{
+    remote_mgmt_message_t msg;
+    MessageType type = decode_message_in_place((UsefulBufC){ m.data(), m.size() }, &msg, &device);
+    std::unique_ptr<DecodedMessage> decoded = decode_message(m.data(), m.size(), &device);
+
+    if (decoded->getType() != type || msg.type != type) {
+        return false;
+    }
+
+    switch (type) {
+        case MessageType::HelloResponseType: {
+            HelloResponse *r = (HelloResponse *)decoded.get();
+            return r->status == msg.hello_response.status
+                && r->err_message == to_string(msg.hello_response.err_message)
+                && in_message(msg.hello_response.err_message, m);
+        }
+        case MessageType::ErrorResponseType: {
+            ErrorResponse *r = (ErrorResponse *)decoded.get();
+            return r->err_message == to_string(msg.error_response.err_message)
+                && in_message(msg.error_response.err_message, m);
+        }
+        case MessageType::SampleRequestType: {
+            SampleRequest *r = (SampleRequest *)decoded.get();
+            return r->sensor == to_string(msg.sample_request.sensor)
+                && in_message(msg.sample_request.sensor, m);
+        }
+        case MessageType::StreamingStartRequestType:
+            return ((StreamingStartRequest *)decoded.get())->status == msg.streaming_start_request.status;
+        case MessageType::StreamingStopRequestType:
+            return ((StreamingStopRequest *)decoded.get())->status == msg.streaming_stop_request.status;
+        default: {
+            DecoderError *r = (DecoderError *)decoded.get();
+            // the messages are literals or slices of the input
+            return r->err_code == msg.decoder_error.err_code
+                && r->err_message == to_string(msg.decoder_error.err_message)
+                && msg.decoder_error.err_message.len <= REMOTE_MGMT_MAX_STRING_LEN;
+        }
+    }
+}
+
+static void test_corpus(const std::vector<message_t> &corpus, const std::string &long_string)
+{
+    remote_mgmt_message_t msg;
+
+    for (const message_t &m : corpus) {
+        CHECK(m.size() > 0);
+        CHECK(decoders_agree(m));
+    }
+
+    CHECK(decode_message_in_place((UsefulBufC){ corpus[0].data(), corpus[0].size() }, &msg, &device)
+          == MessageType::HelloResponseType);
+    CHECK(msg.hello_response.status);
+
+    CHECK(decode_message_in_place((UsefulBufC){ corpus[1].data(), corpus[1].size() }, &msg, &device)
+          == MessageType::HelloResponseType);
+    CHECK(!msg.hello_response.status && to_string(msg.hello_response.err_message) == "Invalid API key");
+
+    CHECK(decode_message_in_place((UsefulBufC){ corpus[5].data(), corpus[5].size() }, &msg, &device)
+          == MessageType::SampleRequestType);
+    CHECK(to_string(msg.sample_request.sensor) == "Accelerometer");
+    CHECK(device.get_upload_path() == "/api/training/data");
+    CHECK(device.get_sample_label() == "idle");
+    CHECK(device.get_sample_interval_ms() == 10.0f);
+    CHECK(device.get_sample_length_ms() == 2000);
+
+    // unknown field in a sample request
+    CHECK(decode_message_in_place((UsefulBufC){ corpus[6].data(), corpus[6].size() }, &msg, &device)
+          == MessageType::DecoderErrorType);
+    CHECK(msg.decoder_error.err_code == ERR_UNKNOWN_FIELD && to_string(msg.decoder_error.err_message) == "labels");
+
+    // long strings are cut
+    CHECK(decode_message_in_place((UsefulBufC){ corpus[7].data(), corpus[7].size() }, &msg, &device)
+          == MessageType::SampleRequestType);
+    CHECK(to_string(msg.sample_request.sensor) == long_string.substr(0, REMOTE_MGMT_MAX_STRING_LEN));
+    CHECK(device.get_sample_label() == long_string.substr(0, REMOTE_MGMT_MAX_STRING_LEN));
+}
+
+static void test_mutations(const std::vector<message_t> &corpus, int mutations)
+{
+    int mismatches = 0;
+
+    for (int ix = 0; ix < mutations; ix++) {
+        message_t m = corpus[rng() % corpus.size()];
+        const int edits = 1 + rng() % 4;
+
+        for (int ex = 0; ex < edits; ex++) {
+            switch (rng() % 3) {
+                case 0:
+                    if (!m.empty()) {
+                        m[rng() % m.size()] = (uint8_t)rng();
+                    }
+                    break;
+                case 1:
+                    if (!m.empty()) {
+                        m.resize(rng() % m.size());
+                    }
+                    break;
+                default:
+                    m.insert(m.begin() + (m.empty() ? 0 : rng() % m.size()), (uint8_t)rng());
+                    break;
+            }
+        }
+
+        // exact size, so reads past the end show up under ASan
+        message_t exact(m);
+        if (!decoders_agree(exact)) {
+            mismatches++;
+        }
+    }
+
+    printf("%d mutated messages, %d mismatches\n", mutations, mismatches);
+    CHECK(mismatches == 0);
+}
+
+static void benchmark(const std::vector<message_t> &corpus)
+{
+    const int count = 200000;
+    // the server messages, not the error cases
+    const size_t messages = 6;
+    size_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int ix = 0; ix < count; ix++) {
+        const message_t &m = corpus[ix % messages];
+        sink += (size_t)decode_message(m.data(), m.size(), &device)->getType();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int ix = 0; ix < count; ix++) {
+        const message_t &m = corpus[ix % messages];
+        remote_mgmt_message_t msg;
+        sink += (size_t)decode_message_in_place((UsefulBufC){ m.data(), m.size() }, &msg, &device);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    printf("decode_message: %.1f ns/message, decode_message_in_place: %.1f ns/message (%u)\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / count,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / count,
+           (unsigned)(sink & 0xff));
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<message_t> corpus;
+    const std::string long_string(300, 'x');
+    const int mutations = (argc > 1) ? atoi(argv[1]) : 200000;
+
+    make_corpus(corpus, long_string);
+
+    test_corpus(corpus, long_string);
+    test_mutations(corpus, mutations);
+    benchmark(corpus);
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+/**
+ * Feeds results to EiReportPolicy the way the inference thread does:
+ * - a mode set while in ALL (where results don't go through update()) is
+ *   in use from the next result on, and resets the state
+ * - ONCHANGE, THRESHOLD (with hysteresis) and SUMMARY decisions
+ * - invalid configs are rejected and leave the config as it was
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "inference/ei_report_policy.h"
+#include "model-parameters/model_metadata.h"
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static const uint16_t labels = EI_CLASSIFIER_LABEL_COUNT;
+
+static int failures = 0;
+static ei_impulse_result_classification_t classification[EI_CLASSIFIER_LABEL_COUNT];
+static ei_impulse_result_t result;
+
+/**
+ * @brief      Result with value for class top, the rest shared by the other classes
+ */
+static const ei_impulse_result_t *make_result(uint16_t top, float value)
+{
+    for (uint16_t ix = 0; ix < labels; ix++) {
+        result.classification[ix].value = (ix == top) ? value : (1.0f - value) / (labels - 1);
+    }
+    return &result;
+}
+
+static bool set_mode(EiReportPolicy &policy, ei_report_mode_t mode, float threshold, float hysteresis, uint16_t windows)
+{
+    ei_report_config_t config = { mode, threshold, hysteresis, windows };
+    return policy.configure(&config);
+}
+
+static void test_mode_change_in_all(void)
+{
+    EiReportPolicy policy;
+
+    // continuous ALL: results are printed without update()
+    CHECK(policy.get_mode() == EI_REPORT_ALL);
+    CHECK(!policy.apply_pending_config());
+
+    CHECK(set_mode(policy, EI_REPORT_ON_CHANGE, 0.6f, 0.1f, 100));
+    // nothing applied until the inference thread looks
+    CHECK(policy.get_mode() == EI_REPORT_ALL);
+
+    // what handle_result does before it picks the path for the next result
+    CHECK(policy.apply_pending_config());
+    CHECK(policy.get_mode() == EI_REPORT_ON_CHANGE);
+    CHECK(!policy.apply_pending_config());
+    CHECK(policy.update(make_result(1, 0.9f), labels) == EI_REPORT_RESULT);
+    CHECK(policy.update(make_result(1, 0.9f), labels) == EI_REPORT_SKIP);
+
+    // and back to ALL, every result again
+    CHECK(set_mode(policy, EI_REPORT_ALL, 0.6f, 0.1f, 100));
+    CHECK(policy.apply_pending_config());
+    CHECK(policy.get_mode() == EI_REPORT_ALL);
+    CHECK(policy.update(make_result(1, 0.9f), labels) == EI_REPORT_RESULT);
+
+    // a new config resets the state: the same top class is reported again
+    CHECK(set_mode(policy, EI_REPORT_ON_CHANGE, 0.6f, 0.1f, 100));
+    CHECK(policy.update(make_result(1, 0.9f), labels) == EI_REPORT_RESULT);
+    CHECK(policy.get_mode() == EI_REPORT_ON_CHANGE);
+}
+
+static void test_on_change(void)
+{
+    EiReportPolicy policy;
+
+    CHECK(set_mode(policy, EI_REPORT_ON_CHANGE, 0.6f, 0.1f, 100));
+    CHECK(policy.update(make_result(0, 0.7f), labels) == EI_REPORT_RESULT);
+    CHECK(policy.get_top_class() == 0);
+    // within the hysteresis the top class stays
+    CHECK(policy.update(make_result(0, 0.55f), labels) == EI_REPORT_SKIP);
+    CHECK(policy.update(make_result(0, 0.4f), labels) == EI_REPORT_RESULT);
+    CHECK(policy.get_top_class() == EI_REPORT_UNCERTAIN);
+    CHECK(policy.update(make_result(2, 0.8f), labels) == EI_REPORT_RESULT);
+    CHECK(policy.get_top_class() == 2);
+}
+
+static void test_threshold(void)
+{
+    EiReportPolicy policy;
+
+    CHECK(set_mode(policy, EI_REPORT_THRESHOLD, 0.6f, 0.1f, 100));
+    CHECK(policy.update(make_result(1, 0.5f), labels) == EI_REPORT_SKIP);
+    CHECK(policy.update(make_result(1, 0.6f), labels) == EI_REPORT_EVENT);
+    CHECK(policy.get_changed_mask() == 0x2 && policy.get_active_mask() == 0x2);
+    CHECK(policy.update(make_result(1, 0.55f), labels) == EI_REPORT_SKIP);
+    CHECK(policy.update(make_result(1, 0.45f), labels) == EI_REPORT_EVENT);
+    CHECK(policy.get_changed_mask() == 0x2 && policy.get_active_mask() == 0);
+}
+
+static void test_summary(void)
+{
+    EiReportPolicy policy;
+
+    CHECK(set_mode(policy, EI_REPORT_SUMMARY, 0.6f, 0.1f, 3));
+    CHECK(policy.update(make_result(0, 0.9f), labels) == EI_REPORT_SKIP);
+    CHECK(policy.update(make_result(0, 0.9f), labels) == EI_REPORT_SKIP);
+    CHECK(policy.update(make_result(3, 0.3f), labels) == EI_REPORT_SUMMARY_READY);
+    CHECK(policy.get_window_count() == 3);
+    CHECK(policy.get_histogram()[0] == 2 && policy.get_histogram()[labels] == 1);
+    // the next window starts a new summary
+    CHECK(policy.update(make_result(0, 0.9f), labels) == EI_REPORT_SKIP);
+    CHECK(policy.get_window_count() == 1);
+}
+
+static void test_invalid(void)
+{
+    EiReportPolicy policy;
+    ei_report_config_t config;
+
+    CHECK(!set_mode(policy, EI_REPORT_THRESHOLD, 1.5f, 0.1f, 100));
+    CHECK(!set_mode(policy, EI_REPORT_THRESHOLD, -0.1f, 0.0f, 100));
+    CHECK(!set_mode(policy, EI_REPORT_THRESHOLD, 0.5f, 0.6f, 100));
+    CHECK(!set_mode(policy, EI_REPORT_SUMMARY, 0.5f, 0.1f, 0));
+    CHECK(!policy.apply_pending_config());
+
+    policy.get_config(&config);
+    CHECK(config.mode == EI_REPORT_ALL && config.summary_windows == 100);
+}
+
+int main(void)
+{
+#if EI_IMPULSE_RESULT_CLASSIFICATION_IS_STATICALLY_ALLOCATED == 0
+    result.classification = classification;
+#endif
+    (void)classification;
+
+    test_mode_change_in_all();
+    test_on_change();
+    test_threshold();
+    test_summary();
+    test_invalid();
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
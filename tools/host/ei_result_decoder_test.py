@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 EdgeImpulse Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an "AS
+# IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+# express or implied. See the License for the specific language
+# governing permissions and limitations under the License.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Round trip of the result stream: ei_result_stream_test writes a capture with
+# the firmware encoders, tools/ei_result_decoder.py decodes it (fed in odd sized
+# chunks) and has to give the values the encoder was given, as int8 or float16.
+#
+# Usage: ei_result_decoder_test.py <build directory>
+
+import math
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, '..'))
+
+from ei_result_decoder import ResultDecoder, format_result, load_formats  # noqa: E402
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print('FAIL %s' % what)
+        failures += 1
+
+
+def f16(value):
+    try:
+        return struct.unpack('<e', struct.pack('<e', value))[0]
+    except OverflowError:
+        return math.copysign(math.inf, value)
+
+
+def int8(value):
+    q = math.floor(abs(value) * 127 + 0.5) * (1 if value >= 0 else -1)
+    return max(-128, min(127, q)) / 127.0
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp:
+        subprocess.run([os.path.join(sys.argv[1], 'ei_result_stream_test'), tmp], check=True,
+                       stdout=subprocess.DEVNULL)
+        with open(os.path.join(tmp, 'capture.bin'), 'rb') as f:
+            data = f.read()
+        with open(os.path.join(tmp, 'expected.txt')) as f:
+            expected = f.read().splitlines()
+
+    decoder = ResultDecoder(load_formats([HERE]))
+    decoded = []
+    for ix in range(0, len(data), 7):
+        decoded.extend(decoder.feed(data[ix:ix + 7]))
+
+    check(len(decoded) == len(expected), '%d decoded, %d expected' % (len(decoded), len(expected)))
+    for got, line in zip(decoded, expected):
+        kind, fields = line.split(' ', 1)
+        if kind == 'L':
+            sequence, text = fields.split(' ', 1)
+            check('log' in got and got['sequence'] == int(sequence) and got['log'] == text + '\n',
+                  'log record %s: %r' % (sequence, got.get('log')))
+            continue
+
+        fields = fields.split()
+        check('scores' in got and got['sequence'] == int(fields[0]) and got['timestamp_ms'] == int(fields[1]),
+              'frame %s' % fields[0])
+        if 'scores' not in got:
+            continue
+        quantize = f16 if int(fields[2]) == 2 else int8
+        scores = [float(v) for v in fields[3:] if not v.startswith('a')]
+        anomaly = [float(v[1:]) for v in fields[3:] if v.startswith('a')]
+        check(got['scores'] == [quantize(v) for v in scores], 'scores of frame %s' % fields[0])
+        check(got.get('anomaly') == (f16(anomaly[0]) if anomaly else None), 'anomaly of frame %s' % fields[0])
+        format_result(got, None)
+
+    check(decoder.crc_errors == 1, 'CRC errors: %d' % decoder.crc_errors)
+    # the corrupted frame and the lost one
+    check(decoder.lost == 2, 'lost frames: %d' % decoder.lost)
+    check(decoder.lost_logs == 0, 'lost log records: %d' % decoder.lost_logs)
+
+    print('FAILED' if failures else 'OK')
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
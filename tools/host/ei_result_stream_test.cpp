@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2024 EdgeImpulse Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS
+ * IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language
+ * governing permissions and limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Encodes result frames and log records:
+ * - AT+RESULTFORMAT names map to formats, unknown names are rejected
+ * - the frame layout, the float16 rounding and the CRC (against a bitwise zlib
+ *   CRC32) are checked here
+ * - with an output directory, a capture (frames, log records, text, a corrupted
+ *   and a lost frame) and the expected values are written there, for
+ *   ei_result_decoder_test.py to decode with tools/ei_result_decoder.py
+ */
+
+/* Include ----------------------------------------------------------------- */
+#define EI_LOG_RECORDS_ENABLED 1
+#include "firmware-sdk/ei_result_stream.h"
+#include "firmware-sdk/ei_log_stream.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static const int frame_count = 300;
+
+static int failures = 0;
+static ei_impulse_t impulse;
+static FILE *capture = nullptr;
+static uint16_t log_sequence = 0;
+
+void ei_log_record_send(uint32_t format_id, const uint32_t *args, uint8_t arg_count)
+{
+    uint8_t record[EI_LOG_RECORD_MAX_SIZE];
+    size_t record_len = ei_log_record_encode(record, sizeof(record), format_id, args, arg_count,
+                                             log_sequence++, 1000);
+
+    CHECK(record_len == EI_LOG_RECORD_HEADER_SIZE + 8 + 4 * arg_count + EI_LOG_RECORD_CRC_SIZE);
+    if (capture) {
+        fwrite(record, 1, record_len, capture);
+    }
+}
+
+static uint32_t reference_crc32(const uint8_t *data, size_t length)
+{
+    uint32_t crc = 0xffffffff;
+
+    for (size_t ix = 0; ix < length; ix++) {
+        crc ^= data[ix];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief float16 of the first score, as encoded
+ */
+static uint16_t encode_half(float value)
+{
+    uint8_t frame[EI_RESULT_FRAME_MAX_SIZE(EI_CLASSIFIER_LABEL_COUNT)];
+    ei_impulse_result_t result;
+
+    memset(&result, 0, sizeof(result));
+    result.classification[0].value = value;
+    ei_result_frame_encode(frame, sizeof(frame), &impulse, &result, EI_RESULT_FORMAT_BINARY_F16, 0, 0);
+
+    return get_u16(&frame[EI_RESULT_FRAME_HEADER_SIZE + 21]);
+}
+
+static void test_half(void)
+{
+    CHECK(encode_half(0.0f) == 0x0000);
+    CHECK(encode_half(-0.0f) == 0x8000);
+    CHECK(encode_half(0.5f) == 0x3800);
+    CHECK(encode_half(1.0f) == 0x3c00);
+    CHECK(encode_half(-2.0f) == 0xc000);
+    CHECK(encode_half(65504.0f) == 0x7bff);
+    // halfway between 65504 and inf, rounded to even
+    CHECK(encode_half(65520.0f) == 0x7c00);
+    CHECK(encode_half(1e10f) == 0x7c00);
+    // smallest subnormal, and halfway below it (rounded to even: 0)
+    CHECK(encode_half(5.9604645e-8f) == 0x0001);
+    CHECK(encode_half(2.9802322e-8f) == 0x0000);
+    // 1 + 2^-11 is halfway, to even (1.0), 1 + 3 * 2^-11 to even (1 + 2^-9)
+    CHECK(encode_half(1.00048828125f) == 0x3c00);
+    CHECK(encode_half(1.00146484375f) == 0x3c02);
+}
+
+static void test_layout(void)
+{
+    uint8_t frame[EI_RESULT_FRAME_MAX_SIZE(EI_CLASSIFIER_LABEL_COUNT)];
+    ei_impulse_result_t result;
+
+    memset(&result, 0, sizeof(result));
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        result.classification[ix].value = ix == 0 ? 2.0f : -0.5f;
+    }
+    result.anomaly = 1.0f;
+    result.timing.dsp_us = 1234;
+    result.timing.classification_us = 5000000000LL;
+    result.timing.anomaly_us = -3;
+    result.gate.decision = EI_GATE_SKIPPED_STABLE;
+    impulse.has_anomaly = true;
+
+    size_t frame_len = ei_result_frame_encode(frame, sizeof(frame), &impulse, &result,
+                                              EI_RESULT_FORMAT_BINARY_INT8, 0x1234, 0xdeadbeef);
+    const size_t payload_len = 21 + EI_CLASSIFIER_LABEL_COUNT + 2;
+
+    CHECK(frame_len == EI_RESULT_FRAME_HEADER_SIZE + payload_len + EI_RESULT_FRAME_CRC_SIZE);
+    CHECK(frame[0] == EI_RESULT_FRAME_SYNC_0 && frame[1] == EI_RESULT_FRAME_SYNC_1);
+    CHECK(frame[2] == EI_RESULT_FRAME_VERSION);
+    CHECK(frame[3] == (EI_RESULT_FLAG_ANOMALY | EI_RESULT_FLAG_SKIPPED));
+    CHECK(get_u16(&frame[4]) == 0x1234);
+    CHECK(get_u16(&frame[6]) == payload_len);
+    CHECK(get_u32(&frame[8]) == 0xdeadbeef);
+    CHECK(get_u32(&frame[12]) == 1234);
+    // timings saturate
+    CHECK(get_u32(&frame[16]) == UINT32_MAX);
+    CHECK(get_u32(&frame[24]) == 0);
+    CHECK(frame[28] == EI_CLASSIFIER_LABEL_COUNT);
+    // int8 scores saturate, -0.5 * 127 rounds away from 0
+    CHECK((int8_t)frame[29] == 127);
+    CHECK((int8_t)frame[30] == -64);
+    CHECK(get_u16(&frame[29 + EI_CLASSIFIER_LABEL_COUNT]) == 0x3c00);
+    CHECK(get_u32(&frame[frame_len - 4]) == reference_crc32(frame, frame_len - 4));
+
+    // too small
+    CHECK(ei_result_frame_encode(frame, frame_len - 1, &impulse, &result,
+                                 EI_RESULT_FORMAT_BINARY_INT8, 0, 0) == 0);
+    impulse.has_anomaly = false;
+}
+
+static void test_log_record(void)
+{
+    uint8_t record[EI_LOG_RECORD_MAX_SIZE];
+    const uint32_t args[] = { 1, 0xffffffff };
+
+    size_t record_len = ei_log_record_encode(record, sizeof(record), 0xcafef00d, args, 2, 7, 99);
+
+    CHECK(record_len == EI_LOG_RECORD_HEADER_SIZE + 16 + EI_LOG_RECORD_CRC_SIZE);
+    CHECK(record[0] == EI_LOG_RECORD_SYNC_0 && record[1] == EI_LOG_RECORD_SYNC_1);
+    CHECK(record[2] == EI_LOG_RECORD_VERSION && record[3] == 2);
+    CHECK(get_u16(&record[4]) == 7 && get_u16(&record[6]) == 16);
+    CHECK(get_u32(&record[8]) == 0xcafef00d && get_u32(&record[12]) == 99);
+    CHECK(get_u32(&record[16]) == 1 && get_u32(&record[20]) == 0xffffffff);
+    CHECK(get_u32(&record[record_len - 4]) == reference_crc32(record, record_len - 4));
+
+    CHECK(ei_log_record_encode(record, sizeof(record), 0, args, EI_LOG_RECORD_MAX_ARGS + 1, 0, 0) == 0);
+    CHECK(ei_log_record_encode(record, record_len - 1, 0, args, 2, 0, 0) == 0);
+
+    // FNV-1a test vectors
+    CHECK(ei_log_format_id("") == 0x811c9dc5);
+    CHECK(ei_log_format_id("a") == 0xe40c292c);
+    CHECK(ei_log_format_id("foobar") == 0xbf9cf968);
+}
+
+/**
+ * Frames in both formats, the sequence number wraps, every 4th is followed by
+ * text and every 5th by a log record. Expected: one line per decoded frame or
+ * record, "R <sequence> <timestamp> <format> <scores> [a<anomaly>]" or
+ * "L <sequence> <text>".
+ */
+static void write_capture(const std::string &dir)
+{
+    uint8_t frame[EI_RESULT_FRAME_MAX_SIZE(EI_CLASSIFIER_LABEL_COUNT)];
+    FILE *expected = fopen((dir + "/expected.txt").c_str(), "w");
+
+    capture = fopen((dir + "/capture.bin").c_str(), "wb");
+    CHECK(capture != nullptr && expected != nullptr);
+    if (!capture || !expected) {
+        return;
+    }
+
+    log_sequence = 0;
+    for (int ix = 0; ix < frame_count; ix++) {
+        ei_impulse_result_t result;
+        const ei_result_format_t format = (ix % 3 == 0) ? EI_RESULT_FORMAT_BINARY_INT8 : EI_RESULT_FORMAT_BINARY_F16;
+        const uint16_t sequence = (uint16_t)(65500 + ix);
+
+        memset(&result, 0, sizeof(result));
+        impulse.has_anomaly = ix & 1;
+        for (size_t lx = 0; lx < EI_CLASSIFIER_LABEL_COUNT; lx++) {
+            result.classification[lx].value = (float)((ix * 7 + lx * 13) % 100) / 99.0f;
+        }
+        if (ix == 5) {
+            result.classification[0].value = 6.0e-8f;
+        }
+        if (ix == 6) {
+            result.classification[0].value = 70000.0f;
+        }
+        result.anomaly = -1.5f + ix * 0.01f;
+
+        size_t frame_len = ei_result_frame_encode(frame, sizeof(frame), &impulse, &result, format,
+                                                  sequence, 1234 + ix);
+        if (ix == 10) {
+            // corrupted, dropped by the CRC
+            frame[12] ^= 1;
+        }
+        if (ix != 20) {
+            // 20 is lost
+            fwrite(frame, 1, frame_len, capture);
+        }
+        if (ix % 4 == 0) {
+            fprintf(capture, "Starting inferencing in 2 seconds...\n");
+        }
+
+        if (ix != 10 && ix != 20) {
+            fprintf(expected, "R %u %d %d", sequence, 1234 + ix, (int)format);
+            for (size_t lx = 0; lx < EI_CLASSIFIER_LABEL_COUNT; lx++) {
+                fprintf(expected, " %.9g", result.classification[lx].value);
+            }
+            if (impulse.has_anomaly) {
+                fprintf(expected, " a%.9g", result.anomaly);
+            }
+            fprintf(expected, "\n");
+        }
+
+        if (ix % 5 == 0) {
+            fprintf(expected, "L %u ERR: Failed to run impulse (%d)\n", log_sequence, -ix);
+            EI_LOG_RECORD("ERR: Failed to run impulse (%d)\n", -ix);
+            fprintf(expected, "L %u Skipped (idle), energy: %f\n", log_sequence, ix / 8.0f);
+            EI_LOG_RECORD("Skipped (idle), energy: %f\n", ix / 8.0f);
+        }
+    }
+
+    fprintf(expected, "L %u Starting inferencing in 2 seconds...\n", log_sequence);
+    EI_LOG_RECORD("Starting inferencing in 2 seconds...\n");
+
+    fclose(capture);
+    fclose(expected);
+    capture = nullptr;
+}
+
+static void test_format_names(void)
+{
+    ei_result_format_t format = EI_RESULT_FORMAT_TEXT;
+
+    CHECK(ei_result_format_from_name("BIN16", &format) && format == EI_RESULT_FORMAT_BINARY_F16);
+    CHECK(ei_result_format_from_name("BIN8", &format) && format == EI_RESULT_FORMAT_BINARY_INT8);
+    CHECK(strcmp(ei_result_format_name(format), "BIN8") == 0);
+
+    // AT+RESULTFORMAT fails on these, the format stays as it was
+    const char *invalid[] = { "", "bin8", "BIN", "BIN32", "TEXT " };
+    for (const char *name : invalid) {
+        CHECK(!ei_result_format_from_name(name, &format));
+        CHECK(format == EI_RESULT_FORMAT_BINARY_INT8);
+    }
+    CHECK(ei_result_format_from_name("TEXT", &format) && format == EI_RESULT_FORMAT_TEXT);
+}
+
+int main(int argc, char **argv)
+{
+    memset(&impulse, 0, sizeof(impulse));
+    impulse.label_count = EI_CLASSIFIER_LABEL_COUNT;
+
+    test_half();
+    test_layout();
+    test_log_record();
+    test_format_names();
+    if (argc > 1) {
+        write_capture(argv[1]);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}